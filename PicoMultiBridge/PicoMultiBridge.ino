@@ -10,15 +10,32 @@
   remark:
     CPU Speed -> 150MHz
     USB Stack -> Pico SDK
+    Flash Size -> any, settings are journalled in the FS if it has 8KB or more, else in the free flash below it
+    Core 0 -> console and network, Core 1 -> UART (connected by lock-free rings)
 
   SPDX-License-Identifier: MIT
   SPDX-FileCopyrightText: (C) 2024-2026 mukyokyo
 */
 
+#include <CoreMutex.h>
 #include <tusb.h>
+#include "capture.hpp"
 #include "led.hpp"
+#include "linecoding.hpp"
 #include "net.hpp"
+#include "lsrmst.hpp"
+#include "modbus.hpp"
 #include "nvm.hpp"
+#include "packer.hpp"
+#include "perf.hpp"
+#include "pusr.hpp"
+#include "rawtcp.hpp"
+#include "rfc2217.hpp"
+#include "seqlock.hpp"
+#include "session.hpp"
+#include "spsc.hpp"
+#include "udp.hpp"
+#include "us_pio.h"
 #include "us.h"
 #include "us_dma.h"
 
@@ -31,6 +48,8 @@ template< typename typ, std::size_t size > size_t GetNumOfElems(const typ (&arra
 
 #define _TX 4
 #define _RX 5
+#define _CTS 6
+#define _RTS 7
 
 #if PICO_RP2040
 #define _MAX_BAUDRATE 3000000
@@ -38,15 +57,12 @@ template< typename typ, std::size_t size > size_t GetNumOfElems(const typ (&arra
 #define _MAX_BAUDRATE 9000000
 #endif
 #define _MIN_BAUDRATE 300
+#define _MAX_PORT 65533  // port 0's report and capture are on the two ports after it
 
 CSysNVM nvm;
 CNet Net;
 CLED led;
-CUartDMA uart1dma;
 
-const char *databits_s = "5678";
-const char *parity_s = "NOEMS";
-const char *stopbit_s = "122";
 
 const TNetInfo default_netinfo = {
   key: { '0', '0' },            // nvm reserved
@@ -60,21 +76,156 @@ const TNetInfo default_netinfo = {
 
   0,       // Method for including baudrate and configuration in serial data from a PC
   115200,  // boottime baudrate
-  "8N1"    // boottime config
+  "8N1",   // boottime config
+
+  0,  // Client allowed to write to UART
+  0,  // Handling of clients that cannot keep up
+
+  0,  // Packing length
+  0,  // Packing idle time in characters
+  -1, // Packing delimiter
+
+  0,                       // Transport
+  IPAddress(0, 0, 0, 0),   // UDP destination
+  0,                       // UDP destination port
+  0,                       // UDP sequence number header
+
+  0,  // Flow control
+
+  0,       // Second UART
+  2300,    // Second UART's client connection port
+  0,       // Second UART's TX pin
+  1,       // Second UART's RX pin
+  0,       // Second UART's serial protocol
+  115200,  // Second UART's boottime baudrate
+  "8N1",   // Second UART's boottime config
+
+  {
+    { 0, 2301, 2, 3, 0, 115200 },    // PIO UART 1: off, port, TX pin, RX pin, serial protocol, baudrate
+    { 0, 2302, 10, 11, 0, 115200 },  // PIO UART 2
+  },
+
+  { 0 },  // No AP remembered yet
+
+  0,  // Backlog while no client is connected
+  0,  // Replay all of it
 };
 
 TNetInfo netinfo;
+// Set by core 0 once netinfo and the bridges are ready for core 1
+std::atomic<bool> setup_done(false);
+// Set by core 1 once it has started the UARTs, a port whose UART failed is off by then
+std::atomic<bool> setup1_done(false);
 
-// For detecting parameter updates by the CDC
-uint32_t cdc_baud, cdc_prevbaud;
-String cdc_config, cdc_prevconfig;
+// For detecting parameter updates by the CDC, set by the USB task on core 0
+std::atomic<uint32_t> cdc_baud(0);
+std::atomic<CLineCoding> cdc_coding;
+uint32_t cdc_prevbaud;
+CLineCoding cdc_prevcoding;
 
-// Parameter update via WiFi
-uint32_t current_baud;
-String current_serconfig;
+// One UART <-> network bridge.
+// Port 0 is UART1 on fixed pins and may use UDP, port 1 is UART0, ports 2 and 3 are PIO UARTs.
+// All but port 0 always use TCP.
+#define _NUM_PORTS 4
+#define _NUM_PIO_PORTS 2
+#define _PORT_QUANTUM 512  // bytes moved per direction before the other port gets its turn
+#define _CORE1_TICK_US 100 // longest core 1 sleeps while received bytes wait in an RX ring
+#define _CDC_IDLE_CHARS 2  // silence on the UART, in characters, before a short USB packet goes
+#define _BACKLOG_RESERVE (64 * 1024)  // heap left to WiFi and lwIP when the backlogs are sized
+#define _BACKLOG_MIN 4096
+
+// Line settings of a port as core 1 last applied them, read by core 0 through a seqlock
+typedef struct {
+  uint32_t baud;          // requested
+  uint32_t actual_baud;
+  CLineCoding coding;
+  TUartReconf reconf;
+  bool flowctrl;          // RTS/CTS
+  bool rts_stopped;       // RTS deasserted as the RX ring fills
+} TPortState;
+
+typedef struct {
+  bool enabled;
+  CUartBase *uart;           // one of hwuart or piouart
+  uint16_t port;             // TCP port
+  int8_t rts;                // RTS pin if flow control is configured, -1 if not
+  int8_t cts;                // CTS pin, likewise
+  CPUSRDecoder pusr;
+  CLsrMstDecoder lsrmst;
+  CRfc2217 rfc2217;
+  CModbusGateway modbus;
+  uint8_t encprotocol;
+
+  // Parameter update via WiFi
+  uint32_t current_baud;
+  CLineCoding current_coding;
+  uint32_t prevbaud;
+  bool brk;
+  bool rts_stopped;          // as last published
+  CSeqLock<TPortState> state;  // published by core 1 after every change of the above
+  CSeqLock<TUartRxStats> rxstats;    // the UART's receive counts, taken by core 1 when core 0 asks
+  std::atomic<bool> rxstats_req;
+
+  // Inter-core pipeline
+  CSPSCRing<8192> net2uart, uart2net;
+  CSessions sessions;
+  CPacker packer;
+  WiFiServer *server;        // port 0 uses Net.server
+  CRawTcpBridge *raw;        // port 0 with the raw TCP transport, NULL otherwise
+  bool listening;
+  uint32_t gen;              // core 1's copy of sessions.generation()
+
+  // Instrumentation, each block is written by one core only
+  struct {
+    CPerfCounter uart_rx;        // bytes taken from the UART
+    CPerfCounter uart_tx;        // bytes handed to the UART
+    CPerfCounter rx_peak;        // highest RX ring occupancy seen
+    CPerfCounter uart_write_us;  // time spent writing to the UART
+  } perf1;
+  struct {
+    CLog2Histogram<> latency;    // UART RX to network send in us
+    uint32_t rate_t;
+    uint32_t rx_prev, tx_prev;
+    uint32_t rx_rate, tx_rate;   // bytes/s over the last second
+  } perf0;
+  uint32_t seenpos;
+  CStampQueue<16> rx_seen;    // core 1 only, RX positions DMA has reached and when
+  CStampQueue<64> rx_stamps;  // core 1 -> core 0, uart2net positions and when their data arrived
+  struct {
+    uint32_t gen;             // capture_gen the count is for
+    uint32_t lost;            // bytes of the port capring had no room for, not reported yet
+  } cap;                      // core 1 only
+} TBridgePort;
 
-IPAddress clientip;
-uint16_t clientport;
+TBridgePort bridge[_NUM_PORTS];
+CUartDMA hwuart[2];
+CPioUart piouart[_NUM_PIO_PORTS];
+CUdpBridge udpbridge;
+CRawTcpBridge rawbridge;
+WiFiServer *perfserver = NULL;
+
+// Traffic capture, core 1 puts whole records into capring while capture_gen is not 0.
+// core 0 bumps capture_gen for each new capture client, so that core 1 knows its loss count is stale.
+CSPSCRing<16384> capring;
+std::atomic<uint32_t> capture_gen(0);
+WiFiServer *capserver = NULL;
+WiFiClient capclient;
+
+// Core 1 sleeps in __wfe() whenever a round moved nothing. It is woken by
+// the DMA IRQ (TX done), core 0 after it moved ring data (__sev) and a tick of its own,
+// which bounds how long received bytes wait.
+alarm_pool_t *core1_pool;
+repeating_timer_t core1_tick;
+struct {
+  CPerfCounter wakes;
+  CPerfCounter sleep_us;
+} sched1;  // core 1 only
+struct {
+  uint32_t rate_t;
+  uint32_t wakes_prev, sleep_prev;
+  uint32_t wake_rate;      // wakeups/s over the last second
+  uint32_t sleep_permille; // share of the last second core 1 slept
+} sched0;  // core 0 only
 
 
 // Switching Settings Mode Using the BOOTSEL button
@@ -84,89 +235,91 @@ bool u2s_config = false;
 //---------------------
 // etc
 //---------------------
-// Convert the “8N1” style parameters to the values required by the hardware serial
-uint32_t conv_str2serconfig(const char *s, char *d = NULL) {
-  struct {
-    const char *str;
-    uint16_t param;
-  } const cparam[]{
-    { "5N1", SERIAL_5N1 }, { "6N1", SERIAL_6N1 }, { "7N1", SERIAL_7N1 }, { "8N1", SERIAL_8N1 },
-    { "5N2", SERIAL_5N2 }, { "6N2", SERIAL_6N2 }, { "7N2", SERIAL_7N2 }, { "8N2", SERIAL_8N2 },
-    { "5E1", SERIAL_5E1 }, { "6E1", SERIAL_6E1 }, { "7E1", SERIAL_7E1 }, { "8E1", SERIAL_8E1 },
-    { "5E2", SERIAL_5E2 }, { "6E2", SERIAL_6E2 }, { "7E2", SERIAL_7E2 }, { "8E2", SERIAL_8E2 },
-    { "5O1", SERIAL_5O1 }, { "6O1", SERIAL_6O1 }, { "7O1", SERIAL_7O1 }, { "8O1", SERIAL_8O1 },
-    { "5O2", SERIAL_5O2 }, { "6O2", SERIAL_6O2 }, { "7O2", SERIAL_7O2 }, { "8O2", SERIAL_8O2 },
-
-    { "5M1", SERIAL_5M1 }, { "6M1", SERIAL_6M1 }, { "7M1", SERIAL_7M1 }, { "8M1", SERIAL_8M1 },
-    { "5M2", SERIAL_5M2 }, { "6M2", SERIAL_6M2 }, { "7M2", SERIAL_7M2 }, { "8M2", SERIAL_8M2 },
-    { "5S1", SERIAL_5S1 }, { "6S1", SERIAL_6S1 }, { "7S1", SERIAL_7S1 }, { "8S1", SERIAL_8S1 },
-    { "5S2", SERIAL_5S2 }, { "6S2", SERIAL_6S2 }, { "7S2", SERIAL_7S2 }, { "8S2", SERIAL_8S2 }
-  };
-  for (int i = 0; i < GetNumOfElems(cparam); i++) {
-    if (strcasecmp(s, cparam[i].str) == 0) {
-      if (s != NULL) strcpy(d, cparam[i].str);
-      return cparam[i].param;
-    }
-  }
-  if (d != NULL) strcpy(d, "8N1");
-  return SERIAL_8N1;
+// The packing must agree with the hardware serial's values
+static_assert(CLineCoding(8, CLineCoding::NONE, 1).serial() == SERIAL_8N1, "SERIAL_8N1");
+static_assert(CLineCoding(7, CLineCoding::EVEN, 1).serial() == SERIAL_7E1, "SERIAL_7E1");
+static_assert(CLineCoding(5, CLineCoding::ODD, 2).serial() == SERIAL_5O2, "SERIAL_5O2");
+static_assert(CLineCoding(6, CLineCoding::MARK, 1).serial() == SERIAL_6M1, "SERIAL_6M1");
+static_assert(CLineCoding(8, CLineCoding::SPACE, 2).serial() == SERIAL_8S2, "SERIAL_8S2");
+// A read of LsrMstInsert data goes to the UART in one piece
+static_assert(_PORT_QUANTUM <= CLsrMstDecoder::STAGE_LEN, "_PORT_QUANTUM");
+
+// Convert the “8N1” style parameters of the settings, anything unknown is 8N1.
+// d receives the normalized text if given.
+CLineCoding conv_str2coding(const char *s, char *d = NULL) {
+  CLineCoding c;
+  if (!CLineCoding::parse(s, c)) c = CLineCoding();
+  if (d != NULL) strcpy(d, c.text().s);
+  return c;
 }
 
 //----------------------------------------------------------------
 // Decoding from packets including baudrate and other parameters
 //----------------------------------------------------------------
+void bridge_uart_write(TBridgePort *bp, const uint8_t *p, size_t len);
+
+// Publish the line settings of a port, core 1 only.
+// The Modbus gateway takes its character times from them as well.
+void bridge_publish(TBridgePort *bp) {
+  TPortState s;
+  s.baud = bp->current_baud;
+  s.actual_baud = bp->uart->getActualBaud();
+  s.coding = bp->current_coding;
+  s.reconf = bp->uart->getReconf();
+  s.flowctrl = bp->uart->getFlowControl();
+  s.rts_stopped = bp->rts_stopped = bp->uart->isRtsStopped();
+  bp->state.write(s);
+  bp->modbus.line(s.actual_baud, s.coding.charbits());
+}
+
+// The receive counts belong to core 1, which takes a snapshot whenever core 0 has asked for one
+void bridge_publish_rxstats(TBridgePort *bp) {
+  if (bp->rxstats_req.load(std::memory_order_acquire)) {
+    bp->rxstats.write(bp->uart->getRxStats());
+    bp->rxstats_req.store(false, std::memory_order_release);
+  }
+}
+
+// Core 0: a fresh snapshot, or the last one if core 1 does not answer in time (config mode)
+TUartRxStats bridge_rxstats(TBridgePort *bp) {
+  bp->rxstats_req.store(true, std::memory_order_release);
+  __sev();
+  for (uint32_t t = millis(); bp->rxstats_req.load(std::memory_order_acquire) && millis() - t < 50;) delay(1);
+  return bp->rxstats.read();
+}
+
 // Extracted from USB CDC events
 void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding) {
-  String s = "   ";
   /// p_line_coding->data_bits  < can be 5, 6, 7, 8 or 16
   /// p_line_coding->parity     < 0: None - 1: Odd - 2: Even - 3: Mark - 4: Space
   /// p_line_coding->stop_bits  < 0: 1 stop bit - 1: 1.5 stop bits - 2: 2 stop bits
-  cdc_baud = max(min(p_line_coding->bit_rate, _MAX_BAUDRATE), _MIN_BAUDRATE);
-  s[0] = databits_s[max(min(p_line_coding->data_bits, 8), 5) - 5];
-  s[1] = parity_s[max(min(p_line_coding->parity, 4), 0)];
-  s[2] = stopbit_s[max(min(p_line_coding->stop_bits, 2), 0)];
-  cdc_config = s;
+  cdc_coding.store(CLineCoding::from_cdc(p_line_coding->data_bits, p_line_coding->parity, p_line_coding->stop_bits), std::memory_order_relaxed);
+  cdc_baud.store(max(min(p_line_coding->bit_rate, (uint32_t)_MAX_BAUDRATE), (uint32_t)_MIN_BAUDRATE), std::memory_order_release);
+}
+
+// The format a port will really run, a PIO port refuses anything but 8N1
+CLineCoding bridge_coding(TBridgePort *bp, CLineCoding c) {
+  return bp->uart->canSetFormat() ? c : CLineCoding();
 }
 
 // Extracted from PUSR's proprietary implementation
-bool PUSR_portconfig_check(uint8_t *p) {
+bool PUSR_portconfig_check(TBridgePort *bp, const uint8_t *p) {
   uint32_t baud = 0;
-  uint16_t config = 0;
-  static uint32_t prevbaud = 0;
-  static uint16_t prevconf = 0;
-
-  String s = "   ";
 
   if (p[0] == 0x55) {
     if (p[1] == 0xaa) {
       if (p[2] == 0x55) {
         if ((uint8_t)(p[3] + p[4] + p[5] + p[6]) == p[7]) {
           baud = max(min((p[3] << 16) | (p[4] << 8) | p[5], _MAX_BAUDRATE), _MIN_BAUDRATE);
-          union {
-            struct {
-              uint8_t databits : 2;    // 0:5bit 1:6bit 2:7bit 3:8bit (LSB side)
-              uint8_t stopbits : 1;    // 0:1bit 1:2bit
-              uint8_t parityen : 1;    // 0:di 1:en
-              uint8_t paritytype : 2;  // 0:ODD 1:EVEN 2:MARK 3:SPACE
-            };
-            uint8_t byte;
-          } bitset;
-          bitset.byte = p[6];
-
-          s[0] = databits_s[bitset.databits];
-          s[1] = parity_s[(bitset.parityen == 1) ? bitset.paritytype + 1 : 0];
-          s[2] = stopbit_s[bitset.stopbits];
-          char tmp[10];
-          config = conv_str2serconfig(s.c_str(), tmp);
+          CLineCoding c = bridge_coding(bp, CLineCoding::from_pusr(p[6]));
           // If change requests occur frequently, ignore them if no changes are needed from the current state.
-          if (prevconf != config || prevbaud != baud) {
-            uart1dma.flush();
-            uart1dma.begin(baud, config);
-            Serial.printf("Update UART to %ubps %s\n", uart1dma.getActualBaud(), tmp);
-            current_baud = baud;
-            current_serconfig = s;
-            prevconf = config;
-            prevbaud = baud;
+          if (bp->current_coding != c || bp->prevbaud != baud) {
+            bp->uart->reconfigure(baud, c.serial());
+            Serial.printf("Update UART to %ubps %s\n", bp->uart->getActualBaud(), c.text().s);
+            bp->current_baud = baud;
+            bp->current_coding = c;
+            bp->prevbaud = baud;
+            bridge_publish(bp);
           }
           return true;
         }
@@ -177,143 +330,587 @@ bool PUSR_portconfig_check(uint8_t *p) {
 }
 
 // Extracted from information inserted based on Windows IOCTL
-void LSRMSTINS_portconfig_check(uint8_t *pBuf, int len) {
+void LSRMSTINS_baud_update(TBridgePort *bp, uint32_t b) {
+  uint32_t baud = max(min(b, (uint32_t)_MAX_BAUDRATE), (uint32_t)_MIN_BAUDRATE);
 
-  #define SERIAL_LSRMST_ESCAPE ((uint8_t)0x00)
-  #define SERIAL_LSRMST_LSR_DATA ((uint8_t)0x01)
-  #define SERIAL_LSRMST_LSR_NODATA ((uint8_t)0x02)
-  #define SERIAL_LSRMST_MST ((uint8_t)0x03)
-  #define C0CE_INSERT_RBR ((uint8_t)16)
-  #define C0CE_INSERT_RLC ((uint8_t)17)
+  Serial.printf("BaudRate=%lu\n", baud);
+  if (baud != bp->prevbaud) {
+    bp->uart->reconfigure(baud, bp->current_coding.serial());
+    Serial.printf("Update UART to *%ubps %s\n", bp->uart->getActualBaud(), bp->current_coding.text().s);
+    bp->current_baud = baud;
+    bp->prevbaud = baud;
+    bridge_publish(bp);
+  }
+}
 
-  uint32_t baud = 0;
-  uint32_t config = 0;
-  static uint32_t prevbaud = 0;
-  static uint32_t prevconf = 0;
-  static String s = "   ";
-
-  const char escapeChar = 'a';
-  uint8_t baud_byte[sizeof(uint32_t)];
-  static int state = 0;
-  static uint8_t code = 0;
-  static int subState = 0;
-
-  uint32_t _baudrate;
-  int _byteSize;
-  int _parity;
-  int _stopBits;
-
-  uint8_t mybuf[len];
-  int mylen = 0;
-
-  for (; len; len--) {
-    uint8_t ch = *pBuf++;
-
-    switch (state) {
-      case 0:
-        break;
-      case 1:
-        code = ch;
-        state++;
-      case 2:
-        switch (code) {
-          case SERIAL_LSRMST_ESCAPE:
-            mybuf[mylen++] = escapeChar;
-            state = subState = 0;
-            break;
-          case SERIAL_LSRMST_LSR_DATA:
-            if (subState == 0) subState++;
-            else if (subState == 1) subState++;
-            else if (subState == 2) state = subState = 0;
-            else state = subState = 0;
-            break;
-          case SERIAL_LSRMST_LSR_NODATA:
-            if (subState == 0) subState++;
-            else if (subState == 1) state = subState = 0;
-            else state = subState = 0;
-            break;
-          case SERIAL_LSRMST_MST:
-            if (subState == 0) subState++;
-            else if (subState == 1) state = subState = 0;
-            else state = subState = 0;
-            break;
-          case C0CE_INSERT_RBR:
-            if (subState == 0) {
-              subState++;
-            } else if (subState >= 1 && subState < (int)(sizeof(uint32_t) + 1)) {
-              baud_byte[subState - 1] = ch;
-              if (subState < (int)sizeof(uint32_t)) {
-                subState++;
-              } else {
-                baud = max(min((long)*(uint32_t *)baud_byte, _MAX_BAUDRATE), _MIN_BAUDRATE);
-                Serial.printf("BaudRate=%lu\n", baud);
-                if (baud != prevbaud) {
-                  uart1dma.write(mybuf, mylen);
-                  mylen = 0;
-                  uart1dma.flush();
-                  uart1dma.begin(baud, prevconf);
-                  Serial.printf("Update UART to *%ubps %s\n", uart1dma.getActualBaud(), s.c_str());
-                  current_baud = baud;
-                  prevbaud = baud;
-                }
-                state = subState = 0;
-              }
-            } else
-              state = subState = 0;
-            break;
-          case C0CE_INSERT_RLC:
-            if (subState == 0) {
-              subState++;
-            } else if (subState == 1) {
-              _byteSize = ch & 0xFF;
-              subState++;
-            } else if (subState == 2) {
-              _parity = ch & 0xFF;
-              subState++;
-            } else if (subState == 3) {
-              _stopBits = ch & 0xFF;
-              Serial.printf("ByteSize=%d Parity=%d StopBits=%d\n", _byteSize, _parity, _stopBits);
-              s[0] = databits_s[max(min(_byteSize - 5, 3), 0)];
-              s[1] = parity_s[max(min(_parity, 4), 0)];
-              s[2] = stopbit_s[max(min(_stopBits, 2), 0)];
-              char tmp[10];
-              config = conv_str2serconfig(s.c_str(), tmp);
-              if (config != prevconf) {
-                uart1dma.write(mybuf, mylen);
-                mylen = 0;
-                uart1dma.flush();
-                uart1dma.begin(prevbaud, config);
-                Serial.printf("Update UART to %ubps *%s\n", uart1dma.getActualBaud(), tmp);
-                current_serconfig = s;
-                prevconf = config;
-              }
-              state = subState = 0;
-            } else
-              state = subState = 0;
-            break;
-          default:
-            state = subState = 0;
-            break;
-        }
-        continue;
+void LSRMSTINS_format_update(TBridgePort *bp, int bytesize, int parity, int stopbits) {
+  Serial.printf("ByteSize=%d Parity=%d StopBits=%d\n", bytesize, parity, stopbits);
+  CLineCoding c = bridge_coding(bp, CLineCoding::from_lsrmst(bytesize, parity, stopbits));
+  if (c != bp->current_coding) {
+    bp->uart->reconfigure(bp->current_baud, c.serial());
+    Serial.printf("Update UART to %ubps *%s\n", bp->uart->getActualBaud(), c.text().s);
+    bp->current_coding = c;
+    bridge_publish(bp);
+  }
+}
 
-      default:
-        state = subState = 0;
+// Requested through RFC 2217 (Telnet COM-Port-Control)
+uint32_t RFC2217_baud_update(TBridgePort *bp, uint32_t b) {
+  if (b != 0) {
+    uint32_t baud = max(min(b, (uint32_t)_MAX_BAUDRATE), (uint32_t)_MIN_BAUDRATE);
+    if (baud != bp->current_baud) {
+      bp->uart->reconfigure(baud, bp->current_coding.serial());
+      Serial.printf("Update UART to *%ubps %s\n", bp->uart->getActualBaud(), bp->current_coding.text().s);
+      bp->current_baud = baud;
+      bridge_publish(bp);
     }
-    if (ch == escapeChar) {
-      state = 1;
-      continue;
+  }
+  return bp->current_baud;
+}
+
+uint8_t RFC2217_format_update(TBridgePort *bp, uint8_t cmd, uint8_t v) {
+  CLineCoding c = bp->current_coding;
+
+  // 0 is a query, out of range values are answered with the current setting
+  switch (cmd) {
+    case CRfc2217::SET_DATASIZE:
+      if (v >= 5 && v <= 8) c = c.with_databits(v);
+      break;
+    case CRfc2217::SET_PARITY:
+      if (v >= 1 && v <= 5) c = c.with_parity(CLineCoding::rfc2217_parity(v));
+      break;
+    case CRfc2217::SET_STOPSIZE:
+      if (v >= 1 && v <= 3) c = c.with_stopbits(CLineCoding::rfc2217_stopbits(v));  // 1.5 becomes 2
+      break;
+  }
+  // The reply tells the client what it got
+  c = bridge_coding(bp, c);
+  if (c != bp->current_coding) {
+    bp->uart->reconfigure(bp->current_baud, c.serial());
+    Serial.printf("Update UART to %ubps *%s\n", bp->uart->getActualBaud(), c.text().s);
+    bp->current_coding = c;
+    bridge_publish(bp);
+  }
+  switch (cmd) {
+    case CRfc2217::SET_DATASIZE:
+      return bp->current_coding.databits();
+    case CRfc2217::SET_PARITY:
+      return bp->current_coding.rfc2217_parity();
+    default:
+      return bp->current_coding.rfc2217_stopsize();
+  }
+}
+
+uint8_t RFC2217_control(TBridgePort *bp, uint8_t v) {
+  switch (v) {
+    case 0:  // query flow control
+      return bp->uart->getFlowControl() ? 3 : 1;
+    case 1:  // no flow control
+    case 3:  // hardware
+      if (bp->rts >= 0) {
+        bp->uart->setFlowControl(v == 3, bp->rts);
+        bridge_publish(bp);
+      }
+      return bp->uart->getFlowControl() ? 3 : 1;
+    case 2:  // XON/XOFF is not supported
+      return bp->uart->getFlowControl() ? 3 : 1;
+    case 4:  // query BREAK
+      return bp->brk ? 5 : 6;
+    case 5:  // BREAK ON
+    case 6:  // BREAK OFF
+      bp->brk = (v == 5);
+      bp->uart->setBreak(bp->brk);
+      return v;
+    case 7:  // query DTR
+    case 8:  // DTR ON
+    case 9:  // DTR OFF, not wired so always on
+      return 8;
+    case 10: // query RTS
+    case 11: // RTS ON
+    case 12: // RTS OFF, flow control drives it where the port has it, otherwise not wired and on
+      return (bp->uart->getFlowControl() && bp->uart->isRtsStopped()) ? 12 : 11;
+    case 13: // query inbound flow control
+    case 14: // no inbound flow control
+    case 15: // XON/XOFF inbound
+    case 16: // hardware inbound
+    case 18: // DTR inbound, inbound goes with outbound, which 1 and 3 set
+      return bp->uart->getFlowControl() ? 16 : 14;
+    case 17: // DCD outbound is not supported
+    case 19: // DSR outbound is not supported
+      return bp->uart->getFlowControl() ? 3 : 1;
+    default:
+      return v;
+  }
+}
+
+// CTS is read from its pin (active low) where the port has one. CD and DSR are not wired,
+// and neither is CTS on the other ports, which then never hold anything off, so they read as on.
+uint8_t RFC2217_modemstate(TBridgePort *bp) {
+  bool cts = (bp->cts < 0) || !gpio_get(bp->cts);
+  return 0x80 | 0x20 | (cts ? 0x10 : 0);
+}
+
+uint8_t RFC2217_linestate(uint8_t err) {
+  return ((err & CUartBase::LINE_BREAK) ? CRfc2217::LINE_BREAK : 0) | ((err & CUartBase::LINE_FRAMING) ? CRfc2217::LINE_FRAMING : 0)
+         | ((err & CUartBase::LINE_PARITY) ? CRfc2217::LINE_PARITY : 0)
+         | ((err & (CUartBase::LINE_FIFO_OVERRUN | CUartBase::LINE_RING_OVERRUN)) ? CRfc2217::LINE_OVERRUN : 0);
+}
+
+const TRfc2217Callbacks rfc2217_callbacks = {
+  [](const uint8_t *p, size_t len, void *any) {
+    bridge_uart_write((TBridgePort *)any, p, len);
+  },
+  [](const uint8_t *p, size_t len, void *any) {
+    TBridgePort *bp = (TBridgePort *)any;
+    return bp->uart2net.space() >= len && bp->uart2net.write(p, len) == len;
+  },
+  [](uint32_t baud, void *any) {
+    return RFC2217_baud_update((TBridgePort *)any, baud);
+  },
+  [](uint8_t cmd, uint8_t value, void *any) {
+    return RFC2217_format_update((TBridgePort *)any, cmd, value);
+  },
+  [](uint8_t value, void *any) {
+    return RFC2217_control((TBridgePort *)any, value);
+  },
+  [](uint8_t value, void *any) {
+    // 1 what came from the line, 2 what waits to go out on it, 3 both.
+    // Only what is still in the UART's rings can be taken back.
+    CUartBase *u = ((TBridgePort *)any)->uart;
+    if (value & 1) u->consume(u->available());
+    if (value & 2) u->purgeTx();
+  },
+  [](void *any) {
+    return RFC2217_modemstate((TBridgePort *)any);
+  }
+};
+
+//----------------------------------------------------------------
+// WiFi bridge pipeline
+//   core 0 owns the WiFiClients, core 1 owns the UARTs and the decoders.
+//   net2uart and uart2net of each port are the only data shared between them.
+//----------------------------------------------------------------
+// Listening socket of a port other than 0, follows the WiFi connection
+void bridge_listen(TBridgePort *bp, bool online) {
+  if (bp->server == NULL || online == bp->listening) return;
+  if (online) {
+    bp->server->begin();
+    bp->server->setNoDelay(true);
+  } else
+    bp->server->end();
+  bp->listening = online;
+}
+
+// Network side, runs on core 0
+void bridge_net_poll(bool online) {
+  static int prevclients = -1;
+  static int first = 0;
+
+  if (Net.server == NULL || !setup1_done.load(std::memory_order_acquire)) return;
+  // Alternate which port goes first so that neither always gets the fresher socket buffers
+  first = (first + 1) % _NUM_PORTS;
+  for (int k = 0; k < _NUM_PORTS; k++) {
+    int i = (first + k) % _NUM_PORTS;
+    TBridgePort *bp = &bridge[i];
+    if (!bp->enabled) continue;
+    uint32_t h = bp->net2uart.head_pos(), t = bp->uart2net.tail_pos();
+    TPortState st = bp->state.read();
+    uint32_t limit = bp->packer.update(&bp->uart2net, micros(), st.actual_baud, st.coding.charbits());
+    if (i == 0 && netinfo.transport == 1) {
+      udpbridge.poll(online, limit);
+    } else if (bp->raw != NULL) {
+      bp->raw->poll(online, limit);
+    } else if (i == 0) {
+      bp->sessions.poll(Net.server, limit);
+    } else {
+      bridge_listen(bp, online);
+      if (bp->listening) bp->sessions.poll(bp->server, limit);
+      else bp->sessions.hold();
+    }
+    // Whatever has left uart2net has been sent
+    bp->rx_stamps.drain(bp->uart2net.tail_pos(), time_us_32(), bp->perf0.latency);
+    // New data for the UART or room for more from it, core 1 may be waiting for either
+    if (h != bp->net2uart.head_pos() || t != bp->uart2net.tail_pos()) __sev();
+  }
+
+  if (netinfo.transport != 1) {
+    int n = 0;
+    for (int i = 0; i < _NUM_PORTS; i++) n += (bridge[i].raw != NULL) ? bridge[i].raw->clients() : bridge[i].sessions.clients();
+    if (n != prevclients) {
+      led.set_pattern((n > 0) ? -1 : 0);
+      prevclients = n;
     }
-    mybuf[mylen++] = ch;
+    if (n == 0 && Net.server->status() != 0) led.set_pattern(6);
   }
-  uart1dma.write(mybuf, mylen);
+}
+
+//----------------------------------------------------------------
+// Instrumentation, runs on core 0
+//----------------------------------------------------------------
+void perf_rate(void) {
+  uint32_t ms = millis();
+  if (ms - sched0.rate_t >= 1000) {
+    uint32_t w = sched1.wakes.get(), sl = sched1.sleep_us.get();
+    sched0.wake_rate = (uint64_t)(w - sched0.wakes_prev) * 1000 / (ms - sched0.rate_t);
+    sched0.sleep_permille = min((uint64_t)(sl - sched0.sleep_prev) / (ms - sched0.rate_t), (uint64_t)1000);
+    sched0.wakes_prev = w;
+    sched0.sleep_prev = sl;
+    sched0.rate_t = ms;
+  }
+  for (int i = 0; i < _NUM_PORTS; i++) {
+    TBridgePort *bp = &bridge[i];
+    if (ms - bp->perf0.rate_t >= 1000) {
+      uint32_t rx = bp->perf1.uart_rx.get(), tx = bp->perf1.uart_tx.get();
+      bp->perf0.rx_rate = (uint64_t)(rx - bp->perf0.rx_prev) * 1000 / (ms - bp->perf0.rate_t);
+      bp->perf0.tx_rate = (uint64_t)(tx - bp->perf0.tx_prev) * 1000 / (ms - bp->perf0.rate_t);
+      bp->perf0.rx_prev = rx;
+      bp->perf0.tx_prev = tx;
+      bp->perf0.rate_t = ms;
+    }
+  }
+}
+
+void perf_print(Print &out, TBridgePort *bp) {
+  out.printf(" UART->net %lu bytes/s, net->UART %lu bytes/s\n", bp->perf0.rx_rate, bp->perf0.tx_rate);
+  out.printf(" UART RX ring peak %lu of %u bytes\n", bp->perf1.rx_peak.get(), bp->uart->getRxBufferSize());
+  out.printf(" time spent writing UART %lums, network %lums\n", bp->perf1.uart_write_us.get() / 1000,
+             (bp->sessions.write_time() + ((bp == &bridge[0]) ? udpbridge.write_time() + rawbridge.write_time() : 0)) / 1000);
+  uint32_t n = bp->perf0.latency.total();
+  out.printf(" UART RX to network latency, %lu samples, p50 <%luus, p99 <%luus\n", n, bp->perf0.latency.percentile(500), bp->perf0.latency.percentile(990));
+  for (size_t i = 0; n > 0 && i < bp->perf0.latency.size(); i++)
+    if (bp->perf0.latency.count(i) > 0) out.printf("  <%9luus %lu\n", CLog2Histogram<>::upper(i), bp->perf0.latency.count(i));
+}
+
+// Side channel on port+1, every connection gets one report and is closed
+void perf_serve(bool online) {
+  static bool listening = false;
+
+  if (perfserver == NULL) return;
+  if (online != listening) {
+    if (online) perfserver->begin();
+    else perfserver->end();
+    listening = online;
+  }
+  if (listening) {
+    WiFiClient c = perfserver->accept();
+    if (c) {
+      c.printf("Core 1 asleep %lu.%lu%%, %lu wakeups/s\n", sched0.sleep_permille / 10, sched0.sleep_permille % 10, sched0.wake_rate);
+      for (int i = 0; i < _NUM_PORTS; i++) {
+        if (!bridge[i].enabled) continue;
+        c.printf("Port %d on %d\n", i, bridge[i].port);
+        perf_print(c, &bridge[i]);
+      }
+      c.flush();
+      c.stop();
+    }
+  }
+}
+
+// Traffic capture on port+2, one client at a time and a new one takes over
+void capture_serve(bool online) {
+  static bool listening = false;
+  static uint32_t gen = 0;
+  TRingSpan s1, s2;
+
+  if (capserver == NULL) return;
+  if (online != listening) {
+    if (online) capserver->begin();
+    else capserver->end();
+    listening = online;
+  }
+  if (listening) {
+    WiFiClient c = capserver->accept();
+    if (c) {
+      capture_gen.store(0, std::memory_order_release);
+      capclient.stop();
+      capclient = c;
+      capclient.setNoDelay(true);
+      capring.clear();
+      uint8_t p[CCapture::PREAMBLE_LEN];
+      CCapture::preamble(p);
+      capclient.write(p, sizeof(p));
+      if (++gen == 0) gen = 1;
+      capture_gen.store(gen, std::memory_order_release);
+    }
+  }
+  if (capture_gen.load(std::memory_order_relaxed) == 0) return;
+  if (!listening || !capclient.connected()) {
+    capture_gen.store(0, std::memory_order_release);
+    capclient.stop();
+    capring.clear();
+  } else if (capring.peek(s1, s2) > 0) {
+    // Never more than the socket takes, the bridge must not wait for the capture
+    size_t room = max(capclient.availableForWrite(), 0);
+    size_t l = capclient.write(s1.ptr, min(room, s1.len));
+    if (l == s1.len && s2.len > 0 && room > l) l += capclient.write(s2.ptr, min(room - l, s2.len));
+    capring.consume(l);
+  }
+}
+
+// UART side, runs on core 1
+// A run of bytes as one record, committed at once. While the stream has fallen behind runs are only counted,
+// per port, and the count goes out as a record of that port ahead of its next run.
+void capture_run(uint32_t gen, uint8_t type, TBridgePort *bp, uint8_t flags, const uint8_t *p1, size_t l1, const uint8_t *p2 = NULL, size_t l2 = 0) {
+  uint32_t &lost = bp->cap.lost;
+  TRingSpan s1, s2;
+  TCaptureRecord r;
+  uint8_t h[CCapture::HEADER_LEN + 4];
+  size_t o = 0;
+  auto put = [&](const uint8_t *p, size_t n) {
+    if (o < s1.len) {
+      size_t a = min(n, s1.len - o);
+      memcpy(s1.ptr + o, p, a);
+      p += a;
+      n -= a;
+      o += a;
+    }
+    if (n > 0) {
+      memcpy(s2.ptr + (o - s1.len), p, n);
+      o += n;
+    }
+  };
+
+  if (gen != bp->cap.gen) {
+    bp->cap.gen = gen;
+    lost = 0;
+  }
+  size_t need = CCapture::HEADER_LEN + l1 + l2 + ((lost > 0) ? CCapture::HEADER_LEN + 4 : 0);
+  if (capring.reserve(s1, s2) < need) {
+    lost += l1 + l2;
+    return;
+  }
+  r.port = bp - bridge;
+  r.time = time_us_64();
+  if (lost > 0) {
+    r.type = CCapture::LOST;
+    r.flags = 0;
+    r.len = 4;
+    CCapture::header(h, r);
+    for (int i = 0; i < 4; i++) h[CCapture::HEADER_LEN + i] = (uint8_t)(lost >> (8 * i));
+    put(h, sizeof(h));
+    lost = 0;
+  }
+  r.type = type;
+  r.flags = flags;
+  r.len = l1 + l2;
+  CCapture::header(h, r);
+  put(h, CCapture::HEADER_LEN);
+  put(p1, l1);
+  if (l2 > 0) put(p2, l2);
+  capring.commit(o);
+}
+
+// Everything that goes to the UART passes here
+void bridge_uart_write(TBridgePort *bp, const uint8_t *p, size_t len) {
+  bp->uart->write(p, len);
+  uint32_t g = capture_gen.load(std::memory_order_acquire);
+  if (g != 0) capture_run(g, CCapture::TX, bp, 0, p, len);
+}
+
+void bridge_uart_tx(TBridgePort *bp, const uint8_t *p, size_t len) {
+  switch (bp->encprotocol) {
+    case 0: // no encode
+      bridge_uart_write(bp, p, len);
+      break;
+    case 1: // PUSR encode
+      bp->pusr.decode(p, len);
+      break;
+    case 2: // LsrMstIns encode
+      bp->lsrmst.decode(p, len);
+      break;
+    case 3: // RFC 2217
+      bp->rfc2217.decode(p, len);
+      break;
+    case 4: // Modbus TCP -> RTU, the gateway sends the frames itself
+      bp->modbus.decode(p, len);
+      break;
+  }
+}
+
+void bridge_uart_rx(TBridgePort *bp, const uint8_t *p, size_t len) {
+  if (bp->encprotocol == 3) bp->rfc2217.encode(p, len);
+  else if (bp->encprotocol == 4) bp->modbus.receive(p, len, time_us_32());
+  else bp->uart2net.write(p, len);
+}
+
+// How much data from core 0 can be taken without anything blocking
+size_t bridge_uart_tx_space(TBridgePort *bp) {
+  if (bp->encprotocol == 4) return bp->modbus.room();
+  // Requests are answered in order, so none are taken while replies wait
+  if (bp->encprotocol == 3 && bp->rfc2217.pending() > 0) return 0;
+  return bp->uart->availableForWrite();
+}
+
+// How much UART data can be handed to core 0 without overflowing uart2net
+size_t bridge_uart_rx_space(TBridgePort *bp) {
+  size_t n = bp->uart2net.space();
+  // The Modbus gateway keeps what a response can hold and counts the rest
+  if (bp->encprotocol == 4) return SIZE_MAX;
+  if (bp->encprotocol == 3) {
+    // Every byte may double, and leave some room for command replies
+    if (bp->rfc2217.suspended || bp->rfc2217.pending() > 0 || n < 64) return 0;
+    return (n - 64) / 2;
+  }
+  return n;
+}
+
+// Move at most _PORT_QUANTUM bytes each way, returns true if anything moved
+bool bridge_uart_poll(TBridgePort *bp) {
+  TRingSpan s1, s2;
+  TUartSpan u1, u2;
+  size_t l, ll;
+  bool moved = false;
+
+  bridge_publish_rxstats(bp);
+  // A new client starts with fresh decoder state.
+  // Queued Modbus requests carry their client along and stay.
+  uint32_t g = (bp->raw != NULL) ? bp->raw->generation() : bp->sessions.generation();
+  if (g != bp->gen) {
+    bp->pusr.reset();
+    bp->lsrmst.reset();
+    bp->rfc2217.reset();
+    bp->gen = g;
+  }
+  if (bp->encprotocol == 3) {
+    // Replies that found uart2net full, and the modem lines as they are now
+    if (bp->rfc2217.pending() > 0 && bp->rfc2217.flush()) moved = true;
+    bp->rfc2217.notify_modemstate(RFC2217_modemstate(bp));
+  }
+
+  // core 0 -> UART tx, never more than the TX ring can take so nothing here blocks
+  if (bp->raw != NULL) {
+    // Straight from the received pbufs
+    const uint8_t *p;
+    size_t room = min(bridge_uart_tx_space(bp), (size_t)_PORT_QUANTUM);
+    uint32_t t = time_us_32();
+    for (l = 0; l < room && (ll = bp->raw->peek(p)) > 0; l += ll) {
+      ll = min(ll, room - l);
+      bridge_uart_tx(bp, p, ll);
+      bp->raw->consume(ll);
+    }
+    if (l > 0) {
+      bp->perf1.uart_write_us.add(time_us_32() - t);
+      bp->perf1.uart_tx.add(l);
+      moved = true;
+    }
+  } else if ((l = min(min(bp->net2uart.peek(s1, s2), bridge_uart_tx_space(bp)), (size_t)_PORT_QUANTUM)) > 0) {
+    uint32_t t = time_us_32();
+    ll = min(l, s1.len);
+    bridge_uart_tx(bp, s1.ptr, ll);
+    if (l > ll) bridge_uart_tx(bp, s2.ptr, l - ll);
+    bp->net2uart.consume(l);
+    bp->perf1.uart_write_us.add(time_us_32() - t);
+    bp->perf1.uart_tx.add(l);
+    moved = true;
+  }
+  // A PUSR packet head the client never completed goes to the UART as data after all
+  if (bp->encprotocol == 1 && bp->pusr.pending() > 0 && bp->uart->availableForWrite() >= bp->pusr.pending() && bp->pusr.poll(time_us_32()))
+    moved = true;
+  // UART rx -> core 0
+  size_t n = bp->uart->peek(u1, u2);
+  if (n > 0) {
+    // Note when DMA got this far, for the latency histogram
+    uint32_t w = (uint32_t)bp->uart->getRxCount() + n;
+    if (w != bp->seenpos) {
+      bp->rx_seen.push(w, time_us_32());
+      bp->seenpos = w;
+    }
+    bp->perf1.rx_peak.peak(n);
+  }
+  l = min(min(n, bridge_uart_rx_space(bp)), (size_t)_PORT_QUANTUM);
+  if (l > 0) {
+    ll = min(l, u1.len);
+    uint8_t err = bp->uart->takeLineErrors();
+    uint32_t g = capture_gen.load(std::memory_order_acquire);
+    if (g != 0) capture_run(g, CCapture::RX, bp, err, u1.ptr, ll, u2.ptr, l - ll);
+    // Ahead of the data they came with
+    if (bp->encprotocol == 3 && err != 0) bp->rfc2217.notify_linestate(RFC2217_linestate(err));
+    bridge_uart_rx(bp, u1.ptr, ll);
+    if (l > ll) bridge_uart_rx(bp, u2.ptr, l - ll);
+    bp->uart->consume(l);
+    bp->perf1.uart_rx.add(l);
+    // Stamped positions that have been passed are now in uart2net
+    uint32_t p, t;
+    uint32_t r = (uint32_t)bp->uart->getRxCount();
+    while (bp->rx_seen.front(p, t) && (int32_t)(r - p) >= 0) {
+      bp->rx_stamps.push(bp->uart2net.head_pos(), t);
+      bp->rx_seen.pop();
+    }
+    moved = true;
+  }
+  // RTS follows the RX ring fill, core 0 sees it with the line settings
+  if (bp->uart->isRtsStopped() != bp->rts_stopped) bridge_publish(bp);
+  // Every pass samples how far RX DMA has got, which is what tells the Modbus gateway the line has gone silent
+  if (bp->encprotocol == 4 && bp->modbus.poll(time_us_32())) moved = true;
+  return moved;
+}
+
+// Set up the decoders of a port and settle its boottime line settings, runs on core 1.
+// The UART itself is started by the caller with current_baud.
+void bridge_uart_begin(TBridgePort *bp, uint32_t baud, const char *serconfig) {
+  bp->current_coding = conv_str2coding(serconfig);
+  bp->current_baud = max(min(baud, (uint32_t)_MAX_BAUDRATE), (uint32_t)_MIN_BAUDRATE);
+
+  // Plain runs go to UART as they are, packets update the UART settings
+  bp->pusr.begin(
+    [](const uint8_t *p, size_t len, void *any) {
+      bridge_uart_write((TBridgePort *)any, p, len);
+    },
+    [](const uint8_t *pkt, void *any) {
+      PUSR_portconfig_check((TBridgePort *)any, pkt);
+    },
+    bp);
+  // Same for LsrMstInsert, except that the settings arrive separately
+  bp->lsrmst.begin(
+    [](const uint8_t *p, size_t len, void *any) {
+      bridge_uart_write((TBridgePort *)any, p, len);
+    },
+    [](uint32_t baud, void *any) {
+      LSRMSTINS_baud_update((TBridgePort *)any, baud);
+    },
+    [](int bytesize, int parity, int stopbits, void *any) {
+      LSRMSTINS_format_update((TBridgePort *)any, bytesize, parity, stopbits);
+    },
+    bp);
+  bp->rfc2217.begin(&rfc2217_callbacks, bp);
+  // Requests come from the queue as RTU frames, responses go back whole
+  bp->modbus.begin(
+    [](const uint8_t *p, size_t len, void *any) {
+      bridge_uart_write((TBridgePort *)any, p, len);
+    },
+    [](const uint8_t *p, size_t len, void *any) {
+      TBridgePort *bp = (TBridgePort *)any;
+      return bp->uart2net.space() >= len && bp->uart2net.write(p, len) == len;
+    },
+    bp);
+}
+
+// UART0 TX is on GPIO 0, 12, 16 or 28 and RX on the pin after one of them
+bool is_uart0_pins(uint8_t tx, uint8_t rx) {
+  return tx < 30 && rx < 30 && (tx % 4) == 0 && (rx % 4) == 1 && (((tx + 4) >> 3) & 1) == 0 && (((rx + 4) >> 3) & 1) == 0;
+}
+
+// A PIO UART may use any GPIO except those of the CYW43 (23, 24, 25, 29) and UART1 with its flow control (4..7)
+bool is_pio_pin(uint8_t pin) {
+  return pin < 29 && !(pin >= 23 && pin <= 25) && !(pin >= _TX && pin <= _RTS);
+}
+bool is_pio_pins(uint8_t tx, uint8_t rx) {
+  return tx != rx && is_pio_pin(tx) && is_pio_pin(rx);
+}
+
+// The other ports must stay clear of port 0, its report and capture, and the n ports in used
+bool is_port_free(uint16_t p, uint16_t port0, const uint16_t *used, int n) {
+  if (p >= port0 && p <= port0 + 2) return false;
+  for (int i = 0; i < n; i++)
+    if (p == used[i]) return false;
+  return true;
 }
 
 //----------------------------------------------------------------
 // setup
 //----------------------------------------------------------------
 void setup() {
-  nvm.Init();
+  nvm.Init(sizeof(TNetInfo));
   led.begin();
   Serial.begin(115200);
   Serial.ignoreFlowControl();
@@ -328,34 +925,163 @@ void setup() {
     });
 
   Net.end();
-  if (netinfo.mode != 0) Net.begin(netinfo);
+  if (netinfo.mode != 0) {
+    Net.begin(netinfo);
+    // A port saved by an older firmware may leave no room after it
+    if (netinfo.port <= _MAX_PORT) {
+      perfserver = new WiFiServer(netinfo.port + 1);
+      capserver = new WiFiServer(netinfo.port + 2);
+    }
+  }
+  // Settings saved by an older firmware read as 0xff
+  bridge[0].enabled = true;
+  bridge[0].uart = &hwuart[1];
+  bridge[0].port = netinfo.port;
+  bridge[0].encprotocol = (netinfo.encprotocol <= 4) ? netinfo.encprotocol : 0;
+  // The Modbus gateway needs the TCP sessions, UDP and raw TCP carry a plain stream
+  if (bridge[0].encprotocol == 4 && netinfo.transport != 0) bridge[0].encprotocol = 0;
+  bridge[1].enabled = (netinfo.mode != 0 && netinfo.uart2 == 1 && is_uart0_pins(netinfo.tx2, netinfo.rx2));
+  bridge[1].uart = &hwuart[0];
+  bridge[1].port = netinfo.port2;
+  bridge[1].encprotocol = (netinfo.encprotocol2 <= 4) ? netinfo.encprotocol2 : 0;
+  for (int i = 0; i < _NUM_PIO_PORTS; i++) {
+    TPioPortInfo *pi = &netinfo.pio[i];
+    TBridgePort *bp = &bridge[2 + i];
+    bp->enabled = (netinfo.mode != 0 && pi->enable == 1 && is_pio_pins(pi->tx, pi->rx));
+    bp->uart = &piouart[i];
+    bp->port = pi->port;
+    bp->encprotocol = (pi->encprotocol <= 4) ? pi->encprotocol : 0;
+  }
+  // Settings saved by an older firmware may have ports clash, the later one stays off
+  uint16_t used[_NUM_PORTS];
+  int nused = 0;
+  for (int i = 1; i < _NUM_PORTS; i++) {
+    if (!bridge[i].enabled) continue;
+    if (!is_port_free(bridge[i].port, netinfo.port, used, nused)) {
+      bridge[i].enabled = false;
+      continue;
+    }
+    used[nused++] = bridge[i].port;
+    bridge[i].server = new WiFiServer(bridge[i].port);
+  }
+  for (int i = 0; i < _NUM_PORTS; i++) {
+    bridge[i].sessions.begin(&bridge[i].uart2net, &bridge[i].net2uart, netinfo.arbitration, netinfo.slowclient);
+    bridge[i].sessions.setModbus(bridge[i].encprotocol == 4);
+    bridge[i].packer.config(netinfo.packlen, netinfo.packidle, netinfo.packdelim);
+  }
+  if (netinfo.transport == 1) udpbridge.begin(&bridge[0].uart2net, &bridge[0].net2uart, netinfo.port, netinfo.udpremote, netinfo.udpport, netinfo.udpseq != 0);
+  if (netinfo.transport == 2) {
+    rawbridge.begin(&bridge[0].uart2net, netinfo.port);
+    bridge[0].raw = &rawbridge;
+  }
+  // The TCP ports share what is left of the heap as backlog, Modbus responses are no use to a later client
+  if (netinfo.mode != 0 && netinfo.backlog == 1) {
+    int n = 0;
+    for (int i = 0; i < _NUM_PORTS; i++)
+      if (bridge[i].enabled && (i != 0 || netinfo.transport == 0) && bridge[i].encprotocol != 4) n++;
+    uint32_t heap = rp2040.getFreeHeap();
+    uint32_t size = (n > 0 && heap > _BACKLOG_RESERVE) ? ((heap - _BACKLOG_RESERVE) / n) & ~1023 : 0;
+    for (int i = 0; size >= _BACKLOG_MIN && i < _NUM_PORTS; i++)
+      if (bridge[i].enabled && (i != 0 || netinfo.transport == 0) && bridge[i].encprotocol != 4) {
+        uint8_t *p = (uint8_t *)malloc(size);
+        if (p != NULL) bridge[i].sessions.setBacklog(p, size, netinfo.replay);
+      }
+  }
+  setup_done.store(true, std::memory_order_release);
+  __sev();
+}
+
+// A port whose UART could not be started stays off, core 0 then never opens its server
+void bridge_uart_failed(int i, const char *what) {
+  bridge[i].enabled = false;
+  Serial.printf("Port %d off, its %s could not be started: no DMA channel, state machine or memory left\n", i, what);
 }
 
 void setup1() {
-  delay(500);
+  while (!setup_done.load(std::memory_order_acquire)) __wfe();
   gpio_pull_up(_RX);
 
   // Initialize the DMA UART1 class
   gpio_set_function(_TX, GPIO_FUNC_UART);
   gpio_set_function(_RX, GPIO_FUNC_UART);
-  current_serconfig = netinfo.serconfig;
-  uart1dma.begin(1, (current_baud = max(min(netinfo.baudrate, _MAX_BAUDRATE), _MIN_BAUDRATE)), conv_str2serconfig(current_serconfig.c_str()), 2048, 2048);
+  bridge_uart_begin(&bridge[0], netinfo.baudrate, netinfo.serconfig);
+  if (hwuart[1].begin(1, bridge[0].current_baud, bridge[0].current_coding.serial(), 2048, 2048) == 0) bridge_uart_failed(0, "UART1");
+  bridge[0].rts = bridge[0].cts = -1;
+  if (netinfo.flowctrl == 1) {
+    gpio_set_function(_CTS, GPIO_FUNC_UART);
+    bridge[0].uart->setFlowControl(true, _RTS);
+    bridge[0].rts = _RTS;
+    bridge[0].cts = _CTS;
+  }
+
+  // Second port on UART0
+  bridge[1].rts = bridge[1].cts = -1;
+  if (bridge[1].enabled) {
+    gpio_pull_up(netinfo.rx2);
+    gpio_set_function(netinfo.tx2, GPIO_FUNC_UART);
+    gpio_set_function(netinfo.rx2, GPIO_FUNC_UART);
+    bridge_uart_begin(&bridge[1], netinfo.baudrate2, netinfo.serconfig2);
+    if (hwuart[0].begin(0, bridge[1].current_baud, bridge[1].current_coding.serial(), 2048, 2048) == 0) bridge_uart_failed(1, "UART0");
+  }
+
+  // PIO ports, each takes two state machines and as many DMA channels as a hardware UART
+  for (int i = 0; i < _NUM_PIO_PORTS; i++) {
+    TBridgePort *bp = &bridge[2 + i];
+    bp->rts = bp->cts = -1;
+    if (bp->enabled) {
+      bridge_uart_begin(bp, netinfo.pio[i].baudrate, "8N1");
+      if (piouart[i].begin(netinfo.pio[i].tx, netinfo.pio[i].rx, bp->current_baud, 2048, 2048) == 0) bridge_uart_failed(2 + i, "PIO UART");
+    }
+  }
+  for (int i = 0; i < _NUM_PORTS; i++)
+    if (i == 0 || bridge[i].enabled) bridge_publish(&bridge[i]);
+
+  // The tick has to interrupt this core, so it gets an alarm pool of its own
+  if (netinfo.mode != 0) {
+    core1_pool = alarm_pool_create_with_unused_hardware_alarm(4);
+    if (core1_pool != NULL)
+      alarm_pool_add_repeating_timer_us(
+        core1_pool, -_CORE1_TICK_US, [](repeating_timer_t *rt) {
+          __sev();
+          return true;
+        },
+        NULL, &core1_tick);
+  }
+  setup1_done.store(true, std::memory_order_release);
 }
 
 //----------------------------------------------------------------
 // loop
 //----------------------------------------------------------------
 void loop() {
-  const char *serprot_s[] = { "Off", "PUSR", "LsrMstIns" };
+  const char *serprot_s[] = { "Off", "PUSR", "LsrMstIns", "RFC2217", "Modbus" };
   String s;
   char b[10];
   uint8_t mode = 0;
-  char bu[5][64];
+  char bu[6][64];
   uint16_t port = 0;
   IPAddress ip;
   uint8_t protocol = 0;
   int baudrate = 115200;
   char bc[10];
+  uint8_t arbitration = 0;
+  uint8_t slowclient = 0;
+  uint8_t backlog = 0;
+  int16_t replay = 0;
+  uint16_t packlen = 0;
+  uint8_t packidle = 0;
+  int16_t packdelim = -1;
+  uint8_t transport = 0;
+  uint16_t udpport = 0;
+  uint8_t udpseq = 0;
+  uint8_t flowctrl = 0;
+  uint8_t uart2 = 0;
+  uint16_t port2 = 0;
+  uint8_t tx2 = 0, rx2 = 1;
+  uint8_t protocol2 = 0;
+  int baudrate2 = 115200;
+  char bc2[10];
+  TPioPortInfo piop[_NUM_PIO_PORTS];
 
   int available = 0;
 
@@ -396,10 +1122,35 @@ void loop() {
       case 'i':
         us_rx_flush();
         Net.print_stat();
-        if (clientip != IPAddress(0, 0, 0, 0)) Serial.printf(" Client connection is %s:%d\n", clientip.toString().c_str(), clientport);
-        Serial.printf(" UART protocol is %s\n", serprot_s[netinfo.encprotocol]);
-        Serial.printf(" UART is %lubps %s\n", (netinfo.mode == 0) ? cdc_baud : current_baud, (netinfo.mode == 0) ? cdc_config.c_str() : current_serconfig.c_str());
-        Serial.printf(" actual UART is %lubps %s\n", uart1dma.getActualBaud(), (netinfo.mode == 0) ? cdc_config.c_str() : current_serconfig.c_str());
+        if (netinfo.mode != 0) Serial.printf("Core 1 asleep %lu.%lu%%, %lu wakeups/s\n", sched0.sleep_permille / 10, sched0.sleep_permille % 10, sched0.wake_rate);
+        for (int i = 0; i < _NUM_PORTS; i++) {
+          TBridgePort *bp = &bridge[i];
+          if (!bp->enabled) continue;
+          if (i > 0) Serial.printf("Port %d on %d\n", i, bp->port);
+          if (netinfo.mode != 0) {
+            if (i == 0 && netinfo.transport == 1) udpbridge.print_stat();
+            else if (bp->raw != NULL) bp->raw->print_stat();
+            else bp->sessions.print_stat();
+          }
+          Serial.printf(" UART protocol is %s\n", serprot_s[bp->encprotocol]);
+          if (bp->encprotocol == 4) {
+            auto &m = bp->modbus.stat;
+            Serial.printf(" Modbus %lu requests, %lu responses (%lu exceptions), %lu broadcasts, queued up to %lu\n", m.requests.get(), m.responses.get(), m.exceptions.get(), m.broadcasts.get(), m.max_queued.get());
+            Serial.printf(" Modbus %lu timeouts, %lu bad frames, %lu stray bytes\n", m.timeouts.get(), m.bad_frames.get(), m.stray.get());
+          }
+          TPortState st = bp->state.read();
+          Serial.printf(" UART is %lubps %s\n", st.baud, st.coding.text().s);
+          Serial.printf(" actual UART is %lubps %s\n", st.actual_baud, st.coding.text().s);
+          if (st.reconf.count > 0) {
+            TUartReconf &r = st.reconf;
+            Serial.printf(" UART reconfigured %lu times, last from RX byte %llu, TX wait %luus, switch %luus (max %luus)\n", r.count, r.rxpos, r.wait_us, r.switch_us, r.max_switch_us);
+          }
+          perf_print(Serial, bp);
+          TUartRxStats r = bridge_rxstats(bp);
+          Serial.printf(" UART RX %llu bytes, read %llu, ring overruns %lu (%llu bytes lost)\n", r.received, r.consumed, r.overruns, r.lost);
+          Serial.printf(" UART errors framing %lu, parity %lu, break %lu, FIFO overrun %lu\n", r.framing, r.parity, r.breaks, r.fifo_overruns);
+          if (st.flowctrl) Serial.printf(" RTS/CTS flow control, RTS is %s\n", st.rts_stopped ? "deasserted" : "asserted");
+        }
         break;
       // Format
       case 'f':
@@ -419,6 +1170,8 @@ void loop() {
         memset(bu, 0, sizeof(bu));
         memset(b, 0, sizeof(b));
         memset(bc, 0, sizeof(bc));
+        memset(bc2, 0, sizeof(bc2));
+        memset(piop, 0, sizeof(piop));
         Serial.print("Select WiFi mode (0:Off 1:AP 2:STA)=");
         if (us_gets(b, sizeof(b)) > 0 && strlen(b) > 0) {
           s = b;
@@ -435,17 +1188,81 @@ void loop() {
               us_gets(bu[3], sizeof(bu[3]));
               Serial.printf("mask%s=", (mode == 2) ? "(If blank, use DHCP)" : "");
               us_gets(bu[4], sizeof(bu[4]));
-              Serial.print("port(0..65535)=");
+              Serial.print("port(0.." TOSTRING(_MAX_PORT) ", the next two are the report and the capture)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                port = max(min(s.toInt(), _MAX_PORT), 0);
+              }
+              Serial.print("transport (0:TCP, 1:UDP, 2:TCP raw, one client)=");
               if (us_gets(b, sizeof(b)) > 0) {
                 s = b;
-                port = max(min(s.toInt(), 65535), 0);
+                transport = max(min(s.toInt(), 2), 0);
+              } else
+                transport = 0;
+              if (transport == 1) {
+                Serial.print("udp destination(If blank, reply to the last sender)=");
+                us_gets(bu[5], sizeof(bu[5]));
+                Serial.print("udp destination port(If blank, same as port)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  udpport = max(min(s.toInt(), 65535), 0);
+                }
+                Serial.print("udp sequence header (0:off, 1:on)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  udpseq = max(min(s.toInt(), 1), 0);
+                }
               }
-              Serial.print("serial protocol (0:Off, 1:PUSR, 2:LsrMstIns)=");
+              Serial.print("serial protocol (0:Off, 1:PUSR, 2:LsrMstIns, 3:RFC2217, 4:Modbus)=");
               if (us_gets(b, sizeof(b)) > 0) {
                 s = b;
-                protocol = max(min(s.toInt(), 2), 0);
+                protocol = max(min(s.toInt(), 4), 0);
               } else
                 protocol = 0;
+              Serial.print("client allowed to write (0:first, 1:last, 2:demand)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                arbitration = max(min(s.toInt(), 2), 0);
+              } else
+                arbitration = 0;
+              Serial.print("slow client (0:wait, 1:drop, 2:disconnect)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                slowclient = max(min(s.toInt(), 2), 0);
+              } else
+                slowclient = 0;
+              Serial.print("backlog while no client is connected (0:off, 1:on)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                backlog = max(min(s.toInt(), 1), 0);
+              } else
+                backlog = 0;
+              if (backlog == 1) {
+                Serial.print("replay (0:all, N:last N KB, -N:last N seconds)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  replay = max(min(s.toInt(), 32767), -32767);
+                } else
+                  replay = 0;
+              }
+              Serial.print("packing length(0..4096, 0:off)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                packlen = max(min(s.toInt(), CPacker::MAX_PACKLEN), 0);
+              } else
+                packlen = 0;
+              Serial.print("packing idle characters(0..100, 0:off)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                packidle = max(min(s.toInt(), CPacker::MAX_IDLECHARS), 0);
+              } else
+                packidle = 0;
+              Serial.print("packing delimiter(0..255, blank:off)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                packdelim = max(min(s.toInt(), 255), 0);
+              } else
+                packdelim = -1;
             }
 
             Serial.print("serial baudrate(" TOSTRING(_MIN_BAUDRATE) "..." TOSTRING(_MAX_BAUDRATE) ")=");
@@ -456,7 +1273,111 @@ void loop() {
               baudrate = 115200;
             Serial.print("serial config(ex.8N1)=");
             us_gets(bc, 3);
-            conv_str2serconfig(bc, bc);
+            conv_str2coding(bc, bc);
+            Serial.print("flow control (0:none, 1:RTS/CTS)=");
+            if (us_gets(b, sizeof(b)) > 0) {
+              s = b;
+              flowctrl = max(min(s.toInt(), 1), 0);
+            } else
+              flowctrl = 0;
+            if (mode != 0) {
+              Serial.print("second UART (0:off, 1:on)=");
+              if (us_gets(b, sizeof(b)) > 0) {
+                s = b;
+                uart2 = max(min(s.toInt(), 1), 0);
+              }
+              if (uart2 == 1) {
+                Serial.print("second UART port(0..65535)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  port2 = max(min(s.toInt(), 65535), 0);
+                }
+                if (!is_port_free(port2, port, NULL, 0)) {
+                  Serial.printf("port %u is taken by port %u and the two after it, second UART off\n", port2, port);
+                  uart2 = 0;
+                }
+              }
+              if (uart2 == 1) {
+                Serial.print("second UART TX pin(0, 12, 16, 28)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  tx2 = max(min(s.toInt(), 29), 0);
+                }
+                Serial.print("second UART RX pin(1, 13, 17, 29)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  rx2 = max(min(s.toInt(), 29), 0);
+                }
+                if (!is_uart0_pins(tx2, rx2)) {
+                  Serial.println("not UART0 pins, using 0 and 1");
+                  tx2 = 0;
+                  rx2 = 1;
+                }
+                Serial.print("second UART serial protocol (0:Off, 1:PUSR, 2:LsrMstIns, 3:RFC2217, 4:Modbus)=");
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  protocol2 = max(min(s.toInt(), 4), 0);
+                }
+                Serial.print("second UART baudrate(" TOSTRING(_MIN_BAUDRATE) "..." TOSTRING(_MAX_BAUDRATE) ")=");
+                if (us_gets(b, 7) > 0) {
+                  s = b;
+                  baudrate2 = max(min(s.toInt(), _MAX_BAUDRATE), _MIN_BAUDRATE);
+                }
+                Serial.print("second UART config(ex.8N1)=");
+                us_gets(bc2, 3);
+              }
+              for (int i = 0; i < _NUM_PIO_PORTS; i++) {
+                TPioPortInfo *pi = &piop[i];
+                pi->baudrate = 115200;
+                Serial.printf("PIO UART %d (0:off, 1:on)=", i + 1);
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  pi->enable = max(min(s.toInt(), 1), 0);
+                }
+                if (pi->enable != 1) continue;
+                Serial.printf("PIO UART %d port(0..65535)=", i + 1);
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  pi->port = max(min(s.toInt(), 65535), 0);
+                }
+                uint16_t used[1 + _NUM_PIO_PORTS];
+                int nused = 0;
+                if (uart2 == 1) used[nused++] = port2;
+                for (int j = 0; j < i; j++)
+                  if (piop[j].enable == 1) used[nused++] = piop[j].port;
+                if (!is_port_free(pi->port, port, used, nused)) {
+                  Serial.printf("port %u is taken, PIO UART off\n", pi->port);
+                  pi->enable = 0;
+                  continue;
+                }
+                Serial.printf("PIO UART %d TX pin(0..28)=", i + 1);
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  pi->tx = max(min(s.toInt(), 28), 0);
+                }
+                Serial.printf("PIO UART %d RX pin(0..28)=", i + 1);
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  pi->rx = max(min(s.toInt(), 28), 0);
+                }
+                if (!is_pio_pins(pi->tx, pi->rx)) {
+                  Serial.println("pins not usable, PIO UART off");
+                  pi->enable = 0;
+                  continue;
+                }
+                Serial.printf("PIO UART %d serial protocol (0:Off, 1:PUSR, 2:LsrMstIns, 3:RFC2217, 4:Modbus)=", i + 1);
+                if (us_gets(b, sizeof(b)) > 0) {
+                  s = b;
+                  pi->encprotocol = max(min(s.toInt(), 4), 0);
+                }
+                Serial.printf("PIO UART %d baudrate(" TOSTRING(_MIN_BAUDRATE) "..." TOSTRING(_MAX_BAUDRATE) ", always 8N1)=", i + 1);
+                if (us_gets(b, 7) > 0) {
+                  s = b;
+                  pi->baudrate = max(min(s.toInt(), _MAX_BAUDRATE), _MIN_BAUDRATE);
+                }
+              }
+            }
+            conv_str2coding(bc2, bc2);
 
             Serial.println("Input values");
             Serial.printf(" hostname:%s\n", bu[0]);
@@ -470,20 +1391,54 @@ void loop() {
             ip.fromString(bu[4]);
             Serial.printf(" mask:%s\n", ip.toString().c_str());
             Serial.printf(" port:%d\n", port);
+            Serial.printf(" transport:%d\n", transport);
+            if (strlen(bu[5]) == 0) strcpy(bu[5], "0.0.0.0");
+            ip.fromString(bu[5]);
+            Serial.printf(" udp destination:%s:%d\n", ip.toString().c_str(), udpport);
+            Serial.printf(" udp sequence header:%d\n", udpseq);
             Serial.printf(" serial protocol:%d\n", protocol);
+            Serial.printf(" arbitration:%d\n", arbitration);
+            Serial.printf(" slow client:%d\n", slowclient);
+            Serial.printf(" backlog:%d, replay %d\n", backlog, replay);
+            Serial.printf(" packing:%u bytes, %u chars idle, delimiter %d\n", packlen, packidle, packdelim);
             Serial.printf(" serial baudrate:%lu\n", baudrate);
             Serial.printf(" serial config:%s\n", bc);
+            Serial.printf(" flow control:%d\n", flowctrl);
+            Serial.printf(" second UART:%d\n", uart2);
+            if (uart2 == 1) Serial.printf(" second UART port:%d, pins TX %d RX %d, protocol %d, %lu %s\n", port2, tx2, rx2, protocol2, baudrate2, bc2);
+            for (int i = 0; i < _NUM_PIO_PORTS; i++)
+              if (piop[i].enable == 1) Serial.printf(" PIO UART %d port:%d, pins TX %d RX %d, protocol %d, %lu 8N1\n", i + 1, piop[i].port, piop[i].tx, piop[i].rx, piop[i].encprotocol, piop[i].baudrate);
             if (are_you_sure()) {
               netinfo.mode = mode;
-              strncpy(netinfo.hostname, bu[0], sizeof(netinfo.hostname) - 1);
-              strncpy(netinfo.ssid, bu[1], sizeof(netinfo.ssid) - 1);
-              strncpy(netinfo.psk, bu[2], sizeof(netinfo.psk) - 1);
+              snprintf(netinfo.hostname, sizeof(netinfo.hostname), "%s", bu[0]);
+              snprintf(netinfo.ssid, sizeof(netinfo.ssid), "%s", bu[1]);
+              snprintf(netinfo.psk, sizeof(netinfo.psk), "%s", bu[2]);
               netinfo.ip.fromString(bu[3]);
               netinfo.mask.fromString(bu[4]);
               netinfo.port = port;
+              netinfo.transport = transport;
+              netinfo.udpremote.fromString(bu[5]);
+              netinfo.udpport = udpport;
+              netinfo.udpseq = udpseq;
               netinfo.encprotocol = protocol;
+              netinfo.arbitration = arbitration;
+              netinfo.slowclient = slowclient;
+              netinfo.backlog = backlog;
+              netinfo.replay = replay;
+              netinfo.packlen = packlen;
+              netinfo.packidle = packidle;
+              netinfo.packdelim = packdelim;
               netinfo.baudrate = baudrate;
-              strncpy(netinfo.serconfig, bc, sizeof(netinfo.serconfig) - 1);
+              snprintf(netinfo.serconfig, sizeof(netinfo.serconfig), "%s", bc);
+              netinfo.flowctrl = flowctrl;
+              netinfo.uart2 = uart2;
+              netinfo.port2 = port2;
+              netinfo.tx2 = tx2;
+              netinfo.rx2 = rx2;
+              netinfo.encprotocol2 = protocol2;
+              netinfo.baudrate2 = baudrate2;
+              snprintf(netinfo.serconfig2, sizeof(netinfo.serconfig2), "%s", bc2);
+              memcpy(netinfo.pio, piop, sizeof(netinfo.pio));
 
               nvm.Write(
                 [] {
@@ -522,9 +1477,27 @@ void loop() {
         Serial.printf(" ip  :%s\n", netinfo.ip.toString().c_str());
         Serial.printf(" mask:%s\n", netinfo.mask.toString().c_str());
         Serial.printf(" port:%d\n", netinfo.port);
+        Serial.printf(" transport: %d\n", netinfo.transport);
+        Serial.printf(" udpremote: %s:%d\n", netinfo.udpremote.toString().c_str(), netinfo.udpport);
+        Serial.printf(" udpseq:    %d\n", netinfo.udpseq);
         Serial.printf(" protocol:  %d\n", netinfo.encprotocol);
         Serial.printf(" baudrate:  %lu\n", netinfo.baudrate);
         Serial.printf(" serconfig: %s\n", netinfo.serconfig);
+        Serial.printf(" arbitration: %d\n", netinfo.arbitration);
+        Serial.printf(" slowclient:  %d\n", netinfo.slowclient);
+        Serial.printf(" backlog:     %d, replay %d\n", netinfo.backlog, netinfo.replay);
+        Serial.printf(" packlen:   %u\n", netinfo.packlen);
+        Serial.printf(" packidle:  %u\n", netinfo.packidle);
+        Serial.printf(" packdelim: %d\n", netinfo.packdelim);
+        Serial.printf(" flowctrl:  %d\n", netinfo.flowctrl);
+        Serial.printf(" uart2:     %d\n", netinfo.uart2);
+        Serial.printf(" port2:     %d\n", netinfo.port2);
+        Serial.printf(" pins2:     TX %d RX %d\n", netinfo.tx2, netinfo.rx2);
+        Serial.printf(" protocol2: %d\n", netinfo.encprotocol2);
+        Serial.printf(" baudrate2: %lu\n", netinfo.baudrate2);
+        Serial.printf(" serconfig2: %s\n", netinfo.serconfig2);
+        for (int i = 0; i < _NUM_PIO_PORTS; i++)
+          Serial.printf(" pio%d:      %d, port %d, TX %d RX %d, protocol %d, %lu\n", i + 1, netinfo.pio[i].enable, netinfo.pio[i].port, netinfo.pio[i].tx, netinfo.pio[i].rx, netinfo.pio[i].encprotocol, netinfo.pio[i].baudrate);
         break;
       default:
         Serial.println(
@@ -536,8 +1509,24 @@ void loop() {
   }
 
   // Network condition monitoring and reaction
-  if (netinfo.mode != 0) Net.poll(&led, NULL);
-  else delay(200);
+  if (netinfo.mode != 0) {
+    bool online = (Net.poll(&led, NULL) == 1);
+    // Remember the AP for a faster join after the next boot
+    TWiFiCache c;
+    if (Net.cacheChanged(&c)) {
+      netinfo.wificache = c;
+      nvm.Write(
+        [] {
+          EEPROM.put(0, netinfo);
+        });
+      nvm.Flush();
+    }
+    bridge_net_poll(online);
+    perf_serve(online);
+    capture_serve(online);
+  } else
+    delay(200);
+  perf_rate();
 
   // Led
   led.poll();
@@ -564,32 +1553,55 @@ void loop1() {
 
     // Not in configuration mode
     if (!u2s_config) {
-      // USB rx -> UART tx
-      while ((l = Serial.available()) > 0) {
-        while ((ll = Serial.readBytes(buf, min(sizeof(buf), l))) > 0) {
-          uart1dma.write(buf, ll);
-          lon = true;
-          l -= ll;
-        }
-        uart1dma.flush();
-      }
-      // UART rx -> USB tx
-      while ((l = uart1dma.available()) > 0) {
-        while ((ll = uart1dma.readBytes(buf, min(sizeof(buf), l))) > 0) {
-          Serial.write(buf, ll);
-          Serial.flush();
-          lon = true;
-          l -= ll;
+      CUartBase *u = bridge[0].uart;
+      static bool cdc_pending = false;
+      static uint32_t cdc_rx_t;  // when data last came from the UART
+      bridge_publish_rxstats(&bridge[0]);
+      {
+        // Straight on the TinyUSB FIFOs, under the lock the USB task on core 0 takes
+        CoreMutex m(&__usb_mutex);
+        if (m) {
+          // USB rx -> UART tx, no more than the TX ring takes so that write() never waits
+          while ((l = min((size_t)tud_cdc_available(), u->availableForWrite())) > 0) {
+            if ((ll = tud_cdc_read(buf, min(sizeof(buf), l))) == 0) break;
+            u->write(buf, ll);
+            bridge[0].perf1.uart_tx.add(ll);
+            lon = true;
+          }
+          // UART rx -> USB tx, from the RX ring by reference.
+          // TinyUSB sends by itself whenever a full packet is queued, the rest goes once the UART
+          // has been silent for _CDC_IDLE_CHARS, which a steady stream never is.
+          TUartSpan s1, s2;
+          if ((l = u->peek(s1, s2)) > 0) {
+            if (tud_cdc_connected()) {
+              size_t room = tud_cdc_write_available();
+              ll = tud_cdc_write(s1.ptr, min(s1.len, room));
+              if (ll == s1.len && s2.len > 0) ll += tud_cdc_write(s2.ptr, min(s2.len, room - ll));
+            } else
+              ll = l;  // nobody is listening
+            u->consume(ll);
+            if (ll > 0) {
+              bridge[0].perf1.uart_rx.add(ll);
+              cdc_pending = true;
+              cdc_rx_t = time_us_32();
+              lon = true;
+            }
+          } else if (cdc_pending && time_us_32() - cdc_rx_t >= (uint64_t)_CDC_IDLE_CHARS * bridge[0].current_coding.charbits() * 1000000 / bridge[0].current_baud) {
+            tud_cdc_write_flush();
+            cdc_pending = false;
+          }
         }
       }
       // Detection of baudrate or parameter changes
-      uint32_t b = cdc_baud;
-      String c = cdc_config;
-      if (b != cdc_prevbaud || c != cdc_prevconfig) {
-        uart1dma.flush();
-        uart1dma.begin(b, conv_str2serconfig(c.c_str()));
+      uint32_t b = cdc_baud.load(std::memory_order_acquire);
+      CLineCoding c = cdc_coding.load(std::memory_order_relaxed);
+      if (b != cdc_prevbaud || c != cdc_prevcoding) {
+        bridge[0].uart->reconfigure(b, c.serial());
         cdc_prevbaud = b;
-        cdc_prevconfig = c;
+        cdc_prevcoding = c;
+        bridge[0].current_baud = b;
+        bridge[0].current_coding = c;
+        bridge_publish(&bridge[0]);
       }
       if (lon) {
         blink_t = millis() + 10;
@@ -601,69 +1613,21 @@ void loop1() {
       delay(2000);
   // WiFi On (WiFi <-> UART Bridge)
   } else if (Net.server != NULL) {
-    if (Net.server->status() != 0) led.set_pattern(6);
-
-    // Check for incoming client connections
-    WiFiClient client = Net.server->accept();
-    Net.server->setNoDelay(true);
-  
-    if (client) {
-      Serial.println("Client connected");
-      led.set_pattern(-1);
-      client.setNoDelay(true);
-      clientip = client.remoteIP();
-      clientport = client.remotePort();
-      while (client.connected()) {
-        // WiFi rx -> UART tx
-        while ((l = client.available()) > 0) {
-          while ((ll = client.readBytes(buf, min(sizeof(buf), l))) > 0) {
-            switch (netinfo.encprotocol) {
-              case 0: // no encode
-                uart1dma.write(buf, ll);
-                lon = true;
-                break;
-              case 1: // PUSR encode
-                for (int j = 0; j < ll;) {
-                  if (j + 8 <= ll) {
-                    if (PUSR_portconfig_check(&buf[j])) {
-                      j += 8;
-                      continue;
-                    }
-                  }
-                  uart1dma.write(buf[j++]);
-                }
-                lon = true;
-                break;
-              case 2: // LsrMstIns encode
-                LSRMSTINS_portconfig_check(buf, ll);
-                lon = true;
-                break;
-            }
-            l -= ll;
-          }
-        }
-        // UART rx -> WiFi tx
-        while ((l = uart1dma.available()) > 0) {
-          lon = true;
-          while ((ll = uart1dma.readBytes(buf, min(sizeof(buf), l))) > 0) {
-            client.write((uint8_t *)buf, ll);
-            l -= ll;
-          }
-        }
+    // Round robin over the ports, each moves at most a quantum per turn
+    for (int i = 0; i < _NUM_PORTS; i++)
+      if (bridge[i].enabled && bridge_uart_poll(&bridge[i])) lon = true;
 
-        if (lon) {
-          blink_t = millis() + 10;
-          digitalWrite(LED_BUILTIN, 1);
-          lon = false;
-        }
-        if (millis() > blink_t) digitalWrite(LED_BUILTIN, 0);
-      }
-      led.set_pattern(0);
-      clientip = IPAddress(0, 0, 0, 0);
-      clientport = 0;
-      // Client disconnected
-      client.stop();
-      Serial.println("Client disconnected");
+    if (lon) {
+      blink_t = millis() + 10;
+      digitalWrite(LED_BUILTIN, 1);
+      lon = false;
+    } else if (core1_pool != NULL) {
+      // Nothing to do, an event that arrived since the round started returns at once
+      uint32_t t = time_us_32();
+      __wfe();
+      sched1.sleep_us.add(time_us_32() - t);
+      sched1.wakes.add(1);
     }
+    if (millis() > blink_t) digitalWrite(LED_BUILTIN, 0);
   }
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+/*
+  backlog
+
+  Byte ring that keeps the newest data it was given, for replay to a client that was not there.
+
+  When full, the oldest bytes are overwritten and counted. Positions run on as byte totals,
+  so a reader holds a position rather than a pointer and finds out itself how much it missed.
+  Every so often the position is stamped with the time it was reached, which lets a replay
+  start at a point in time; it starts at the stamp before that time, so it errs towards more.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "spsc.hpp"
+
+class CBacklog {
+public:
+  static const int MARKS = 64;
+
+private:
+  uint8_t *buf;
+  uint32_t len;
+  uint32_t head;     // bytes appended
+  uint32_t hoff;     // where in buf the head is, len need not be a power of two
+  uint32_t tail;     // position of the oldest byte held
+  uint64_t dropped;  // bytes overwritten before anyone read them
+
+  struct {
+    uint32_t pos;
+    uint32_t t;
+  } mark[MARKS];
+  uint32_t nmark;    // marks taken, the newest is mark[(nmark - 1) % MARKS]
+  uint32_t mark_ms;
+
+  // Offset in buf of a position no more than len behind the head
+  uint32_t offset(uint32_t pos) const {
+    uint32_t back = head - pos;
+    return (hoff >= back) ? hoff - back : hoff + len - back;
+  }
+
+public:
+  void begin(uint8_t *p, uint32_t size, uint32_t interval_ms = 1000) {
+    buf = p;
+    len = (p != NULL) ? size : 0;
+    mark_ms = interval_ms;
+    head = tail = hoff = 0;
+    dropped = 0;
+    nmark = 0;
+  }
+
+  bool enabled(void) const { return len > 0; }
+  uint32_t size(void) const { return len; }
+  uint32_t head_pos(void) const { return head; }
+  uint32_t tail_pos(void) const { return tail; }
+  uint32_t held(void) const { return head - tail; }
+  uint64_t lost(void) const { return dropped; }
+
+  void append(const uint8_t *p, size_t n, uint32_t now) {
+    if (len == 0 || n == 0) return;
+    if (nmark == 0 || now - mark[(nmark - 1) % MARKS].t >= mark_ms) {
+      mark[nmark % MARKS].pos = head;
+      mark[nmark % MARKS].t = now;
+      nmark++;
+    }
+    // Only the last len bytes of a long run can stay
+    if (n > len) {
+      head += n - len;
+      p += n - len;
+      n = len;
+    }
+    uint32_t l1 = (n < len - hoff) ? n : len - hoff;
+    memcpy(&buf[hoff], p, l1);
+    memcpy(buf, &p[l1], n - l1);
+    hoff = (hoff + n) % len;
+    head += n;
+    if (head - tail > len) {
+      dropped += head - len - tail;
+      tail = head - len;
+    }
+  }
+
+  // Readable regions from pos to the head, pos is moved up to the tail if it has been overwritten
+  size_t peek_at(uint32_t &pos, TRingSpan &s1, TRingSpan &s2) {
+    if ((int32_t)(pos - tail) < 0) pos = tail;
+    uint32_t n = ((int32_t)(head - pos) > 0) ? head - pos : 0;
+    uint32_t o = (n > 0) ? offset(pos) : 0;
+    s1.ptr = &buf[o];
+    s1.len = (n < len - o) ? n : len - o;
+    s2.ptr = buf;
+    s2.len = n - s1.len;
+    return n;
+  }
+
+  // Where to start for everything held, the last n bytes, or what arrived from time t on
+  uint32_t start_all(void) const { return tail; }
+  uint32_t start_last(uint32_t n) const { return (n < held()) ? head - n : tail; }
+  uint32_t start_since(uint32_t t) const {
+    uint32_t pos = tail;
+    uint32_t first = (nmark > MARKS) ? nmark - MARKS : 0;
+    for (uint32_t i = first; i < nmark; i++) {
+      const auto &m = mark[i % MARKS];
+      if ((int32_t)(m.t - t) > 0) break;
+      if ((int32_t)(m.pos - tail) > 0) pos = m.pos;
+    }
+    return pos;
+  }
+
+  // Forget what is held, e.g. once it has been replayed
+  void clear(void) { tail = head; }
+};
@@ -0,0 +1,117 @@
+/*
+  capture
+
+  Record format of the traffic capture stream, shared by the firmware and the host decoder.
+
+  The stream opens with 8 bytes, "PMBCAP", the version (1) and 0.
+  Then come records of a 14 byte header and the payload, little endian:
+    u8  type   1:UART RX 2:UART TX 3:capture data lost, the payload is the u32 number of bytes
+    u8  port   bridge port
+    u8  flags  line errors seen since the previous RX record of the port (CUartBase::LINE_xxx)
+               01:framing 02:parity 04:break 08:FIFO overrun 10:RX ring overrun
+    u8  0
+    u64 time   us since boot when the run was taken from or handed to the UART ring
+    u16 len    payload length
+  A record stands for a run of bytes, so the time is that of the whole run.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+  uint8_t type;
+  uint8_t port;
+  uint8_t flags;
+  uint64_t time;
+  uint16_t len;
+} TCaptureRecord;
+
+class CCapture {
+public:
+  enum { RX = 1, TX = 2, LOST = 3 };
+  static const size_t HEADER_LEN = 14;
+  static const size_t PREAMBLE_LEN = 8;
+  static const uint8_t VERSION = 1;
+
+  static void preamble(uint8_t *p) {
+    memcpy(p, "PMBCAP", 6);
+    p[6] = VERSION;
+    p[7] = 0;
+  }
+
+  static void header(uint8_t *p, const TCaptureRecord &r) {
+    p[0] = r.type;
+    p[1] = r.port;
+    p[2] = r.flags;
+    p[3] = 0;
+    for (int i = 0; i < 8; i++) p[4 + i] = (uint8_t)(r.time >> (8 * i));
+    p[12] = (uint8_t)r.len;
+    p[13] = (uint8_t)(r.len >> 8);
+  }
+
+  static TCaptureRecord parse_header(const uint8_t *p) {
+    TCaptureRecord r;
+    r.type = p[0];
+    r.port = p[1];
+    r.flags = p[2];
+    r.time = 0;
+    for (int i = 7; i >= 0; i--) r.time = (r.time << 8) | p[4 + i];
+    r.len = p[12] | (uint16_t)p[13] << 8;
+    return r;
+  }
+};
+
+// Splits a byte stream, fed in pieces of any size, back into records
+typedef void capture_record_callback(const TCaptureRecord &r, const uint8_t *payload, void *any);
+
+class CCaptureParser {
+  capture_record_callback *cb;
+  void *any;
+  uint8_t buf[CCapture::HEADER_LEN + 65535];
+  size_t fill;
+  bool started;
+  TCaptureRecord rec;
+
+public:
+  bool bad;  // the stream did not start with the preamble of a known version
+
+  void begin(capture_record_callback *callback, void *p) {
+    cb = callback;
+    any = p;
+    fill = 0;
+    started = bad = false;
+  }
+
+  void feed(const uint8_t *p, size_t n) {
+    while (n > 0 && !bad) {
+      size_t want = !started ? CCapture::PREAMBLE_LEN : (fill < CCapture::HEADER_LEN) ? CCapture::HEADER_LEN : CCapture::HEADER_LEN + rec.len;
+      size_t l = (want - fill < n) ? want - fill : n;
+      memcpy(&buf[fill], p, l);
+      fill += l;
+      p += l;
+      n -= l;
+      if (fill < want) break;
+      if (!started) {
+        bad = (memcmp(buf, "PMBCAP", 6) != 0 || buf[6] != CCapture::VERSION);
+        started = true;
+        fill = 0;
+      } else if (want == CCapture::HEADER_LEN) {
+        rec = CCapture::parse_header(buf);
+        if (rec.len == 0) {
+          cb(rec, &buf[CCapture::HEADER_LEN], any);
+          fill = 0;
+        }
+      } else {
+        cb(rec, &buf[CCapture::HEADER_LEN], any);
+        fill = 0;
+      }
+    }
+  }
+};
@@ -0,0 +1,36 @@
+/*
+  CRC16
+
+  CRC-16/MODBUS, the check of a Modbus RTU frame.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include "crc16.hpp"
+
+// Polynomial 0xa001 (0x8005 reflected), Ini Value 0xffff
+struct CCRC16_MODBUS {
+  uint16_t ary[256];
+  constexpr CCRC16_MODBUS () : ary () {
+    for (int i = 0; i < 256; i++) {
+      uint16_t crc = i;
+      for (int b = 0; b < 8; b++)
+        if ((crc & 1) != 0) crc = (crc >> 1) ^ 0xa001; else crc = (crc >> 1);
+      ary[i] = crc;
+    }
+  }
+} static constexpr CRC16_MODBUS;
+
+uint16_t CCRC16::calc (const void *buf, size_t size) {
+    const uint8_t *data = (const uint8_t *)buf;
+    uint16_t crc16 = 0xFFFF;
+
+    while (size-- != 0) crc16 = (crc16 >> 8) ^ CRC16_MODBUS.ary[(crc16 ^ *data++) & 0xff];
+    return crc16;
+}
+
+uint16_t CCRC16::get (uint16_t *crc, uint8_t dat) {
+  *crc = (*crc >> 8) ^ CRC16_MODBUS.ary[(*crc ^ dat) & 0xff];
+  return *crc;
+}
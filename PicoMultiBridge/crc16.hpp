@@ -0,0 +1,21 @@
+/*
+  CRC16
+
+  CRC-16/MODBUS, the check of a Modbus RTU frame.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class CCRC16 {
+  // A byte at a time from a table, the frames are at most 256 bytes.
+  // Polynomial 0x8005 reflected (0xa001), Ini Value 0xffff, no final xor, sent low byte first
+public:
+  uint16_t calc (const void *buf, size_t size);
+  uint16_t get (uint16_t *crc, uint8_t dat);
+};
@@ -0,0 +1,80 @@
+/*
+  dgram
+
+  Packs UART data from a ring into datagrams and unpacks received ones.
+
+  With the sequence header enabled every datagram starts with a 32bit counter (MSB first),
+  incremented per datagram, so that a receiver can spot loss and reordering.
+  The same header is expected on datagrams coming in.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "spsc.hpp"
+
+class CDgramPacker {
+public:
+  static const size_t MAX_DATAGRAM = 1472;  // fits an Ethernet MTU without fragmentation
+  static const size_t SEQ_LEN = 4;
+
+private:
+  bool seqen;
+  uint32_t txseq;
+  uint32_t rxseq;
+  bool rxsynced;
+
+public:
+  uint32_t lost;  // datagrams missing according to the received sequence numbers
+
+  void begin(bool seq) {
+    seqen = seq;
+    txseq = rxseq = 0;
+    rxsynced = false;
+    lost = 0;
+  }
+
+  size_t header_len(void) const { return seqen ? SEQ_LEN : 0; }
+
+  // Build one datagram out of ring data up to limit, returns its length or 0 if there is nothing to send
+  size_t pack(CSPSCRingBase *ring, uint32_t limit, uint8_t *out, size_t max = MAX_DATAGRAM) {
+    TRingSpan s1, s2;
+    size_t h = header_len();
+    if ((int32_t)(limit - ring->tail_pos()) <= 0) return 0;
+    size_t n = ring->peek_at(ring->tail_pos(), limit, s1, s2);
+    if (n == 0 || max <= h) return 0;
+    if (n > max - h) n = max - h;
+    if (seqen) {
+      out[0] = txseq >> 24;
+      out[1] = txseq >> 16;
+      out[2] = txseq >> 8;
+      out[3] = txseq;
+      txseq++;
+    }
+    size_t l1 = (n < s1.len) ? n : s1.len;
+    memcpy(&out[h], s1.ptr, l1);
+    memcpy(&out[h + l1], s2.ptr, n - l1);
+    ring->consume(n);
+    return h + n;
+  }
+
+  // Check the header of a received datagram, returns the offset of its payload
+  size_t unpack(const uint8_t *p, size_t len) {
+    if (!seqen) return 0;
+    if (len < SEQ_LEN) return len;
+    uint32_t seq = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    if (rxsynced && (int32_t)(seq - rxseq) > 0) lost += seq - rxseq;
+    if (!rxsynced || (int32_t)(seq - rxseq) >= 0) rxseq = seq + 1;
+    rxsynced = true;
+    return SEQ_LEN;
+  }
+
+  CDgramPacker() {
+    begin(false);
+  }
+};
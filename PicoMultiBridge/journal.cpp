@@ -0,0 +1,141 @@
+/*
+  journal
+
+  Append-only store of versioned, CRC protected records spread over several flash sectors.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include "crc16.hpp"
+#include "journal.hpp"
+
+CJournal::CJournal() {
+  fl = NULL;
+  slot_size = slots = 0;
+  newest = -1;
+  seq = head = 0;
+  appends = erases = 0;
+}
+
+bool CJournal::header(uint32_t slot, TJournalHeader &h) {
+  fl->read(slot * slot_size, &h, sizeof(h), fl->any);
+  return h.magic == MAGIC && h.len <= slot_size - sizeof(h);
+}
+
+// Header and payload against the CRC, read a page at a time
+bool CJournal::valid(uint32_t slot) {
+  TJournalHeader h;
+  CCRC16 CRC16;
+  uint16_t crc = 0xffff;
+
+  if (!header(slot, h)) return false;
+  uint16_t c = h.crc;
+  h.crc = 0xffff;
+  for (size_t i = 0; i < sizeof(h); i++) CRC16.get(&crc, ((uint8_t *)&h)[i]);
+  for (uint32_t i = 0; i < h.len; i += fl->page_size) {
+    uint32_t n = (h.len - i < fl->page_size) ? h.len - i : fl->page_size;
+    fl->read(slot * slot_size + sizeof(h) + i, page, n, fl->any);
+    for (uint32_t j = 0; j < n; j++) CRC16.get(&crc, page[j]);
+  }
+  return crc == c;
+}
+
+bool CJournal::erased(uint32_t off, uint32_t len) {
+  for (uint32_t i = 0; i < len; i += fl->page_size) {
+    fl->read(off + i, page, fl->page_size, fl->any);
+    for (uint32_t j = 0; j < fl->page_size; j++)
+      if (page[j] != 0xff) return false;
+  }
+  return true;
+}
+
+bool CJournal::begin(const TJournalFlash *flash, size_t maxlen) {
+  TJournalHeader h;
+
+  fl = NULL;
+  if (flash->sectors < 2 || flash->page_size > MAX_PAGE || flash->sector_size % flash->page_size != 0) return false;
+  for (slot_size = flash->page_size; slot_size < sizeof(h) + maxlen; slot_size <<= 1)
+    ;
+  if (slot_size > flash->sector_size) return false;
+  fl = flash;
+  slots = fl->sector_size / slot_size * fl->sectors;
+
+  // Headers only, the highest sequence number is where writing stopped
+  int32_t top = -1;
+  seq = 0;
+  for (uint32_t i = 0; i < slots; i++) {
+    if (header(i, h) && (top < 0 || (int32_t)(h.seq - seq) > 0)) {
+      top = i;
+      seq = h.seq;
+    }
+  }
+  head = (top < 0) ? 0 : (top + 1) % slots;
+
+  // Backwards from there to the first record that is intact
+  newest = -1;
+  for (uint32_t k = 0; top >= 0 && k < slots; k++) {
+    uint32_t i = (top + slots - k) % slots;
+    if (valid(i)) {
+      newest = i;
+      break;
+    }
+  }
+  return true;
+}
+
+int CJournal::read(void *buf, size_t len, uint8_t *version) {
+  TJournalHeader h;
+
+  if (fl == NULL || newest < 0) return -1;
+  header(newest, h);
+  size_t n = (h.len < len) ? h.len : len;
+  fl->read(newest * slot_size + sizeof(h), buf, n, fl->any);
+  memset((uint8_t *)buf + n, 0xff, len - n);
+  if (version != NULL) *version = h.version;
+  return h.len;
+}
+
+bool CJournal::append(const void *buf, size_t len, uint8_t version) {
+  TJournalHeader h;
+  CCRC16 CRC16;
+
+  if (fl == NULL || len > slot_size - sizeof(h)) return false;
+  size_t total = sizeof(h) + len;
+
+  // A slot that is not blank was torn or is bad, it is skipped
+  for (uint32_t k = 0; k < slots; k++, head = (head + 1) % slots) {
+    uint32_t off = head * slot_size;
+    if (off % fl->sector_size == 0 && !erased(off, fl->sector_size)) {
+      fl->erase(off, fl->any);
+      erases++;
+    }
+    if (!erased(off, slot_size)) continue;
+
+    h.magic = MAGIC;
+    h.len = len;
+    h.seq = ++seq;
+    h.crc = 0xffff;
+    h.version = version;
+    h.reserved = 0xff;
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < sizeof(h); i++) CRC16.get(&crc, ((uint8_t *)&h)[i]);
+    for (size_t i = 0; i < len; i++) CRC16.get(&crc, ((const uint8_t *)buf)[i]);
+    h.crc = crc;
+
+    // Header first, so that a record cut short is never taken for a blank slot
+    for (uint32_t p = 0; p < total; p += fl->page_size) {
+      memset(page, 0xff, fl->page_size);
+      for (uint32_t j = 0; j < fl->page_size && p + j < total; j++)
+        page[j] = (p + j < sizeof(h)) ? ((uint8_t *)&h)[p + j] : ((const uint8_t *)buf)[p + j - sizeof(h)];
+      fl->program(off + p, page, fl->page_size, fl->any);
+    }
+    if (!valid(head)) continue;
+    newest = head;
+    head = (head + 1) % slots;
+    appends++;
+    return true;
+  }
+  return false;
+}
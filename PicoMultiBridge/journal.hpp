@@ -0,0 +1,76 @@
+/*
+  journal
+
+  Append-only store of versioned, CRC protected records spread over several flash sectors.
+
+  Every record is a complete copy of the data, so only the newest valid one matters.
+  A record takes a fixed slot of whole pages and slots are written in order around the region.
+  A record torn by a power failure fails its CRC and the one before it is used instead.
+  Entering a sector erases it, which only drops records older than those in the sector just filled.
+  Nothing here depends on the Pico SDK, flash access is passed in.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Flash region, offsets are relative to its start
+typedef struct {
+  void (*read)(uint32_t off, void *buf, size_t len, void *any);
+  void (*program)(uint32_t off, const void *buf, size_t len, void *any);  // whole pages
+  void (*erase)(uint32_t off, void *any);                                   // one sector
+  void *any;
+  uint32_t sector_size;
+  uint32_t page_size;
+  uint32_t sectors;
+} TJournalFlash;
+
+typedef struct {
+  uint16_t magic;
+  uint16_t len;       // payload bytes
+  uint32_t seq;       // one more than the record before
+  uint16_t crc;       // CRC16 of the header with crc as 0xffff and the payload
+  uint8_t version;    // payload layout, up to the user
+  uint8_t reserved;
+} TJournalHeader;
+
+class CJournal {
+public:
+  static const uint16_t MAGIC = 0x4e4b;
+  static const uint32_t MAX_PAGE = 256;
+
+private:
+  const TJournalFlash *fl;
+  uint32_t slot_size;  // power of two number of pages
+  uint32_t slots;
+  int32_t newest;      // slot of the newest valid record, -1 if none
+  uint32_t seq;        // highest sequence number seen, torn records included
+  uint32_t head;       // slot of the next append
+  uint8_t page[MAX_PAGE];
+
+  bool header(uint32_t slot, TJournalHeader &h);
+  bool valid(uint32_t slot);
+  bool erased(uint32_t off, uint32_t len);
+
+public:
+  uint32_t appends;    // since begin()
+  uint32_t erases;
+
+  // Size the slots for records of up to maxlen bytes and find the newest record
+  bool begin(const TJournalFlash *flash, size_t maxlen);
+  bool ready(void) { return fl != NULL; }
+
+  // Newest record into buf, bytes beyond its length read 0xff like erased flash.
+  // Returns its length, -1 if there is none.
+  int read(void *buf, size_t len, uint8_t *version = NULL);
+  bool append(const void *buf, size_t len, uint8_t version);
+
+  uint32_t sequence(void) { return seq; }
+  uint32_t capacity(void) { return slots; }
+
+  CJournal();
+};
@@ -0,0 +1,111 @@
+/*
+  linecoding
+
+  Data bits, parity and stop bits packed into one byte, with the conversions to and from
+  each form they come and go in: USB CDC line coding, PUSR's bitset, the fields of
+  LsrMstInsert and RFC 2217, "8N1" text and the SERIAL_xxx values of the Arduino API.
+  Two settings compare as a single integer and nothing allocates.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class CLineCoding {
+public:
+  // Same order as CDC, LsrMstInsert and "NOEMS"
+  enum { NONE = 0, ODD, EVEN, MARK, SPACE };
+
+  // "8N1" and its terminator
+  typedef struct {
+    char s[4];
+  } TText;
+
+private:
+  // bit 0-1: data bits - 5, bit 2-4: parity, bit 5: 2 stop bits
+  uint8_t v;
+
+  static constexpr uint8_t clamp(int x, int lo, int hi) { return (x < lo) ? lo : (x > hi) ? hi : x; }
+
+public:
+  // Out of range values are clamped, 1.5 stop bits becomes 2
+  constexpr CLineCoding(int databits = 8, int parity = NONE, int stopbits = 1)
+    : v((clamp(databits, 5, 8) - 5) | (clamp(parity, NONE, SPACE) << 2) | ((stopbits == 1) ? 0 : 0x20)) {}
+
+  constexpr uint8_t raw(void) const { return v; }
+  constexpr int databits(void) const { return (v & 3) + 5; }
+  constexpr int parity(void) const { return (v >> 2) & 7; }
+  constexpr int stopbits(void) const { return (v & 0x20) ? 2 : 1; }
+  // Bits a character takes on the line, start bit included
+  constexpr int charbits(void) const { return 1 + databits() + ((parity() != NONE) ? 1 : 0) + stopbits(); }
+  constexpr bool operator==(const CLineCoding &o) const { return v == o.v; }
+  constexpr bool operator!=(const CLineCoding &o) const { return v != o.v; }
+
+  constexpr CLineCoding with_databits(int d) const { return CLineCoding(d, parity(), stopbits()); }
+  constexpr CLineCoding with_parity(int p) const { return CLineCoding(databits(), p, stopbits()); }
+  constexpr CLineCoding with_stopbits(int s) const { return CLineCoding(databits(), parity(), s); }
+
+  // USB CDC SET_LINE_CODING, stop_bits 0:1 1:1.5 2:2
+  static constexpr CLineCoding from_cdc(uint8_t data_bits, uint8_t parity, uint8_t stop_bits) {
+    return CLineCoding(data_bits, parity, (stop_bits == 0) ? 1 : 2);
+  }
+  constexpr uint8_t cdc_stop_bits(void) const { return (v & 0x20) ? 2 : 0; }
+
+  // LsrMstInsert carries the Windows DCB fields, which count like CDC
+  static constexpr CLineCoding from_lsrmst(int bytesize, int parity, int stopbits) {
+    return CLineCoding(bytesize, parity, (stopbits == 0) ? 1 : 2);
+  }
+
+  // PUSR, bit 0-1: data bits - 5, bit 2: 2 stop bits, bit 3: parity on, bit 4-5: 0:ODD 1:EVEN 2:MARK 3:SPACE
+  static constexpr CLineCoding from_pusr(uint8_t b) {
+    return CLineCoding((b & 3) + 5, (b & 8) ? ((b >> 4) & 3) + ODD : NONE, (b & 4) ? 2 : 1);
+  }
+  constexpr uint8_t pusr(void) const {
+    return (v & 3) | ((v & 0x20) ? 4 : 0) | ((parity() != NONE) ? 8 | (parity() - ODD) << 4 : 0);
+  }
+
+  // RFC 2217, parity 1:NONE ... 5:SPACE, stop size 1:1 2:2 3:1.5
+  static constexpr int rfc2217_parity(int p) { return p - 1; }
+  static constexpr int rfc2217_stopbits(int s) { return (s == 1) ? 1 : 2; }
+  constexpr uint8_t rfc2217_parity(void) const { return parity() + 1; }
+  constexpr uint8_t rfc2217_stopsize(void) const { return stopbits(); }
+
+  // Arduino API, SERIAL_DATA_x | SERIAL_PARITY_x | SERIAL_STOP_BIT_x
+  constexpr uint16_t serial(void) const {
+    return (databits() - 4) << 8 | ((v & 0x20) ? 0x30 : 0x10) | ((0x54123 >> (parity() * 4)) & 0xf);
+  }
+  static bool from_serial(uint16_t config, CLineCoding &c) {
+    int d = (config >> 8) & 0xf, s = (config >> 4) & 0xf, p;
+    switch (config & 0xf) {
+      case 0x3: p = NONE; break;
+      case 0x2: p = ODD; break;
+      case 0x1: p = EVEN; break;
+      case 0x4: p = MARK; break;
+      case 0x5: p = SPACE; break;
+      default: return false;
+    }
+    if (d < 1 || d > 4 || (s != 1 && s != 3)) return false;
+    c = CLineCoding(d + 4, p, (s == 1) ? 1 : 2);
+    return true;
+  }
+
+  // "8N1", case insensitive
+  static bool parse(const char *s, CLineCoding &c) {
+    static const char par[] = "NOEMS";
+    if (s == nullptr || s[0] < '5' || s[0] > '8' || s[1] == '\0' || (s[2] != '1' && s[2] != '2') || s[3] != '\0') return false;
+    char u = (s[1] >= 'a' && s[1] <= 'z') ? s[1] - 'a' + 'A' : s[1];
+    for (int p = NONE; p <= SPACE; p++)
+      if (par[p] == u) {
+        c = CLineCoding(s[0] - '0', p, s[2] - '0');
+        return true;
+      }
+    return false;
+  }
+  constexpr TText text(void) const {
+    return { { (char)('0' + databits()), "NOEMS"[parity()], (char)('0' + stopbits()), '\0' } };
+  }
+};
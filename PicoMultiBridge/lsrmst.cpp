@@ -0,0 +1,169 @@
+/*
+  lsrmst
+
+  Streaming decoder for the stream produced by Windows IOCTL_SERIAL_LSRMST_INSERT.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include "lsrmst.hpp"
+
+CLsrMstDecoder::CLsrMstDecoder() {
+  escapeChar = 'a';
+  datafunc = NULL;
+  baudfunc = NULL;
+  formatfunc = NULL;
+  any = NULL;
+  reset();
+}
+
+void CLsrMstDecoder::begin(lsrmst_data_callback *d, lsrmst_baud_callback *b, lsrmst_format_callback *f, void *a, uint8_t esc) {
+  datafunc = d;
+  baudfunc = b;
+  formatfunc = f;
+  any = a;
+  escapeChar = esc;
+  reset();
+}
+
+void CLsrMstDecoder::reset(void) {
+  state = subState = 0;
+  run = NULL;
+  runlen = 0;
+  code = 0;
+  byteSize = parity = 0;
+}
+
+// Hands the run over
+void CLsrMstDecoder::flush(void) {
+  if (runlen > 0 && datafunc != NULL) datafunc(run, runlen, any);
+  runlen = 0;
+}
+
+// The run goes on in the stage, one too long for it goes over as it is
+void CLsrMstDecoder::to_stage(void) {
+  if (runlen == 0 || run == stage) return;
+  if (runlen > STAGE_LEN) {
+    flush();
+    return;
+  }
+  memcpy(stage, run, runlen);
+  run = stage;
+}
+
+// Data from the input joins the run, without a copy while it follows on from it there
+void CLsrMstDecoder::gather(const uint8_t *p, size_t len) {
+  if (runlen == 0) {
+    run = p;
+    runlen = len;
+    return;
+  }
+  if (run != stage && run + runlen == p) {
+    runlen += len;
+    return;
+  }
+  to_stage();
+  while (len > 0) {
+    if (runlen == 0) {
+      run = p;
+      runlen = len;
+      return;
+    }
+    size_t n = STAGE_LEN - runlen;
+    if (n > len) n = len;
+    memcpy(&stage[runlen], p, n);
+    runlen += n;
+    p += n;
+    len -= n;
+    if (runlen == STAGE_LEN) flush();
+  }
+}
+
+// An escaped escape character, which is in the input only as part of its sequence
+void CLsrMstDecoder::literal(uint8_t ch) {
+  to_stage();
+  run = stage;
+  stage[runlen++] = ch;
+  if (runlen == STAGE_LEN) flush();
+}
+
+// One byte following the escape character
+void CLsrMstDecoder::step(uint8_t ch) {
+  if (state == 1) {
+    code = ch;
+    state = 2;
+  }
+  switch (code) {
+    case SERIAL_LSRMST_ESCAPE:
+      literal(escapeChar);
+      state = subState = 0;
+      break;
+    case SERIAL_LSRMST_LSR_DATA:
+      // LSR and DATA follow
+      if (subState < 2) subState++;
+      else state = subState = 0;
+      break;
+    case SERIAL_LSRMST_LSR_NODATA:
+    case SERIAL_LSRMST_MST:
+      // LSR or MSR follows
+      if (subState == 0) subState++;
+      else state = subState = 0;
+      break;
+    case C0CE_INSERT_RBR:
+      // 32bit baudrate follows (LSB first)
+      if (subState == 0) {
+        subState++;
+      } else {
+        baud_byte[subState - 1] = ch;
+        if (subState < (int)sizeof(uint32_t)) {
+          subState++;
+        } else {
+          uint32_t baud = baud_byte[0] | (baud_byte[1] << 8) | (baud_byte[2] << 16) | ((uint32_t)baud_byte[3] << 24);
+          state = subState = 0;
+          // The data before the change goes out at the old rate
+          flush();
+          if (baudfunc != NULL) baudfunc(baud, any);
+        }
+      }
+      break;
+    case C0CE_INSERT_RLC:
+      // ByteSize, Parity and StopBits follow
+      if (subState == 0) {
+        subState++;
+      } else if (subState == 1) {
+        byteSize = ch;
+        subState++;
+      } else if (subState == 2) {
+        parity = ch;
+        subState++;
+      } else {
+        state = subState = 0;
+        flush();
+        if (formatfunc != NULL) formatfunc(byteSize, parity, ch, any);
+      }
+      break;
+    default:
+      state = subState = 0;
+      break;
+  }
+}
+
+void CLsrMstDecoder::decode(const uint8_t *p, size_t len) {
+  size_t start = 0, i = 0;
+
+  while (i < len) {
+    if (state == 0) {
+      const uint8_t *q = (const uint8_t *)memchr(&p[i], escapeChar, len - i);
+      if (q == NULL) break;
+      i = q - p;
+      if (i > start) gather(&p[start], i - start);
+      state = 1;
+    } else
+      step(p[i]);
+    start = ++i;
+  }
+  if (len > start) gather(&p[start], len - start);
+  flush();
+}
@@ -0,0 +1,69 @@
+/*
+  lsrmst
+
+  Streaming decoder for the stream produced by Windows IOCTL_SERIAL_LSRMST_INSERT,
+  including the baudrate (C0CE_INSERT_RBR) and line control (C0CE_INSERT_RLC) extensions.
+
+  All state lives in the object, so it can be fed reads of any size and
+  an escape sequence may be split anywhere. The data of one read is handed over in one
+  piece, cut only where a baudrate or format change falls: straight from the input buffer
+  while it lies there in one piece, gathered in a stage of its own once an escaped escape
+  character or a dropped sequence leaves a gap in it.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void(lsrmst_data_callback)(const uint8_t *p, size_t len, void *any);
+typedef void(lsrmst_baud_callback)(uint32_t baud, void *any);
+typedef void(lsrmst_format_callback)(int bytesize, int parity, int stopbits, void *any);
+
+class CLsrMstDecoder {
+public:
+  static const uint8_t SERIAL_LSRMST_ESCAPE = 0x00;
+  static const uint8_t SERIAL_LSRMST_LSR_DATA = 0x01;
+  static const uint8_t SERIAL_LSRMST_LSR_NODATA = 0x02;
+  static const uint8_t SERIAL_LSRMST_MST = 0x03;
+  static const uint8_t C0CE_INSERT_RBR = 16;
+  static const uint8_t C0CE_INSERT_RLC = 17;
+  // At least what the bridge hands over per read, so a read is never cut for room
+  static const size_t STAGE_LEN = 512;
+
+private:
+  uint8_t escapeChar;
+
+  int state;      // 0:data 1:escape received 2:inside a sequence
+  uint8_t code;
+  int subState;
+  uint8_t baud_byte[sizeof(uint32_t)];
+  int byteSize;
+  int parity;
+
+  // The data run handed over next, in the input or the stage
+  const uint8_t *run;
+  size_t runlen;
+  uint8_t stage[STAGE_LEN];
+
+  lsrmst_data_callback *datafunc;
+  lsrmst_baud_callback *baudfunc;
+  lsrmst_format_callback *formatfunc;
+  void *any;
+
+  void step(uint8_t ch);
+  void to_stage(void);
+  void gather(const uint8_t *p, size_t len);
+  void literal(uint8_t ch);
+  void flush(void);
+
+public:
+  void begin(lsrmst_data_callback *d, lsrmst_baud_callback *b, lsrmst_format_callback *f, void *any = NULL, uint8_t esc = 'a');
+  void reset(void);
+  void decode(const uint8_t *p, size_t len);
+
+  CLsrMstDecoder();
+};
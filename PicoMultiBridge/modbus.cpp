@@ -0,0 +1,170 @@
+/*
+  modbus
+
+  Modbus TCP to Modbus RTU gateway.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include "crc16.hpp"
+#include "modbus.hpp"
+
+CModbusGateway::CModbusGateway() {
+  uartfunc = NULL;
+  netfunc = NULL;
+  any = NULL;
+  char_us = 0;
+  t35_us = FAST_T35_US;
+  reset();
+}
+
+void CModbusGateway::begin(modbus_uart_callback *u, modbus_net_callback *n, void *a) {
+  uartfunc = u;
+  netfunc = n;
+  any = a;
+  reset();
+}
+
+void CModbusGateway::reset(void) {
+  qhead = qtail = 0;
+  fill = 0;
+  state = sIdle;
+  rxlen = resplen = 0;
+  last_rx = sent_at = 0;
+  wait_us = 0;
+}
+
+void CModbusGateway::line(uint32_t baud, int bits) {
+  if (baud == 0 || bits <= 0) return;
+  char_us = (uint32_t)(((uint64_t)bits * 1000000 + baud - 1) / baud);
+  t35_us = (baud > 19200) ? FAST_T35_US : (uint32_t)(((uint64_t)bits * 3500000 + baud - 1) / baud);
+}
+
+size_t CModbusGateway::room(void) const {
+  if (qhead - qtail >= (uint32_t)QUEUE_LEN) return 0;
+  return (fill < CModbus::RECORD_HEAD) ? CModbus::RECORD_HEAD - fill : record_len(queue[qhead % QUEUE_LEN]) - fill;
+}
+
+// Records as core 0 made them, pieces of any size
+void CModbusGateway::decode(const uint8_t *p, size_t len) {
+  size_t n;
+  while (len > 0 && (n = room()) > 0) {
+    uint8_t *r = queue[qhead % QUEUE_LEN];
+    if (n > len) n = len;
+    memcpy(&r[fill], p, n);
+    fill += n;
+    p += n;
+    len -= n;
+    // core 0 has checked the header already, but a bad one would derail everything after it
+    if (fill == CModbus::RECORD_HEAD && !CModbus::valid_mbap(&r[1])) {
+      fill = 0;
+      continue;
+    }
+    if (fill > CModbus::RECORD_HEAD && fill == record_len(r)) {
+      qhead++;
+      fill = 0;
+      stat.requests.add(1);
+      stat.max_queued.peak(qhead - qtail);
+    }
+  }
+}
+
+void CModbusGateway::receive(const uint8_t *p, size_t len, uint32_t now) {
+  if (len == 0) return;
+  last_rx = now;
+  if (state != sWait) {
+    stat.stray.add(len);
+    return;
+  }
+  size_t n = (rxlen < CModbus::MAX_RTU) ? CModbus::MAX_RTU - rxlen : 0;
+  if (n > len) n = len;
+  memcpy(&resp[7 + rxlen], p, n);
+  // Counts on past the buffer, such a frame is bad anyway
+  rxlen += len;
+}
+
+// Tag, transaction id and protocol id of the request being served, and the length field
+void CModbusGateway::header(size_t len) {
+  memcpy(resp, queue[qtail % QUEUE_LEN], 5);
+  resp[5] = (uint8_t)(len >> 8);
+  resp[6] = (uint8_t)len;
+}
+
+void CModbusGateway::exception(uint8_t code) {
+  const uint8_t *q = &queue[qtail % QUEUE_LEN][CModbus::RECORD_HEAD - 1];
+  header(3);
+  resp[7] = q[0];
+  resp[8] = q[1] | 0x80;
+  resp[9] = code;
+  resplen = 10;
+  state = sReply;
+}
+
+// The line fell silent after a response
+void CModbusGateway::finish(void) {
+  CCRC16 CRC16;
+  const uint8_t *q = &queue[qtail % QUEUE_LEN][CModbus::RECORD_HEAD - 1];  // unit id and function
+  const uint8_t *f = &resp[7];
+  bool ok = rxlen >= 4 && rxlen <= CModbus::MAX_RTU;
+  ok = ok && CRC16.calc(f, rxlen - 2) == (f[rxlen - 2] | f[rxlen - 1] << 8);
+  ok = ok && f[0] == q[0] && (f[1] & 0x7f) == q[1];
+  if (!ok) {
+    stat.bad_frames.add(1);
+    exception(CModbus::GATEWAY_TARGET_FAILED);
+    return;
+  }
+  stat.responses.add(1);
+  if (f[1] & 0x80) stat.exceptions.add(1);
+  header(rxlen - 2);
+  resplen = 7 + rxlen - 2;
+  state = sReply;
+}
+
+bool CModbusGateway::poll(uint32_t now) {
+  switch (state) {
+    case sIdle: {
+      // A request goes out only onto a line that has been silent for 3.5 characters
+      if (qhead == qtail || now - last_rx < t35_us || now - sent_at < wait_us) return false;
+      CCRC16 CRC16;
+      uint8_t *r = queue[qtail % QUEUE_LEN];
+      uint8_t *f = &r[CModbus::RECORD_HEAD - 1];
+      size_t n = record_len(r) - (CModbus::RECORD_HEAD - 1);
+      uint16_t crc = CRC16.calc(f, n);
+      f[n] = (uint8_t)crc;
+      f[n + 1] = (uint8_t)(crc >> 8);
+      if (uartfunc != NULL) uartfunc(f, n + 2, any);
+      // Timed from when the frame will have left
+      sent_at = now;
+      wait_us = (n + 2) * char_us;
+      if (f[0] == 0) {
+        stat.broadcasts.add(1);
+        wait_us += BROADCAST_DELAY_US;
+        qtail++;
+      } else {
+        wait_us += RESPONSE_TIMEOUT_US;
+        rxlen = 0;
+        state = sWait;
+      }
+      return true;
+    }
+    case sWait:
+      if (rxlen > 0) {
+        if (now - last_rx < t35_us) return false;
+        finish();
+        return true;
+      }
+      if (now - sent_at < wait_us) return false;
+      stat.timeouts.add(1);
+      exception(CModbus::GATEWAY_TARGET_FAILED);
+      return true;
+    case sReply:
+      if (netfunc != NULL && !netfunc(resp, resplen, any)) return false;
+      qtail++;
+      wait_us = 0;
+      state = sIdle;
+      return true;
+  }
+  return false;
+}
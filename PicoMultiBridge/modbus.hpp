@@ -0,0 +1,143 @@
+/*
+  modbus
+
+  Modbus TCP to Modbus RTU gateway.
+
+  Between the cores a transaction travels as a record, a session tag followed by the
+  MBAP header and the PDU, in both directions. The tag tells core 0 which client a
+  response belongs to; core 1 only carries it along.
+  Requests from all clients are queued in the order they arrived and go out on the
+  serial line one at a time, as unit id, PDU and CRC16. A response ends once the line
+  has been silent for 3.5 character times and goes back with the MBAP header of its request.
+  A unit that does not answer, or answers with a broken frame, earns the client a
+  "gateway target device failed to respond" exception instead. Unit 0 is a broadcast,
+  nobody answers it and the client gets nothing back.
+  The caller passes in the time, so the framing runs just as well on simulated timings.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "perf.hpp"
+
+class CModbus {
+public:
+  static const size_t MBAP_LEN = 7;                   // transaction id, protocol id, length, unit id
+  static const size_t MAX_PDU = 253;
+  static const size_t MAX_ADU = MBAP_LEN + MAX_PDU;
+  static const size_t RECORD_HEAD = 1 + MBAP_LEN;     // tag and MBAP header
+  static const size_t MAX_RECORD = 1 + MAX_ADU;
+  static const size_t MAX_RTU = 1 + MAX_PDU + 2;      // unit id, PDU, CRC16
+
+  static const uint8_t GATEWAY_TARGET_FAILED = 0x0b;
+
+  // The length field counts the unit id and the PDU
+  static size_t adu_len(const uint8_t *mbap) { return 6 + ((size_t)mbap[4] << 8 | mbap[5]); }
+  static bool valid_mbap(const uint8_t *mbap) {
+    size_t l = (size_t)mbap[4] << 8 | mbap[5];
+    return mbap[2] == 0 && mbap[3] == 0 && l >= 2 && l <= 1 + MAX_PDU;
+  }
+};
+
+// Collects one ADU from a TCP stream that may split or merge them anywhere, core 0
+class CMbapAssembler {
+  uint8_t buf[CModbus::MAX_ADU];
+  size_t fill;
+
+public:
+  void reset(void) { fill = 0; }
+  // Bytes to read next, no more so that the following ADU stays in the socket
+  size_t need(void) const { return (fill < CModbus::MBAP_LEN) ? CModbus::MBAP_LEN - fill : CModbus::adu_len(buf) - fill; }
+  uint8_t *tail(void) { return &buf[fill]; }
+  // Account for n bytes read into tail(), false if the header is not Modbus TCP.
+  // There is no resynchronising a stream after that.
+  bool add(size_t n) {
+    fill += n;
+    return fill != CModbus::MBAP_LEN || CModbus::valid_mbap(buf);
+  }
+  bool complete(void) const { return fill >= CModbus::MBAP_LEN && fill == CModbus::adu_len(buf); }
+  const uint8_t *adu(void) const { return buf; }
+  size_t len(void) const { return fill; }
+
+  CMbapAssembler() : fill(0) {}
+};
+
+typedef void(modbus_uart_callback)(const uint8_t *p, size_t len, void *any);
+// A whole response record, false if there is no room for it yet
+typedef bool(modbus_net_callback)(const uint8_t *p, size_t len, void *any);
+
+// Serial side, core 1
+class CModbusGateway {
+public:
+  static const int QUEUE_LEN = 8;
+  static const uint32_t RESPONSE_TIMEOUT_US = 1000000;
+  static const uint32_t BROADCAST_DELAY_US = 100000;  // turnaround the units get after a broadcast
+  static const uint32_t FAST_T35_US = 1750;           // fixed above 19200bps by the specification
+
+private:
+  typedef enum {
+    sIdle,
+    sWait,   // request sent, collecting the response
+    sReply   // response or exception ready, waiting for room on the way back
+  } TState;
+
+  uint8_t queue[QUEUE_LEN][CModbus::MAX_RECORD + 2];  // room for the CRC behind the PDU
+  uint32_t qhead, qtail;  // requests taken in and retired
+  size_t fill;            // of the one at qhead, being assembled
+
+  TState state;
+  uint8_t resp[1 + 6 + CModbus::MAX_RTU];  // tag, MBAP up to the length, then the RTU frame as received
+  size_t rxlen;
+  size_t resplen;
+
+  uint32_t char_us;
+  uint32_t t35_us;
+  // Elapsed times are taken as unsigned differences, which stay right across the wrap of now
+  uint32_t last_rx;   // when the line was last seen busy
+  uint32_t sent_at;   // when the last request went out
+  uint32_t wait_us;   // from sent_at, for the response or until a broadcast has been dealt with
+
+  modbus_uart_callback *uartfunc;
+  modbus_net_callback *netfunc;
+  void *any;
+
+  static size_t record_len(const uint8_t *rec) { return 1 + CModbus::adu_len(&rec[1]); }
+  void header(size_t len);
+  void finish(void);
+  void exception(uint8_t code);
+
+public:
+  struct {
+    CPerfCounter requests;
+    CPerfCounter responses;
+    CPerfCounter exceptions;  // from the units
+    CPerfCounter timeouts;
+    CPerfCounter bad_frames;  // CRC, length, unit or function did not match
+    CPerfCounter broadcasts;
+    CPerfCounter stray;       // bytes received while no response was expected
+    CPerfCounter max_queued;
+  } stat;
+
+  void begin(modbus_uart_callback *u, modbus_net_callback *n, void *any = NULL);
+  void reset(void);
+  // Character time from the actual baudrate and the bits a character takes on the line
+  void line(uint32_t baud, int bits);
+  uint32_t t35(void) const { return t35_us; }
+
+  // Requests, room() is what decode() takes at most just now
+  size_t room(void) const;
+  void decode(const uint8_t *p, size_t len);
+  int queued(void) const { return qhead - qtail; }
+
+  // Bytes from the UART, now is when they were seen
+  void receive(const uint8_t *p, size_t len, uint32_t now);
+  // Sends, frames and times out, true if anything happened
+  bool poll(uint32_t now);
+
+  CModbusGateway();
+};
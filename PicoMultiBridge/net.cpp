@@ -15,7 +15,7 @@
 
 static String pass(const char *s) {
   String p;
-  for (int i = 0; i < strlen(s); i++) {
+  for (size_t i = 0; i < strlen(s); i++) {
     p += '*';
   }
   return p;
@@ -29,6 +29,55 @@ void CNet::print_stat(void) {
   Serial.printf(" My IP is %s/%s\n", WiFi.softAPIP().toString().c_str(), WiFi.subnetMask().toString().c_str());
   Serial.printf(" RSSI is %ddBm\n", WiFi.RSSI());
   Serial.printf(" TCP server started at %s:%d\n", WiFi.localIP().toString().c_str(), NetInfo.port);
+  if (NetInfo.mode == 2 && NetInfo.wificache.valid == 1) {
+    const uint8_t *b = NetInfo.wificache.bssid;
+    Serial.printf(" BSSID is %02x:%02x:%02x:%02x:%02x:%02x on channel %d\n", b[0], b[1], b[2], b[3], b[4], b[5], NetInfo.wificache.channel);
+  }
+  Serial.printf(" Serving %lums after boot, link lost %lu times, last back in %lums (max %lums)\n", BootToServing, Drops, Recovered, MaxRecovered);
+}
+
+// Time given to the current attempt
+uint32_t CNet::retry_time(void) {
+  uint32_t t = WIFI_REJOIN_MIN_TIME << ((attempt < 4) ? attempt : 4);
+  return (t < WIFI_REJOIN_MAX_TIME) ? t : WIFI_REJOIN_MAX_TIME;
+}
+
+// Only the first attempt goes for the cached AP, it may be gone
+const uint8_t *CNet::join_bssid(void) {
+  return (attempt == 0 && NetInfo.wificache.valid == 1) ? NetInfo.wificache.bssid : NULL;
+}
+
+// The link has come up
+void CNet::online(void) {
+  if (BootToServing == 0) BootToServing = millis();
+  if (DropTime != 0) {
+    Recovered = millis() - DropTime;
+    if (Recovered > MaxRecovered) MaxRecovered = Recovered;
+    DropTime = 0;
+  }
+  attempt = 0;
+  if (NetInfo.mode == 2) {
+    TWiFiCache c;
+    c.valid = 1;
+    WiFi.BSSID(c.bssid);
+    c.channel = WiFi.channel();
+    if (memcmp(&c, &NetInfo.wificache, sizeof(c)) != 0) {
+      NetInfo.wificache = c;
+      cache_dirty = true;
+    }
+  }
+  // A rejoin leaves the server listening
+  if (server->status() == 0) {
+    server->begin();
+    server->setNoDelay(true);
+  }
+}
+
+bool CNet::cacheChanged(TWiFiCache *c) {
+  if (!cache_dirty) return false;
+  *c = NetInfo.wificache;
+  cache_dirty = false;
+  return true;
 }
 
 bool CNet::SetWiFiMode(void) {
@@ -49,7 +98,7 @@ bool CNet::SetWiFiMode(void) {
       WiFi.mode(WIFI_STA);
       WiFi.setHostname(NetInfo.hostname);
       if (NetInfo.ip != IPAddress(0, 0, 0, 0)) WiFi.config(NetInfo.ip, NetInfo.ip, NetInfo.mask);
-      WiFi.begin(NetInfo.ssid, NetInfo.psk);
+      WiFi.beginNoBlock(NetInfo.ssid, NetInfo.psk, join_bssid());
       break;
     default:
       break;
@@ -71,30 +120,39 @@ uint8_t CNet::poll(CLED *led, net_hp_callback *func, void *any) {
       led->set_pattern(3);
       SetWiFiMode();
       server->end();
-      ConnectTime = millis() + WIFI_CONNECTION_ATTEMPT_TIME;
+      ConnectTime = millis() + ((NetInfo.mode == 2 && retry_time() > WIFI_CONNECTION_ATTEMPT_TIME) ? retry_time() : WIFI_CONNECTION_ATTEMPT_TIME);
+      pollstat = 0;
+      break;
+    // Rejoin, association only
+    case 2:
+      led->set_pattern(3);
+      WiFi.beginNoBlock(NetInfo.ssid, NetInfo.psk, join_bssid());
+      ConnectTime = millis() + retry_time();
       pollstat = 0;
       break;
     case 0:
       if (!is_Connected()) {
-        if (millis() > ConnectTime) pollstat = -1;
+        if (millis() > ConnectTime) {
+          if (attempt < 255) attempt++;
+          pollstat = (NetInfo.mode == 2 && DropTime != 0 && attempt < WIFI_REJOIN_ATTEMPTS) ? 2 : -1;
+        }
       } else {
         if (NetInfo.mode == 1) {
           led->set_pattern(0);
-          server->begin();
-          server->setNoDelay(true);
+          online();
 //          Serial.printf("Connected to '%s' %ddBm\nTCP server started at %s:%d\n", WiFi.SSID().c_str(), WiFi.RSSI(), WiFi.localIP().toString().c_str(), NetInfo.port);
           MDNS.begin(NetInfo.hostname);
           pollstat = 1;
         } else {
           if (WiFi.RSSI() != 0 && WiFi.RSSI() != -255) {
             led->set_pattern(0);
-            server->begin();
-            server->setNoDelay(true);
+            online();
 //            Serial.printf("Connected to '%s' %ddBm\nTCP server started at %s:%d\n", WiFi.SSID().c_str(), WiFi.RSSI(), WiFi.localIP().toString().c_str(), NetInfo.port);
             MDNS.begin(NetInfo.hostname);
             pollstat = 1;
           } else {
             if (millis() > ConnectTime) {
+              if (attempt < 255) attempt++;
               pollstat = -1;
             }
           }
@@ -138,20 +196,35 @@ uint8_t CNet::poll(CLED *led, net_hp_callback *func, void *any) {
             }
           }
         }
-      } else pollstat = -1;
+      } else {
+        // The link has been down for WIFI_UNCONNECTED_DURATION_TIME already
+        DropTime = millis() - WIFI_UNCONNECTED_DURATION_TIME;
+        Drops++;
+        attempt = 0;
+        pollstat = (NetInfo.mode == 2) ? 2 : -1;
+      }
       break;
   }
   return pollstat;
 }
 
+// With the raw TCP transport the bridge owns the port itself,
+// the server is then only there for the connection handling above and listens on an ephemeral port
+uint16_t CNet::server_port(void) {
+  return (NetInfo.transport == 2) ? 0 : NetInfo.port;
+}
+
 void CNet::reset(void) {
   if (server != NULL) delete server;
-  server = new WiFiServer(NetInfo.port);
+  server = new WiFiServer(server_port());
 }
 
 CNet::CNet() {
   server = NULL;
   pollstat = -1;
+  attempt = 0;
+  cache_dirty = false;
+  DropTime = BootToServing = Drops = Recovered = MaxRecovered = 0;
   WiFiConnectedDelay = new CDelay(CDelay::tOffDelay, false, 0, WIFI_UNCONNECTED_DURATION_TIME);
 }
 
@@ -168,7 +241,7 @@ uint8_t CNet::begin(const TNetInfo info) {
   memcpy((void *)&NetInfo, (void *)&info, sizeof(TNetInfo));
   CurrentTime = millis();
   PreviousTime = 0;
-  server = new WiFiServer(NetInfo.port);
+  server = new WiFiServer(server_port());
   pollstat = -1;
 
   return info.mode;
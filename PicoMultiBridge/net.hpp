@@ -16,6 +16,22 @@
 #include "led.hpp"
 #include "delay.hpp"
 
+// Last association in STA mode, kept so that the next join can go straight to the same AP
+typedef struct {
+  uint8_t valid;        // 1 if the rest holds
+  uint8_t bssid[6];
+  uint8_t channel;
+} TWiFiCache;
+
+// A bridge on a PIO UART, always 8N1
+typedef struct {
+  uint8_t enable;       // 0:off 1:on
+  uint16_t port;        // port for client connection
+  uint8_t tx, rx;       // pins, any GPIO not used by the CYW43
+  uint8_t encprotocol;  // same values as encprotocol
+  uint32_t baudrate;    // default baudrate
+} TPioPortInfo;
+
 typedef struct {
   char key[2];          // nvm reserved. don't care !!
 
@@ -27,9 +43,37 @@ typedef struct {
   IPAddress mask;       // Net mask
   uint16_t port;        // Port for client connection
 
-  uint8_t encprotocol;  // 0:OFF 1:PUSR 2:LsrMstInsert
+  uint8_t encprotocol;  // 0:OFF 1:PUSR 2:LsrMstInsert 3:RFC2217 4:Modbus TCP to RTU gateway
   uint32_t baudrate;    // default baudrate
   char serconfig[10];   // default serial config
+
+  uint8_t arbitration;  // 0:first 1:last 2:demand, which client may write to the UART
+  uint8_t slowclient;   // 0:wait 1:drop 2:disconnect, what to do with a client that cannot keep up
+
+  uint16_t packlen;     // UART data is sent once this many bytes are buffered, 0:off
+  uint8_t packidle;     // or once the line has been idle for this many characters, 0:off
+  int16_t packdelim;    // or when this byte arrives, -1:off
+
+  uint8_t transport;    // 0:TCP 1:UDP 2:TCP on the lwIP raw API, one client
+  IPAddress udpremote;  // UDP destination, unicast or multicast group. 0.0.0.0:last sender
+  uint16_t udpport;     // UDP destination port, 0:same as port
+  uint8_t udpseq;       // 0:plain datagrams 1:with sequence number header
+
+  uint8_t flowctrl;     // 0:none 1:RTS/CTS
+
+  uint8_t uart2;        // 0:off 1:second bridge on UART0
+  uint16_t port2;       // its port for client connection
+  uint8_t tx2, rx2;     // its pins
+  uint8_t encprotocol2; // its serial protocol, same values as encprotocol
+  uint32_t baudrate2;   // its default baudrate
+  char serconfig2[10];  // its default serial config
+
+  TPioPortInfo pio[2];  // further bridges on PIO state machines
+
+  TWiFiCache wificache; // maintained by CNet
+
+  uint8_t backlog;      // 0:off 1:keep UART data while no client is connected and send it to the next one
+  int16_t replay;       // 0:all of it N>0:the last N KB N<0:the last -N seconds
 } TNetInfo;
 
 typedef void(net_hp_callback)(WiFiClient *cli, String *header, void *any);
@@ -38,6 +82,11 @@ class CNet {
   const uint32_t WIFI_CONNECTION_ATTEMPT_TIME = 10000;
   const uint32_t WIFI_UNCONNECTED_DURATION_TIME = 1000;
   const uint32_t CLIENT_TIMEOUT_MS = 10000;
+  // A lost STA link is first rejoined without tearing the stack down, which keeps the address and the sockets.
+  // Each failed attempt doubles the time given to the next one.
+  const uint32_t WIFI_REJOIN_MIN_TIME = 4000;
+  const uint32_t WIFI_REJOIN_MAX_TIME = 32000;
+  const uint8_t WIFI_REJOIN_ATTEMPTS = 2;  // before falling back to a full restart
 
   TNetInfo NetInfo;
 
@@ -49,10 +98,22 @@ class CNet {
   const char *hostname;
 
   int8_t pollstat;
+  uint8_t attempt;     // failed attempts since the link was last up
+  bool cache_dirty;
+
+  // Timings
+  uint32_t DropTime;   // millis() the link was lost, 0 while it is up
+  uint32_t BootToServing;
+  uint32_t Drops;
+  uint32_t Recovered, MaxRecovered;
 
   CDelay *WiFiConnectedDelay;
 
   bool SetWiFiMode(void);
+  uint16_t server_port(void);
+  uint32_t retry_time(void);
+  const uint8_t *join_bssid(void);
+  void online(void);
 
 public:
   WiFiServer *server;
@@ -63,6 +124,8 @@ public:
   uint8_t poll(CLED *led, net_hp_callback *func, void *any = NULL);
 
   void reset(void);
+  // True once after an association to a different AP, c is what should be saved
+  bool cacheChanged(TWiFiCache *c);
 
   CNet();
   uint8_t begin(TNetInfo info);
@@ -4,6 +4,16 @@
   The first two bytes and the last byte of the region are used to track the state of the NVM.
   Specifically, the first two bytes must be reserved at the beginning of the data to be written.
 
+  Flush() appends the first Init(len) bytes of the EEPROM image to a journal instead of rewriting
+  the EEPROM sector, and Read() takes the newest journalled copy. Whatever the EEPROM sector holds
+  is journalled once when the journal is still empty.
+  The journal lives in the filesystem region if the board has one of at least two sectors, the
+  filesystem itself is not used by this sketch. Otherwise it takes the sectors just below the
+  filesystem (or the EEPROM, when the filesystem is empty) that the sketch binary leaves free,
+  the end of the free space that a larger sketch reaches last. Flashing a sketch that grows into
+  them loses the journal, and the settings go back to the last copy in the EEPROM sector.
+  With neither, everything stays in the EEPROM sector.
+
   SPDX-License-Identifier: MIT
   SPDX-FileCopyrightText: (C) 2024-2026 mukyokyo
 */
@@ -11,18 +21,87 @@
 #pragma once
 
 #include <EEPROM.h>
+#include <string.h>
+#include <hardware/flash.h>
 #include "crc8.hpp"
+#include "journal.hpp"
+
+extern uint8_t __flash_binary_end;
+extern uint8_t _FS_start;
+extern uint8_t _FS_end;
 
 class CSysNVM {
+  static const uint32_t JOURNAL_MAX_SECTORS = 16;
+  static const uint8_t JOURNAL_VERSION = 1;
+
+  TJournalFlash jflash;
+  CJournal journal;
+  size_t reclen;
+
+  // any is the start of the journal region in the XIP address space
+  static void _FlashRead(uint32_t off, void *buf, size_t len, void *any) {
+    memcpy(buf, (const uint8_t *)any + off, len);
+  }
+
+  // XIP is off while flash is written, so nothing may run from it on either core
+  static void _FlashProgram(uint32_t off, const void *buf, size_t len, void *any) {
+    rp2040.idleOtherCore();
+    noInterrupts();
+    flash_range_program((uintptr_t)any - XIP_BASE + off, (const uint8_t *)buf, len);
+    interrupts();
+    rp2040.resumeOtherCore();
+  }
+
+  static void _FlashErase(uint32_t off, void *any) {
+    rp2040.idleOtherCore();
+    noInterrupts();
+    flash_range_erase((uintptr_t)any - XIP_BASE + off, FLASH_SECTOR_SIZE);
+    interrupts();
+    rp2040.resumeOtherCore();
+  }
+
+  // The filesystem region, or the free sectors below it, with at least two sectors
+  static uint32_t _JournalRegion(uint8_t *&start) {
+    uint32_t n = (&_FS_end - &_FS_start) / FLASH_SECTOR_SIZE;
+    if (n >= 2) {
+      start = &_FS_start;
+      return (n < JOURNAL_MAX_SECTORS) ? n : JOURNAL_MAX_SECTORS;
+    }
+    uintptr_t end = XIP_BASE + (((uintptr_t)&__flash_binary_end - XIP_BASE + FLASH_SECTOR_SIZE - 1) & ~(uintptr_t)(FLASH_SECTOR_SIZE - 1));
+    n = ((uintptr_t)&_FS_start > end) ? ((uintptr_t)&_FS_start - end) / FLASH_SECTOR_SIZE : 0;
+    if (n > JOURNAL_MAX_SECTORS) n = JOURNAL_MAX_SECTORS;
+    start = &_FS_start - n * FLASH_SECTOR_SIZE;
+    return (n >= 2) ? n : 0;
+  }
+
+  bool _KeyValid(void) {
+    char n[2];
+    EEPROM.get(0, n);
+    return '0' <= n[0] && n[0] <= '9' && '0' <= n[1] && n[1] <= '9';
+  }
+
+  // Count the first two bytes up, returns the new count
+  int _KeyNext(void) {
+    char n[2];
+    EEPROM.get(0, n);
+    int v;
+    v = (n[0] - '0') * 10 + (n[1] - '0');
+    v = (v + 1) % 100;
+    n[0] = ((v / 10) % 10) + '0';
+    n[1] = (v % 10) + '0';
+    EEPROM.put(0, n);
+    return v;
+  }
+
   void _NVMClear(void) {
-    for(int i = 0; i < EEPROM.length(); i++) {
+    for(size_t i = 0; i < EEPROM.length(); i++) {
       EEPROM.write(i, 0xff);
     }
     EEPROM.commit();
   }
 
   bool _NVMFullFF(void) {
-    for(int i = 0; i < EEPROM.length(); i++) {
+    for(size_t i = 0; i < EEPROM.length(); i++) {
       volatile uint8_t n = EEPROM.read(i);
       if (n != 0xff) return false;
     }
@@ -32,7 +111,7 @@ class CSysNVM {
   uint8_t _NVMCalcCRC(void) {
     CCRC8 CRC8;
     uint8_t crc = 0xff;
-    for(int i = 0; i < EEPROM.length() - 1; i++) {
+    for(size_t i = 0; i < EEPROM.length() - 1; i++) {
       CRC8.get(&crc, EEPROM.read(i));
     }
     crc = crc ^ 0xff;
@@ -56,16 +135,9 @@ class CSysNVM {
     }
   }
 
-public:
-  void Init(void) {
-    EEPROM.begin(4096);
-  }
-
-  void Read(void (*r)(void), void (*d)(void) = NULL) {
+  void _EEPROMRead(void (*r)(void), void (*d)(void)) {
     if(_NVMCheck() && !_NVMFullFF()) {
-      char n[2];
-      EEPROM.get(0, n);
-      if('0' <= n[0] && n[0] <= '9' && '0' <= n[1] && n[1] <= '9') {
+      if(_KeyValid()) {
         if (r != NULL) (*r)();
       } else {
         if (d != NULL) (*d)();
@@ -77,22 +149,49 @@ public:
     }
   }
 
+public:
+  // len: bytes at the start of the EEPROM image that make up the settings, 0 keeps everything in the EEPROM sector
+  void Init(size_t len = 0) {
+    EEPROM.begin(4096);
+    reclen = len;
+    uint8_t *start;
+    uint32_t n = _JournalRegion(start);
+    if (len > 0 && n >= 2) {
+      jflash = { _FlashRead, _FlashProgram, _FlashErase, start, FLASH_SECTOR_SIZE, FLASH_PAGE_SIZE, n };
+      journal.begin(&jflash, len);
+    }
+  }
+
+  bool Journaled(void) {
+    return journal.ready();
+  }
+
+  void Read(void (*r)(void), void (*d)(void) = NULL) {
+    if (journal.ready()) {
+      if (journal.read(EEPROM.getDataPtr(), reclen) >= 0) {
+        if (r != NULL) (*r)();
+      } else {
+        _EEPROMRead(r, d);
+        journal.append(EEPROM.getDataPtr(), reclen, JOURNAL_VERSION);
+      }
+    } else
+      _EEPROMRead(r, d);
+  }
+
   void Write(void (*w)(void)) {
     if (w != NULL) (*w)();
-    _NVMSetCRC();
+    if (!journal.ready()) _NVMSetCRC();
   }
 
   int Flush(void) {
+    if (journal.ready()) {
+      if (!_KeyValid()) return -1;
+      int v = _KeyNext();
+      return journal.append(EEPROM.getDataPtr(), reclen, JOURNAL_VERSION) ? v : -1;
+    }
     if(_NVMCheck() && !_NVMFullFF()) {
-      char n[2];
-      EEPROM.get(0, n);
-      if('0' <= n[0] && n[0] <= '9' && '0' <= n[1] && n[1] <= '9') {
-        int v;
-        v = (n[0] - '0') * 10 + (n[1] - '0');
-        v = (v + 1) % 100;
-        n[0] = ((v / 10) % 10) + '0';
-        n[1] = (v % 10) + '0';
-        EEPROM.put(0, n);
+      if(_KeyValid()) {
+        int v = _KeyNext();
         _NVMSetCRC();
         EEPROM.commit();
         return v;
@@ -0,0 +1,101 @@
+/*
+  packer
+
+  Decides when buffered UART data is handed to the network, like the
+  "packing length / packing interval" of commercial serial servers.
+
+  Data is released when packlen bytes have accumulated, when the line has been quiet
+  for idle character times, or up to and including a delimiter byte.
+  With nothing configured everything is released immediately.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "spsc.hpp"
+
+class CPacker {
+public:
+  static const uint16_t MAX_PACKLEN = 4096;
+  static const uint8_t MAX_IDLECHARS = 100;
+  static const uint8_t DEFAULT_IDLECHARS = 32;  // used when only a length or a delimiter is set
+
+private:
+  uint16_t packlen;   // 0:no length threshold
+  uint8_t idlechars;  // 0:no idle threshold
+  int16_t delim;      // -1:no delimiter
+  uint32_t baud;
+  int bits;           // a character takes on the line
+  uint32_t idletime;  // us
+
+  uint32_t scanned;   // ring position checked for the delimiter
+  uint32_t released;  // ring position up to which data may be sent
+  uint32_t lastpos;   // ring head at the previous update
+  uint32_t lasttime;  // us when the ring head last moved
+
+public:
+  void config(uint16_t len, uint8_t idle, int16_t d) {
+    // Settings saved by an older firmware read as 0xff
+    packlen = (len <= MAX_PACKLEN) ? len : 0;
+    idlechars = (idle <= MAX_IDLECHARS) ? idle : 0;
+    delim = (d >= 0 && d <= 0xff) ? d : -1;
+    if (idlechars == 0 && (packlen != 0 || delim >= 0)) idlechars = DEFAULT_IDLECHARS;
+    baud = 0;
+  }
+
+  bool enabled(void) const { return packlen != 0 || idlechars != 0 || delim >= 0; }
+
+  // Returns the ring position up to which data may be sent.
+  // charbits is what a character takes on the line, start and stop bits included, as for the Modbus gateway.
+  uint32_t update(CSPSCRingBase *ring, uint32_t now_us, uint32_t actualbaud, int charbits) {
+    uint32_t head = ring->head_pos();
+    uint32_t tail = ring->tail_pos();
+
+    if (!enabled()) return head;
+
+    if ((actualbaud != baud || charbits != bits) && actualbaud != 0 && charbits > 0) {
+      baud = actualbaud;
+      bits = charbits;
+      idletime = (uint32_t)((uint64_t)idlechars * bits * 1000000 / baud);
+    }
+    // The ring was cleared or released behind our back
+    if ((int32_t)(released - tail) < 0) released = tail;
+    if ((int32_t)(scanned - released) < 0) scanned = released;
+
+    if (head != lastpos) {
+      lastpos = head;
+      lasttime = now_us;
+    }
+    if (delim >= 0) {
+      TRingSpan s1, s2;
+      while (scanned != head) {
+        ring->peek_at(scanned, head, s1, s2);
+        const uint8_t *q = (const uint8_t *)memchr(s1.ptr, delim, s1.len);
+        if (q != NULL) {
+          released = scanned = scanned + (q - s1.ptr) + 1;
+          continue;
+        }
+        if ((q = (const uint8_t *)memchr(s2.ptr, delim, s2.len)) != NULL) {
+          released = scanned = scanned + s1.len + (q - s2.ptr) + 1;
+          continue;
+        }
+        scanned = head;
+      }
+    }
+    if (packlen != 0 && head - released >= packlen) released = head;
+    if (idlechars != 0 && head != released && now_us - lasttime >= idletime) released = head;
+    return released;
+  }
+
+  CPacker() {
+    config(0, 0, -1);
+    bits = 0;
+    idletime = 0;
+    scanned = released = lastpos = lasttime = 0;
+  }
+};
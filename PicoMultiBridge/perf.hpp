@@ -0,0 +1,115 @@
+/*
+  perf
+
+  Throughput and latency instrumentation.
+
+  Every counter has exactly one writer, the core whose hot path it measures, and may be read
+  from the other core at any time. With a single writer no read-modify-write is needed,
+  which matters on the RP2040 where Cortex-M0+ has no atomic add.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+class CPerfCounter {
+  std::atomic<uint32_t> v;
+
+public:
+  // Writer side
+  void add(uint32_t n) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+  void peak(uint32_t n) {
+    if (n > v.load(std::memory_order_relaxed)) v.store(n, std::memory_order_relaxed);
+  }
+
+  // Either side
+  uint32_t get(void) const { return v.load(std::memory_order_relaxed); }
+
+  CPerfCounter() : v(0) {}
+};
+
+// Histogram with power-of-two buckets.
+// Bucket 0 holds 0 and 1, bucket k holds 2^k ... 2^(k+1)-1 and the last bucket everything above.
+template< std::size_t N = 24 > class CLog2Histogram {
+  CPerfCounter bucket[N];
+
+public:
+  static size_t index(uint32_t v) {
+    if (v < 2) return 0;
+    size_t i = 31 - __builtin_clz(v);
+    return (i < N) ? i : N - 1;
+  }
+  // Smallest value that no longer fits in bucket i, UINT32_MAX for the last which has no end
+  static uint32_t upper(size_t i) {
+    return (i >= 31 || i >= N - 1) ? UINT32_MAX : (uint32_t)2 << i;
+  }
+
+  void add(uint32_t v) { bucket[index(v)].add(1); }
+
+  size_t size(void) const { return N; }
+  uint32_t count(size_t i) const { return bucket[i].get(); }
+  uint32_t total(void) const {
+    uint32_t n = 0;
+    for (size_t i = 0; i < N; i++) n += bucket[i].get();
+    return n;
+  }
+  // Upper edge of the bucket holding the given fraction (in per mille) of all samples
+  uint32_t percentile(uint32_t permille) const {
+    uint32_t t = total();
+    if (t == 0) return 0;
+    uint64_t want = ((uint64_t)t * permille + 999) / 1000, n = 0;
+    for (size_t i = 0; i < N; i++) {
+      n += bucket[i].get();
+      if (n >= want) return upper(i);
+    }
+    return upper(N - 1);
+  }
+};
+
+// Byte stream positions and the time they were reached, handed from one core to the other.
+// When the queue is full the stamp is simply not taken, so latency is sampled rather than lost.
+template< std::size_t N > class CStampQueue {
+  static_assert((N & (N - 1)) == 0, "N must be a power of two");
+  struct {
+    uint32_t pos;
+    uint32_t t;
+  } q[N];
+  std::atomic<uint32_t> head;  // producer only
+  std::atomic<uint32_t> tail;  // consumer only
+
+public:
+  bool push(uint32_t pos, uint32_t t) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return false;
+    q[h & (N - 1)].pos = pos;
+    q[h & (N - 1)].t = t;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool front(uint32_t &pos, uint32_t &t) {
+    uint32_t tl = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == tl) return false;
+    pos = q[tl & (N - 1)].pos;
+    t = q[tl & (N - 1)].t;
+    return true;
+  }
+  void pop(void) { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Every stamp at or before pos has been passed, record how long each took
+  template< typename H > void drain(uint32_t pos, uint32_t now, H &hist) {
+    uint32_t p, t;
+    while (front(p, t) && (int32_t)(pos - p) >= 0) {
+      hist.add(now - t);
+      pop();
+    }
+  }
+
+  CStampQueue() : head(0), tail(0) {}
+};
@@ -0,0 +1,33 @@
+/*
+  piodiv
+
+  Clock divider of a PIO program that spends a fixed number of cycles on every bit.
+  The divider is 16.8 fixed point, 1.0 to 65535 + 255/256.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+  uint16_t integer;
+  uint8_t frac;  // 1/256ths
+} TPioDiv;
+
+// Closest divider of sysclk for baudrate
+inline TPioDiv piodiv_from_baud(uint32_t sysclk, uint32_t baudrate, uint32_t cycles) {
+  uint64_t den = (uint64_t)(baudrate ? baudrate : 1) * cycles;
+  uint64_t d = ((uint64_t)sysclk * 256 + den / 2) / den;
+  if (d < 0x100) d = 0x100;
+  if (d > 0xffffff) d = 0xffffff;
+  return { (uint16_t)(d >> 8), (uint8_t)d };
+}
+
+// Baudrate a divider actually produces
+inline uint32_t piodiv_to_baud(uint32_t sysclk, TPioDiv d, uint32_t cycles) {
+  uint64_t den = (uint64_t)((d.integer << 8) | d.frac) * cycles;
+  return ((uint64_t)sysclk * 256 + den / 2) / den;
+}
@@ -0,0 +1,111 @@
+/*
+  pusr
+
+  Streaming decoder for the port configuration packets of PUSR's VCOM.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include "pusr.hpp"
+
+static const uint8_t pusr_sig[3] = { 0x55, 0xaa, 0x55 };
+
+CPUSRDecoder::CPUSRDecoder() {
+  holdlen = 0;
+  fresh = false;
+  held_at = 0;
+  datafunc = NULL;
+  configfunc = NULL;
+  any = NULL;
+}
+
+void CPUSRDecoder::begin(pusr_data_callback *d, pusr_config_callback *c, void *a) {
+  datafunc = d;
+  configfunc = c;
+  any = a;
+  holdlen = 0;
+}
+
+// Forget a partial packet, e.g. when the client changes
+void CPUSRDecoder::reset(void) {
+  holdlen = 0;
+  fresh = false;
+}
+
+void CPUSRDecoder::flush(void) {
+  size_t n = holdlen;
+  holdlen = 0;
+  if (n > 0 && datafunc != NULL) datafunc(hold, n, any);
+}
+
+bool CPUSRDecoder::poll(uint32_t now) {
+  if (fresh) {
+    fresh = false;
+    held_at = now;
+    return false;
+  }
+  if (holdlen == 0 || now - held_at < HOLD_US) return false;
+  flush();
+  return true;
+}
+
+bool CPUSRDecoder::is_packet(const uint8_t *p) {
+  return memcmp(p, pusr_sig, sizeof(pusr_sig)) == 0 && (uint8_t)(p[3] + p[4] + p[5] + p[6]) == p[7];
+}
+
+// Process one contiguous buffer.
+// Returns the number of bytes consumed; the rest is a possible packet head that needs more data.
+size_t CPUSRDecoder::scan(const uint8_t *p, size_t len) {
+  size_t start = 0, i = 0;
+
+  while (i < len) {
+    const uint8_t *q = (const uint8_t *)memchr(&p[i], pusr_sig[0], len - i);
+    if (q == NULL) break;
+    i = q - p;
+    size_t r = len - i;
+    if (r >= PACKET_LEN) {
+      if (is_packet(&p[i])) {
+        if (i > start && datafunc != NULL) datafunc(&p[start], i - start, any);
+        if (configfunc != NULL) configfunc(&p[i], any);
+        i += PACKET_LEN;
+        start = i;
+        continue;
+      }
+    } else if (memcmp(&p[i], pusr_sig, (r < sizeof(pusr_sig)) ? r : sizeof(pusr_sig)) == 0) {
+      if (i > start && datafunc != NULL) datafunc(&p[start], i - start, any);
+      return i;
+    }
+    i++;
+  }
+  if (len > start && datafunc != NULL) datafunc(&p[start], len - start, any);
+  return len;
+}
+
+void CPUSRDecoder::decode(const uint8_t *p, size_t len) {
+  if (len == 0) return;
+  fresh = true;
+
+  if (holdlen > 0) {
+    // Join the held tail with just enough new bytes to decide every held position
+    uint8_t tmp[sizeof(hold) + PACKET_LEN];
+    size_t n = (len < PACKET_LEN) ? len : PACKET_LEN;
+    memcpy(tmp, hold, holdlen);
+    memcpy(&tmp[holdlen], p, n);
+    size_t total = holdlen + n;
+    size_t k = scan(tmp, total);
+    if (n == len) {
+      holdlen = total - k;
+      memcpy(hold, &tmp[k], holdlen);
+      return;
+    }
+    p += k - holdlen;
+    len -= k - holdlen;
+    holdlen = 0;
+  }
+
+  size_t k = scan(p, len);
+  holdlen = len - k;
+  memcpy(hold, &p[k], holdlen);
+}
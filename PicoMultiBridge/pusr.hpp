@@ -0,0 +1,54 @@
+/*
+  pusr
+
+  Streaming decoder for the port configuration packets of PUSR's VCOM.
+
+  A packet is 0x55 0xAA 0x55, a 24bit baudrate (MSB first), a parameter bitset and a checksum.
+  Everything between packets is handed over as runs as large as the input allows,
+  and a packet that straddles two reads is still recognized.
+  A tail that may start a packet is held back until the next read decides it, or until
+  poll() finds that nothing has followed it for HOLD_US and hands it over as data.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void(pusr_data_callback)(const uint8_t *p, size_t len, void *any);
+typedef void(pusr_config_callback)(const uint8_t *pkt, void *any);
+
+class CPUSRDecoder {
+public:
+  static const size_t PACKET_LEN = 8;
+  static const uint32_t HOLD_US = 20000;  // VCOM writes a packet at once, its parts never lie this far apart
+
+private:
+  uint8_t hold[PACKET_LEN - 1];  // tail of the previous read that may be the start of a packet
+  size_t holdlen;
+  bool fresh;        // decode() ran since the last poll()
+  uint32_t held_at;  // poll() time the held tail was last added to
+
+  pusr_data_callback *datafunc;
+  pusr_config_callback *configfunc;
+  void *any;
+
+  size_t scan(const uint8_t *p, size_t len);
+
+public:
+  static bool is_packet(const uint8_t *p);
+
+  void begin(pusr_data_callback *d, pusr_config_callback *c, void *any = NULL);
+  void reset(void);
+  void decode(const uint8_t *p, size_t len);
+  // Bytes held back, and handing them over as data
+  size_t pending(void) const { return holdlen; }
+  void flush(void);
+  // Flushes a tail held for HOLD_US, true if it did
+  bool poll(uint32_t now);
+
+  CPUSRDecoder();
+};
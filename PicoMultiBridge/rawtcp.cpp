@@ -0,0 +1,201 @@
+/*
+  rawtcp
+
+  TCP transport on the lwIP raw API, for one client at a time.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <pico/cyw43_arch.h>
+#include <hardware/sync.h>
+#include "rawtcp.hpp"
+
+CRawTcpBridge::CRawTcpBridge() : gen(0) {
+  listener = pcb = NULL;
+  port = 0;
+  conn = 0;
+  rx = NULL;
+  queued = acked = 0;
+  cur.p = NULL;
+  seg = NULL;
+  off = 0;
+  referenced = copied = received = 0;
+  aborted = 0;
+  write_us = 0;
+}
+
+void CRawTcpBridge::begin(CSPSCRingBase *uart2net, uint16_t localport) {
+  rx = uart2net;
+  port = localport;
+}
+
+void CRawTcpBridge::start(void) {
+  struct tcp_pcb *l = tcp_new_ip_type(IPADDR_TYPE_ANY);
+  if (l == NULL) return;
+  if (tcp_bind(l, IP_ANY_TYPE, port) != ERR_OK) {
+    tcp_close(l);
+    return;
+  }
+  if ((listener = tcp_listen_with_backlog(l, 1)) == NULL) {
+    tcp_close(l);
+    return;
+  }
+  tcp_arg(listener, this);
+  tcp_accept(listener, on_accept);
+}
+
+// Drop the client, true if it had to be reset.
+// lwIP resends unacknowledged data from where tcp_write() was pointed at, which is the ring,
+// and the ring is about to be reused, so a graceful close is only possible once everything is acknowledged.
+bool CRawTcpBridge::close(void) {
+  if (pcb == NULL) return false;
+  struct tcp_pcb *p = pcb;
+  pcb = NULL;
+  tcp_arg(p, NULL);
+  tcp_recv(p, NULL);
+  tcp_sent(p, NULL);
+  tcp_err(p, NULL);
+  if (queued != acked || tcp_close(p) != ERR_OK) {
+    tcp_abort(p);
+    aborted++;
+    return true;
+  }
+  return false;
+}
+
+void CRawTcpBridge::end(void) {
+  cyw43_arch_lwip_begin();
+  close();
+  if (listener != NULL) tcp_close(listener);
+  listener = NULL;
+  cyw43_arch_lwip_end();
+}
+
+// The newest client takes over, an older one is often a connection that died unnoticed
+err_t CRawTcpBridge::on_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+  CRawTcpBridge *b = (CRawTcpBridge *)arg;
+  if (err != ERR_OK || newpcb == NULL) return ERR_VAL;
+  b->close();
+  b->pcb = newpcb;
+  b->gen.store(++b->conn, std::memory_order_release);
+  tcp_arg(newpcb, b);
+  tcp_recv(newpcb, on_recv);
+  tcp_sent(newpcb, on_sent);
+  tcp_err(newpcb, on_err);
+  tcp_nagle_disable(newpcb);
+  b->queued = b->acked = b->rx->head_pos();
+  b->rx->release_to(b->acked);
+  return ERR_OK;
+}
+
+err_t CRawTcpBridge::on_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+  CRawTcpBridge *b = (CRawTcpBridge *)arg;
+  if (p == NULL) return b->close() ? ERR_ABRT : ERR_OK;  // the peer has closed
+  if (err != ERR_OK) {
+    pbuf_free(p);
+    return err;
+  }
+  // Refused chains are kept by lwIP and offered again
+  if (!b->in.push({ p, b->conn })) return ERR_MEM;
+  b->received += p->tot_len;
+  __sev();
+  return ERR_OK;
+}
+
+err_t CRawTcpBridge::on_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+  CRawTcpBridge *b = (CRawTcpBridge *)arg;
+  uint32_t out = b->queued - b->acked;
+  b->acked += (len < out) ? len : out;
+  b->rx->release_to(b->acked);
+  __sev();  // room for core 1 to pass on more UART data
+  return ERR_OK;
+}
+
+// lwIP has already freed the pcb, and with it every reference into the ring
+void CRawTcpBridge::on_err(void *arg, err_t err) {
+  CRawTcpBridge *b = (CRawTcpBridge *)arg;
+  if (b != NULL) b->pcb = NULL;
+}
+
+// UART -> client, up to the ring position limit
+void CRawTcpBridge::send(uint32_t limit) {
+  TRingSpan s[2];
+  bool wrote = false;
+
+  if ((int32_t)(limit - queued) <= 0) return;
+  rx->peek_at(queued, limit, s[0], s[1]);
+  uint32_t t = micros();
+  for (int k = 0; k < 2 && s[k].len > 0; k++) {
+    size_t n = min(s[k].len, (size_t)tcp_sndbuf(pcb));
+    if (n == 0) break;
+    u8_t flags = (n < COPY_BELOW) ? TCP_WRITE_FLAG_COPY : 0;
+    if (k == 0 && n == s[0].len && s[1].len > 0) flags |= TCP_WRITE_FLAG_MORE;
+    if (tcp_write(pcb, s[k].ptr, n, flags) != ERR_OK) break;
+    if (flags & TCP_WRITE_FLAG_COPY) copied += n;
+    else referenced += n;
+    queued += n;
+    wrote = true;
+    if (n < s[k].len) break;
+  }
+  if (wrote) tcp_output(pcb);
+  write_us += micros() - t;
+}
+
+void CRawTcpBridge::poll(bool online, uint32_t limit) {
+  TChain c;
+
+  cyw43_arch_lwip_begin();
+  // Chains core 1 has written to the UART, the window opens again by as much
+  while (done.front(c)) {
+    done.pop();
+    if (pcb != NULL && c.conn == conn) tcp_recved(pcb, c.p->tot_len);
+    pbuf_free(c.p);
+  }
+  if (!online) {
+    close();
+    if (listener != NULL) tcp_close(listener);
+    listener = NULL;
+  } else if (listener == NULL)
+    start();
+  // Nobody to deliver UART data to
+  if (pcb == NULL) rx->clear();
+  else send(limit);
+  cyw43_arch_lwip_end();
+}
+
+void CRawTcpBridge::print_stat(void) {
+  Serial.printf(" Raw TCP port %d, client %s", port, (pcb != NULL) ? "" : "none");
+  if (pcb != NULL) Serial.printf("%s:%d lag %lu unacknowledged %lu", ipaddr_ntoa(&pcb->remote_ip), pcb->remote_port, rx->head_pos() - queued, queued - acked);
+  Serial.printf("\n Sent %llu bytes by reference and %llu copied, received %llu, connections reset %lu\n", referenced, copied, received, aborted);
+}
+
+//---- core 1
+
+// Whole chains go back to core 0 as soon as they are used up
+void CRawTcpBridge::consume(size_t n) {
+  off += n;
+  while (seg != NULL && off >= seg->len) {
+    seg = seg->next;
+    off = 0;
+  }
+  if (cur.p != NULL && seg == NULL && done.push(cur)) cur.p = NULL;
+}
+
+size_t CRawTcpBridge::peek(const uint8_t *&p) {
+  if (cur.p == NULL) {
+    if (!in.front(cur)) return 0;
+    in.pop();
+    seg = cur.p;
+    off = 0;
+    consume(0);  // skips empty segments
+  }
+  if (seg == NULL) {
+    // done was full at the last consume()
+    consume(0);
+    return 0;
+  }
+  p = (const uint8_t *)seg->payload + off;
+  return seg->len - off;
+}
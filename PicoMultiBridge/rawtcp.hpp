@@ -0,0 +1,84 @@
+/*
+  rawtcp
+
+  TCP transport on the lwIP raw API, for one client at a time.
+
+  UART -> network: the rx ring is handed to tcp_write() by reference and only
+  released once the peer has acknowledged it, so lwIP may retransmit straight from it.
+  Runs shorter than COPY_BELOW are copied instead, each reference costs lwIP a pbuf.
+  Network -> UART: received pbuf chains are passed to core 1 as they are, written to
+  the UART from their payload and handed back to be freed. The TCP window is only
+  reopened for data the UART has taken, which throttles the sender.
+
+  Everything but the reader side runs on core 0, either in poll() under the lwIP lock or
+  in lwIP callbacks, so the two never interleave.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <lwip/tcp.h>
+#include <atomic>
+#include "spsc.hpp"
+
+class CRawTcpBridge {
+public:
+  static const size_t COPY_BELOW = 64;
+  static const int MAX_CHAINS = 32;
+
+private:
+  typedef struct {
+    struct pbuf *p;
+    uint32_t conn;  // connection it arrived on
+  } TChain;
+
+  struct tcp_pcb *listener;
+  struct tcp_pcb *pcb;
+  uint16_t port;
+  uint32_t conn;                // connections accepted so far
+  std::atomic<uint32_t> gen;    // same, for core 1
+
+  CSPSCRingBase *rx;  // UART -> network
+  uint32_t queued;    // rx position handed to tcp_write()
+  uint32_t acked;     // rx position the peer has acknowledged, the ring is released up to here
+
+  CSPSCQueue<TChain, MAX_CHAINS> in;    // core 0 -> core 1, received chains
+  CSPSCQueue<TChain, MAX_CHAINS> done;  // core 1 -> core 0, chains written to the UART
+
+  // Reader side, core 1 only
+  TChain cur;
+  struct pbuf *seg;
+  uint16_t off;
+
+  uint64_t referenced, copied, received;  // bytes
+  uint32_t aborted;   // connections reset because unacknowledged data referred to the ring
+  uint32_t write_us;  // time spent in tcp_write() and tcp_output()
+
+  void start(void);
+  bool close(void);
+  void send(uint32_t limit);
+
+  static err_t on_accept(void *arg, struct tcp_pcb *newpcb, err_t err);
+  static err_t on_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+  static err_t on_sent(void *arg, struct tcp_pcb *tpcb, u16_t len);
+  static void on_err(void *arg, err_t err);
+
+public:
+  void begin(CSPSCRingBase *uart2net, uint16_t localport);
+  void poll(bool online, uint32_t limit);
+  void end(void);
+  void print_stat(void);
+  int clients(void) { return (pcb != NULL) ? 1 : 0; }
+  uint32_t write_time(void) { return write_us; }
+
+  //---- core 1
+  // Changes with every new client
+  uint32_t generation(void) { return gen.load(std::memory_order_acquire); }
+  // Received bytes in one contiguous run, then how many of them were used
+  size_t peek(const uint8_t *&p);
+  void consume(size_t n);
+
+  CRawTcpBridge();
+};
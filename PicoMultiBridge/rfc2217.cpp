@@ -0,0 +1,288 @@
+/*
+  rfc2217
+
+  Telnet COM-Port-Control (RFC 2217) codec.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include "rfc2217.hpp"
+
+static const char rfc2217_signature[] = "Pico-WiFi-Serial-Bridge";
+
+CRfc2217::CRfc2217() {
+  cb = NULL;
+  any = NULL;
+  dropped = 0;
+  reset();
+}
+
+void CRfc2217::begin(const TRfc2217Callbacks *callbacks, void *a) {
+  cb = callbacks;
+  any = a;
+  reset();
+}
+
+void CRfc2217::reset(void) {
+  state = sData;
+  verb = 0;
+  sblen = 0;
+  local_on = remote_on = 0;
+  linestate_mask = 0;
+  modemstate_mask = 0xff;
+  last_modemstate = 0;
+  pendlen = 0;
+  suspended = false;
+}
+
+int CRfc2217::option_bit(uint8_t opt) {
+  switch (opt) {
+    case OPT_BINARY:
+      return 1 << 0;
+    case OPT_SGA:
+      return 1 << 1;
+    case OPT_COM_PORT:
+      return 1 << 2;
+    default:
+      return 0;
+  }
+}
+
+// Nothing overtakes what is already waiting
+void CRfc2217::send(const uint8_t *p, size_t len) {
+  if (cb == NULL || cb->net == NULL) return;
+  if (pendlen == 0 && cb->net(p, len, any)) return;
+  if (pendlen + len > sizeof(pend)) {
+    dropped++;
+    return;
+  }
+  memcpy(&pend[pendlen], p, len);
+  pendlen += len;
+}
+
+bool CRfc2217::flush(void) {
+  if (pendlen > 0 && cb != NULL && cb->net != NULL && cb->net(pend, pendlen, any)) pendlen = 0;
+  return pendlen == 0;
+}
+
+void CRfc2217::send_option(uint8_t v, uint8_t opt) {
+  uint8_t b[3] = { IAC, v, opt };
+  send(b, sizeof(b));
+}
+
+// IAC SB COM-PORT-OPTION cmd value... IAC SE, with IAC in the value doubled
+void CRfc2217::send_subneg(uint8_t cmd, const uint8_t *p, size_t len) {
+  uint8_t b[4 + MAX_SUBNEG * 2 + 2];
+  size_t n = 0;
+  b[n++] = IAC;
+  b[n++] = SB;
+  b[n++] = OPT_COM_PORT;
+  b[n++] = cmd;
+  for (size_t i = 0; i < len && i < MAX_SUBNEG; i++) {
+    if (p[i] == IAC) b[n++] = IAC;
+    b[n++] = p[i];
+  }
+  b[n++] = IAC;
+  b[n++] = SE;
+  send(b, n);
+}
+
+// Accept BINARY, SGA and COM-PORT-OPTION in both directions, refuse everything else.
+// Only state changes are answered so that negotiation cannot loop.
+void CRfc2217::negotiate(uint8_t v, uint8_t opt) {
+  int bit = option_bit(opt);
+  switch (v) {
+    case WILL:
+      if (bit == 0) send_option(DONT, opt);
+      else if (!(remote_on & bit)) {
+        remote_on |= bit;
+        send_option(DO, opt);
+        // Clients only learn the modem lines from notifications, so start with one
+        if (opt == OPT_COM_PORT) {
+          uint8_t m = last_modemstate = (cb != NULL && cb->modemstate != NULL) ? cb->modemstate(any) : 0;
+          send_subneg(SERVER_OFFSET + NOTIFY_MODEMSTATE, &m, 1);
+        }
+      }
+      break;
+    case WONT:
+      if (remote_on & bit) {
+        remote_on &= ~bit;
+        send_option(DONT, opt);
+      }
+      break;
+    case DO:
+      if (bit == 0) send_option(WONT, opt);
+      else if (!(local_on & bit)) {
+        local_on |= bit;
+        send_option(WILL, opt);
+      }
+      break;
+    case DONT:
+      if (local_on & bit) {
+        local_on &= ~bit;
+        send_option(WONT, opt);
+      }
+      break;
+  }
+}
+
+void CRfc2217::subnegotiation(void) {
+  if (sblen < 2 || sb[0] != OPT_COM_PORT || cb == NULL) return;
+
+  uint8_t cmd = sb[1];
+  const uint8_t *v = &sb[2];
+  size_t vlen = sblen - 2;
+  uint8_t r[4];
+
+  switch (cmd) {
+    case SIGNATURE:
+      send_subneg(SERVER_OFFSET + cmd, (const uint8_t *)rfc2217_signature, strlen(rfc2217_signature));
+      break;
+    case SET_BAUDRATE:
+      if (vlen >= 4) {
+        uint32_t baud = ((uint32_t)v[0] << 24) | ((uint32_t)v[1] << 16) | ((uint32_t)v[2] << 8) | v[3];
+        if (cb->baud != NULL) baud = cb->baud(baud, any);
+        r[0] = baud >> 24;
+        r[1] = baud >> 16;
+        r[2] = baud >> 8;
+        r[3] = baud;
+        send_subneg(SERVER_OFFSET + cmd, r, 4);
+      }
+      break;
+    case SET_DATASIZE:
+    case SET_PARITY:
+    case SET_STOPSIZE:
+      if (vlen >= 1) {
+        r[0] = (cb->format != NULL) ? cb->format(cmd, v[0], any) : v[0];
+        send_subneg(SERVER_OFFSET + cmd, r, 1);
+      }
+      break;
+    case SET_CONTROL:
+      if (vlen >= 1) {
+        r[0] = (cb->control != NULL) ? cb->control(v[0], any) : v[0];
+        send_subneg(SERVER_OFFSET + cmd, r, 1);
+      }
+      break;
+    case NOTIFY_LINESTATE:
+      // Poll from the client
+      r[0] = 0;
+      send_subneg(SERVER_OFFSET + cmd, r, 1);
+      break;
+    case NOTIFY_MODEMSTATE:
+      r[0] = last_modemstate = (cb->modemstate != NULL) ? cb->modemstate(any) : 0;
+      send_subneg(SERVER_OFFSET + cmd, r, 1);
+      break;
+    case FLOWCONTROL_SUSPEND:
+      suspended = true;
+      break;
+    case FLOWCONTROL_RESUME:
+      suspended = false;
+      break;
+    case SET_LINESTATE_MASK:
+      if (vlen >= 1) {
+        linestate_mask = v[0];
+        send_subneg(SERVER_OFFSET + cmd, v, 1);
+      }
+      break;
+    case SET_MODEMSTATE_MASK:
+      if (vlen >= 1) {
+        modemstate_mask = v[0];
+        send_subneg(SERVER_OFFSET + cmd, v, 1);
+      }
+      break;
+    case PURGE_DATA:
+      if (vlen >= 1) {
+        if (cb->purge != NULL) cb->purge(v[0], any);
+        send_subneg(SERVER_OFFSET + cmd, v, 1);
+      }
+      break;
+  }
+}
+
+void CRfc2217::decode(const uint8_t *p, size_t len) {
+  size_t start = 0, i = 0;
+  static const uint8_t iac = IAC;
+
+  while (i < len) {
+    uint8_t ch = p[i];
+    switch (state) {
+      case sData: {
+        const uint8_t *q = (const uint8_t *)memchr(&p[i], IAC, len - i);
+        if (q == NULL) {
+          i = len;
+          continue;
+        }
+        i = q - p;
+        if (i > start && cb != NULL && cb->uart != NULL) cb->uart(&p[start], i - start, any);
+        state = sIAC;
+        break;
+      }
+      case sIAC:
+        if (ch == IAC) {
+          // Escaped 0xff
+          if (cb != NULL && cb->uart != NULL) cb->uart(&iac, 1, any);
+          state = sData;
+        } else if (ch >= WILL && ch <= DONT) {
+          verb = ch;
+          state = sOption;
+        } else if (ch == SB) {
+          sblen = 0;
+          state = sSB;
+        } else
+          state = sData;  // NOP, AYT and the like are ignored
+        break;
+      case sOption:
+        negotiate(verb, ch);
+        state = sData;
+        break;
+      case sSB:
+        if (ch == IAC) state = sSBIAC;
+        else if (sblen < sizeof(sb)) sb[sblen++] = ch;
+        break;
+      case sSBIAC:
+        if (ch == SE) {
+          subnegotiation();
+          state = sData;
+        } else {
+          if (ch == IAC && sblen < sizeof(sb)) sb[sblen++] = ch;
+          state = sSB;
+        }
+        break;
+    }
+    start = ++i;
+  }
+  if (len > start && cb != NULL && cb->uart != NULL) cb->uart(&p[start], len - start, any);
+}
+
+// UART data to the network, doubling every IAC
+void CRfc2217::encode(const uint8_t *p, size_t len) {
+  static const uint8_t iaciac[2] = { IAC, IAC };
+
+  while (len > 0) {
+    const uint8_t *q = (const uint8_t *)memchr(p, IAC, len);
+    size_t n = (q != NULL) ? (size_t)(q - p) : len;
+    if (n > 0) send(p, n);
+    if (q == NULL) break;
+    send(iaciac, 2);
+    p += n + 1;
+    len -= n + 1;
+  }
+}
+
+void CRfc2217::notify_linestate(uint8_t s) {
+  if (!(remote_on & option_bit(OPT_COM_PORT))) return;
+  uint8_t v = s & linestate_mask;
+  if (v != 0) send_subneg(SERVER_OFFSET + NOTIFY_LINESTATE, &v, 1);
+}
+
+void CRfc2217::notify_modemstate(uint8_t s) {
+  if (!(remote_on & option_bit(OPT_COM_PORT))) return;
+  if (s != last_modemstate) {
+    // Delta bits are derived from the previous state
+    uint8_t v = ((s & 0xf0) | (((s ^ last_modemstate) >> 4) & 0x0f)) & modemstate_mask;
+    last_modemstate = s;
+    if (v != 0) send_subneg(SERVER_OFFSET + NOTIFY_MODEMSTATE, &v, 1);
+  }
+}
@@ -0,0 +1,123 @@
+/*
+  rfc2217
+
+  Telnet COM-Port-Control (RFC 2217) codec.
+
+  decode() takes the Telnet stream from the network. It answers option negotiation,
+  carries out COM-PORT-OPTION requests through callbacks and passes unescaped
+  data runs on to the UART. encode() escapes UART data for the network.
+  Replies and notifications the network has no room for wait, in order, until flush().
+  Runs between IAC bytes are handed over as they are, nothing is processed per byte
+  except inside commands.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  void (*uart)(const uint8_t *p, size_t len, void *any);     // data for the UART
+  bool (*net)(const uint8_t *p, size_t len, void *any);      // bytes for the network, false if there is no room for all of them
+  uint32_t (*baud)(uint32_t baud, void *any);                // SET-BAUDRATE, 0:query, returns the current baudrate
+  uint8_t (*format)(uint8_t cmd, uint8_t value, void *any);  // SET-DATASIZE/PARITY/STOPSIZE, 0:query, returns the current value
+  uint8_t (*control)(uint8_t value, void *any);              // SET-CONTROL, returns the resulting value
+  void (*purge)(uint8_t value, void *any);                   // PURGE-DATA
+  uint8_t (*modemstate)(void *any);                          // current modem state bits
+} TRfc2217Callbacks;
+
+class CRfc2217 {
+public:
+  // Telnet
+  static const uint8_t IAC = 255;
+  static const uint8_t DONT = 254;
+  static const uint8_t DO = 253;
+  static const uint8_t WONT = 252;
+  static const uint8_t WILL = 251;
+  static const uint8_t SB = 250;
+  static const uint8_t SE = 240;
+  static const uint8_t OPT_BINARY = 0;
+  static const uint8_t OPT_SGA = 3;
+  static const uint8_t OPT_COM_PORT = 44;
+
+  // COM-PORT-OPTION commands, client to server. The server answers with +100
+  static const uint8_t SIGNATURE = 0;
+  static const uint8_t SET_BAUDRATE = 1;
+  static const uint8_t SET_DATASIZE = 2;
+  static const uint8_t SET_PARITY = 3;
+  static const uint8_t SET_STOPSIZE = 4;
+  static const uint8_t SET_CONTROL = 5;
+  static const uint8_t NOTIFY_LINESTATE = 6;
+  static const uint8_t NOTIFY_MODEMSTATE = 7;
+  static const uint8_t FLOWCONTROL_SUSPEND = 8;
+  static const uint8_t FLOWCONTROL_RESUME = 9;
+  static const uint8_t SET_LINESTATE_MASK = 10;
+  static const uint8_t SET_MODEMSTATE_MASK = 11;
+  static const uint8_t PURGE_DATA = 12;
+  static const uint8_t SERVER_OFFSET = 100;
+
+  static const size_t MAX_SUBNEG = 64;
+  static const size_t MAX_PENDING = 256;
+
+  // NOTIFY-LINESTATE bits
+  static const uint8_t LINE_BREAK = 0x10;
+  static const uint8_t LINE_FRAMING = 0x08;
+  static const uint8_t LINE_PARITY = 0x04;
+  static const uint8_t LINE_OVERRUN = 0x02;
+
+private:
+  typedef enum {
+    sData,
+    sIAC,
+    sOption,  // after WILL/WONT/DO/DONT
+    sSB,
+    sSBIAC
+  } TState;
+
+  TState state;
+  uint8_t verb;
+  uint8_t sb[MAX_SUBNEG];
+  size_t sblen;
+
+  uint8_t local_on;   // options we have agreed to perform, bit per supported option
+  uint8_t remote_on;  // options the client has agreed to perform
+
+  uint8_t linestate_mask;
+  uint8_t modemstate_mask;
+  uint8_t last_modemstate;
+
+  uint8_t pend[MAX_PENDING];  // bytes for the network waiting for room
+  size_t pendlen;
+
+  const TRfc2217Callbacks *cb;
+  void *any;
+
+  static int option_bit(uint8_t opt);
+  void send(const uint8_t *p, size_t len);
+  void send_option(uint8_t v, uint8_t opt);
+  void send_subneg(uint8_t cmd, const uint8_t *p, size_t len);
+  void negotiate(uint8_t v, uint8_t opt);
+  void subnegotiation(void);
+
+public:
+  bool suspended;  // FLOWCONTROL-SUSPEND received, hold back data to the client
+  uint32_t dropped;  // replies and notifications lost because not even pend had room
+
+  void begin(const TRfc2217Callbacks *callbacks, void *any = NULL);
+  void reset(void);
+  void decode(const uint8_t *p, size_t len);
+  void encode(const uint8_t *p, size_t len);
+  // Bytes waiting for the network, decode() and encode() should wait while there are any
+  size_t pending(void) const { return pendlen; }
+  // Try again to hand them over, true once none are left
+  bool flush(void);
+
+  // Unsolicited notifications, sent only if the client's mask asks for them
+  void notify_linestate(uint8_t state);
+  void notify_modemstate(uint8_t state);
+
+  CRfc2217();
+};
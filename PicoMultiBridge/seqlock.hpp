@@ -0,0 +1,68 @@
+/*
+  seqlock
+
+  A plain struct published by one core and read by the other as a consistent snapshot.
+
+  The writer makes the sequence odd, stores the words and makes it even again.
+  A reader copies the words and retries if the sequence was odd or moved meanwhile,
+  so it never sees half of one update and half of another. The writer never waits,
+  and as with perf.hpp there is a single writer so no read-modify-write is needed.
+  The words are relaxed atomics, which keeps the copy free of data races in C++ terms
+  while compiling to plain loads and stores.
+  Nothing here depends on the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
+
+template< typename T > class CSeqLock {
+  static_assert(std::is_trivially_copyable< T >::value, "T must be a plain struct");
+  static const size_t WORDS = (sizeof(T) + 3) / 4;
+
+  std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> w[WORDS];
+
+public:
+  // Writer side
+  void write(const T &v) {
+    uint32_t b[WORDS] = {};
+    memcpy(b, &v, sizeof(T));
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) w[i].store(b[i], std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  // Either side, false if an update was in progress
+  bool try_read(T &v) const {
+    uint32_t b[WORDS];
+    uint32_t s = seq.load(std::memory_order_acquire);
+    if (s & 1) return false;
+    for (size_t i = 0; i < WORDS; i++) b[i] = w[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) != s) return false;
+    memcpy(&v, b, sizeof(T));
+    return true;
+  }
+  T read(void) const {
+    T v;
+    while (!try_read(v))
+      ;
+    return v;
+  }
+
+  // Number of updates so far
+  uint32_t version(void) const { return seq.load(std::memory_order_acquire) / 2; }
+
+  CSeqLock() : seq(0) {
+    for (size_t i = 0; i < WORDS; i++) w[i].store(0, std::memory_order_relaxed);
+  }
+};
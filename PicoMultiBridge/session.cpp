@@ -0,0 +1,295 @@
+/*
+  session
+
+  Table of TCP clients attached to one serial port.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include "session.hpp"
+
+// A Modbus tag keeps the slot in its low bits however often it wraps
+static_assert(256 % CSessions::MAX_SESSIONS == 0, "MAX_SESSIONS must divide 256");
+
+CSessions::CSessions() : owner_gen(0) {
+  owner = -1;
+  count = 0;
+  arbitration = tFirst;
+  slowpolicy = tWait;
+  rx = tx = NULL;
+  backlog.begin(NULL, 0);
+  replaymode = 0;
+  modbus = false;
+  write_us = 0;
+  for (int i = 0; i < MAX_SESSIONS; i++) {
+    session[i].active = false;
+    session[i].tag = i;
+  }
+}
+
+void CSessions::begin(CSPSCRingBase *uart2net, CSPSCRingBase *net2uart, uint8_t arb, uint8_t slow) {
+  rx = uart2net;
+  tx = net2uart;
+  // Settings saved by an older firmware read as 0xff
+  arbitration = (arb <= tDemand) ? (TArbitration)arb : tFirst;
+  slowpolicy = (slow <= tDisconnect) ? (TSlowPolicy)slow : tWait;
+}
+
+void CSessions::setBacklog(uint8_t *buf, uint32_t size, int16_t replay) {
+  backlog.begin(buf, size);
+  replaymode = replay;
+}
+
+void CSessions::end(void) {
+  for (int i = 0; i < MAX_SESSIONS; i++)
+    if (session[i].active) detach(i);
+}
+
+void CSessions::set_owner(int i) {
+  if (owner != i) {
+    owner = i;
+    owner_gen.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void CSessions::attach(WiFiClient &c) {
+  int i;
+  for (i = 0; i < MAX_SESSIONS; i++)
+    if (!session[i].active) break;
+  if (i >= MAX_SESSIONS) {
+    c.stop();
+    Serial.println("Client refused, no free session");
+    return;
+  }
+  TSession *s = &session[i];
+  s->client = c;
+  s->client.setNoDelay(true);
+  s->active = true;
+  s->cursor = rx->head_pos();
+  s->since = s->lastrx = millis();
+  s->stalled = 0;
+  s->dropped = 0;
+  s->replaying = (backlog.held() > 0);
+  s->tag = (uint8_t)((s->tag / MAX_SESSIONS + 1) * MAX_SESSIONS + i);
+  s->mbap.reset();
+  if (replaymode > 0) s->replay = backlog.start_last((uint32_t)replaymode * 1024);
+  else if (replaymode < 0) s->replay = backlog.start_since(millis() + (uint32_t)replaymode * 1000);
+  else s->replay = backlog.start_all();
+  // The rx ring has been emptied into the backlog up to its tail, what follows is live.
+  // While a client is still replaying the ring is held from there, so a later one joins there too.
+  if (backlog.enabled() && (count == 0 || s->replaying)) s->cursor = rx->tail_pos();
+  s->ip = c.remoteIP();
+  s->port = c.remotePort();
+  count++;
+  Serial.printf("Client %d connected from %s:%d", i, s->ip.toString().c_str(), s->port);
+  if (s->replaying) Serial.printf(", replaying %lu bytes", backlog.head_pos() - s->replay);
+  Serial.println();
+  if (owner < 0 || arbitration == tLast) set_owner(i);
+}
+
+void CSessions::detach(int i) {
+  TSession *s = &session[i];
+  s->client.stop();
+  s->active = false;
+  count--;
+  Serial.printf("Client %d disconnected\n", i);
+  if (owner == i) {
+    // Hand ownership to the longest connected client
+    int n = -1;
+    for (int j = 0; j < MAX_SESSIONS; j++)
+      if (session[j].active && (n < 0 || (int32_t)(session[j].since - session[n].since) < 0)) n = j;
+    set_owner(n);
+  }
+}
+
+// Clients -> UART
+void CSessions::receive(void) {
+  static uint8_t discard[256];
+  TRingSpan s1, s2;
+  int l, ll;
+
+  for (int i = 0; i < MAX_SESSIONS; i++) {
+    TSession *s = &session[i];
+    if (!s->active) continue;
+    while ((l = s->client.available()) > 0) {
+      if (i != owner && arbitration == tDemand && (owner < 0 || millis() - session[owner].lastrx > ARB_IDLE_MS))
+        set_owner(i);
+      s->lastrx = millis();
+      if (i == owner) {
+        // Only while the ring has room, so that TCP's window throttles the sender
+        if (tx->reserve(s1, s2) == 0) break;
+        if ((ll = s->client.read(s1.ptr, min((size_t)l, s1.len))) <= 0) break;
+        tx->commit(ll);
+      } else {
+        if (s->client.read(discard, min((size_t)l, sizeof(discard))) <= 0) break;
+      }
+    }
+  }
+}
+
+// Clients -> UART, each whole request as one record
+void CSessions::receive_modbus(void) {
+  uint8_t rec[CModbus::MAX_RECORD];
+  int l;
+
+  for (int i = 0; i < MAX_SESSIONS; i++) {
+    TSession *s = &session[i];
+    if (!s->active) continue;
+    while (true) {
+      if (s->mbap.complete()) {
+        // Only while the ring has room, so that TCP's window throttles the sender
+        size_t n = s->mbap.len();
+        if (tx->space() < 1 + n) break;
+        rec[0] = s->tag;
+        memcpy(&rec[1], s->mbap.adu(), n);
+        tx->write(rec, 1 + n);
+        s->mbap.reset();
+      }
+      if ((l = s->client.available()) <= 0) break;
+      if ((l = s->client.read(s->mbap.tail(), min((size_t)l, s->mbap.need()))) <= 0) break;
+      s->lastrx = millis();
+      if (!s->mbap.add(l)) {
+        Serial.printf("Client %d does not speak Modbus TCP\n", i);
+        detach(i);
+        break;
+      }
+    }
+  }
+}
+
+// UART -> clients, each response to the client that asked, if it is still there.
+// A response goes out whole; one its client has had no room for in SLOW_TIMEOUT_MS is dropped.
+void CSessions::send_modbus(void) {
+  uint8_t rec[CModbus::MAX_RECORD];
+  TRingSpan s1, s2;
+  size_t n;
+
+  while ((n = rx->peek(s1, s2)) >= CModbus::RECORD_HEAD) {
+    auto at = [&](size_t k) { return (k < s1.len) ? s1.ptr[k] : s2.ptr[k - s1.len]; };
+    size_t len = 1 + 6 + ((size_t)at(5) << 8 | at(6));  // tag, MBAP up to the length field and what that counts
+    if (n < len) break;
+    TSession *s = &session[at(0) % MAX_SESSIONS];
+    bool live = s->active && s->tag == at(0);
+    if (live && (size_t)max(s->client.availableForWrite(), 0) < len - 1) {
+      if (s->stalled == 0) s->stalled = millis() | 1;
+      if (millis() - s->stalled <= SLOW_TIMEOUT_MS) break;
+      s->dropped += len;
+      live = false;
+    }
+    rx->read(rec, len);
+    if (live) {
+      uint32_t t = micros();
+      s->client.write(rec + 1, len - 1);
+      write_us += micros() - t;
+    }
+    s->stalled = 0;
+  }
+}
+
+// Backlog -> client, true once all of it has gone
+bool CSessions::send_backlog(TSession *s) {
+  TRingSpan s1, s2;
+  if (backlog.peek_at(s->replay, s1, s2) > 0) {
+    size_t room = max(s->client.availableForWrite(), 0);
+    uint32_t t = micros();
+    size_t l = s->client.write(s1.ptr, min(room, s1.len));
+    if (l == s1.len && s2.len > 0 && room > l) l += s->client.write(s2.ptr, min(room - l, s2.len));
+    write_us += micros() - t;
+    s->replay += l;
+  }
+  return s->replay == backlog.head_pos();
+}
+
+// UART -> clients, up to the ring position limit
+void CSessions::send(uint32_t limit) {
+  TRingSpan s1, s2;
+  uint32_t head = rx->head_pos();
+  uint32_t oldest = head;
+  bool replaying = false;
+
+  for (int i = 0; i < MAX_SESSIONS; i++) {
+    TSession *s = &session[i];
+    if (!s->active) continue;
+    // What was missed goes first, live data waits in the rx ring meanwhile
+    if (s->replaying) s->replaying = !send_backlog(s);
+    if (s->replaying) {
+      replaying = true;
+    } else if ((int32_t)(limit - s->cursor) > 0 && rx->peek_at(s->cursor, limit, s1, s2) > 0) {
+      // Never more than the socket takes without blocking, so one client cannot hold up the others
+      size_t room = max(s->client.availableForWrite(), 0);
+      uint32_t t = micros();
+      size_t l = s->client.write(s1.ptr, min(room, s1.len));
+      if (l == s1.len && s2.len > 0 && room > l) l += s->client.write(s2.ptr, min(room - l, s2.len));
+      write_us += micros() - t;
+      s->cursor += l;
+    }
+    if (head - s->cursor >= rx->size()) {
+      if (s->stalled == 0) s->stalled = millis() | 1;
+      else if (millis() - s->stalled > SLOW_TIMEOUT_MS) {
+        if (slowpolicy == tDrop) {
+          s->dropped += head - s->cursor;
+          s->cursor = head;
+          s->stalled = 0;
+        } else if (slowpolicy == tDisconnect) {
+          detach(i);
+          continue;
+        }
+      }
+    } else
+      s->stalled = 0;
+    if ((int32_t)(s->cursor - oldest) < 0) oldest = s->cursor;
+  }
+  rx->release_to(oldest);
+  // Everyone still here has had it
+  if (!replaying && count > 0) backlog.clear();
+}
+
+void CSessions::hold(void) {
+  TRingSpan s1, s2;
+  if (count > 0) end();
+  if (backlog.enabled() && rx->peek(s1, s2) > 0) {
+    uint32_t now = millis();
+    backlog.append(s1.ptr, s1.len, now);
+    backlog.append(s2.ptr, s2.len, now);
+  }
+  rx->clear();
+}
+
+void CSessions::poll(WiFiServer *server, uint32_t limit) {
+  // Check for incoming client connections
+  for (int i = 0; i < MAX_SESSIONS; i++)
+    if (session[i].active && !session[i].client.connected()) detach(i);
+
+  // Nobody to deliver UART data to, it is kept if there is a backlog
+  if (count == 0) hold();
+
+  WiFiClient c = server->accept();
+  if (c) attach(c);
+  if (count == 0) return;
+  // Modbus responses go out as soon as they are whole, limit is for streams
+  if (modbus) {
+    receive_modbus();
+    send_modbus();
+    return;
+  }
+  receive();
+  send(limit);
+}
+
+void CSessions::print_stat(void) {
+  const char *arb_s[] = { "first", "last", "demand" };
+  const char *slow_s[] = { "wait", "drop", "disconnect" };
+  if (modbus) Serial.printf(" Clients %d/%d, every one may send Modbus requests\n", count, MAX_SESSIONS);
+  else Serial.printf(" Clients %d/%d, arbitration is %s, slow client is %s\n", count, MAX_SESSIONS, arb_s[arbitration], slow_s[slowpolicy]);
+  if (backlog.enabled())
+    Serial.printf(" Backlog %lu of %lu bytes held, %llu dropped\n", backlog.held(), backlog.size(), backlog.lost());
+  for (int i = 0; i < MAX_SESSIONS; i++) {
+    TSession *s = &session[i];
+    if (s->active && modbus)
+      Serial.printf("   %d %s:%d responses dropped %lu bytes\n", i, s->ip.toString().c_str(), s->port, s->dropped);
+    else if (s->active)
+      Serial.printf("  %c%d %s:%d lag %lu dropped %lu\n", (i == owner) ? '*' : ' ', i, s->ip.toString().c_str(), s->port, rx->head_pos() - s->cursor, s->dropped);
+  }
+}
@@ -0,0 +1,104 @@
+/*
+  session
+
+  Table of TCP clients attached to one serial port.
+
+  UART data is broadcast to every client from the single copy in the rx ring,
+  each client having its own cursor into it. Only the owner's data goes to the UART,
+  what the others send is read and discarded.
+  With a backlog, what arrives while nobody is connected is kept there and sent to
+  the next client before anything live.
+  As a Modbus TCP gateway every client may send; whole requests go to the UART side
+  tagged with their client, and each response goes back to the client its tag names.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <atomic>
+#include "backlog.hpp"
+#include "modbus.hpp"
+#include "spsc.hpp"
+
+typedef struct {
+  WiFiClient client;
+  bool active;
+  uint32_t cursor;    // position in the rx ring sent so far
+  uint32_t since;     // millis() at connection
+  uint32_t lastrx;    // millis() of the last data received
+  uint32_t stalled;   // millis() since the client has been a full ring behind, 0 if not
+  uint32_t dropped;   // bytes skipped by the slow consumer policy
+  bool replaying;     // still sending from the backlog
+  uint32_t replay;    // position in the backlog sent so far
+  IPAddress ip;
+  uint16_t port;
+  uint8_t tag;          // Modbus, slot and connection count, so that a late response finds no successor
+  CMbapAssembler mbap;  // Modbus, request being read
+} TSession;
+
+class CSessions {
+public:
+  static const int MAX_SESSIONS = 4;
+  static const uint32_t SLOW_TIMEOUT_MS = 500;
+  static const uint32_t ARB_IDLE_MS = 1000;
+
+  typedef enum {
+    tFirst,   // the first client keeps ownership until it leaves
+    tLast,    // the newest client takes ownership over
+    tDemand   // a client that sends takes ownership once the owner has been quiet for ARB_IDLE_MS
+  } TArbitration;
+
+  typedef enum {
+    tWait,        // the slowest client throttles everyone
+    tDrop,        // a client that cannot keep up skips ahead
+    tDisconnect   // a client that cannot keep up is disconnected
+  } TSlowPolicy;
+
+private:
+  TSession session[MAX_SESSIONS];
+  int owner;
+  int count;
+  TArbitration arbitration;
+  TSlowPolicy slowpolicy;
+
+  CSPSCRingBase *rx;  // UART -> clients
+  CSPSCRingBase *tx;  // owner -> UART
+  CBacklog backlog;
+  int16_t replaymode;
+  bool modbus;
+
+  std::atomic<uint32_t> owner_gen;
+  uint32_t write_us;  // time spent in client.write()
+
+  void attach(WiFiClient &c);
+  void detach(int i);
+  void set_owner(int i);
+  void receive(void);
+  void send(uint32_t limit);
+  bool send_backlog(TSession *s);
+  void receive_modbus(void);
+  void send_modbus(void);
+
+public:
+  void begin(CSPSCRingBase *uart2net, CSPSCRingBase *net2uart, uint8_t arb, uint8_t slow);
+  // Keep UART data in buf while there is no client, replay: 0:all of it, N>0:the last N KB, N<0:the last -N seconds
+  void setBacklog(uint8_t *buf, uint32_t size, int16_t replay);
+  // Modbus TCP records instead of a byte stream, see modbus.hpp
+  void setModbus(bool on) { modbus = on; }
+  void poll(WiFiServer *server, uint32_t limit);
+  // Nobody can connect, e.g. while WiFi is down
+  void hold(void);
+  void end(void);
+
+  int clients(void) { return count; }
+  // Changes whenever a different client starts writing to the UART
+  uint32_t generation(void) { return owner_gen.load(std::memory_order_acquire); }
+  void print_stat(void);
+  uint32_t write_time(void) { return write_us; }
+
+  CSessions();
+};
@@ -0,0 +1,169 @@
+/*
+  spsc
+
+  Lock-free single-producer/single-consumer byte ring for passing data between the two cores.
+
+  The producer only ever stores head and the consumer only ever stores tail.
+  Both are free-running counters, so the fill level is simply head - tail.
+  Data is published with a release store of head and observed with an acquire load,
+  which on Cortex-M0+/M33 turns into the DMB needed so the other core never
+  sees an index before the bytes it covers.
+
+  The consumer may also walk the ring with cursors of its own (peek_at()) and
+  release_to() the oldest of them, which is how one copy is fanned out to several readers.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// One contiguous region of a ring buffer
+typedef struct {
+  uint8_t *ptr;
+  size_t len;
+} TRingSpan;
+
+class CSPSCRingBase {
+  uint8_t *buf;
+  uint32_t len;
+  std::atomic<uint32_t> head;  // bytes written, producer only
+  std::atomic<uint32_t> tail;  // bytes consumed, consumer only
+
+  // Split [from, from + n) into at most two regions of buf
+  size_t span(uint32_t from, size_t n, TRingSpan &s1, TRingSpan &s2) {
+    uint32_t pos = from & (len - 1);
+    s1.ptr = &buf[pos];
+    s1.len = (n < len - pos) ? n : len - pos;
+    s2.ptr = buf;
+    s2.len = n - s1.len;
+    return n;
+  }
+
+protected:
+  CSPSCRingBase(uint8_t *p, uint32_t size) : buf(p), len(size), head(0), tail(0) {}
+
+public:
+  size_t size(void) const { return len; }
+
+  //---- producer side
+  size_t space(void) const {
+    return len - (head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+  }
+
+  // Writable regions; fill them and then call commit()
+  size_t reserve(TRingSpan &s1, TRingSpan &s2) {
+    return span(head.load(std::memory_order_relaxed), space(), s1, s2);
+  }
+
+  void commit(size_t n) {
+    head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  // Copy in as much as fits, returns the number of bytes taken
+  size_t write(const uint8_t *p, size_t n) {
+    TRingSpan s1, s2;
+    size_t l = reserve(s1, s2);
+    if (n < l) l = n;
+    size_t l1 = (l < s1.len) ? l : s1.len;
+    memcpy(s1.ptr, p, l1);
+    memcpy(s2.ptr, &p[l1], l - l1);
+    commit(l);
+    return l;
+  }
+
+  //---- consumer side
+  uint32_t head_pos(void) const {
+    return head.load(std::memory_order_acquire);
+  }
+
+  uint32_t tail_pos(void) const {
+    return tail.load(std::memory_order_relaxed);
+  }
+
+  size_t available(void) const {
+    return head_pos() - tail_pos();
+  }
+
+  // Readable regions; process them and then call consume()
+  size_t peek(TRingSpan &s1, TRingSpan &s2) {
+    return span(tail_pos(), available(), s1, s2);
+  }
+
+  // Readable regions from a cursor between tail and head
+  size_t peek_at(uint32_t pos, TRingSpan &s1, TRingSpan &s2) {
+    return span(pos, head_pos() - pos, s1, s2);
+  }
+
+  // Same, but only up to end
+  size_t peek_at(uint32_t pos, uint32_t end, TRingSpan &s1, TRingSpan &s2) {
+    return span(pos, end - pos, s1, s2);
+  }
+
+  void consume(size_t n) {
+    release_to(tail_pos() + n);
+  }
+
+  void release_to(uint32_t pos) {
+    tail.store(pos, std::memory_order_release);
+  }
+
+  // Copy out as much as is there, returns the number of bytes taken
+  size_t read(uint8_t *p, size_t n) {
+    TRingSpan s1, s2;
+    size_t l = peek(s1, s2);
+    if (n < l) l = n;
+    size_t l1 = (l < s1.len) ? l : s1.len;
+    memcpy(p, s1.ptr, l1);
+    memcpy(&p[l1], s2.ptr, l - l1);
+    consume(l);
+    return l;
+  }
+
+  // Drop everything that is queued, consumer side only
+  void clear(void) {
+    release_to(head_pos());
+  }
+};
+
+template< std::size_t N > class CSPSCRing : public CSPSCRingBase {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "size must be a power of two");
+  uint8_t storage[N];
+
+public:
+  CSPSCRing() : CSPSCRingBase(storage, N) {}
+};
+
+// Same rules for whole items, used to hand over pointers
+template< typename T, std::size_t N > class CSPSCQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "size must be a power of two");
+  T q[N];
+  std::atomic<uint32_t> head;  // producer only
+  std::atomic<uint32_t> tail;  // consumer only
+
+public:
+  //---- producer side
+  bool push(const T &v) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return false;
+    q[h & (N - 1)] = v;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  //---- consumer side
+  bool front(T &v) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t) return false;
+    v = q[t & (N - 1)];
+    return true;
+  }
+  void pop(void) { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  CSPSCQueue() : head(0), tail(0) {}
+};
@@ -0,0 +1,91 @@
+/*
+  udp
+
+  UDP transport for the bridge, an alternative to the TCP sessions.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include "udp.hpp"
+
+CUdpBridge::CUdpBridge() {
+  started = false;
+  rx = tx = NULL;
+  port = remoteport = lastport = 0;
+  txcount = rxcount = 0;
+  write_us = 0;
+}
+
+void CUdpBridge::begin(CSPSCRingBase *uart2net, CSPSCRingBase *net2uart, uint16_t localport, IPAddress dest, uint16_t destport, bool seq) {
+  rx = uart2net;
+  tx = net2uart;
+  port = localport;
+  remote = dest;
+  remoteport = (destport != 0) ? destport : localport;
+  packer.begin(seq);
+}
+
+void CUdpBridge::start(void) {
+  if (is_multicast(remote)) udp.beginMulticast(remote, port);
+  else udp.begin(port);
+  lastip = IPAddress(0, 0, 0, 0);
+  lastport = 0;
+  started = true;
+}
+
+void CUdpBridge::end(void) {
+  if (started) udp.stop();
+  started = false;
+}
+
+void CUdpBridge::poll(bool online, uint32_t limit) {
+  int l;
+
+  if (!online) {
+    end();
+    rx->clear();
+    return;
+  }
+  if (!started) start();
+
+  // Network -> UART, a datagram is only taken when it is sure to fit
+  while (tx->space() >= sizeof(buf) && (l = udp.parsePacket()) > 0) {
+    lastip = udp.remoteIP();
+    lastport = udp.remotePort();
+    if ((l = udp.read(buf, sizeof(buf))) <= 0) break;
+    size_t h = packer.unpack(buf, l);
+    tx->write(&buf[h], l - h);
+    rxcount++;
+  }
+
+  // UART -> network
+  IPAddress ip = remote;
+  uint16_t p = remoteport;
+  if (ip == IPAddress(0, 0, 0, 0)) {
+    ip = lastip;
+    p = lastport;
+  }
+  if (p == 0) {
+    // Nobody to deliver UART data to
+    rx->clear();
+    return;
+  }
+  size_t n;
+  while ((n = packer.pack(rx, limit, buf)) > 0) {
+    uint32_t t = micros();
+    udp.beginPacket(ip, p);
+    udp.write(buf, n);
+    udp.endPacket();
+    write_us += micros() - t;
+    txcount++;
+  }
+}
+
+void CUdpBridge::print_stat(void) {
+  Serial.printf(" UDP port %d, sending to %s:%d%s\n", port,
+                (remote == IPAddress(0, 0, 0, 0)) ? "(last sender)" : remote.toString().c_str(), remoteport,
+                is_multicast(remote) ? " (multicast)" : "");
+  Serial.printf(" Datagrams sent %lu, received %lu, lost %lu\n", txcount, rxcount, packer.lost);
+}
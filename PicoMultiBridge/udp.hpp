@@ -0,0 +1,51 @@
+/*
+  udp
+
+  UDP transport for the bridge, an alternative to the TCP sessions.
+
+  UART data is packed into datagrams and sent to a fixed unicast or multicast destination,
+  or back to whoever sent the last datagram if no destination is set.
+  Datagrams received on the port go to the UART.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include "dgram.hpp"
+#include "spsc.hpp"
+
+class CUdpBridge {
+  WiFiUDP udp;
+  bool started;
+
+  uint16_t port;
+  IPAddress remote;
+  uint16_t remoteport;
+  IPAddress lastip;
+  uint16_t lastport;
+
+  CDgramPacker packer;
+  uint8_t buf[CDgramPacker::MAX_DATAGRAM];
+
+  CSPSCRingBase *rx;  // UART -> network
+  CSPSCRingBase *tx;  // network -> UART
+
+  uint32_t txcount, rxcount;
+  uint32_t write_us;  // time spent sending datagrams
+
+  static bool is_multicast(IPAddress ip) { return (ip[0] & 0xf0) == 0xe0; }
+  void start(void);
+
+public:
+  void begin(CSPSCRingBase *uart2net, CSPSCRingBase *net2uart, uint16_t localport, IPAddress dest, uint16_t destport, bool seq);
+  void poll(bool online, uint32_t limit);
+  void end(void);
+  void print_stat(void);
+  uint32_t write_time(void) { return write_us; }
+
+  CUdpBridge();
+};
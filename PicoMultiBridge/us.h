@@ -62,7 +62,7 @@ bool are_you_sure(void) {
 
 String pass(const char *s) {
   String p;
-  for (int i = 0; i < strlen(s); i++) {
+  for (size_t i = 0; i < strlen(s); i++) {
     p += '*';
   }
   return p;
@@ -3,7 +3,7 @@
 
   UART Transmission and Reception via DMA.
 
-  Incidentally, no ring buffer is configured for transmission.
+  Both directions use power-of-two ring buffers that DMA wraps around by itself.
   Referenced “Copyright (c) 2025 https://github.com/qqqlab”
 
   SPDX-License-Identifier: MIT
@@ -15,27 +15,24 @@
 #include <stdlib.h>
 #include <hardware/gpio.h>
 #include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
 #include <api/HardwareSerial.h>
 #include "us_dma.h"
 
+CUartBase* CUartBase::irq_owner[CUartBase::MAX_OWNERS];
+
 uint32_t CUartDMA::begin(uint8_t uart_ch, uint32_t baudrate, uint16_t config, uint16_t txblen, uint16_t rxblen) {
   seluart = UART_INSTANCE(uart_ch);
   if (seluart != nullptr) {
+    uart_hw_t* reg = uart_get_hw(seluart);
     actualbaudrate = begin(baudrate, config);
-    rxbuf_len_pow = log_2(rxblen);
-    txbuf_len_pow = log_2(txblen);
-    rxbuf_len = 1 << (rxbuf_len_pow);
-    txbuf_len = 1 << (txbuf_len_pow);
-    rxbuf = (uint8_t*)aligned_alloc(rxbuf_len, rxbuf_len);
-    txbuf = (uint8_t*)aligned_alloc(txbuf_len, txbuf_len);
-
-    init_dma(uart_ch);
-    return actualbaudrate;
+    if (start(txblen, rxblen, uart_get_dreq(seluart, true), uart_get_dreq(seluart, false), &reg->dr, &reg->dr)) return actualbaudrate;
   }
   return 0;
 }
 
-uint8_t CUartDMA::log_2(uint16_t val) {
+uint8_t CUartBase::log_2(uint16_t val) {
   uint8_t i = 0;
   val--;
   while (val > 0) {
@@ -45,73 +42,165 @@ uint8_t CUartDMA::log_2(uint16_t val) {
   return i;
 }
 
+// Convert SERIAL_xxx to the data bits, stop bits and parity of the SDK and apply them
+void CUartDMA::set_format(uint16_t config) {
+  int bits, stop;
+  uart_parity_t parity;
+  switch (config & SERIAL_PARITY_MASK) {
+    case SERIAL_PARITY_EVEN:
+      parity = UART_PARITY_EVEN;
+      break;
+    case SERIAL_PARITY_ODD:
+      parity = UART_PARITY_ODD;
+      break;
+    default:
+      parity = UART_PARITY_NONE;
+      break;
+  }
+  switch (config & SERIAL_STOP_BIT_MASK) {
+    case SERIAL_STOP_BIT_1:
+      stop = 1;
+      break;
+    default:
+      stop = 2;
+      break;
+  }
+  switch (config & SERIAL_DATA_MASK) {
+    case SERIAL_DATA_5:
+      bits = 5;
+      break;
+    case SERIAL_DATA_6:
+      bits = 6;
+      break;
+    case SERIAL_DATA_7:
+      bits = 7;
+      break;
+    default:
+      bits = 8;
+      break;
+  }
+  uart_set_format(seluart, bits, stop, parity);
+}
+
 uint32_t CUartDMA::begin(uint32_t baudrate, uint16_t config) {
   if (seluart != nullptr) {
-    int bits, stop;
-    uart_parity_t parity;
-    switch (config & SERIAL_PARITY_MASK) {
-      case SERIAL_PARITY_EVEN:
-        parity = UART_PARITY_EVEN;
-        break;
-      case SERIAL_PARITY_ODD:
-        parity = UART_PARITY_ODD;
-        break;
-      default:
-        parity = UART_PARITY_NONE;
-        break;
-    }
-    switch (config & SERIAL_STOP_BIT_MASK) {
-      case SERIAL_STOP_BIT_1:
-        stop = 1;
-        break;
-      default:
-        stop = 2;
-        break;
-    }
-    switch (config & SERIAL_DATA_MASK) {
-      case SERIAL_DATA_5:
-        bits = 5;
-        break;
-      case SERIAL_DATA_6:
-        bits = 6;
-        break;
-      case SERIAL_DATA_7:
-        bits = 7;
-        break;
-      default:
-        bits = 8;
-        break;
-    }
     actualbaudrate = uart_init(seluart, baudrate);
-    uart_set_format(seluart, bits, stop, parity);
+    set_format(config);
     return (actualbaudrate);
   }
   return 0;
 }
 
-uint32_t CUartDMA::getActualBaud(void) {
-  if (seluart != nullptr) return actualbaudrate;
-  return 0;
+uint32_t CUartDMA::set_line(uint32_t baudrate, uint16_t config) {
+  uint32_t b = uart_set_baudrate(seluart, baudrate);
+  set_format(config);
+  return b;
+}
+
+void CUartDMA::tx_drain(void) {
+  while ((uart_get_hw(seluart)->fr & UART_UARTFR_BUSY_BITS))
+    delay(0);
 }
 
-void CUartDMA::init_dma(int usch) {
-  int dreq_tx_num, dreq_rx_num;
-  uart_hw_t* reg;
-  if (usch == 0) {
-    dreq_tx_num = DREQ_UART0_TX;
-    dreq_rx_num = DREQ_UART0_RX;
-    reg = uart0_hw;
-  } else if (usch == 1) {
-    dreq_tx_num = DREQ_UART1_TX;
-    dreq_rx_num = DREQ_UART1_RX;
-    reg = uart1_hw;
-  } else
-    return;
+// Change baudrate and format without resetting the UART.
+// Only the bytes already queued for TX are waited for, RX DMA keeps running throughout
+// and the RX byte offset of the switch is recorded.
+uint32_t CUartBase::reconfigure(uint32_t baudrate, uint16_t config) {
+  if (started()) {
+    uint32_t t0 = time_us_32();
+    flush();
+    uint32_t t1 = time_us_32();
+    actualbaudrate = set_line(baudrate, config);
+    uint32_t t2 = time_us_32();
+
+    reconf.count++;
+    reconf.rxpos = rx_count + available();
+    reconf.wait_us = t1 - t0;
+    reconf.switch_us = t2 - t1;
+    if (reconf.switch_us > reconf.max_switch_us) reconf.max_switch_us = reconf.switch_us;
+    return actualbaudrate;
+  }
+  return begin(baudrate, config);
+}
+
+uint32_t CUartBase::getActualBaud(void) {
+  return actualbaudrate;
+}
+
+void CUartDMA::setBreak(bool on) {
+  if (seluart != nullptr) uart_set_break(seluart, on);
+}
+
+// RTS is driven by software from the RX ring fill
+// so that the sender is held off before the ring, not just the FIFO, overflows.
+void CUartBase::setFlowControl(bool en, int rts) {
+  if (en && rts >= 0) {
+    rx_mark.config(rxbuf_len * 3 / 4, rxbuf_len / 4);
+    gpio_init(rts);
+    gpio_set_dir(rts, GPIO_OUT);
+    gpio_put(rts, 0);
+    rts_pin = rts;
+  } else {
+    if (rts_pin >= 0) gpio_put(rts_pin, 0);
+    rx_mark.config(0, 0);
+    rts_pin = -1;
+  }
+}
+
+// Hardware CTS stops TX
+void CUartDMA::setFlowControl(bool en, int rts) {
+  if (seluart == nullptr) return;
+  uart_set_hw_flow(seluart, en, false);
+  CUartBase::setFlowControl(en, rts);
+}
+
+// Allocate the rings and start DMA on them, everything is released again if channels run out
+bool CUartBase::start(uint16_t txblen, uint16_t rxblen, uint dreq_tx, uint dreq_rx, volatile void* txreg, const volatile void* rxreg) {
+  rxbuf_len_pow = log_2(rxblen);
+  txbuf_len_pow = log_2(txblen);
+  rxbuf_len = 1 << (rxbuf_len_pow);
+  txbuf_len = 1 << (txbuf_len_pow);
+  rxbuf = (uint8_t*)aligned_alloc(rxbuf_len, rxbuf_len);
+  txbuf = (uint8_t*)aligned_alloc(txbuf_len, txbuf_len);
+  if (rxbuf != nullptr && txbuf != nullptr && init_dma(dreq_tx, dreq_rx, txreg, rxreg)) return true;
+  free(rxbuf);
+  free(txbuf);
+  rxbuf = txbuf = nullptr;
+  return false;
+}
+
+bool CUartBase::init_dma(uint dreq_tx, uint dreq_rx, volatile void* txreg, const volatile void* rxreg) {
+  int slot = 0;
+  while (slot < MAX_OWNERS && irq_owner[slot] != nullptr) slot++;
+  if (slot == MAX_OWNERS) return false;
+
+#if PICO_RP2040
+  const int channels = 3;
+#else
+  const int channels = 2;
+#endif
+  int ch[channels];
+  for (int i = 0; i < channels; i++) {
+    if ((ch[i] = dma_claim_unused_channel(false)) < 0) {
+      while (--i >= 0) dma_channel_unclaim(ch[i]);
+      return false;
+    }
+  }
+  rx_dma_ch = ch[0];
+  tx_dma_ch = ch[1];
+
+  // Count every RX segment so that the write position can be extended to 64 bits
+  rx_wraps = 0;
+  if (slot == 0) {
+    irq_add_shared_handler(DMA_IRQ_1, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+  }
+  irq_owner[slot] = this;
+  dma_channel_set_irq1_enabled(rx_dma_ch, true);
 
 #if PICO_RP2040
-  rx_dma_ch = dma_claim_unused_channel(true);
   // RP2040 does not have self trigger, use second dma channel to re-trigger rx channel
-  rx_trg_dma_ch = dma_claim_unused_channel(true);
+  rx_trg_dma_ch = ch[2];
   // DMA control to re-trigger uart read channel (performs dummy 1 byte transfer from rx_ctrl_dummy_read to rx_ctrl_dummy_write)
   dma_channel_config trg_config = dma_channel_get_default_config(rx_trg_dma_ch);
   channel_config_set_transfer_data_size(&trg_config, DMA_SIZE_8);
@@ -127,100 +216,217 @@ void CUartDMA::init_dma(int usch) {
   channel_config_set_read_increment(&rx_config, false);
   channel_config_set_write_increment(&rx_config, true);
   channel_config_set_ring(&rx_config, true, rxbuf_len_pow);
-  channel_config_set_dreq(&rx_config, dreq_rx_num);
+  channel_config_set_dreq(&rx_config, dreq_rx);
   channel_config_set_chain_to(&rx_config, rx_trg_dma_ch);
   channel_config_set_enable(&rx_config, true);
-  dma_channel_configure(rx_dma_ch, &rx_config, rxbuf, &reg->dr, rxbuf_len, true);
+  dma_channel_configure(rx_dma_ch, &rx_config, rxbuf, rxreg, RX_SEGMENT, true);
 #else
   // DMA uart read
-  rx_dma_ch = dma_claim_unused_channel(true);
   dma_channel_config rx_config = dma_channel_get_default_config(rx_dma_ch);
   channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
   channel_config_set_read_increment(&rx_config, false);
   channel_config_set_write_increment(&rx_config, true);
   channel_config_set_ring(&rx_config, true, rxbuf_len_pow);
-  channel_config_set_dreq(&rx_config, dreq_rx_num);
+  channel_config_set_dreq(&rx_config, dreq_rx);
   channel_config_set_enable(&rx_config, true);
-  dma_channel_configure(rx_dma_ch, &rx_config, rxbuf, &reg->dr, dma_encode_transfer_count_with_self_trigger(rxbuf_len), true);
-  dma_channel_set_irq0_enabled(rx_dma_ch, false);
+  dma_channel_configure(rx_dma_ch, &rx_config, rxbuf, rxreg, dma_encode_transfer_count_with_self_trigger(RX_SEGMENT), true);
 #endif
 
   // DMA uart write
-  tx_dma_ch = dma_claim_unused_channel(true);
   dma_channel_config tx_config = dma_channel_get_default_config(tx_dma_ch);
   channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
   channel_config_set_read_increment(&tx_config, true);
   channel_config_set_write_increment(&tx_config, false);
-  channel_config_set_dreq(&tx_config, dreq_tx_num);
-  dma_channel_configure(tx_dma_ch, &tx_config, &reg->dr, txbuf, 1, false);
+  channel_config_set_ring(&tx_config, false, txbuf_len_pow);
+  channel_config_set_dreq(&tx_config, dreq_tx);
+  dma_channel_configure(tx_dma_ch, &tx_config, txreg, txbuf, 0, false);
+  tx_head = tx_tail = 0;
+  dma_channel_set_irq1_enabled(tx_dma_ch, true);
 
-  rx_dma_hw = dma_channel_hw_addr(rx_dma_ch);
   tx_dma_hw = dma_channel_hw_addr(tx_dma_ch);
+  rx_dma_hw = dma_channel_hw_addr(rx_dma_ch);
+  return true;
+}
+
+// Also wakes a core waiting in __wfe() once TX DMA is done, so that it can hand over what is left in the ring
+void CUartBase::dma_irq_handler(void) {
+  for (CUartBase* u : irq_owner) {
+    if (u == nullptr) continue;
+    if (dma_channel_get_irq1_status(u->rx_dma_ch)) {
+      dma_channel_acknowledge_irq1(u->rx_dma_ch);
+      u->rx_wraps++;
+    }
+    if (dma_channel_get_irq1_status(u->tx_dma_ch)) dma_channel_acknowledge_irq1(u->tx_dma_ch);
+  }
+  __sev();
+}
+
+// Total bytes DMA has written into the RX ring.
+// A completion whose IRQ has not been serviced yet is still pending in the status register;
+// the retry covers the IRQ or a completion landing between the reads.
+uint64_t CUartBase::rx_wpos(void) {
+  uint32_t w, remain;
+  bool p1, p2;
+  do {
+    w = rx_wraps;
+    p1 = dma_channel_get_irq1_status(rx_dma_ch);
+    remain = rx_dma_hw->transfer_count & 0x0fffffff;
+    p2 = dma_channel_get_irq1_status(rx_dma_ch);
+  } while (w != rx_wraps || p1 != p2);
+  return ((uint64_t)(w + p1) << RX_SEGMENT_POW) + ((RX_SEGMENT - remain) & (RX_SEGMENT - 1));
+}
+
+// DMA has lapped the reader at 'from': the bytes up to the last rxbuf_len it wrote are gone,
+// those are still there, and the reader goes on from the oldest of them
+void CUartBase::rx_overrun(uint64_t from, uint64_t w) {
+  uint64_t keep = w - rxbuf_len;
+  rx_stats.overruns++;
+  rx_stats.lost += keep - from;
+  line_err |= LINE_RING_OVERRUN;
+  if ((int64_t)(keep - rx_count) > 0) {
+    rx_count = keep;
+    read_ptr = keep & (rxbuf_len - 1);
+  }
+}
+
+// Unread bytes in the RX ring
+size_t CUartBase::rx_fill(void) {
+  uint64_t w = rx_wpos();
+  if (w - rx_count > rxbuf_len) rx_overrun(rx_count, w);
+  return w - rx_count;
+}
+
+TUartRxStats CUartBase::getRxStats(void) {
+  TUartRxStats s = rx_stats;
+  if (started()) s.received = rx_wpos();
+  s.consumed = rx_count - rx_stats.lost;
+  return s;
+}
+
+// Hand everything queued in the TX ring to DMA if the previous transfer has finished.
+// The read side of the channel wraps at txbuf_len, so one transfer covers the ring seam.
+void CUartBase::tx_kick(void) {
+  if (tx_head != tx_tail && !dma_channel_is_busy(tx_dma_ch)) {
+    uint32_t n = tx_head - tx_tail;
+    tx_dma_hw->read_addr = (uintptr_t)&txbuf[tx_tail & (txbuf_len - 1)];
+    tx_tail = tx_head;
+    tx_dma_hw->al1_transfer_count_trig = n;
+  }
+}
+
+// Free space in the TX ring, counting bytes DMA has not yet read as occupied.
+// An aborted transfer leaves its count behind, so only a busy channel has any.
+size_t CUartBase::tx_free(void) {
+  uint32_t remain = dma_channel_is_busy(tx_dma_ch) ? (tx_dma_hw->transfer_count & 0x0fffffff) : 0;
+  return txbuf_len - (tx_head - (tx_tail - remain));
 }
 
-void CUartDMA::flush(void) {
-  if (seluart) {
+void CUartBase::purgeTx(void) {
+  if (started()) {
+    dma_channel_abort(tx_dma_ch);
+    tx_tail = tx_head;
+  }
+}
+
+void CUartBase::flush(void) {
+  if (started()) {
     clear_err();
-    while ((uart_get_hw(seluart)->fr & UART_UARTFR_BUSY_BITS))
+    while (tx_head != tx_tail || dma_channel_is_busy(tx_dma_ch)) {
+      tx_kick();
       delay(0);
+    }
+    tx_drain();
   }
 }
 
-size_t CUartDMA::availableForWrite(void) {
-  if (seluart) {
+size_t CUartBase::availableForWrite(void) {
+  if (started()) {
     clear_err();
-    return txbuf_len - 1 - tx_dma_hw->transfer_count;
+    tx_kick();
+    return tx_free();
   }
   return 0;
 }
 
-size_t CUartDMA::write(const uint8_t* data, uint16_t length) {
-  if (seluart) {
+size_t CUartBase::write(const uint8_t* data, uint16_t length) {
+  if (started()) {
     clear_err();
     if (length == 0) return 0;
-    int l = 0;
-    for (int i = 0; i < length; i += l) {
-      dma_channel_wait_for_finish_blocking(tx_dma_ch);
-      l = min(txbuf_len, length);
-      memcpy(txbuf, &data[i], l);
-      tx_dma_hw->read_addr = (uintptr_t)txbuf;
-      tx_dma_hw->al1_transfer_count_trig = length;
+    uint16_t i = 0;
+    while (i < length) {
+      size_t l = min(tx_free(), (size_t)(length - i));
+      if (l == 0) {
+        // Ring is full, wait for DMA to make room
+        tx_kick();
+        delay(0);
+        continue;
+      }
+      uint32_t pos = tx_head & (txbuf_len - 1);
+      size_t l1 = min(l, (size_t)(txbuf_len - pos));
+      memcpy(&txbuf[pos], &data[i], l1);
+      if (l > l1) memcpy(txbuf, &data[i + l1], l - l1);
+      tx_head += l;
+      i += l;
+      tx_kick();
     }
     return length;
   }
   return 0;
 }
 
-size_t CUartDMA::available(void) {
-  if (seluart) {
+size_t CUartBase::available(void) {
+  if (started()) {
     clear_err();
-#if PICO_RP2040
-  uint16_t idx = (rxbuf_len - rx_dma_hw->transfer_count) & (rxbuf_len - 1);
-  
-  if (read_ptr <= idx) return idx - read_ptr;
-  else return rxbuf_len + idx - read_ptr;
-#else
-    int s = (int)rxbuf_len - (int)(rx_dma_hw->transfer_count & 0x0fffffff) - (int)read_ptr;
-    if (s < 0) s += rxbuf_len;
-    return s;
-#endif
+    tx_kick();
+    size_t n = rx_fill();
+    update_rts(n);
+    return n;
   }
   return 0;
 }
 
-bool CUartDMA::pop(uint8_t* ch) {
-  if (seluart) {
-    uint32_t current_dma_pos = rx_dma_hw->write_addr - (uint32_t)rxbuf;
-    if (read_ptr == current_dma_pos) return false;
-    *ch = rxbuf[read_ptr++];
-    read_ptr %= rxbuf_len;
+// Expose the unread part of the RX ring as up to two contiguous regions without copying.
+// The regions stay valid until consume() is called or DMA laps the ring.
+size_t CUartBase::peek(TUartSpan& s1, TUartSpan& s2) {
+  s1.len = s2.len = 0;
+  if (started()) {
+    clear_err();
+    tx_kick();
+    size_t n = rx_fill();
+    s1.ptr = &rxbuf[read_ptr];
+    s2.ptr = rxbuf;
+    s1.len = min(n, (size_t)(rxbuf_len - read_ptr));
+    s2.len = n - s1.len;
+    update_rts(n);
+  }
+  return s1.len + s2.len;
+}
+
+void CUartBase::consume(size_t n) {
+  uint64_t from = rx_count;
+  read_ptr = (read_ptr + n) & (rxbuf_len - 1);
+  rx_count += n;
+  // What peek() handed out may have been overwritten while it was in use, that much is lost
+  // along with whatever DMA went on to overwrite behind it
+  if (started()) {
+    uint64_t w = rx_wpos();
+    if (w - from > rxbuf_len) rx_overrun(from, w);
+  }
+}
+
+bool CUartBase::pop(uint8_t* ch) {
+  if (started()) {
+    if (rx_fill() == 0) return false;
+    *ch = rxbuf[read_ptr];
+    read_ptr = (read_ptr + 1) & (rxbuf_len - 1);
+    rx_count++;
     return true;
   }
   return false;
 }
 
-int CUartDMA::read(void) {
-  if (seluart) {
+int CUartBase::read(void) {
+  if (started()) {
     while (!available()) delay(0);
     uint8_t c;
     if (pop(&c)) return c;
@@ -228,12 +434,23 @@ int CUartDMA::read(void) {
   return -1;
 }
 
-size_t CUartDMA::readBytes(uint8_t* data, uint16_t length) {
-  if (seluart) {
+size_t CUartBase::readBytes(uint8_t* data, uint16_t length) {
+  if (started()) {
     if (length == 0) return 0;
-    for (int i = 0; i < length; i++) {
-      while (!available()) delay(0);
-      pop(&data[i]);
+    clear_err();
+    TUartSpan s1, s2;
+    size_t i = 0;
+    while (i < length) {
+      if (peek(s1, s2) == 0) {
+        delay(0);
+        continue;
+      }
+      size_t l1 = min(s1.len, (size_t)(length - i));
+      memcpy(&data[i], s1.ptr, l1);
+      size_t l2 = min(s2.len, (size_t)(length - i - l1));
+      memcpy(&data[i + l1], s2.ptr, l2);
+      consume(l1 + l2);
+      i += l1 + l2;
     }
     return length;
   }
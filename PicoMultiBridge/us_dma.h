@@ -2,8 +2,11 @@
   us_dma
 
   UART Transmission and Reception via DMA.
+  CUartBase owns the rings, CUartDMA drives a hardware UART and CPioUart (us_pio) a pair of PIO state machines.
 
-  Incidentally, no ring buffer is configured for transmission.
+  Both directions use power-of-two ring buffers that DMA wraps around by itself.
+  write() only appends to the TX ring and kicks DMA when it is idle,
+  so it blocks only while the ring is full.
   Referenced “Copyright (c) 2025 https://github.com/qqqlab”
 
   SPDX-License-Identifier: MIT
@@ -14,11 +17,43 @@
 
 #include <stdint.h>
 #include <hardware/dma.h>
+#include <hardware/gpio.h>
 #include <hardware/uart.h>
-
-class CUartDMA {
-  uart_inst_t* seluart;
-
+#include "watermark.hpp"
+
+// One contiguous region of a ring buffer
+typedef struct {
+  const uint8_t* ptr;
+  size_t len;
+} TUartSpan;
+
+// What happened at the last reconfigure()
+typedef struct {
+  uint32_t count;          // number of reconfigurations
+  uint64_t rxpos;          // RX byte offset (see getRxCount()) from which the new settings apply
+  uint32_t wait_us;        // time spent waiting for TX to shift out
+  uint32_t switch_us;      // time the line settings took to change
+  uint32_t max_switch_us;
+} TUartReconf;
+
+// Receive side health since begin().
+// The UART error flags are sticky, so each count is the number of polls that found the flag set
+// and is a lower bound on the number of affected characters.
+typedef struct {
+  uint64_t received;      // bytes written into the RX ring by DMA
+  uint64_t consumed;      // bytes taken out of it intact
+  uint32_t overruns;      // times DMA lapped the reader
+  uint64_t lost;          // bytes overwritten before they were read, received = consumed + lost + unread
+  uint32_t framing;
+  uint32_t parity;
+  uint32_t breaks;
+  uint32_t fifo_overruns; // UART FIFO was full when a character arrived
+} TUartRxStats;
+
+// DMA ring buffers in both directions, shared by every UART backend.
+// A backend only has to say where the data register is and how to drive the line.
+class CUartBase {
+protected:
 #if PICO_RP2040
   uint8_t rx_trg_dma_ch;
   uint8_t rx_ctrl_dma_ch;
@@ -36,21 +71,77 @@ class CUartDMA {
   uint16_t txbuf_len;
   uint8_t* txbuf;
   dma_channel_hw_t *tx_dma_hw;
+  uint32_t tx_head;   // total bytes put into the ring
+  uint32_t tx_tail;   // total bytes handed over to DMA
 
-  void init_dma(int ch);
+  bool start(uint16_t txblen, uint16_t rxblen, uint dreq_tx, uint dreq_rx, volatile void* txreg, const volatile void* rxreg);
+  bool init_dma(uint dreq_tx, uint dreq_rx, volatile void* txreg, const volatile void* rxreg);
   uint8_t log_2(uint16_t val);
   uint32_t actualbaudrate;
 
-  inline void clear_err(void) {
-    hw_clear_bits(&uart_get_hw(seluart)->rsr, UART_UARTRSR_BITS);
-  }
+  TUartRxStats rx_stats;
+  uint8_t line_err;  // LINE_xxx seen since takeLineErrors()
+
+  // RX DMA runs for RX_SEGMENT bytes per trigger while its write address wraps round the ring,
+  // so TRANS_COUNT gives the write position exactly however far DMA has lapped the reader.
+  // The completions are counted by the DMA_IRQ_1 handler, one every 128MB, which no stall is
+  // long enough to miss. The count field of the RP2350 is 28 bits, mode bits above.
+  static const uint8_t RX_SEGMENT_POW = 27;
+  static const uint32_t RX_SEGMENT = 1u << RX_SEGMENT_POW;
+  volatile uint32_t rx_wraps;
+  static const int MAX_OWNERS = 8;
+  static CUartBase* irq_owner[MAX_OWNERS];
+  static void dma_irq_handler(void);
 
   uint32_t read_ptr;
+  uint64_t rx_count;  // total bytes the reader has moved past, lost ones included
   bool pop(uint8_t* ch);
+  uint64_t rx_wpos(void);
+  void rx_overrun(uint64_t from, uint64_t w);
+  size_t rx_fill(void);
+
+  TUartReconf reconf;
+
+  int8_t rts_pin;        // RTS driven from the RX ring fill, -1 if unused
+  CWatermark rx_mark;
+  inline void update_rts(size_t fill) {
+    if (rts_pin >= 0) {
+      bool stop = rx_mark.is_stopped();
+      if (rx_mark.update(fill) != stop) gpio_put(rts_pin, !stop);  // RTS is active low
+    }
+  }
+
+  void tx_kick(void);
+  size_t tx_free(void);
+  inline bool started(void) { return rx_dma_hw != nullptr; }
+
+  // Backend
+  virtual void clear_err(void) = 0;                                  // collect and clear line errors
+  virtual void tx_drain(void) = 0;                                   // wait for the last bit to leave
+  virtual uint32_t set_line(uint32_t baudrate, uint16_t config) = 0;  // returns the actual baudrate
 
 public:
-  uint32_t begin(uint8_t uart_ch, uint32_t baudrate, uint16_t config, uint16_t txblen, uint16_t rxblen);
-  uint32_t begin(uint32_t baudrate, uint16_t config);
+  // Line errors, as flags
+  enum {
+    LINE_FRAMING = 0x01,
+    LINE_PARITY = 0x02,
+    LINE_BREAK = 0x04,
+    LINE_FIFO_OVERRUN = 0x08,
+    LINE_RING_OVERRUN = 0x10  // data lost from the RX ring
+  };
+
+  virtual uint32_t begin(uint32_t baudrate, uint16_t config) = 0;
+  uint32_t reconfigure(uint32_t baudrate, uint16_t config);
+  const TUartReconf& getReconf(void) { return reconf; }
+  uint64_t getRxCount(void) { return rx_count; }
+  // On the core that reads the ring, the counts are not synchronised
+  TUartRxStats getRxStats(void);
+  // Errors seen since the last call, reading clears them
+  uint8_t takeLineErrors(void) {
+    uint8_t e = line_err;
+    line_err = 0;
+    return e;
+  }
 
   size_t getTxBufferSize(void) { return txbuf_len; }
   size_t getRxBufferSize(void) { return rxbuf_len; }
@@ -62,16 +153,73 @@ public:
 
   int read(void);
   size_t readBytes(uint8_t* data, uint16_t length);
+  size_t peek(TUartSpan& s1, TUartSpan& s2);
+  void consume(size_t n);
   size_t available(void);
   size_t availableForWrite(void);
   uint32_t getActualBaud(void);
+  // false where the line always runs 8N1 whatever format is asked for
+  virtual bool canSetFormat(void) { return true; }
+  virtual void setBreak(bool on) {}
+  virtual void setFlowControl(bool en, int rts = -1);
+  bool getFlowControl(void) { return rts_pin >= 0; }
+  bool isRtsStopped(void) { return rx_mark.is_stopped(); }
   void flush(void);
+  // Drops what waits in the TX ring, what the UART FIFO already holds still goes out
+  void purgeTx(void);
 
-  CUartDMA()
-    : seluart(nullptr),
+  CUartBase()
+    : rxbuf_len(0),
       rxbuf(nullptr),
-      txbuf(nullptr),
-      rxbuf_len(0),
+      rx_dma_hw(nullptr),
       txbuf_len(0),
-      read_ptr(0) {}
-};
\ No newline at end of file
+      txbuf(nullptr),
+      tx_dma_hw(nullptr),
+      tx_head(0),
+      tx_tail(0),
+      actualbaudrate(0),
+      rx_stats(),
+      line_err(0),
+      rx_wraps(0),
+      read_ptr(0),
+      rx_count(0),
+      reconf(),
+      rts_pin(-1) {}
+  virtual ~CUartBase() {}
+};
+
+// Hardware UART0/UART1
+class CUartDMA : public CUartBase {
+  uart_inst_t* seluart;
+
+  void set_format(uint16_t config);
+
+protected:
+  void clear_err(void) override {
+    uart_hw_t* hw = uart_get_hw(seluart);
+    uint32_t ris = hw->ris & (UART_UARTRIS_OERIS_BITS | UART_UARTRIS_BERIS_BITS | UART_UARTRIS_PERIS_BITS | UART_UARTRIS_FERIS_BITS);
+    if (ris) {
+      if (ris & UART_UARTRIS_FERIS_BITS) rx_stats.framing++;
+      if (ris & UART_UARTRIS_PERIS_BITS) rx_stats.parity++;
+      if (ris & UART_UARTRIS_BERIS_BITS) rx_stats.breaks++;
+      if (ris & UART_UARTRIS_OERIS_BITS) rx_stats.fifo_overruns++;
+      hw->icr = ris;
+    }
+    // The RSR bits are in the same order as LINE_xxx
+    uint32_t rsr = hw->rsr & UART_UARTRSR_BITS;
+    line_err |= rsr | ((ris & UART_UARTRIS_FERIS_BITS) ? LINE_FRAMING : 0) | ((ris & UART_UARTRIS_PERIS_BITS) ? LINE_PARITY : 0)
+                | ((ris & UART_UARTRIS_BERIS_BITS) ? LINE_BREAK : 0) | ((ris & UART_UARTRIS_OERIS_BITS) ? LINE_FIFO_OVERRUN : 0);
+    hw_clear_bits(&hw->rsr, UART_UARTRSR_BITS);
+  }
+  void tx_drain(void) override;
+  uint32_t set_line(uint32_t baudrate, uint16_t config) override;
+
+public:
+  uint32_t begin(uint8_t uart_ch, uint32_t baudrate, uint16_t config, uint16_t txblen, uint16_t rxblen);
+  uint32_t begin(uint32_t baudrate, uint16_t config) override;
+  void setBreak(bool on) override;
+  void setFlowControl(bool en, int rts = -1) override;
+
+  CUartDMA()
+    : seluart(nullptr) {}
+};
@@ -0,0 +1,169 @@
+/*
+  us_pio
+
+  UART on a pair of PIO state machines.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <arduino.h>
+#include <hardware/clocks.h>
+#include <hardware/gpio.h>
+#include <api/HardwareSerial.h>
+#include "us_pio.h"
+#include "piodiv.hpp"
+
+#define CYCLES_PER_BIT 8
+
+// pico-examples pio/uart_tx
+//   .side_set 1 opt
+//   pull side 1 [7]
+//   set x, 7 side 0 [7]
+//   out pins, 1
+//   jmp x-- 2 [6]
+static const uint16_t uart_tx_code[] = { 0x9fa0, 0xf727, 0x6001, 0x0642 };
+static const pio_program_t uart_tx_prog = { uart_tx_code, 4, -1 };
+
+// pico-examples pio/uart_rx, a bad stop bit raises irq 4 rel
+//   wait 0 pin 0
+//   set x, 7 [10]
+//   in pins, 1
+//   jmp x-- 2 [6]
+//   jmp pin 8
+//   irq 4 rel
+//   wait 1 pin 0
+//   jmp 0
+//   push
+static const uint16_t uart_rx_code[] = { 0x2020, 0xea27, 0x4001, 0x0642, 0x00c8, 0xc014, 0x20a0, 0x0000, 0x8020 };
+static const pio_program_t uart_rx_prog = { uart_rx_code, 9, -1 };
+
+uint8_t CPioUart::prog_tx[NUM_PIOS];
+uint8_t CPioUart::prog_rx[NUM_PIOS];
+
+// Two free state machines and room for both programs in one PIO block
+bool CPioUart::claim(PIO p) {
+  uint i = pio_get_index(p);
+  int t = pio_claim_unused_sm(p, false);
+  if (t < 0) return false;
+  int r = pio_claim_unused_sm(p, false);
+  if (r >= 0) {
+    if (!prog_tx[i] && pio_can_add_program(p, &uart_tx_prog)) prog_tx[i] = pio_add_program(p, &uart_tx_prog) + 1;
+    if (!prog_rx[i] && pio_can_add_program(p, &uart_rx_prog)) prog_rx[i] = pio_add_program(p, &uart_rx_prog) + 1;
+    if (prog_tx[i] && prog_rx[i]) {
+      pio = p;
+      sm_tx = t;
+      sm_rx = r;
+      return true;
+    }
+    pio_sm_unclaim(p, r);
+  }
+  pio_sm_unclaim(p, t);
+  return false;
+}
+
+void CPioUart::release(void) {
+  pio_sm_set_enabled(pio, sm_tx, false);
+  pio_sm_set_enabled(pio, sm_rx, false);
+  pio_sm_unclaim(pio, sm_tx);
+  pio_sm_unclaim(pio, sm_rx);
+  pio = nullptr;
+}
+
+uint32_t CPioUart::begin(uint8_t tx, uint8_t rx, uint32_t baudrate, uint16_t txblen, uint16_t rxblen) {
+  if (pio != nullptr) return 0;
+  for (uint i = 0; i < NUM_PIOS && pio == nullptr; i++) claim(pio_get_instance(i));
+  if (pio == nullptr) return 0;
+  txpin = tx;
+  rxpin = rx;
+  uint i = pio_get_index(pio);
+  pio_sm_config c;
+
+  // TX idles high
+  pio_sm_set_pins_with_mask(pio, sm_tx, 1u << tx, 1u << tx);
+  pio_sm_set_pindirs_with_mask(pio, sm_tx, 1u << tx, 1u << tx);
+  pio_gpio_init(pio, tx);
+  c = pio_get_default_sm_config();
+  sm_config_set_wrap(&c, prog_tx[i] - 1, prog_tx[i] - 1 + 3);
+  sm_config_set_sideset(&c, 2, true, false);
+  sm_config_set_out_shift(&c, true, false, 32);
+  sm_config_set_out_pins(&c, tx, 1);
+  sm_config_set_sideset_pins(&c, tx);
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+  pio_sm_init(pio, sm_tx, prog_tx[i] - 1, &c);
+
+  // RX, the byte ends up in the top 8 bits of the FIFO word
+  pio_sm_set_consecutive_pindirs(pio, sm_rx, rx, 1, false);
+  pio_gpio_init(pio, rx);
+  gpio_pull_up(rx);
+  c = pio_get_default_sm_config();
+  sm_config_set_wrap(&c, prog_rx[i] - 1, prog_rx[i] - 1 + 8);
+  sm_config_set_in_pins(&c, rx);
+  sm_config_set_jmp_pin(&c, rx);
+  sm_config_set_in_shift(&c, true, false, 32);
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+  pio_sm_init(pio, sm_rx, prog_rx[i] - 1, &c);
+
+  actualbaudrate = set_line(baudrate, SERIAL_8N1);
+  if (!start(txblen, rxblen, pio_get_dreq(pio, sm_tx, true), pio_get_dreq(pio, sm_rx, false), &pio->txf[sm_tx], (const volatile uint8_t*)&pio->rxf[sm_rx] + 3)) {
+    release();
+    return 0;
+  }
+  pio_interrupt_clear(pio, 4 + sm_rx);
+  pio_sm_set_enabled(pio, sm_tx, true);
+  pio_sm_set_enabled(pio, sm_rx, true);
+  return actualbaudrate;
+}
+
+uint32_t CPioUart::begin(uint32_t baudrate, uint16_t config) {
+  if (pio == nullptr) return 0;
+  actualbaudrate = set_line(baudrate, config);
+  return actualbaudrate;
+}
+
+uint32_t CPioUart::set_line(uint32_t baudrate, uint16_t config) {
+  uint32_t sysclk = clock_get_hz(clk_sys);
+  TPioDiv d = piodiv_from_baud(sysclk, baudrate, CYCLES_PER_BIT);
+  pio_sm_set_clkdiv_int_frac(pio, sm_tx, d.integer, d.frac);
+  pio_sm_set_clkdiv_int_frac(pio, sm_rx, d.integer, d.frac);
+  return piodiv_to_baud(sysclk, d, CYCLES_PER_BIT);
+}
+
+void CPioUart::clear_err(void) {
+  if (pio_interrupt_get(pio, 4 + sm_rx)) {
+    rx_stats.framing++;
+    line_err |= LINE_FRAMING;
+    pio_interrupt_clear(pio, 4 + sm_rx);
+  }
+  uint32_t stall = 1u << (PIO_FDEBUG_RXSTALL_LSB + sm_rx);
+  if (pio->fdebug & stall) {
+    rx_stats.fifo_overruns++;
+    line_err |= LINE_FIFO_OVERRUN;
+    pio->fdebug = stall;
+  }
+}
+
+// TXSTALL is set once the state machine waits on an empty FIFO, which happens
+// at the start of the stop bit of the last character, so the stop bit is waited for separately.
+// Nothing leaves while a break holds the state machine stopped.
+void CPioUart::tx_drain(void) {
+  if (!(pio->ctrl & (1u << sm_tx))) return;
+  uint32_t stall = 1u << (PIO_FDEBUG_TXSTALL_LSB + sm_tx);
+  pio->fdebug = stall;
+  while (!(pio->fdebug & stall))
+    delay(0);
+  if (actualbaudrate) delayMicroseconds(1000000 / actualbaudrate + 1);
+}
+
+// Hold TX low with the state machine stopped
+void CPioUart::setBreak(bool on) {
+  if (pio == nullptr) return;
+  if (on) {
+    tx_drain();
+    pio_sm_set_enabled(pio, sm_tx, false);
+    pio_sm_set_pins_with_mask(pio, sm_tx, 0, 1u << txpin);
+  } else {
+    pio_sm_set_pins_with_mask(pio, sm_tx, 1u << txpin, 1u << txpin);
+    pio_sm_set_enabled(pio, sm_tx, true);
+  }
+}
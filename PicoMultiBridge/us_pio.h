@@ -0,0 +1,43 @@
+/*
+  us_pio
+
+  UART on a pair of PIO state machines, feeding the same DMA rings as CUartDMA.
+  Any GPIO can be used. The line is always 8N1, other formats are accepted but not applied
+  and canSetFormat() says so. A break can be sent but is received as a framing error.
+  The programs are the uart_tx/uart_rx examples of the Pico SDK (8 PIO cycles per bit).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <hardware/pio.h>
+#include "us_dma.h"
+
+class CPioUart : public CUartBase {
+  PIO pio;
+  uint8_t sm_tx, sm_rx;
+  uint8_t txpin, rxpin;
+
+  // Program offset + 1 in each PIO block, 0 while not loaded. Shared by every instance.
+  static uint8_t prog_tx[NUM_PIOS];
+  static uint8_t prog_rx[NUM_PIOS];
+  bool claim(PIO p);
+  void release(void);
+
+protected:
+  void clear_err(void) override;
+  void tx_drain(void) override;
+  uint32_t set_line(uint32_t baudrate, uint16_t config) override;
+
+public:
+  uint32_t begin(uint8_t tx, uint8_t rx, uint32_t baudrate, uint16_t txblen, uint16_t rxblen);
+  uint32_t begin(uint32_t baudrate, uint16_t config) override;
+  bool canSetFormat(void) override { return false; }
+  void setBreak(bool on) override;
+
+  CPioUart()
+    : pio(nullptr), sm_tx(0), sm_rx(0), txpin(0), rxpin(0) {}
+};
@@ -0,0 +1,41 @@
+/*
+  watermark
+
+  Stop/go decision on a buffer fill level with hysteresis.
+
+  Stop is raised once the fill reaches the high mark and cleared only after it has
+  fallen to the low mark, so that the signal does not chatter around a single threshold.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+class CWatermark {
+  size_t high, low;
+  bool stopped;
+
+public:
+  void config(size_t h, size_t l) {
+    high = h;
+    low = l;
+    stopped = false;
+  }
+
+  bool update(size_t fill) {
+    if (stopped) {
+      if (fill <= low) stopped = false;
+    } else if (fill >= high)
+      stopped = true;
+    return stopped;
+  }
+
+  bool is_stopped(void) const { return stopped; }
+
+  CWatermark() {
+    config(0, 0);
+  }
+};
@@ -0,0 +1,296 @@
+/*
+  bridge_bench
+
+  Throughput and latency of the WiFi <-> UART bridge, per serial protocol and chunk size.
+
+  Port 0's TX is looped back to its RX, so a client gets back whatever it sends through the UART.
+  Each protocol runs the sketch in a process of its own, as encprotocol is only read at boot.
+  MB/s is a stream of chunks written and read back at the same time, latency is one chunk
+  going round at a time. The lines run at the given baudrate, 3Mbps unless told otherwise,
+  so a protocol that keeps up reaches baud / 10 and its latency is mostly the line.
+  Unpaced lines would overrun the RX ring just as a UART faster than core 1 would.
+  The payload avoids the bytes each protocol treats specially. For the Modbus gateway a chunk
+  is a request, which the loopback answers with itself.
+  Then all four ports, UART1, UART0 and two PIO UARTs, each looped back and streamed at once,
+  give the aggregate rate of the bridge.
+  Last, 1 to MAX_SESSIONS clients on port 0 all read what arrives on its line, which shows
+  what handing the same data to every session costs: a fan-out that keeps up gives every
+  client the line rate.
+
+    bridge_bench [--quick] [baudrate]
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "modbus.hpp"
+#include "session.hpp"
+
+static const char *const proto_name[] = { "none", "PUSR", "LsrMstIns", "RFC2217", "Modbus" };
+static const size_t chunk_sizes[] = { 16, 64, 256, 1024, 4096 };
+
+static int encprotocol;
+static bool quick;
+static uint32_t baudrate = 3000000;
+
+static double now_s(void) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Plain data: 0x20..0x4f, clear of 0x55 (PUSR), 'a' (LsrMstIns) and 0xff (Telnet IAC)
+static void fill(uint8_t *p, size_t len, uint32_t seed) {
+  for (size_t i = 0; i < len; i++) p[i] = 0x20 + (seed + i * 7) % 0x30;
+}
+
+// One chunk as the client sends it
+static std::vector<uint8_t> chunk(size_t size, uint32_t seq) {
+  std::vector<uint8_t> c;
+  if (encprotocol == 4) {
+    size_t pdu = std::min(size, (size_t)CModbus::MAX_PDU);
+    c.resize(CModbus::MBAP_LEN + pdu);
+    c[0] = seq >> 8;
+    c[1] = seq;
+    c[2] = c[3] = 0;
+    c[4] = (1 + pdu) >> 8;
+    c[5] = 1 + pdu;
+    c[6] = 1;     // unit
+    c[7] = 0x10;  // write multiple registers, any function will do
+    fill(&c[8], pdu - 1, seq);
+  } else {
+    c.resize(size);
+    fill(c.data(), size, seq);
+  }
+  return c;
+}
+
+static bool stream(int fd, size_t size, size_t total, double *mbs) {
+  std::vector<std::vector<uint8_t> > chunks;
+  size_t bytes = 0;
+  for (uint32_t seq = 0; bytes < total; seq++) {
+    chunks.push_back(chunk(size, seq));
+    bytes += chunks.back().size();
+  }
+  std::vector<uint8_t> in(bytes);
+  double t0 = now_s();
+  std::thread writer([&] {
+    for (const std::vector<uint8_t> &c : chunks) sim_fd_write(fd, c.data(), c.size(), 10000);
+  });
+  size_t got = sim_fd_read(fd, in.data(), bytes, 10000);
+  double t = now_s() - t0;
+  writer.join();
+  *mbs = got / t / 1e6;
+
+  size_t o = 0;
+  for (const std::vector<uint8_t> &c : chunks) {
+    if (o + c.size() > got || memcmp(&in[o], c.data(), c.size()) != 0) {
+      fprintf(stderr, "%s: chunk %zu: data differs at %zu of %zu\n", proto_name[encprotocol], size, o, bytes);
+      return false;
+    }
+    o += c.size();
+  }
+  return true;
+}
+
+static bool pingpong(int fd, size_t size, int rounds, double *p50, double *p99) {
+  std::vector<double> lat;
+  for (int r = 0; r < rounds; r++) {
+    std::vector<uint8_t> c = chunk(size, r), in(c.size());
+    double t0 = now_s();
+    sim_fd_write(fd, c.data(), c.size());
+    size_t got = sim_fd_read(fd, in.data(), in.size());
+    lat.push_back((now_s() - t0) * 1e6);
+    if (got != c.size() || in != c) {
+      fprintf(stderr, "%s: chunk %zu: round %d came back wrong\n", proto_name[encprotocol], size, r);
+      return false;
+    }
+  }
+  std::sort(lat.begin(), lat.end());
+  *p50 = lat[lat.size() / 2];
+  *p99 = lat[lat.size() * 99 / 100];
+  return true;
+}
+
+static int connect_port(int port) {
+  int fd = -1;
+  for (int i = 0; i < 500 && (fd = sim_connect(sim_sketch_port(port))) < 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  if (fd < 0) fprintf(stderr, "port %d on %u does not listen\n", port, sim_sketch_port(port));
+  return fd;
+}
+
+// A stream that came back wrong because its RX ring overran while the host kept core 1 off
+// the CPU, which no Pico does, is reported rather than held against the bridge
+static bool starved(int port) {
+  uint32_t lost = sim_sketch_uart(port)->getRxStats().lost;
+  if (lost > 0) fprintf(stderr, "port %d: %u bytes lost in the RX ring, core 1 was kept off the CPU\n", port, lost);
+  return lost > 0;
+}
+
+// Runs in the child for one protocol
+static int bench(void) {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.encprotocol = encprotocol;
+      n.baudrate = baudrate;
+    });
+  sim_line_loopback(4, 5);
+  sim_sketch_start();
+
+  int fd = connect_port(0);
+  if (fd < 0) return 1;
+  // The Telnet option negotiation of RFC 2217 comes first
+  sim_fd_read_all(fd);
+
+  bool ok = true;
+  for (size_t size : chunk_sizes) {
+    // A Modbus request holds no more than a PDU, and every one waits for 3.5 characters of silence
+    if (encprotocol == 4 && size > 256) break;
+    size_t total = (quick ? 64 : 1024) * 1024;
+    if (encprotocol == 4) total = std::min(total, (quick ? 64 : 512) * (size + CModbus::MBAP_LEN));
+    double mbs = 0, p50 = 0, p99 = 0;
+    ok = stream(fd, size, total, &mbs) && pingpong(fd, size, quick ? 50 : 500, &p50, &p99);
+    if (!ok) {
+      ok = starved(0);
+      break;
+    }
+    printf("%-10s %6zu %9.2f %10.0f %10.0f\n", proto_name[encprotocol], chunk(size, 0).size(), mbs, p50, p99);
+    fflush(stdout);
+  }
+  close(fd);
+  sim_sketch_stop();
+  return ok ? 0 : 1;
+}
+
+// Runs in a child: the four ports streamed at once
+static int bench_ports(void) {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.baudrate = baudrate;
+      n.uart2 = 1;
+      n.port2 = 8000;
+      n.tx2 = 0;
+      n.rx2 = 1;
+      n.baudrate2 = baudrate;
+      n.pio[0] = { 1, 8001, 10, 11, 0, baudrate };
+      n.pio[1] = { 1, 8002, 12, 13, 0, baudrate };
+    });
+  sim_line_loopback(4, 5);
+  sim_line_loopback(0, 1);
+  sim_line_loopback(10, 11);
+  sim_line_loopback(12, 13);
+  sim_sketch_start();
+
+  int fd[4];
+  for (int p = 0; p < 4; p++)
+    if ((fd[p] = connect_port(p)) < 0) return 1;
+  size_t size = 1024, total = (quick ? 64 : 1024) * 1024;
+  double mbs[4] = {};
+  bool ok[4] = {};
+  double t0 = now_s();
+  std::vector<std::thread> t;
+  for (int p = 0; p < 4; p++) t.emplace_back([&, p] { ok[p] = stream(fd[p], size, total, &mbs[p]); });
+  for (std::thread &th : t) th.join();
+  double all = 4 * total / (now_s() - t0) / 1e6;
+  for (int p = 0; p < 4; p++)
+    if (!ok[p]) ok[p] = starved(p);
+  printf("%-10s %6zu %9.2f   per port %.2f %.2f %.2f %.2f\n", "4 ports", size, all, mbs[0], mbs[1], mbs[2], mbs[3]);
+  fflush(stdout);
+  for (int p = 0; p < 4; p++) close(fd[p]);
+  sim_sketch_stop();
+  return (ok[0] && ok[1] && ok[2] && ok[3]) ? 0 : 1;
+}
+
+// Runs in a child: n clients on port 0, for n from 1 to MAX_SESSIONS, reading the line.
+// Nothing holds the line back, so bytes the RX ring lost while the host kept core 1 off the
+// CPU are counted, and every client must have what the UART kept, no more and no less.
+static int bench_fanout(void) {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.baudrate = baudrate;
+    });
+  sim_sketch_start();
+
+  CUartBase *u = sim_sketch_uart(0);
+  size_t total = (quick ? 64 : 1024) * 1024;
+  std::vector<uint8_t> data(total);
+  fill(data.data(), total, 0);
+  bool ok = true;
+  for (int n = 1; n <= CSessions::MAX_SESSIONS && ok; n++) {
+    int fd[CSessions::MAX_SESSIONS];
+    for (int c = 0; c < n; c++)
+      if ((fd[c] = connect_port(0)) < 0) return 1;
+    // Every client has its session before the data starts
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint32_t lost = u->getRxStats().lost;
+    double t0 = now_s(), mbs[CSessions::MAX_SESSIONS] = {};
+    std::vector<uint8_t> in[CSessions::MAX_SESSIONS];
+    std::vector<std::thread> t;
+    for (int c = 0; c < n; c++)
+      t.emplace_back([&, c] {
+        uint8_t b[16384];
+        double last = t0;
+        for (size_t l; in[c].size() < total && (l = sim_fd_read(fd[c], b, sizeof(b), 500)) > 0; last = now_s()) in[c].insert(in[c].end(), b, b + l);
+        mbs[c] = in[c].size() / (last - t0) / 1e6;
+      });
+    sim_line_send(5, data.data(), total);
+    for (std::thread &th : t) th.join();
+    lost = u->getRxStats().lost - lost;
+    double least = mbs[0], sum = 0;
+    for (int c = 0; c < n; c++) {
+      if (in[c].size() != total - lost || in[c] != in[0]) {
+        fprintf(stderr, "fan-out: client %d of %d got %zu bytes, the UART kept %zu\n", c + 1, n, in[c].size(), total - lost);
+        ok = false;
+      }
+      least = std::min(least, mbs[c]);
+      sum += mbs[c];
+      close(fd[c]);
+    }
+    printf("%-10s %6d %9.2f   slowest client %.2f", "fan-out", n, sum, least);
+    if (lost > 0) printf(", %u lost in the RX ring", lost);
+    printf("\n");
+    fflush(stdout);
+    // The sessions are gone before the next round connects
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  }
+  sim_sketch_stop();
+  return ok ? 0 : 1;
+}
+
+static int run(int (*f)(void), const char *name) {
+  pid_t pid = fork();
+  if (pid == 0) _exit(f());
+  int st = 0;
+  waitpid(pid, &st, 0);
+  if (WIFEXITED(st) && WEXITSTATUS(st) == 0) return 0;
+  fprintf(stderr, "%s: failed\n", name);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) quick = true;
+    else baudrate = strtoul(argv[i], NULL, 0);
+  }
+
+  printf("%ubps\n", baudrate);
+  printf("%-10s %6s %9s %10s %10s\n", "protocol", "chunk", "MB/s", "p50 us", "p99 us");
+  fflush(stdout);
+  int failed = 0;
+  for (encprotocol = 0; encprotocol <= 4; encprotocol++) failed += run(bench, proto_name[encprotocol]);
+  encprotocol = 0;
+  failed += run(bench_ports, "4 ports");
+  printf("%-10s %6s %9s\n", "", "client", "MB/s");
+  fflush(stdout);
+  failed += run(bench_fanout, "fan-out");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,384 @@
+/*
+  core
+
+  Time, events, interrupts and the stepping of the simulated hardware.
+
+  An IRQ is taken by the thread that enabled it, the next time that thread touches a
+  peripheral, waits or delays, which is where an interrupt could cut in on the Pico too.
+  The handler runs without sim_hw_mutex, so it sees the hardware moving on as a real one would.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <sim/sim.h>
+#include <hardware/clocks.h>
+#include "hw.h"
+
+std::recursive_mutex sim_hw_mutex;
+bool sim_paced = true;
+uint64_t sim_step_now, sim_step_prev;
+std::atomic<bool> sim_bootsel(false);
+RP2040Class rp2040;
+
+// The heap of a Pico 2 W with the WiFi stack up, roughly
+uint32_t RP2040Class::getFreeHeap(void) {
+  return 200000;
+}
+
+//---- time
+static const auto t_origin = std::chrono::steady_clock::now();
+static std::atomic<bool> clock_manual(false);
+static std::atomic<uint64_t> clock_frozen(0);  // manual clock
+static std::atomic<int64_t> clock_offset(0);   // real clock, added by sim_advance()
+
+uint64_t sim_now_us(void) {
+  if (clock_manual.load()) return clock_frozen.load();
+  auto d = std::chrono::steady_clock::now() - t_origin;
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count() + clock_offset.load();
+}
+
+void sim_clock_manual(bool on) {
+  if (on == clock_manual.load()) return;
+  if (on) {
+    clock_frozen.store(sim_now_us());
+    clock_manual.store(true);
+  } else {
+    uint64_t t = clock_frozen.load();
+    clock_manual.store(false);
+    clock_offset.fetch_add(t - sim_now_us());
+  }
+}
+
+static void clock_forward(uint64_t us) {
+  if (clock_manual.load()) clock_frozen.fetch_add(us);
+  else clock_offset.fetch_add(us);
+}
+
+uint64_t time_us_64(void) {
+  return sim_now_us();
+}
+uint32_t time_us_32(void) {
+  return (uint32_t)sim_now_us();
+}
+unsigned long micros(void) {
+  return (uint32_t)sim_now_us();
+}
+unsigned long millis(void) {
+  return (uint32_t)(sim_now_us() / 1000);
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+  return (clk_index == clk_peri) ? SIM_CLK_PERI : SIM_CLK_SYS;
+}
+
+//---- cores and halting
+static thread_local int this_core = 0;
+static std::atomic<bool> halt_req[2];
+static std::atomic<bool> rebooted(false);
+
+void sim_set_core(int core) {
+  this_core = core;
+}
+int sim_core(void) {
+  return this_core;
+}
+void sim_request_halt(int core, bool on) {
+  halt_req[core].store(on);
+  sim_wake();
+}
+void sim_check_halt(void) {
+  if (halt_req[this_core].load()) throw sim_halt();
+}
+bool sim_rebooted(void) {
+  return rebooted.load();
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) {
+  rebooted.store(true);
+  throw sim_halt();
+}
+void reset_usb_boot(uint32_t gpio_activity_pin_mask, uint32_t disable_interface_mask) {
+  rebooted.store(true);
+  throw sim_halt();
+}
+
+//---- hardware stepping
+static std::thread hw_thread;
+static std::atomic<bool> hw_running(false);
+
+void sim_hw_step(void) {
+  {
+    std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+    sim_step_now = sim_now_us();
+    sim_dma_service();
+    sim_lines_step();
+    sim_dma_service();
+    sim_step_prev = sim_step_now;
+  }
+  sim_irq_poll();
+}
+
+void sim_hw_start(void) {
+  if (hw_running.exchange(true)) return;
+  hw_thread = std::thread([] {
+    while (hw_running.load()) {
+      {
+        std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+        sim_step_now = sim_now_us();
+        sim_dma_service();
+        sim_lines_step();
+        sim_dma_service();
+        sim_step_prev = sim_step_now;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+  });
+}
+
+void sim_hw_stop(void) {
+  if (!hw_running.exchange(false)) return;
+  hw_thread.join();
+}
+
+void sim_advance(uint64_t us) {
+  clock_forward(us);
+  if (!hw_running.load()) sim_hw_step();
+  else sim_irq_poll();
+}
+
+//---- events, one register per core like SEV/WFE
+static std::mutex ev_mutex;
+static std::condition_variable ev_cv;
+static bool ev_flag[2];
+
+void sim_wake(void) {
+  std::lock_guard<std::mutex> l(ev_mutex);
+  ev_cv.notify_all();
+}
+
+void __sev(void) {
+  std::lock_guard<std::mutex> l(ev_mutex);
+  ev_flag[0] = ev_flag[1] = true;
+  ev_cv.notify_all();
+}
+
+void __wfe(void) {
+  for (;;) {
+    sim_check_halt();
+    sim_irq_poll();
+    {
+      std::unique_lock<std::mutex> l(ev_mutex);
+      if (ev_flag[this_core]) {
+        ev_flag[this_core] = false;
+        return;
+      }
+      // A manual clock stands still unless the waiting moves it
+      if (!clock_manual.load()) ev_cv.wait_for(l, std::chrono::milliseconds(1));
+    }
+    if (clock_manual.load()) clock_forward(100);
+    if (!hw_running.load()) sim_hw_step();
+  }
+}
+
+//---- interrupts
+static irq_handler_t dma_irq1_handler;
+static std::atomic<bool> dma_irq1_enabled(false);
+static std::thread::id irq_thread;
+static thread_local bool in_irq, irq_masked;
+static std::atomic<uint32_t> irq_runs(0);
+
+uint32_t sim_irq_count(void) {
+  return irq_runs.load();
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+  if (num == DMA_IRQ_1) dma_irq1_handler = handler;
+}
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority) {
+  if (num == DMA_IRQ_1) dma_irq1_handler = handler;
+}
+void irq_remove_handler(uint num, irq_handler_t handler) {
+  if (num == DMA_IRQ_1 && dma_irq1_handler == handler) dma_irq1_handler = NULL;
+}
+void irq_set_enabled(uint num, bool enabled) {
+  if (num != DMA_IRQ_1) return;
+  irq_thread = std::this_thread::get_id();
+  dma_irq1_enabled.store(enabled);
+}
+
+void noInterrupts(void) {
+  irq_masked = true;
+}
+void interrupts(void) {
+  irq_masked = false;
+}
+
+// The DMA has raised IRQ 1, whoever takes it may be waiting
+void sim_irq_raise(void) {
+  sim_wake();
+}
+
+void sim_irq_poll(void) {
+  if (in_irq || irq_masked || !dma_irq1_enabled.load() || dma_irq1_handler == NULL) return;
+  if (std::this_thread::get_id() != irq_thread) return;
+  bool pending;
+  {
+    std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+    pending = sim_dma_irq1_pending();
+  }
+  if (!pending) return;
+  in_irq = true;
+  dma_irq1_handler();
+  in_irq = false;
+  irq_runs.fetch_add(1);
+}
+
+//---- delays
+void delay(unsigned long ms) {
+  if (clock_manual.load()) {
+    // Stepped in slices so that characters and IRQs fall in order
+    uint64_t left = (ms > 0) ? ms * 1000 : 10;
+    while (left > 0) {
+      uint64_t d = (left > 100) ? 100 : left;
+      sim_check_halt();
+      sim_advance(d);
+      left -= d;
+    }
+    return;
+  }
+  uint64_t end = sim_now_us() + ms * 1000;
+  do {
+    sim_check_halt();
+    if (!hw_running.load()) sim_hw_step();
+    else sim_irq_poll();
+    if (ms == 0) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(50));
+  } while (sim_now_us() < end);
+}
+
+void delayMicroseconds(unsigned int us) {
+  if (clock_manual.load()) {
+    sim_advance(us);
+    return;
+  }
+  uint64_t end = sim_now_us() + us;
+  while (sim_now_us() < end) {
+    if (!hw_running.load()) sim_hw_step();
+    else sim_irq_poll();
+    std::this_thread::yield();
+  }
+}
+
+void sleep_us(uint64_t us) {
+  delayMicroseconds(us);
+}
+void sleep_ms(uint32_t ms) {
+  delay(ms);
+}
+
+//---- alarm pool, a thread per repeating timer
+struct alarm_pool {
+  std::vector<std::thread> timers;
+};
+static std::vector<alarm_pool_t *> pools;
+static std::vector<repeating_timer_t *> active_timers;
+static std::mutex timer_mutex;
+static std::atomic<bool> timers_stop(false);
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(unsigned max_timers) {
+  alarm_pool_t *p = new alarm_pool_t;
+  std::lock_guard<std::mutex> l(timer_mutex);
+  pools.push_back(p);
+  return p;
+}
+
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out) {
+  out->delay_us = delay_us;
+  out->pool = pool;
+  out->alarm_id = 1;
+  out->callback = callback;
+  out->user_data = user_data;
+  uint64_t period = (delay_us < 0) ? -delay_us : delay_us;
+  std::lock_guard<std::mutex> l(timer_mutex);
+  active_timers.push_back(out);
+  pool->timers.emplace_back([out, period] {
+    while (!timers_stop.load() && out->alarm_id != 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(period));
+      if (!timers_stop.load() && out->alarm_id != 0 && !out->callback(out)) break;
+    }
+  });
+  return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer) {
+  timer->alarm_id = 0;
+  return true;
+}
+
+// Threads have to be gone before the statics they use
+static struct TShutdown {
+  ~TShutdown() {
+    timers_stop.store(true);
+    for (alarm_pool_t *p : pools)
+      for (std::thread &t : p->timers)
+        if (t.joinable()) t.join();
+    sim_hw_stop();
+  }
+} shutdown_hook;
+
+//---- peripheral registers, dispatched by address
+template< typename T, size_t N > static bool inside(const void *a, T (&arr)[N], int *idx, int *field, int *byte) {
+  uintptr_t p = (uintptr_t)a, b = (uintptr_t)&arr[0];
+  if (p < b || p >= b + sizeof(arr)) return false;
+  *idx = (p - b) / sizeof(T);
+  uintptr_t o = (p - b) % sizeof(T);
+  *field = o / sizeof(sim_reg);
+  *byte = o % sizeof(sim_reg);
+  return true;
+}
+
+uintptr_t sim_reg_read(const sim_reg *r) {
+  int i, f, b;
+  sim_irq_poll();
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  if (inside(r, sim_dma_hw, &i, &f, &b)) return sim_dma_reg_read(i, f);
+  if (inside(r, sim_uart_hw, &i, &f, &b)) return sim_uart_read(i, f, 0, 4, false);
+  if (inside(r, sim_pio_hw, &i, &f, &b)) return sim_pio_read(i, f, 0, 4, false);
+  return r->raw;
+}
+
+void sim_reg_write(sim_reg *r, uintptr_t v) {
+  int i, f, b;
+  sim_irq_poll();
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  if (inside(r, sim_dma_hw, &i, &f, &b)) sim_dma_reg_write(i, f, v);
+  else if (inside(r, sim_uart_hw, &i, &f, &b)) sim_uart_write(i, f, 0, 4, v, false);
+  else if (inside(r, sim_pio_hw, &i, &f, &b)) sim_pio_write(i, f, 0, 4, v, false);
+  else r->raw = v;
+}
+
+// A DMA access, to a peripheral FIFO or to memory
+uintptr_t sim_bus_read(uintptr_t addr, int size) {
+  int i, f, b;
+  if (inside((const void *)addr, sim_uart_hw, &i, &f, &b)) return sim_uart_read(i, f, b, size, true);
+  if (inside((const void *)addr, sim_pio_hw, &i, &f, &b)) return sim_pio_read(i, f, b, size, true);
+  uint32_t v = 0;
+  memcpy(&v, (const void *)addr, size);
+  return v;
+}
+
+void sim_bus_write(uintptr_t addr, int size, uintptr_t v) {
+  int i, f, b;
+  if (inside((const void *)addr, sim_uart_hw, &i, &f, &b)) sim_uart_write(i, f, b, size, v, true);
+  else if (inside((const void *)addr, sim_pio_hw, &i, &f, &b)) sim_pio_write(i, f, b, size, v, true);
+  else {
+    uint32_t w = (uint32_t)v;
+    memcpy((void *)addr, &w, size);
+  }
+}
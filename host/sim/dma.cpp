@@ -0,0 +1,270 @@
+/*
+  dma
+
+  DMA channels of the host simulation.
+
+  A triggered channel moves one item whenever its DREQ allows, wraps its ring, and on
+  completion raises IRQ 1 if enabled, triggers its chain and, in the RP2350's self trigger
+  mode (bits 28..31 of the count), starts over with the reloaded count.
+  Reading transfer_count gives the items left, with the mode bits, as on the chip.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <sim/sim.h>
+#include "hw.h"
+
+dma_channel_hw_t sim_dma_hw[NUM_DMA_CHANNELS];
+
+typedef struct {
+  bool claimed;
+  uint32_t ctrl;
+  uintptr_t read_addr, write_addr;
+  uint32_t reload;  // written count, with the mode bits
+  uint32_t count;   // items left
+  bool busy;
+  bool irq_raw;
+  bool irq0_en, irq1_en;
+} TChannel;
+
+static TChannel chan[NUM_DMA_CHANNELS];
+
+static inline TChannel &CH(uint ch) {
+  return chan[ch % NUM_DMA_CHANNELS];
+}
+
+int dma_claim_unused_channel(bool required) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  for (int i = 0; i < NUM_DMA_CHANNELS; i++)
+    if (!chan[i].claimed) {
+      chan[i] = TChannel();
+      chan[i].claimed = true;
+      return i;
+    }
+  return -1;
+}
+
+void dma_channel_unclaim(uint ch) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint ch) {
+  dma_channel_config c = { 0 };
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_dreq(&c, DREQ_FORCE);
+  channel_config_set_chain_to(&c, ch);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_ring(&c, false, 0);
+  channel_config_set_enable(&c, true);
+  return c;
+}
+
+static void set_bits(dma_channel_config *c, uint32_t mask, uint32_t v) {
+  c->ctrl = (c->ctrl & ~mask) | (v & mask);
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS, (uint32_t)size << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_INCR_READ_BITS, incr ? ~0u : 0);
+}
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS, incr ? ~0u : 0);
+}
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS, chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+void channel_config_set_enable(dma_channel_config *c, bool enable) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_EN_BITS, enable ? ~0u : 0);
+}
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_RING_SIZE_BITS | DMA_CH0_CTRL_TRIG_RING_SEL_BITS,
+           (size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) | (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0));
+}
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+  set_bits(c, DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS, dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+uint32_t dma_encode_transfer_count_with_self_trigger(uint32_t count) {
+  return (count & 0x0fffffff) | (1u << 28);
+}
+
+static void trigger(uint ch) {
+  TChannel &c = CH(ch);
+  if (!(c.ctrl & DMA_CH0_CTRL_TRIG_EN_BITS)) return;
+  c.count = c.reload & 0x0fffffff;
+  c.busy = true;
+}
+
+void dma_channel_configure(uint ch, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint32_t transfer_count, bool trig) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TChannel &c = CH(ch);
+  c.ctrl = config->ctrl;
+  c.write_addr = (uintptr_t)write_addr;
+  c.read_addr = (uintptr_t)read_addr;
+  c.reload = transfer_count;
+  if (trig) trigger(ch);
+  sim_dma_service();
+}
+
+void dma_channel_set_read_addr(uint ch, const volatile void *read_addr, bool trig) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).read_addr = (uintptr_t)read_addr;
+  if (trig) trigger(ch);
+  sim_dma_service();
+}
+
+void dma_channel_set_trans_count(uint ch, uint32_t count, bool trig) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).reload = count;
+  if (trig) trigger(ch);
+  sim_dma_service();
+}
+
+void dma_channel_set_irq0_enabled(uint ch, bool enabled) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).irq0_en = enabled;
+}
+
+void dma_channel_set_irq1_enabled(uint ch, bool enabled) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).irq1_en = enabled;
+}
+
+bool dma_channel_get_irq1_status(uint ch) {
+  sim_irq_poll();
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return CH(ch).irq_raw && CH(ch).irq1_en;
+}
+
+void dma_channel_acknowledge_irq1(uint ch) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).irq_raw = false;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint ch) {
+  return &sim_dma_hw[ch % NUM_DMA_CHANNELS];
+}
+
+bool dma_channel_is_busy(uint ch) {
+  sim_irq_poll();
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return CH(ch).busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint ch) {
+  while (dma_channel_is_busy(ch)) sim_hw_step();
+}
+
+void dma_channel_abort(uint ch) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  CH(ch).busy = false;
+}
+
+bool sim_dma_irq1_pending(void) {
+  for (const TChannel &c : chan)
+    if (c.irq_raw && c.irq1_en) return true;
+  return false;
+}
+
+// Registers, in the order of dma_channel_hw_t
+uintptr_t sim_dma_reg_read(int ch, int field) {
+  TChannel &c = CH(ch);
+  switch (field) {
+    case 0:
+    case 5:
+      return c.read_addr;
+    case 1:
+    case 6:
+      return c.write_addr;
+    case 2:
+    case 7:
+      return (c.reload & 0xf0000000) | c.count;
+    default:
+      return c.ctrl | (c.busy ? DMA_CH0_CTRL_TRIG_BUSY_BITS : 0);
+  }
+}
+
+void sim_dma_reg_write(int ch, int field, uintptr_t v) {
+  TChannel &c = CH(ch);
+  switch (field) {
+    case 0:
+    case 5:
+      c.read_addr = v;
+      break;
+    case 1:
+    case 6:
+      c.write_addr = v;
+      break;
+    case 2:
+      c.reload = v;
+      break;
+    case 7:
+      c.reload = v;
+      trigger(ch);
+      break;
+    case 3:
+      c.ctrl = v;
+      trigger(ch);
+      break;
+    case 4:
+      c.ctrl = v;
+      break;
+  }
+  sim_dma_service();
+}
+
+static bool dreq_ready(uint dreq) {
+  if (dreq == DREQ_FORCE) return true;
+  if (dreq >= DREQ_UART0_TX && dreq <= DREQ_UART1_RX) return sim_uart_dreq((dreq - DREQ_UART0_TX) / 2, ((dreq - DREQ_UART0_TX) & 1) == 0);
+  if (dreq < 24) return sim_pio_dreq(dreq / 8, dreq % 4, (dreq & 4) == 0);
+  return false;
+}
+
+static uintptr_t advance(uintptr_t addr, uint32_t size, uint32_t ring_bits) {
+  if (ring_bits == 0) return addr + size;
+  uintptr_t mask = ((uintptr_t)1 << ring_bits) - 1;
+  return (addr & ~mask) | ((addr + size) & mask);
+}
+
+static void complete(uint ch) {
+  TChannel &c = CH(ch);
+  c.busy = false;
+  c.irq_raw = true;
+  if (c.irq1_en) sim_irq_raise();
+  if ((c.reload >> 28) == 1) trigger(ch);
+  uint chain = (c.ctrl & DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) >> DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB;
+  if (chain != ch) trigger(chain);
+}
+
+// Run every channel as far as its DREQ lets it, called with sim_hw_mutex held
+void sim_dma_service(void) {
+  bool moved;
+  do {
+    moved = false;
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+      TChannel &c = chan[ch];
+      if (!c.busy) continue;
+      uint32_t size = 1u << ((c.ctrl & DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+      uint32_t ring = (c.ctrl & DMA_CH0_CTRL_TRIG_RING_SIZE_BITS) >> DMA_CH0_CTRL_TRIG_RING_SIZE_LSB;
+      bool ring_write = (c.ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS) != 0;
+      uint dreq = (c.ctrl & DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) >> DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB;
+      while (c.busy && c.count > 0 && dreq_ready(dreq)) {
+        sim_bus_write(c.write_addr, size, sim_bus_read(c.read_addr, size));
+        if (c.ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS) c.read_addr = advance(c.read_addr, size, ring_write ? 0 : ring);
+        if (c.ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) c.write_addr = advance(c.write_addr, size, ring_write ? ring : 0);
+        c.count--;
+        moved = true;
+      }
+      if (c.busy && c.count == 0) {
+        complete(ch);
+        moved = true;
+      }
+    }
+  } while (moved);
+}
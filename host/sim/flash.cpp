@@ -0,0 +1,68 @@
+/*
+  flash
+
+  Flash and EEPROM of the host simulation.
+
+  The flash is a 2MB array laid out as arduino-pico's linker script lays out a board with no
+  filesystem: the sketch up to 512KB, free space, and the EEPROM in the last sector, with
+  _FS_start and _FS_end both at the EEPROM.
+  Programming can only clear bits, as on the chip.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <EEPROM.h>
+#include <hardware/flash.h>
+#include <string.h>
+#include <sim/sim.h>
+
+#define FLASH_SIZE (2u << 20)
+
+uint8_t sim_flash[FLASH_SIZE];
+
+__asm__(".globl __flash_binary_end\n .set __flash_binary_end, sim_flash + 0x80000\n"
+        ".globl _FS_start\n .set _FS_start, sim_flash + 0x1ff000\n"
+        ".globl _FS_end\n .set _FS_end, sim_flash + 0x1ff000\n"
+        ".globl _EEPROM_start\n .set _EEPROM_start, sim_flash + 0x1ff000\n");
+extern uint8_t _EEPROM_start;
+
+static uint32_t erases, programs;
+
+static struct TErased {
+  TErased() {
+    memset(sim_flash, 0xff, sizeof(sim_flash));
+  }
+} erased;
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  memset(&sim_flash[flash_offs % FLASH_SIZE], 0xff, count);
+  erases += count / FLASH_SECTOR_SIZE;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+  for (size_t i = 0; i < count; i++) sim_flash[(flash_offs + i) % FLASH_SIZE] &= data[i];
+  programs++;
+}
+
+uint32_t sim_flash_erases(void) {
+  return erases;
+}
+
+uint32_t sim_flash_programs(void) {
+  return programs;
+}
+
+EEPROMClass EEPROM;
+
+void EEPROMClass::begin(size_t s) {
+  size = (s > sizeof(data)) ? sizeof(data) : s;
+  memcpy(data, &_EEPROM_start, size);
+}
+
+bool EEPROMClass::commit(void) {
+  uint32_t off = &_EEPROM_start - sim_flash;
+  flash_range_erase(off, FLASH_SECTOR_SIZE);
+  flash_range_program(off, data, size);
+  return true;
+}
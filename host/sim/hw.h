@@ -0,0 +1,71 @@
+/*
+  hw
+
+  Shared between the parts of the simulated Pico, not for tests.
+
+  Every peripheral access and every step of the hardware holds sim_hw_mutex, so DMA,
+  the lines and the firmware see each other's changes in a single order.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <hardware/dma.h>
+#include <hardware/uart.h>
+#include <hardware/pio.h>
+
+#define SIM_NUM_PIOS 3
+#define SIM_NUM_PINS 72
+#define SIM_CLK_SYS 150000000u
+#define SIM_CLK_PERI 150000000u
+
+extern std::recursive_mutex sim_hw_mutex;
+extern bool sim_paced;
+
+// core.cpp
+void sim_irq_poll(void);
+void sim_irq_raise(void);
+void sim_wake(void);
+// Time the current step runs up to, and where the previous one ended
+extern uint64_t sim_step_now, sim_step_prev;
+
+// DMA accesses to a peripheral FIFO or to memory
+uintptr_t sim_bus_read(uintptr_t addr, int size);
+void sim_bus_write(uintptr_t addr, int size, uintptr_t v);
+
+// dma.cpp
+uintptr_t sim_dma_reg_read(int ch, int field);
+void sim_dma_reg_write(int ch, int field, uintptr_t v);
+void sim_dma_service(void);
+bool sim_dma_irq1_pending(void);
+extern dma_channel_hw_t sim_dma_hw[NUM_DMA_CHANNELS];
+
+// uart.cpp, u is 0 or 1
+uintptr_t sim_uart_read(int u, int field, int byte, int size, bool dma);
+void sim_uart_write(int u, int field, int byte, int size, uintptr_t v, bool dma);
+bool sim_uart_dreq(int u, bool tx);
+// Line side: a character leaving TX, one arriving on RX
+bool sim_uart_tx_pop(int u, uint16_t *c, uint32_t *char_ns);
+bool sim_uart_rx_push(int u, uint16_t c, uint32_t *char_ns);
+bool sim_uart_cts_enabled(int u);
+bool sim_uart_break(int u);
+
+// pio.cpp
+uintptr_t sim_pio_read(int p, int field, int byte, int size, bool dma);
+void sim_pio_write(int p, int field, int byte, int size, uintptr_t v, bool dma);
+bool sim_pio_dreq(int p, int sm, bool tx);
+bool sim_pio_tx_pop(int p, int sm, uint16_t *c, uint32_t *char_ns);
+bool sim_pio_rx_push(int p, int sm, uint16_t c, uint32_t *char_ns);
+bool sim_pio_tx_enabled(int p, int sm);
+// State machines on a pin, -1 if none
+bool sim_pio_on_pin(unsigned pin, bool tx, int *p, int *sm);
+
+// line.cpp
+void sim_lines_step(void);
+void sim_gpio_set_function(unsigned pin, int fn);
+int sim_gpio_function(unsigned pin);
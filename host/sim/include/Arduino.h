@@ -0,0 +1,146 @@
+/*
+  Arduino.h of the host simulation
+
+  What the sketch uses of arduino-pico: String, Print/Stream, Serial, time, pins and rp2040.
+  Serial is a queue the test types into and a log of what the sketch printed (sim/serial.cpp).
+  Print::printf takes the format as arduino-pico would on a 32 bit target, %lu included.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <atomic>
+#include <hardware/dma.h>
+#include <hardware/uart.h>
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/hw.h>
+#include <pico/time.h>
+#include <api/HardwareSerial.h>
+
+#ifndef PICO_RP2040
+#define PICO_RP2040 0
+#endif
+
+#define LED_BUILTIN 64  // on the CYW43, a pin of its own here
+#define OUTPUT 1
+#define INPUT 0
+#define INPUT_PULLUP 2
+#define HIGH 1
+#define LOW 0
+
+extern std::atomic<bool> sim_bootsel;
+#define BOOTSEL (sim_bootsel.load())
+
+template< class T, class L > auto min(const T &a, const L &b) -> decltype((b < a) ? b : a) {
+  return (b < a) ? b : a;
+}
+template< class T, class L > auto max(const T &a, const L &b) -> decltype((b < a) ? b : a) {
+  return (a < b) ? b : a;
+}
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int val);
+int digitalRead(int pin);
+void noInterrupts(void);
+void interrupts(void);
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void reset_usb_boot(uint32_t gpio_activity_pin_mask, uint32_t disable_interface_mask);
+
+class String {
+  std::string s;
+
+public:
+  String() {}
+  String(const char *c) : s(c ? c : "") {}
+  String(const std::string &c) : s(c) {}
+  String &operator=(const char *c) {
+    s = c ? c : "";
+    return *this;
+  }
+  String &operator+=(char c) {
+    s += c;
+    return *this;
+  }
+  String &operator+=(const char *c) {
+    s += c;
+    return *this;
+  }
+  String &operator+=(const String &o) {
+    s += o.s;
+    return *this;
+  }
+  char operator[](size_t i) const { return s[i]; }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  const char *c_str(void) const { return s.c_str(); }
+  size_t length(void) const { return s.size(); }
+  long toInt(void) const { return atol(s.c_str()); }
+};
+
+class Print {
+public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size);
+  size_t write(const char *str) { return (str != NULL) ? write((const uint8_t *)str, strlen(str)) : 0; }
+  size_t write(const char *buf, size_t size) { return write((const uint8_t *)buf, size); }
+  size_t write(char c) { return write((uint8_t)c); }
+  size_t printf(const char *format, ...);
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write(c); }
+  size_t println(void) { return write("\r\n"); }
+  size_t println(const char *s) { return print(s) + println(); }
+  size_t println(const String &s) { return print(s) + println(); }
+  size_t println(char c) { return print(c) + println(); }
+  virtual int availableForWrite(void) { return 0; }
+  virtual void flush(void) {}
+  virtual ~Print() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+};
+
+#include <IPAddress.h>
+
+class SerialUSB : public Stream {
+public:
+  void begin(unsigned long baud = 115200) {}
+  void end(void) {}
+  void ignoreFlowControl(bool ignore = true) {}
+  operator bool(void) { return true; }
+  int available(void) override;
+  int read(void) override;
+  int peek(void) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int availableForWrite(void) override { return 256; }
+};
+extern SerialUSB Serial;
+
+class RP2040Class {
+public:
+  uint32_t getFreeHeap(void);
+  void idleOtherCore(void) {}
+  void resumeOtherCore(void) {}
+  uint32_t f_cpu(void) { return 150000000; }
+};
+extern RP2040Class rp2040;
@@ -0,0 +1,23 @@
+/*
+  CoreMutex.h of the host simulation
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+
+typedef std::recursive_mutex mutex_t;
+extern mutex_t __usb_mutex;
+
+class CoreMutex {
+  mutex_t *m;
+
+public:
+  CoreMutex(mutex_t *mutex, uint8_t option = 1) : m(mutex) { m->lock(); }
+  ~CoreMutex() { m->unlock(); }
+  operator bool(void) { return true; }
+};
@@ -0,0 +1,37 @@
+/*
+  EEPROM.h of the host simulation
+
+  The image lives in the last sector of the simulated flash, as with arduino-pico.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class EEPROMClass {
+  uint8_t data[4096];
+  size_t size;
+
+public:
+  void begin(size_t s);
+  bool commit(void);
+  size_t length(void) { return size; }
+  uint8_t read(int a) { return data[a]; }
+  void write(int a, uint8_t v) { data[a] = v; }
+  uint8_t *getDataPtr(void) { return data; }
+  template< typename T > T &get(int a, T &t) {
+    memcpy((void *)&t, &data[a], sizeof(T));
+    return t;
+  }
+  template< typename T > const T &put(int a, const T &t) {
+    memcpy(&data[a], (const void *)&t, sizeof(T));
+    return t;
+  }
+  EEPROMClass() : size(0) {}
+};
+extern EEPROMClass EEPROM;
@@ -0,0 +1,34 @@
+/*
+  IPAddress.h of the host simulation, IPv4 only
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+class String;
+
+class IPAddress {
+  uint8_t b[4];
+
+public:
+  IPAddress() : b{ 0, 0, 0, 0 } {}
+  IPAddress(uint8_t a0, uint8_t a1, uint8_t a2, uint8_t a3) : b{ a0, a1, a2, a3 } {}
+  // Network byte order, as lwIP keeps it
+  explicit IPAddress(uint32_t addr) { memcpy(b, &addr, 4); }
+  bool operator==(const IPAddress &o) const { return memcmp(b, o.b, 4) == 0; }
+  bool operator!=(const IPAddress &o) const { return !(*this == o); }
+  uint8_t operator[](int i) const { return b[i]; }
+  uint32_t v4(void) const {
+    uint32_t v;
+    memcpy(&v, b, 4);
+    return v;
+  }
+  bool isSet(void) const { return v4() != 0; }
+  bool fromString(const char *s);
+  String toString(void) const;
+};
@@ -0,0 +1,15 @@
+/*
+  LEAmDNS.h of the host simulation, nothing is announced
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+class MDNSResponder {
+public:
+  bool begin(const char *hostname) { return true; }
+  void update(void) {}
+};
+extern MDNSResponder MDNS;
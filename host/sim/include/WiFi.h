@@ -0,0 +1,82 @@
+/*
+  WiFi.h of the host simulation
+
+  A client is one end of a socketpair, the test holds the other (sim_connect() in sim/sim.h).
+  Copies of a WiFiClient share the connection, as in arduino-pico.
+  The link state is whatever the test sets (sim/wifi.cpp).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+
+class WiFiClient : public Stream {
+  struct TConn;
+  std::shared_ptr<TConn> conn;
+  friend class WiFiServer;
+
+public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd, uint16_t remoteport);
+
+  operator bool(void);
+  uint8_t connected(void);
+  int available(void) override;
+  int read(void) override;
+  int read(uint8_t *buf, size_t size);
+  int peek(void) override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int availableForWrite(void) override;
+  void flush(void) override {}
+  void stop(void);
+  void setNoDelay(bool nodelay) {}
+  IPAddress remoteIP(void) { return IPAddress(127, 0, 0, 1); }
+  uint16_t remotePort(void);
+};
+
+class WiFiServer {
+  uint16_t port;
+  bool listening;
+
+public:
+  WiFiServer(uint16_t p);
+  ~WiFiServer();
+  void begin(void);
+  void end(void);
+  void close(void) { end(); }
+  uint8_t status(void) { return listening ? 1 : 0; }
+  WiFiClient accept(void);
+  void setNoDelay(bool nodelay) {}
+  uint16_t getPort(void) { return port; }
+};
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } WiFiMode_t;
+#define WL_CONNECTED 3
+
+class WiFiClass {
+public:
+  void mode(WiFiMode_t m) {}
+  void setHostname(const char *name) {}
+  bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) { return true; }
+  bool softAP(const char *ssid, const char *psk, int channel, int hidden, int maxconn) { return true; }
+  void config(IPAddress local, IPAddress dns, IPAddress gateway) {}
+  void config(IPAddress local, IPAddress dns, IPAddress gateway, IPAddress subnet) {}
+  int beginNoBlock(const char *ssid, const char *psk, const uint8_t *bssid = nullptr);
+  int disconnect(bool wifioff = false);
+  void end(void) {}
+  bool connected(void);
+  int32_t RSSI(void);
+  IPAddress softAPIP(void) { return IPAddress(10, 0, 0, 1); }
+  IPAddress subnetMask(void) { return IPAddress(255, 255, 255, 0); }
+  IPAddress localIP(void) { return IPAddress(10, 0, 0, 1); }
+  uint8_t *BSSID(uint8_t *bssid);
+  int32_t channel(void);
+  int status(void) { return connected() ? WL_CONNECTED : 0; }
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,38 @@
+/*
+  WiFiUdp.h of the host simulation, datagrams are queued in memory per port (sim/wifi.cpp)
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class WiFiUDP : public Stream {
+  uint16_t port;
+  std::vector<uint8_t> rxbuf, txbuf;
+  size_t rxpos;
+  IPAddress rip, dip;
+  uint16_t rport, dport;
+
+public:
+  WiFiUDP() : port(0), rxpos(0), rport(0), dport(0) {}
+  ~WiFiUDP() { stop(); }
+  uint8_t begin(uint16_t p);
+  uint8_t beginMulticast(IPAddress group, uint16_t p);
+  void stop(void);
+  int beginPacket(IPAddress ip, uint16_t p);
+  int endPacket(void);
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int parsePacket(void);
+  int available(void) override { return rxbuf.size() - rxpos; }
+  int read(void) override;
+  int read(uint8_t *buf, size_t size);
+  int peek(void) override { return (rxpos < rxbuf.size()) ? rxbuf[rxpos] : -1; }
+  IPAddress remoteIP(void) { return rip; }
+  uint16_t remotePort(void) { return rport; }
+};
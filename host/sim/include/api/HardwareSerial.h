@@ -0,0 +1,64 @@
+/*
+  api/HardwareSerial.h of the host simulation, the SERIAL_xxx values of ArduinoCore-API
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+#define SERIAL_PARITY_EVEN   (0x1ul)
+#define SERIAL_PARITY_ODD    (0x2ul)
+#define SERIAL_PARITY_NONE   (0x3ul)
+#define SERIAL_PARITY_MARK   (0x4ul)
+#define SERIAL_PARITY_SPACE  (0x5ul)
+#define SERIAL_PARITY_MASK   (0xFul)
+#define SERIAL_STOP_BIT_1    (0x10ul)
+#define SERIAL_STOP_BIT_1_5  (0x20ul)
+#define SERIAL_STOP_BIT_2    (0x30ul)
+#define SERIAL_STOP_BIT_MASK (0xF0ul)
+#define SERIAL_DATA_5        (0x100ul)
+#define SERIAL_DATA_6        (0x200ul)
+#define SERIAL_DATA_7        (0x300ul)
+#define SERIAL_DATA_8        (0x400ul)
+#define SERIAL_DATA_MASK     (0xF00ul)
+#define D(b,p,s) (SERIAL_DATA_##b | SERIAL_PARITY_##p | SERIAL_STOP_BIT_##s)
+#define SERIAL_5N1 D(5,NONE,1)
+#define SERIAL_6N1 D(6,NONE,1)
+#define SERIAL_7N1 D(7,NONE,1)
+#define SERIAL_8N1 D(8,NONE,1)
+#define SERIAL_5N2 D(5,NONE,2)
+#define SERIAL_6N2 D(6,NONE,2)
+#define SERIAL_7N2 D(7,NONE,2)
+#define SERIAL_8N2 D(8,NONE,2)
+#define SERIAL_5E1 D(5,EVEN,1)
+#define SERIAL_6E1 D(6,EVEN,1)
+#define SERIAL_7E1 D(7,EVEN,1)
+#define SERIAL_8E1 D(8,EVEN,1)
+#define SERIAL_5E2 D(5,EVEN,2)
+#define SERIAL_6E2 D(6,EVEN,2)
+#define SERIAL_7E2 D(7,EVEN,2)
+#define SERIAL_8E2 D(8,EVEN,2)
+#define SERIAL_5O1 D(5,ODD,1)
+#define SERIAL_6O1 D(6,ODD,1)
+#define SERIAL_7O1 D(7,ODD,1)
+#define SERIAL_8O1 D(8,ODD,1)
+#define SERIAL_5O2 D(5,ODD,2)
+#define SERIAL_6O2 D(6,ODD,2)
+#define SERIAL_7O2 D(7,ODD,2)
+#define SERIAL_8O2 D(8,ODD,2)
+#define SERIAL_5M1 D(5,MARK,1)
+#define SERIAL_6M1 D(6,MARK,1)
+#define SERIAL_7M1 D(7,MARK,1)
+#define SERIAL_8M1 D(8,MARK,1)
+#define SERIAL_5M2 D(5,MARK,2)
+#define SERIAL_6M2 D(6,MARK,2)
+#define SERIAL_7M2 D(7,MARK,2)
+#define SERIAL_8M2 D(8,MARK,2)
+#define SERIAL_5S1 D(5,SPACE,1)
+#define SERIAL_6S1 D(6,SPACE,1)
+#define SERIAL_7S1 D(7,SPACE,1)
+#define SERIAL_8S1 D(8,SPACE,1)
+#define SERIAL_5S2 D(5,SPACE,2)
+#define SERIAL_6S2 D(6,SPACE,2)
+#define SERIAL_7S2 D(7,SPACE,2)
+#define SERIAL_8S2 D(8,SPACE,2)
@@ -0,0 +1,3 @@
+#pragma once
+// The core includes it as arduino.h as well
+#include <Arduino.h>
@@ -0,0 +1,14 @@
+/*
+  hardware/clocks.h of the host simulation
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+enum clock_index { clk_gpout0 = 0, clk_ref = 4, clk_sys = 5, clk_peri = 6 };
+
+uint32_t clock_get_hz(enum clock_index clk_index);
@@ -0,0 +1,84 @@
+/*
+  hardware/dma.h of the host simulation
+
+  The channels are simulated by sim/dma.cpp: they move data between host memory and the
+  simulated peripherals at DREQ pace, reload, chain, self trigger and raise IRQ 1.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <hardware/hw.h>
+
+typedef unsigned int uint;
+
+#define NUM_DMA_CHANNELS 16
+
+typedef struct {
+  sim_reg read_addr;
+  sim_reg write_addr;
+  sim_reg transfer_count;
+  sim_reg ctrl_trig;
+  sim_reg al1_ctrl;
+  sim_reg al1_read_addr;
+  sim_reg al1_write_addr;
+  sim_reg al1_transfer_count_trig;
+} dma_channel_hw_t;
+
+// CTRL as the RP2040 lays it out
+typedef struct {
+  uint32_t ctrl;
+} dma_channel_config;
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS 0x00000001
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB 2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS 0x0000000c
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS 0x00000010
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS 0x00000020
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB 6
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS 0x000003c0
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS 0x00000400
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB 11
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS 0x00007800
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB 15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS 0x001f8000
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS 0x01000000
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+// Numbered for the simulation only, DREQ_FORCE runs unpaced
+enum {
+  DREQ_PIO0_TX0 = 0, DREQ_PIO0_RX0 = 4, DREQ_PIO1_TX0 = 8, DREQ_PIO1_RX0 = 12, DREQ_PIO2_TX0 = 16, DREQ_PIO2_RX0 = 20,
+  DREQ_UART0_TX = 40, DREQ_UART0_RX = 41, DREQ_UART1_TX = 42, DREQ_UART1_RX = 43,
+  DREQ_FORCE = 63
+};
+
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint ch);
+dma_channel_config dma_channel_get_default_config(uint ch);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+void channel_config_set_enable(dma_channel_config *c, bool enable);
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint ch, const dma_channel_config *c, volatile void *write_addr, const volatile void *read_addr, uint32_t transfer_count, bool trigger);
+uint32_t dma_encode_transfer_count_with_self_trigger(uint32_t count);
+void dma_channel_set_irq0_enabled(uint ch, bool enabled);
+void dma_channel_set_irq1_enabled(uint ch, bool enabled);
+bool dma_channel_get_irq1_status(uint ch);
+void dma_channel_acknowledge_irq1(uint ch);
+dma_channel_hw_t *dma_channel_hw_addr(uint ch);
+void dma_channel_wait_for_finish_blocking(uint ch);
+bool dma_channel_is_busy(uint ch);
+void dma_channel_abort(uint ch);
+void dma_channel_set_read_addr(uint ch, const volatile void *read_addr, bool trigger);
+void dma_channel_set_trans_count(uint ch, uint32_t count, bool trigger);
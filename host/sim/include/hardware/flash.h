@@ -0,0 +1,24 @@
+/*
+  hardware/flash.h of the host simulation
+
+  The flash is a host array that XIP_BASE stands for, laid out like a 2MB Pico with the
+  symbols of the arduino-pico linker script (sim/flash.cpp).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_BLOCK_SIZE (1u << 16)
+
+extern uint8_t sim_flash[];
+#define XIP_BASE ((uintptr_t)sim_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
@@ -0,0 +1,27 @@
+/*
+  hardware/gpio.h of the host simulation, pins are plain levels (sim/line.cpp)
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define NUM_BANK0_GPIOS 30
+
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_I2C = 3, GPIO_FUNC_PWM = 4, GPIO_FUNC_SIO = 5, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7, GPIO_FUNC_NULL = 0x1f };
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_pull_down(uint gpio);
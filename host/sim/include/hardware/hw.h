@@ -0,0 +1,15 @@
+/*
+  hardware/hw.h of the host simulation
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <sim/reg.h>
+
+static inline void hw_set_bits(sim_reg *r, uint32_t mask) { *r = (uintptr_t)*r | mask; }
+static inline void hw_clear_bits(sim_reg *r, uint32_t mask) { *r = (uintptr_t)*r & ~(uintptr_t)mask; }
+static inline void hw_write_masked(sim_reg *r, uint32_t values, uint32_t mask) { *r = ((uintptr_t)*r & ~(uintptr_t)mask) | (values & mask); }
@@ -0,0 +1,23 @@
+/*
+  hardware/irq.h of the host simulation
+
+  A handler runs on the thread that enabled its IRQ, the next time that thread calls into
+  the simulation (sim/core.cpp), the way an interrupt cuts in between two instructions.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef unsigned int uint;
+typedef void (*irq_handler_t)(void);
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
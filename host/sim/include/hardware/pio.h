@@ -0,0 +1,88 @@
+/*
+  hardware/pio.h of the host simulation
+
+  State machines are not executed. One whose program has an OUT to a pin is taken for a UART
+  transmitter on that pin, one with IN pins for a receiver, each with an 8 deep joined FIFO
+  and the bit rate its clock divider gives at 8 cycles per bit (sim/pio.cpp).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sim/reg.h>
+
+typedef unsigned int uint;
+
+#if PICO_RP2040
+#define NUM_PIOS 2
+#else
+#define NUM_PIOS 3
+#endif
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+
+typedef struct {
+  sim_reg ctrl, fstat, fdebug, flevel;
+  sim_reg txf[NUM_PIO_STATE_MACHINES];
+  sim_reg rxf[NUM_PIO_STATE_MACHINES];
+  sim_reg irq, irq_force;
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t sim_pio_hw[3];  // as many as an RP2350 has, whichever chip is built for
+#define pio0 (&sim_pio_hw[0])
+#define pio1 (&sim_pio_hw[1])
+
+typedef struct {
+  uint32_t clkdiv;
+  int8_t out_pin, in_pin, sideset_pin;
+  uint8_t wrap_target, wrap;
+  uint8_t fifo_join;
+} pio_sm_config;
+
+typedef struct pio_program {
+  const uint16_t *instructions;
+  uint8_t length;
+  int8_t origin;
+  uint8_t pio_version;
+} pio_program_t;
+
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE, PIO_FIFO_JOIN_TX, PIO_FIFO_JOIN_RX };
+
+#define PIO_FDEBUG_TXSTALL_LSB 24
+#define PIO_FDEBUG_TXOVER_LSB 16
+#define PIO_FDEBUG_RXUNDER_LSB 8
+#define PIO_FDEBUG_RXSTALL_LSB 0
+
+PIO pio_get_instance(uint instance);
+uint pio_get_index(PIO pio);
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+pio_sm_config pio_get_default_sm_config(void);
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap);
+void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs);
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base);
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_gpio_init(PIO pio, uint pin);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
@@ -0,0 +1,17 @@
+/*
+  hardware/sync.h of the host simulation, events are a flag and a condition variable (sim/core.cpp)
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+void __sev(void);
+void __wfe(void);
+static inline void __dmb(void) { std::atomic_thread_fence(std::memory_order_seq_cst); }
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
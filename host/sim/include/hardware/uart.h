@@ -0,0 +1,77 @@
+/*
+  hardware/uart.h of the host simulation
+
+  Two PL011s with 32 deep FIFOs, their lines are driven by sim/line.cpp.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <hardware/hw.h>
+
+typedef unsigned int uint;
+
+typedef struct {
+  sim_reg dr, rsr, fr, ilpr, ibrd, fbrd, lcr_h, cr, ifls, imsc, ris, mis, icr, dmacr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_hw_t sim_uart_hw[2];
+#define uart0_hw (&sim_uart_hw[0])
+#define uart1_hw (&sim_uart_hw[1])
+#define uart0 ((uart_inst_t *)uart0_hw)
+#define uart1 ((uart_inst_t *)uart1_hw)
+#define UART_INSTANCE(n) ((n) == 0 ? uart0 : (n) == 1 ? uart1 : (uart_inst_t *)0)
+
+typedef enum { UART_PARITY_NONE, UART_PARITY_EVEN, UART_PARITY_ODD } uart_parity_t;
+
+uart_hw_t *uart_get_hw(uart_inst_t *uart);
+uint uart_get_index(uart_inst_t *uart);
+uint32_t uart_init(uart_inst_t *uart, uint32_t baudrate);
+void uart_deinit(uart_inst_t *uart);
+uint32_t uart_set_baudrate(uart_inst_t *uart, uint32_t baudrate);
+void uart_set_format(uart_inst_t *uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+void uart_set_break(uart_inst_t *uart, bool en);
+void uart_set_hw_flow(uart_inst_t *uart, bool cts, bool rts);
+uint uart_get_dreq(uart_inst_t *uart, bool is_tx);
+
+#define UART_UARTDR_OE_BITS 0x800
+#define UART_UARTDR_BE_BITS 0x400
+#define UART_UARTDR_PE_BITS 0x200
+#define UART_UARTDR_FE_BITS 0x100
+#define UART_UARTRSR_BITS 0xf
+#define UART_UARTRSR_OE_BITS 0x8
+#define UART_UARTRSR_BE_BITS 0x4
+#define UART_UARTRSR_PE_BITS 0x2
+#define UART_UARTRSR_FE_BITS 0x1
+#define UART_UARTFR_TXFE_BITS 0x80
+#define UART_UARTFR_RXFF_BITS 0x40
+#define UART_UARTFR_TXFF_BITS 0x20
+#define UART_UARTFR_RXFE_BITS 0x10
+#define UART_UARTFR_BUSY_BITS 0x8
+#define UART_UARTFR_CTS_BITS 0x1
+#define UART_UARTLCR_H_SPS_BITS 0x80
+#define UART_UARTLCR_H_WLEN_BITS 0x60
+#define UART_UARTLCR_H_WLEN_LSB 5
+#define UART_UARTLCR_H_FEN_BITS 0x10
+#define UART_UARTLCR_H_STP2_BITS 0x8
+#define UART_UARTLCR_H_EPS_BITS 0x4
+#define UART_UARTLCR_H_PEN_BITS 0x2
+#define UART_UARTLCR_H_BRK_BITS 0x1
+#define UART_UARTCR_CTSEN_BITS 0x8000
+#define UART_UARTCR_RTSEN_BITS 0x4000
+#define UART_UARTIMSC_RTIM_BITS 0x40
+#define UART_UARTIMSC_RXIM_BITS 0x10
+#define UART_UARTRIS_OERIS_BITS 0x400
+#define UART_UARTRIS_BERIS_BITS 0x200
+#define UART_UARTRIS_PERIS_BITS 0x100
+#define UART_UARTRIS_FERIS_BITS 0x080
+#define UART_UARTRIS_RTRIS_BITS 0x040
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+#define UART_IRQ_NUM(u) (uart_get_index(u) ? UART1_IRQ : UART0_IRQ)
@@ -0,0 +1,22 @@
+/*
+  lwip/pbuf.h of the host simulation
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+};
+
+u8_t pbuf_free(struct pbuf *p);
@@ -0,0 +1,73 @@
+/*
+  lwip/tcp.h of the host simulation
+
+  The callbacks and calls of the raw API that rawtcp uses, with a peer the test drives
+  (sim_tcp_xxx in sim/sim.h). tcp_write() without TCP_WRITE_FLAG_COPY keeps a reference,
+  and the data is checked to be unchanged when the peer acknowledges it (sim/lwip.cpp).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <lwip/pbuf.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_VAL -6
+#define ERR_USE -8
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_TYPE_ANY 46U
+
+typedef struct {
+  uint32_t addr;
+} ip_addr_t;
+extern const ip_addr_t ip_addr_any_type;
+#define IP_ANY_TYPE (&ip_addr_any_type)
+
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+struct tcp_pcb {
+  ip_addr_t remote_ip;
+  u16_t remote_port;
+  // Simulation
+  void *callback_arg;
+  tcp_accept_fn accept;
+  tcp_recv_fn recv;
+  tcp_sent_fn sent;
+  tcp_err_fn errf;
+  int sim;  // index of the simulated connection, -1 for a listener
+  u16_t local_port;
+  bool listening;
+};
+
+const char *ipaddr_ntoa(const ip_addr_t *addr);
+struct tcp_pcb *tcp_new_ip_type(u8_t type);
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog);
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+void tcp_nagle_disable(struct tcp_pcb *pcb);
+u16_t tcp_sndbuf(struct tcp_pcb *pcb);
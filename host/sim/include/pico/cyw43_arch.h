@@ -0,0 +1,11 @@
+/*
+  pico/cyw43_arch.h of the host simulation, the lwIP lock is a recursive mutex (sim/lwip.cpp)
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+void cyw43_arch_lwip_begin(void);
+void cyw43_arch_lwip_end(void);
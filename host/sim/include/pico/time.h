@@ -0,0 +1,31 @@
+/*
+  pico/time.h of the host simulation, a monotonic microsecond clock (sim/core.cpp)
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+typedef struct alarm_pool alarm_pool_t;
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer {
+  int64_t delay_us;
+  alarm_pool_t *pool;
+  int32_t alarm_id;
+  repeating_timer_callback_t callback;
+  void *user_data;
+};
+
+alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(unsigned max_timers);
+bool alarm_pool_add_repeating_timer_us(alarm_pool_t *pool, int64_t delay_us, repeating_timer_callback_t callback, void *user_data, repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
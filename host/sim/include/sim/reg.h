@@ -0,0 +1,38 @@
+/*
+  reg
+
+  A peripheral register of the host simulation.
+
+  The SDK structs that firmware reads and writes directly (dma_channel_hw_t, uart_hw_t, pio_hw_t)
+  are made of these, so that every access goes to the simulated peripheral that owns the
+  register, just as a bus access would. A register is as wide as a pointer, DMA addresses
+  are host addresses.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+class sim_reg;
+uintptr_t sim_reg_read(const sim_reg *r);
+void sim_reg_write(sim_reg *r, uintptr_t v);
+
+class sim_reg {
+public:
+  uintptr_t raw;  // storage, only the peripheral touches it
+
+  operator uintptr_t() const { return sim_reg_read(this); }
+  sim_reg &operator=(uintptr_t v) {
+    sim_reg_write(this, v);
+    return *this;
+  }
+  sim_reg &operator=(const sim_reg &o) { return *this = (uintptr_t)o; }
+  sim_reg &operator|=(uintptr_t v) { return *this = (uintptr_t)*this | v; }
+  sim_reg &operator&=(uintptr_t v) { return *this = (uintptr_t)*this & v; }
+
+  sim_reg() : raw(0) {}
+  sim_reg(const sim_reg &) = delete;
+};
@@ -0,0 +1,116 @@
+/*
+  sim
+
+  What a host test or benchmark uses to drive the simulated Pico.
+
+  The clock is the host's monotonic clock unless sim_clock_manual() freezes it, then time
+  only moves through sim_advance(), delay() and waiting for events, which makes the
+  character timing of the lines exact.
+  The peripherals move data when they are stepped: by a thread of their own after sim_hw_start(),
+  otherwise by sim_hw_step(), sim_advance(), delay() and __wfe().
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <IPAddress.h>
+
+//---- time and stepping
+void sim_clock_manual(bool on);
+void sim_advance(uint64_t us);
+uint64_t sim_now_us(void);
+void sim_hw_step(void);
+void sim_hw_start(void);
+void sim_hw_stop(void);
+// Which core the calling thread plays, for events and for sim_halt
+void sim_set_core(int core);
+int sim_core(void);
+// Ask a core to leave whatever it is waiting in, it throws sim_halt at the next chance
+struct sim_halt {};
+void sim_request_halt(int core, bool on);
+void sim_check_halt(void);
+// watchdog_enable() or reset_usb_boot() was called
+bool sim_rebooted(void);
+// DMA_IRQ_1 handler runs so far
+uint32_t sim_irq_count(void);
+
+//---- serial lines, by GPIO
+// Line error flags of a character, as CUartBase::LINE_xxx
+enum { SIM_FRAMING = 0x01, SIM_PARITY = 0x02, SIM_BREAK = 0x04 };
+// Characters arriving on an RX pin, at the baudrate of whatever receives them
+void sim_line_send(unsigned pin, const void *p, size_t len, uint8_t err = 0);
+size_t sim_line_pending(unsigned pin);
+// Characters that have left a TX pin and were not looped back, and how many left in all
+size_t sim_line_recv(unsigned pin, void *p, size_t max);
+size_t sim_line_sent(unsigned pin);
+uint32_t sim_line_breaks(unsigned pin);
+// What leaves txpin arrives on rxpin, -1 undoes it
+void sim_line_loopback(unsigned txpin, int rxpin);
+// Off, characters move as fast as the FIFOs and DMA take them
+void sim_line_paced(bool on);
+bool sim_gpio_level(unsigned pin);
+void sim_gpio_drive(unsigned pin, bool level);
+
+//---- flash, sectors erased and program calls so far
+uint32_t sim_flash_erases(void);
+uint32_t sim_flash_programs(void);
+
+//---- USB console
+void sim_serial_type(const char *s);
+std::string sim_serial_output(bool clear = true);
+extern std::atomic<bool> sim_bootsel;
+
+//---- USB CDC, the host side
+void sim_usb_connect(bool on);
+void sim_usb_write(const void *p, size_t len);
+// What the device sent, in the packets it went in
+size_t sim_usb_read(void *p, size_t max);
+std::vector<size_t> sim_usb_packets(bool clear = true);
+uint32_t sim_usb_flushes(void);
+void sim_usb_line_coding(uint32_t baud, uint8_t databits, uint8_t parity, uint8_t stopbits);
+
+//---- WiFi
+void sim_wifi_link(bool up);
+void sim_wifi_ap(const uint8_t bssid[6], int channel);
+// BSSID the last join asked for, empty if any
+std::vector<uint8_t> sim_wifi_join_bssid(void);
+uint32_t sim_wifi_joins(void);
+// A client connecting to a WiFiServer, the socket of the client side, -1 if nobody listens
+int sim_connect(uint16_t port);
+bool sim_listening(uint16_t port);
+// fd helpers with a timeout in ms, they return what they managed
+size_t sim_fd_write(int fd, const void *p, size_t len, int timeout_ms = 2000);
+size_t sim_fd_read(int fd, void *p, size_t len, int timeout_ms = 2000);
+std::string sim_fd_read_all(int fd, int idle_ms = 200);
+
+//---- UDP
+void sim_udp_send(uint16_t port, IPAddress from, uint16_t fromport, const void *p, size_t len);
+typedef struct {
+  IPAddress ip;
+  uint16_t port;
+  uint16_t srcport;
+  std::vector<uint8_t> data;
+} TSimDatagram;
+bool sim_udp_recv(TSimDatagram &d);
+
+//---- lwIP raw API, the peer of a connection
+int sim_tcp_connect(uint16_t port);
+// Offered in segments of seg bytes, returns what the window took
+size_t sim_tcp_send(int c, const void *p, size_t len, size_t seg = 1460);
+// Retries segments lwIP refused
+void sim_tcp_poll(void);
+size_t sim_tcp_recv(int c, void *p, size_t max);
+size_t sim_tcp_unacked(int c);
+void sim_tcp_ack(int c, size_t n);
+void sim_tcp_close(int c);
+bool sim_tcp_open(int c);
+// pbufs handed out and not freed, referenced data that changed before it was acknowledged
+int sim_tcp_pbufs(void);
+uint32_t sim_tcp_ref_errors(void);
@@ -0,0 +1,32 @@
+/*
+  sketch
+
+  Runs PicoMultiBridge.ino on two threads, one per core, the way arduino-pico does:
+  setup() and loop() on core 0, setup1() and loop1() on core 1.
+  The hardware is stepped by a thread of its own while the sketch runs.
+  The sketch's globals live once per process, so a test starts it once.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "net.hpp"
+#include "us_dma.h"
+
+// Settings the sketch boots with, the defaults passed through edit, saved as the sketch saves them
+void sim_sketch_config(void (*edit)(TNetInfo &n));
+void sim_sketch_start(void);
+// Stops both cores wherever they wait next
+void sim_sketch_stop(void);
+// Both cores are through their setup
+bool sim_sketch_ready(void);
+// CPU time the thread of core c has used, which a loaded host does not stretch
+uint64_t sim_sketch_cpu_us(int c);
+
+// Bridge ports, 0..3
+bool sim_sketch_enabled(int port);
+uint16_t sim_sketch_port(int port);
+CUartBase *sim_sketch_uart(int port);
@@ -0,0 +1,31 @@
+/*
+  tusb.h of the host simulation
+
+  The CDC FIFOs of TinyUSB, the test is the host on the other side (sim/usb.cpp).
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+  uint32_t bit_rate;
+  uint8_t stop_bits;
+  uint8_t parity;
+  uint8_t data_bits;
+} cdc_line_coding_t;
+
+bool tud_disconnect(void);
+uint32_t tud_cdc_available(void);
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write(const void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_available(void);
+uint32_t tud_cdc_write_flush(void);
+bool tud_cdc_connected(void);
+
+// Defined by the sketch
+void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding);
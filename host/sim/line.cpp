@@ -0,0 +1,233 @@
+/*
+  line
+
+  GPIOs and the serial lines on them.
+
+  A pin carries whole characters, each with the line error flags it arrived with. What a
+  UART or a PIO transmitter on a pin sends is kept for the test or looped back to another
+  pin, what the test sends waits on the pin until the receiver there takes it.
+  Characters are paced by the character time of the peripheral that moves them, within the
+  time a hardware step covers, unless sim_line_paced(false) lets them through at once.
+  Breaks are counted when a UART sets BRK or a stopped PIO transmitter holds its pin low.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <deque>
+#include <sim/sim.h>
+#include "hw.h"
+
+typedef struct {
+  int fn;
+  bool level;
+  std::deque<uint16_t> in;  // data | error flags << 8, waiting for the receiver
+  std::deque<uint8_t> out;  // sent and not looped back
+  size_t sent;
+  int loop;                 // pin that receives what this one sends, -1 if none
+  uint64_t tx_next, rx_next;  // in ns, when the line is free for the next character
+  bool in_break;
+  uint32_t breaks;
+} TPin;
+
+static struct TPins {
+  TPin p[SIM_NUM_PINS];
+  TPins() {
+    for (TPin &g : p) {
+      g.fn = GPIO_FUNC_NULL;
+      g.level = true;  // idle lines are high
+      g.sent = 0;
+      g.loop = -1;
+      g.tx_next = g.rx_next = 0;
+      g.in_break = false;
+      g.breaks = 0;
+    }
+  }
+} pins;
+
+static TPin &PIN(unsigned pin) {
+  return pins.p[pin % SIM_NUM_PINS];
+}
+
+// Pins of the UARTs, per UART
+static const uint8_t uart_tx_pins[2][4] = { { 0, 12, 16, 28 }, { 4, 8, 20, 24 } };
+static const uint8_t uart_rx_pins[2][4] = { { 1, 13, 17, 29 }, { 5, 9, 21, 25 } };
+static const uint8_t uart_cts_pins[2][4] = { { 2, 14, 18, 0xff }, { 6, 10, 22, 26 } };
+
+static int uart_on(unsigned pin, const uint8_t (&tab)[2][4]) {
+  if (PIN(pin).fn != GPIO_FUNC_UART) return -1;
+  for (int u = 0; u < 2; u++)
+    for (uint8_t t : tab[u])
+      if (t == pin) return u;
+  return -1;
+}
+
+static bool pio_on(unsigned pin, bool tx, int *p, int *sm) {
+  int fn = PIN(pin).fn;
+  return fn >= GPIO_FUNC_PIO0 && fn < GPIO_FUNC_PIO0 + SIM_NUM_PIOS && sim_pio_on_pin(pin, tx, p, sm);
+}
+
+// Hardware CTS of a UART is deasserted, CTS is active low
+static bool cts_stopped(int u) {
+  if (!sim_uart_cts_enabled(u)) return false;
+  for (uint8_t t : uart_cts_pins[u])
+    if (t < SIM_NUM_PINS && PIN(t).fn == GPIO_FUNC_UART && PIN(t).level) return true;
+  return false;
+}
+
+static void deliver(TPin &g, uint16_t c) {
+  g.sent++;
+  if (g.loop >= 0) PIN(g.loop).in.push_back(c);
+  else g.out.push_back((uint8_t)c);
+}
+
+static bool step_tx(unsigned pin) {
+  TPin &g = PIN(pin);
+  int u = uart_on(pin, uart_tx_pins), p = -1, sm = -1;
+  bool pio = (u < 0) && pio_on(pin, true, &p, &sm);
+  if (u < 0 && !pio) return false;
+
+  bool brk = (u >= 0) ? sim_uart_break(u) : (!sim_pio_tx_enabled(p, sm) && !g.level);
+  if (brk && !g.in_break) {
+    g.breaks++;
+    if (g.loop >= 0) PIN(g.loop).in.push_back(SIM_BREAK << 8);
+  }
+  g.in_break = brk;
+  if (brk) return false;
+
+  bool moved = false;
+  uint64_t t = (g.tx_next > sim_step_prev * 1000) ? g.tx_next : sim_step_prev * 1000;
+  for (;;) {
+    if (sim_paced && t > sim_step_now * 1000) break;
+    if (u >= 0 && cts_stopped(u)) break;
+    uint16_t c;
+    uint32_t ns;
+    if (!((u >= 0) ? sim_uart_tx_pop(u, &c, &ns) : sim_pio_tx_pop(p, sm, &c, &ns))) break;
+    deliver(g, c);
+    moved = true;
+    if (sim_paced) g.tx_next = t += (ns > 0) ? ns : 1;
+    sim_dma_service();
+  }
+  return moved;
+}
+
+static bool step_rx(unsigned pin) {
+  TPin &g = PIN(pin);
+  if (g.in.empty()) return false;
+  int u = uart_on(pin, uart_rx_pins), p = -1, sm = -1;
+  bool pio = (u < 0) && pio_on(pin, false, &p, &sm);
+  if (u < 0 && !pio) return false;
+
+  bool moved = false;
+  uint64_t t = (g.rx_next > sim_step_prev * 1000) ? g.rx_next : sim_step_prev * 1000;
+  while (!g.in.empty()) {
+    if (sim_paced && t > sim_step_now * 1000) break;
+    uint32_t ns;
+    if (!((u >= 0) ? sim_uart_rx_push(u, g.in.front(), &ns) : sim_pio_rx_push(p, sm, g.in.front(), &ns))) break;
+    g.in.pop_front();
+    moved = true;
+    if (sim_paced) g.rx_next = t += (ns > 0) ? ns : 1;
+    sim_dma_service();
+  }
+  return moved;
+}
+
+// Called with sim_hw_mutex held. A looped back character may arrive on a pin already passed.
+void sim_lines_step(void) {
+  bool moved;
+  do {
+    moved = false;
+    for (unsigned pin = 0; pin < SIM_NUM_PINS; pin++) {
+      if (step_tx(pin)) moved = true;
+      if (step_rx(pin)) moved = true;
+    }
+  } while (moved);
+}
+
+void sim_gpio_set_function(unsigned pin, int fn) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  PIN(pin).fn = fn;
+}
+
+int sim_gpio_function(unsigned pin) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return PIN(pin).fn;
+}
+
+//---- SDK and Arduino
+void gpio_init(uint gpio) {
+  sim_gpio_set_function(gpio, GPIO_FUNC_SIO);
+}
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+  sim_gpio_set_function(gpio, fn);
+}
+void gpio_set_dir(uint gpio, bool out) {}
+void gpio_put(uint gpio, bool value) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  PIN(gpio).level = value;
+}
+bool gpio_get(uint gpio) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return PIN(gpio).level;
+}
+void gpio_pull_up(uint gpio) {}
+void gpio_pull_down(uint gpio) {}
+
+void pinMode(int pin, int mode) {}
+void digitalWrite(int pin, int val) {
+  gpio_put(pin, val != 0);
+}
+int digitalRead(int pin) {
+  return gpio_get(pin) ? HIGH : LOW;
+}
+
+//---- test side
+void sim_line_send(unsigned pin, const void *p, size_t len, uint8_t err) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  for (size_t i = 0; i < len; i++) PIN(pin).in.push_back(((const uint8_t *)p)[i] | (uint16_t)err << 8);
+}
+
+size_t sim_line_pending(unsigned pin) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return PIN(pin).in.size();
+}
+
+size_t sim_line_recv(unsigned pin, void *p, size_t max) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TPin &g = PIN(pin);
+  size_t n = 0;
+  for (; n < max && !g.out.empty(); n++) {
+    ((uint8_t *)p)[n] = g.out.front();
+    g.out.pop_front();
+  }
+  return n;
+}
+
+size_t sim_line_sent(unsigned pin) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return PIN(pin).sent;
+}
+
+uint32_t sim_line_breaks(unsigned pin) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return PIN(pin).breaks;
+}
+
+void sim_line_loopback(unsigned txpin, int rxpin) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  PIN(txpin).loop = rxpin;
+}
+
+void sim_line_paced(bool on) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  sim_paced = on;
+}
+
+bool sim_gpio_level(unsigned pin) {
+  return gpio_get(pin);
+}
+
+void sim_gpio_drive(unsigned pin, bool level) {
+  gpio_put(pin, level);
+}
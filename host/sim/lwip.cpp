@@ -0,0 +1,321 @@
+/*
+  lwip
+
+  The part of the lwIP raw API rawtcp uses, with the peer of each connection driven by the test.
+
+  tcp_write() takes up to an 8760 byte send buffer, tcp_output() hands what was written to the
+  peer and sim_tcp_ack() releases it. Data written without TCP_WRITE_FLAG_COPY stays where it
+  was, so it is compared with a snapshot when it goes out and when it is acknowledged; any
+  difference is counted, it is data lwIP would have retransmitted wrongly.
+  What the peer sends arrives as pbuf chains of its segment size within an 11680 byte window,
+  a chain the recv callback refuses is offered again by sim_tcp_poll().
+  Everything runs under the lwIP lock, as the callbacks of the real stack do.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <lwip/tcp.h>
+#include <pico/cyw43_arch.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <sim/sim.h>
+
+#define SND_BUF 8760
+#define WINDOW 11680
+
+const ip_addr_t ip_addr_any_type = { 0 };
+
+static std::recursive_mutex lwip_mutex;
+
+void cyw43_arch_lwip_begin(void) {
+  lwip_mutex.lock();
+}
+void cyw43_arch_lwip_end(void) {
+  lwip_mutex.unlock();
+}
+
+const char *ipaddr_ntoa(const ip_addr_t *addr) {
+  return "127.0.0.1";
+}
+
+//---- pbufs
+static int pbufs_out;
+
+static struct pbuf *pbuf_new(const uint8_t *p, size_t len) {
+  struct pbuf *b = (struct pbuf *)malloc(sizeof(struct pbuf) + len);
+  b->next = NULL;
+  b->payload = b + 1;
+  b->len = b->tot_len = len;
+  memcpy(b->payload, p, len);
+  pbufs_out++;
+  return b;
+}
+
+u8_t pbuf_free(struct pbuf *p) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  u8_t n = 0;
+  while (p != NULL) {
+    struct pbuf *next = p->next;
+    free(p);
+    pbufs_out--;
+    n++;
+    p = next;
+  }
+  return n;
+}
+
+int sim_tcp_pbufs(void) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  return pbufs_out;
+}
+
+//---- connections
+typedef struct {
+  const uint8_t *ptr;          // where lwIP would send it from
+  std::vector< uint8_t > snap;  // what it was when written
+  bool copied;
+  bool output;
+  size_t acked;                // of this record
+} TRecord;
+
+typedef struct {
+  struct tcp_pcb *pcb;         // NULL once closed or aborted
+  size_t used;                 // send buffer taken
+  std::deque< TRecord > sent;
+  std::deque< uint8_t > delivered;
+  size_t window;
+  std::deque< struct pbuf * > refused;
+} TConn;
+
+static std::vector< TConn > conns;
+static std::map< u16_t, struct tcp_pcb * > listeners;
+static uint32_t ref_errors;
+
+uint32_t sim_tcp_ref_errors(void) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  return ref_errors;
+}
+
+static TConn *conn_of(struct tcp_pcb *pcb) {
+  return (pcb->sim >= 0 && (size_t)pcb->sim < conns.size()) ? &conns[pcb->sim] : NULL;
+}
+
+static void check(const TRecord &r, size_t from, size_t to) {
+  if (!r.copied && memcmp(r.ptr + from, r.snap.data() + from, to - from) != 0) ref_errors++;
+}
+
+// The connection is gone, and with it whatever lwIP held for it
+static void drop(struct tcp_pcb *pcb) {
+  TConn *c = conn_of(pcb);
+  if (c != NULL) {
+    c->pcb = NULL;
+    c->sent.clear();
+    c->used = 0;
+    for (struct pbuf *p : c->refused) pbuf_free(p);
+    c->refused.clear();
+  }
+  delete pcb;
+}
+
+struct tcp_pcb *tcp_new_ip_type(u8_t type) {
+  struct tcp_pcb *pcb = new tcp_pcb();
+  pcb->sim = -1;
+  return pcb;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  if (listeners.count(port)) return ERR_USE;
+  pcb->local_port = port;
+  return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen_with_backlog(struct tcp_pcb *pcb, u8_t backlog) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  pcb->listening = true;
+  listeners[pcb->local_port] = pcb;
+  return pcb;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) {
+  pcb->callback_arg = arg;
+}
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) {
+  pcb->accept = accept;
+}
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) {
+  pcb->recv = recv;
+}
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) {
+  pcb->sent = sent;
+}
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) {
+  pcb->errf = err;
+}
+void tcp_nagle_disable(struct tcp_pcb *pcb) {}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn *c = conn_of(pcb);
+  if (c != NULL) c->window = (c->window + len > WINDOW) ? WINDOW : c->window + len;
+}
+
+u16_t tcp_sndbuf(struct tcp_pcb *pcb) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn *c = conn_of(pcb);
+  return (c != NULL) ? SND_BUF - c->used : 0;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn *c = conn_of(pcb);
+  if (c == NULL) return ERR_CLSD;
+  if (len > SND_BUF - c->used) return ERR_MEM;
+  TRecord r;
+  r.ptr = (const uint8_t *)dataptr;
+  r.snap.assign(r.ptr, r.ptr + len);
+  r.copied = (apiflags & TCP_WRITE_FLAG_COPY) != 0;
+  r.output = false;
+  r.acked = 0;
+  c->sent.push_back(r);
+  c->used += len;
+  return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn *c = conn_of(pcb);
+  if (c == NULL) return ERR_CLSD;
+  for (TRecord &r : c->sent) {
+    if (r.output) continue;
+    check(r, 0, r.snap.size());
+    c->delivered.insert(c->delivered.end(), r.snap.begin(), r.snap.end());
+    r.output = true;
+  }
+  return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  if (pcb->listening) {
+    listeners.erase(pcb->local_port);
+    delete pcb;
+    return ERR_OK;
+  }
+  drop(pcb);
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  tcp_err_fn f = pcb->errf;
+  void *arg = pcb->callback_arg;
+  drop(pcb);
+  if (f != NULL) f(arg, ERR_ABRT);
+}
+
+//---- the peer
+int sim_tcp_connect(uint16_t port) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  auto it = listeners.find(port);
+  if (it == listeners.end() || it->second->accept == NULL) return -1;
+  struct tcp_pcb *lp = it->second;
+  struct tcp_pcb *pcb = new tcp_pcb();
+  pcb->remote_ip.addr = 0x0100007f;
+  pcb->remote_port = 50000 + conns.size();
+  pcb->local_port = port;
+  pcb->sim = conns.size();
+  TConn c = {};
+  c.pcb = pcb;
+  c.window = WINDOW;
+  conns.push_back(c);
+  int ci = pcb->sim;
+  if (lp->accept(lp->callback_arg, pcb, ERR_OK) != ERR_OK) tcp_abort(pcb);
+  return ci;
+}
+
+bool sim_tcp_open(int c) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  return conns.at(c).pcb != NULL;
+}
+
+static bool offer(TConn &c) {
+  while (!c.refused.empty() && c.pcb != NULL && c.pcb->recv != NULL) {
+    struct pbuf *p = c.refused.front();
+    if (c.pcb->recv(c.pcb->callback_arg, c.pcb, p, ERR_OK) != ERR_OK) return false;
+    // The callback may have closed the connection, which let go of the chains
+    if (!c.refused.empty()) c.refused.pop_front();
+  }
+  return true;
+}
+
+size_t sim_tcp_send(int ci, const void *p, size_t len, size_t seg) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn &c = conns.at(ci);
+  if (c.pcb == NULL) return 0;
+  size_t n = (len < c.window) ? len : c.window;
+  if (n == 0) return 0;
+  struct pbuf *head = NULL, **tail = &head;
+  for (size_t o = 0; o < n; o += seg) {
+    *tail = pbuf_new((const uint8_t *)p + o, (n - o < seg) ? n - o : seg);
+    tail = &(*tail)->next;
+  }
+  size_t left = n;
+  for (struct pbuf *b = head; b != NULL; left -= b->len, b = b->next) b->tot_len = left;
+  c.window -= n;
+  c.refused.push_back(head);
+  offer(c);
+  return n;
+}
+
+void sim_tcp_poll(void) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  for (TConn &c : conns) offer(c);
+}
+
+size_t sim_tcp_recv(int ci, void *p, size_t max) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn &c = conns.at(ci);
+  size_t n = 0;
+  for (; n < max && !c.delivered.empty(); n++) {
+    ((uint8_t *)p)[n] = c.delivered.front();
+    c.delivered.pop_front();
+  }
+  return n;
+}
+
+size_t sim_tcp_unacked(int ci) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  size_t n = 0;
+  for (const TRecord &r : conns.at(ci).sent)
+    if (r.output) n += r.snap.size() - r.acked;
+  return n;
+}
+
+void sim_tcp_ack(int ci, size_t n) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn &c = conns.at(ci);
+  size_t done = 0;
+  while (done < n && !c.sent.empty() && c.sent.front().output) {
+    TRecord &r = c.sent.front();
+    size_t k = (n - done < r.snap.size() - r.acked) ? n - done : r.snap.size() - r.acked;
+    check(r, r.acked, r.acked + k);
+    r.acked += k;
+    done += k;
+    if (r.acked == r.snap.size()) c.sent.pop_front();
+  }
+  c.used -= done;
+  if (done > 0 && c.pcb != NULL && c.pcb->sent != NULL) c.pcb->sent(c.pcb->callback_arg, c.pcb, done);
+}
+
+// The peer closes, lwIP tells with an empty receive
+void sim_tcp_close(int ci) {
+  std::lock_guard<std::recursive_mutex> l(lwip_mutex);
+  TConn &c = conns.at(ci);
+  if (c.pcb != NULL && c.pcb->recv != NULL) c.pcb->recv(c.pcb->callback_arg, c.pcb, NULL, ERR_OK);
+}
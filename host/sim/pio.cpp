@@ -0,0 +1,304 @@
+/*
+  pio
+
+  PIO blocks of the host simulation. Programs only take up instruction memory, a state
+  machine is a UART transmitter or receiver by the pins its config names (see hardware/pio.h).
+  TXSTALL is raised when an enabled transmitter finds its FIFO empty, RXSTALL when a character
+  arrives at a full one, and a character with a bad stop bit raises irq 4 rel instead of
+  being pushed, as the uart_rx program does.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdlib.h>
+#include <deque>
+#include <hardware/gpio.h>
+#include "hw.h"
+
+pio_hw_t sim_pio_hw[SIM_NUM_PIOS];
+
+enum { F_CTRL, F_FSTAT, F_FDEBUG, F_FLEVEL, F_TXF0, F_RXF0 = F_TXF0 + 4, F_IRQ = F_RXF0 + 4, F_IRQ_FORCE };
+
+typedef struct {
+  bool claimed, enabled;
+  pio_sm_config cfg;
+  std::deque<uint32_t> tx, rx;
+} TSm;
+
+typedef struct {
+  uint32_t used;  // instruction slots
+  TSm sm[NUM_PIO_STATE_MACHINES];
+  uint32_t fdebug;
+  uint32_t irq;
+} TPio;
+
+static TPio pios[SIM_NUM_PIOS];
+
+static int index_of(PIO pio) {
+  return (int)(pio - sim_pio_hw);
+}
+
+PIO pio_get_instance(uint instance) {
+  return &sim_pio_hw[instance % SIM_NUM_PIOS];
+}
+
+uint pio_get_index(PIO pio) {
+  return index_of(pio);
+}
+
+static int find_slot(const TPio &p, const pio_program_t *program) {
+  uint32_t mask = (program->length >= 32) ? ~0u : ((1u << program->length) - 1);
+  for (int o = PIO_INSTRUCTION_COUNT - program->length; o >= 0; o--) {
+    if (program->origin >= 0 && o != program->origin) continue;
+    if (!(p.used & (mask << o))) return o;
+  }
+  return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return find_slot(pios[index_of(pio)], program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TPio &p = pios[index_of(pio)];
+  int o = find_slot(p, program);
+  if (o < 0) abort();  // the SDK panics
+  p.used |= ((program->length >= 32) ? ~0u : ((1u << program->length) - 1)) << o;
+  return o;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TPio &p = pios[index_of(pio)];
+  for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++)
+    if (!p.sm[i].claimed) {
+      p.sm[i] = TSm();
+      p.sm[i].claimed = true;
+      p.sm[i].cfg = pio_get_default_sm_config();
+      return i;
+    }
+  if (required) abort();
+  return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  pios[index_of(pio)].sm[sm].claimed = false;
+}
+
+pio_sm_config pio_get_default_sm_config(void) {
+  pio_sm_config c = {};
+  c.clkdiv = 0x100;
+  c.out_pin = c.in_pin = c.sideset_pin = -1;
+  c.wrap = 31;
+  return c;
+}
+
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) {
+  c->wrap_target = wrap_target;
+  c->wrap = wrap;
+}
+void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) {}
+void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) {
+  c->sideset_pin = sideset_base;
+}
+void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {}
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {}
+void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) {
+  c->out_pin = out_base;
+}
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+  c->in_pin = in_base;
+}
+void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {}
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+  c->fifo_join = join;
+}
+
+int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TSm &s = pios[index_of(pio)].sm[sm];
+  s.enabled = false;
+  s.cfg = *config;
+  s.tx.clear();
+  s.rx.clear();
+  return 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  pios[index_of(pio)].sm[sm].enabled = enabled;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) {
+  for (uint pin = 0; pin < 32; pin++)
+    if (pin_mask & (1u << pin)) gpio_put(pin, (pin_values >> pin) & 1);
+}
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) {}
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {}
+
+void pio_sm_set_clkdiv_int_frac(PIO pio, uint sm, uint16_t div_int, uint8_t div_frac) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  pios[index_of(pio)].sm[sm].cfg.clkdiv = ((uint32_t)div_int << 8) | div_frac;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TSm &s = pios[index_of(pio)].sm[sm];
+  s.tx.clear();
+  s.rx.clear();
+}
+
+void pio_sm_restart(PIO pio, uint sm) {}
+
+void pio_gpio_init(PIO pio, uint pin) {
+  sim_gpio_set_function(pin, GPIO_FUNC_PIO0 + index_of(pio));
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+  return index_of(pio) * 8 + sm + (is_tx ? 0 : 4);
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  return (pios[index_of(pio)].irq >> pio_interrupt_num) & 1;
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  pios[index_of(pio)].irq &= ~(1u << pio_interrupt_num);
+}
+
+//---- the line side and the registers, called with sim_hw_mutex held
+static size_t depth(const TSm &s, bool tx) {
+  return (s.cfg.fifo_join == (tx ? PIO_FIFO_JOIN_TX : PIO_FIFO_JOIN_RX)) ? 8 : 4;
+}
+
+// 8 PIO cycles per bit, 10 bits per character
+static uint32_t char_time(const TSm &s) {
+  uint64_t baud = ((uint64_t)SIM_CLK_SYS * 256) / ((uint64_t)s.cfg.clkdiv * 8);
+  return (baud == 0) ? 0 : (uint32_t)((10 * 1000000000ull + baud - 1) / baud);
+}
+
+bool sim_pio_dreq(int p, int sm, bool tx) {
+  TSm &s = pios[p].sm[sm];
+  if (!s.claimed) return false;
+  return tx ? s.tx.size() < depth(s, true) : !s.rx.empty();
+}
+
+bool sim_pio_tx_pop(int p, int sm, uint16_t *c, uint32_t *char_ns) {
+  TSm &s = pios[p].sm[sm];
+  *char_ns = char_time(s);
+  if (!s.enabled) return false;
+  if (s.tx.empty()) {
+    pios[p].fdebug |= 1u << (PIO_FDEBUG_TXSTALL_LSB + sm);
+    return false;
+  }
+  *c = (uint8_t)s.tx.front();
+  s.tx.pop_front();
+  return true;
+}
+
+bool sim_pio_rx_push(int p, int sm, uint16_t c, uint32_t *char_ns) {
+  TSm &s = pios[p].sm[sm];
+  *char_ns = char_time(s);
+  if (!s.enabled) return false;
+  // A break is a framing error to the program, parity is not looked at
+  if (c & 0x500) {
+    pios[p].irq |= 1u << (4 + sm);
+    return true;
+  }
+  if (s.rx.size() >= depth(s, false)) {
+    pios[p].fdebug |= 1u << (PIO_FDEBUG_RXSTALL_LSB + sm);
+    return true;
+  }
+  s.rx.push_back((uint32_t)(c & 0xff) << 24);
+  return true;
+}
+
+bool sim_pio_tx_enabled(int p, int sm) {
+  return pios[p].sm[sm].enabled;
+}
+
+bool sim_pio_on_pin(unsigned pin, bool tx, int *p, int *sm) {
+  for (int i = 0; i < SIM_NUM_PIOS; i++)
+    for (int j = 0; j < NUM_PIO_STATE_MACHINES; j++) {
+      const TSm &s = pios[i].sm[j];
+      if (s.claimed && (tx ? s.cfg.out_pin : s.cfg.in_pin) == (int)pin) {
+        *p = i;
+        *sm = j;
+        return true;
+      }
+    }
+  return false;
+}
+
+uintptr_t sim_pio_read(int p, int field, int byte, int size, bool dma) {
+  TPio &b = pios[p];
+  uint32_t v = 0;
+  if (field >= F_RXF0 && field < F_RXF0 + NUM_PIO_STATE_MACHINES) {
+    TSm &s = b.sm[field - F_RXF0];
+    if (!s.rx.empty()) {
+      v = s.rx.front();
+      s.rx.pop_front();
+    } else
+      b.fdebug |= 1u << (PIO_FDEBUG_RXUNDER_LSB + field - F_RXF0);
+  } else
+    switch (field) {
+      case F_CTRL:
+        for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++)
+          if (b.sm[i].enabled) v |= 1u << i;
+        break;
+      case F_FSTAT:
+        for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++) {
+          const TSm &s = b.sm[i];
+          if (s.rx.size() >= depth(s, false)) v |= 1u << i;
+          if (s.rx.empty()) v |= 1u << (8 + i);
+          if (s.tx.size() >= depth(s, true)) v |= 1u << (16 + i);
+          if (s.tx.empty()) v |= 1u << (24 + i);
+        }
+        break;
+      case F_FDEBUG:
+        v = b.fdebug;
+        break;
+      case F_FLEVEL:
+        for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++) v |= ((b.sm[i].tx.size() & 0xf) | (b.sm[i].rx.size() & 0xf) << 4) << (8 * i);
+        break;
+      case F_IRQ:
+        v = b.irq;
+        break;
+      default:
+        break;
+    }
+  return (v >> (8 * byte)) & ((size >= 4) ? 0xffffffffu : ((1u << (8 * size)) - 1));
+}
+
+void sim_pio_write(int p, int field, int byte, int size, uintptr_t v, bool dma) {
+  TPio &b = pios[p];
+  if (field >= F_TXF0 && field < F_TXF0 + NUM_PIO_STATE_MACHINES) {
+    TSm &s = b.sm[field - F_TXF0];
+    if (s.tx.size() < depth(s, true)) s.tx.push_back((uint32_t)v);
+    else b.fdebug |= 1u << (PIO_FDEBUG_TXOVER_LSB + field - F_TXF0);
+    return;
+  }
+  switch (field) {
+    case F_CTRL:
+      for (int i = 0; i < NUM_PIO_STATE_MACHINES; i++) b.sm[i].enabled = (v >> i) & 1;
+      break;
+    case F_FDEBUG:
+      // Write 1 to clear
+      b.fdebug &= ~(uint32_t)v;
+      break;
+    case F_IRQ:
+      b.irq &= ~(uint32_t)v;
+      break;
+    case F_IRQ_FORCE:
+      b.irq |= (uint32_t)v;
+      break;
+    default:
+      break;
+  }
+}
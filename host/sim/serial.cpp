@@ -0,0 +1,125 @@
+/*
+  serial
+
+  Print, IPAddress and the USB console of the host simulation.
+  The console takes what the test types and keeps what the sketch prints, SIM_SERIAL_ECHO=1
+  in the environment copies the output to stdout as well.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <sim/sim.h>
+
+SerialUSB Serial;
+
+size_t Print::write(const uint8_t *buf, size_t size) {
+  size_t n = 0;
+  while (n < size && write(buf[n])) n++;
+  return n;
+}
+
+// long is 32 bits on the Pico, so a single l is dropped and %lu takes a uint32_t as it does there
+size_t Print::printf(const char *format, ...) {
+  std::string f;
+  for (const char *c = format; *c; c++) {
+    f += *c;
+    if (*c != '%') continue;
+    if (c[1] == '%') {
+      f += *++c;
+      continue;
+    }
+    while (c[1] != '\0' && strchr("-+ #0123456789.*", c[1]) != NULL) f += *++c;
+    if (c[1] == 'l' && c[2] != 'l') c++;
+    else if (c[1] == 'l') {
+      f += "ll";
+      c += 2;
+    }
+  }
+  va_list ap;
+  va_start(ap, format);
+  va_list aq;
+  va_copy(aq, ap);
+  int n = vsnprintf(NULL, 0, f.c_str(), aq);
+  va_end(aq);
+  std::string s(n > 0 ? n : 0, '\0');
+  if (n > 0) vsnprintf(&s[0], n + 1, f.c_str(), ap);
+  va_end(ap);
+  return write((const uint8_t *)s.data(), s.size());
+}
+
+//---- IPAddress
+bool IPAddress::fromString(const char *s) {
+  unsigned v[4];
+  char tail;
+  if (sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4) return false;
+  for (int i = 0; i < 4; i++) {
+    if (v[i] > 255) return false;
+    b[i] = v[i];
+  }
+  return true;
+}
+
+String IPAddress::toString(void) const {
+  char s[16];
+  snprintf(s, sizeof(s), "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+  return String(s);
+}
+
+//---- console
+static std::mutex serial_mutex;
+static std::deque<uint8_t> serial_in;
+static std::string serial_out;
+static const bool serial_echo = getenv("SIM_SERIAL_ECHO") != NULL && atoi(getenv("SIM_SERIAL_ECHO")) != 0;
+
+// The sketch polls this in tight loops, which is where it can be halted
+int SerialUSB::available(void) {
+  sim_check_halt();
+  std::lock_guard<std::mutex> l(serial_mutex);
+  if (serial_in.empty()) std::this_thread::yield();
+  return serial_in.size();
+}
+
+int SerialUSB::read(void) {
+  std::lock_guard<std::mutex> l(serial_mutex);
+  if (serial_in.empty()) return -1;
+  int c = serial_in.front();
+  serial_in.pop_front();
+  return c;
+}
+
+int SerialUSB::peek(void) {
+  std::lock_guard<std::mutex> l(serial_mutex);
+  return serial_in.empty() ? -1 : serial_in.front();
+}
+
+size_t SerialUSB::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t SerialUSB::write(const uint8_t *buf, size_t size) {
+  std::lock_guard<std::mutex> l(serial_mutex);
+  serial_out.append((const char *)buf, size);
+  if (serial_echo) {
+    fwrite(buf, 1, size, stdout);
+    fflush(stdout);
+  }
+  return size;
+}
+
+void sim_serial_type(const char *s) {
+  std::lock_guard<std::mutex> l(serial_mutex);
+  while (*s) serial_in.push_back(*s++);
+}
+
+std::string sim_serial_output(bool clear) {
+  std::lock_guard<std::mutex> l(serial_mutex);
+  std::string s = serial_out;
+  if (clear) serial_out.clear();
+  return s;
+}
@@ -0,0 +1,97 @@
+/*
+  sketch
+
+  The sketch built for the host, with what the tests need to run it and look into it.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include "PicoMultiBridge.ino"
+
+#include <pthread.h>
+#include <time.h>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+
+static std::thread core[2];
+static std::atomic<int> ready(0);
+static std::atomic<uint32_t> loops(0);  // rounds of loop() on core 0
+
+static TNetInfo config;
+
+void sim_sketch_config(void (*edit)(TNetInfo &n)) {
+  config = default_netinfo;
+  if (edit != NULL) edit(config);
+  nvm.Init(sizeof(TNetInfo));
+  nvm.Write(
+    [] {
+      EEPROM.put(0, config);
+    });
+  nvm.Flush();
+}
+
+static void run(int c) {
+  sim_set_core(c);
+  try {
+    if (c == 0) setup();
+    else setup1();
+    ready.fetch_add(1);
+    for (;;) {
+      sim_check_halt();
+      if (c == 0) {
+        loop();
+        loops.fetch_add(1);
+      } else
+        loop1();
+      std::this_thread::yield();
+    }
+  } catch (sim_halt &) {
+  }
+}
+
+void sim_sketch_start(void) {
+  sim_request_halt(0, false);
+  sim_request_halt(1, false);
+  sim_hw_start();
+  core[0] = std::thread(run, 0);
+  core[1] = std::thread(run, 1);
+  // Core 1 takes the DMA IRQ, its setup1() has to be through before anything else goes on
+  while (!sim_sketch_ready()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // and core 0 has to go round its loop after that, which is where the servers open
+  uint32_t l = loops.load();
+  while (loops.load() < l + 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+void sim_sketch_stop(void) {
+  sim_request_halt(0, true);
+  sim_request_halt(1, true);
+  for (std::thread &t : core)
+    if (t.joinable()) t.join();
+  sim_hw_stop();
+}
+
+bool sim_sketch_ready(void) {
+  return ready.load() == 2;
+}
+
+bool sim_sketch_enabled(int port) {
+  return bridge[port].enabled;
+}
+
+uint16_t sim_sketch_port(int port) {
+  return bridge[port].port;
+}
+
+CUartBase *sim_sketch_uart(int port) {
+  return bridge[port].uart;
+}
+
+uint64_t sim_sketch_cpu_us(int c) {
+  clockid_t id;
+  struct timespec ts;
+  if (pthread_getcpuclockid(core[c].native_handle(), &id) != 0 || clock_gettime(id, &ts) != 0) return 0;
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,226 @@
+/*
+  uart
+
+  PL011 UARTs of the host simulation: 32 deep FIFOs, the raw interrupt and receive status
+  bits of line errors, hardware CTS and the divisor arithmetic of the Pico SDK.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <deque>
+#include "hw.h"
+
+uart_hw_t sim_uart_hw[2];
+
+#define FIFO_DEPTH 32
+
+enum { F_DR, F_RSR, F_FR, F_ILPR, F_IBRD, F_FBRD, F_LCR_H, F_CR, F_IFLS, F_IMSC, F_RIS, F_MIS, F_ICR, F_DMACR };
+
+typedef struct {
+  bool enabled;
+  uint32_t ibrd, fbrd, lcr_h, cr;
+  uint32_t ris, rsr;
+  std::deque<uint16_t> rx;  // data and the DR error bits
+  std::deque<uint8_t> tx;
+} TUart;
+
+static TUart uart[2];
+
+static int index_of(uart_inst_t *u) {
+  return ((uart_hw_t *)u == uart1_hw) ? 1 : 0;
+}
+
+uart_hw_t *uart_get_hw(uart_inst_t *u) {
+  return (uart_hw_t *)u;
+}
+
+uint uart_get_index(uart_inst_t *u) {
+  return index_of(u);
+}
+
+uint uart_get_dreq(uart_inst_t *u, bool is_tx) {
+  return DREQ_UART0_TX + 2 * index_of(u) + (is_tx ? 0 : 1);
+}
+
+// Bits a character takes on the line
+static uint32_t charbits(const TUart &s) {
+  uint32_t bits = 1 + 5 + ((s.lcr_h & UART_UARTLCR_H_WLEN_BITS) >> UART_UARTLCR_H_WLEN_LSB) + 1;
+  if (s.lcr_h & UART_UARTLCR_H_PEN_BITS) bits++;
+  if (s.lcr_h & UART_UARTLCR_H_STP2_BITS) bits++;
+  return bits;
+}
+
+static uint32_t baud(const TUart &s) {
+  return (s.ibrd == 0) ? 0 : (4 * SIM_CLK_PERI) / (64 * s.ibrd + s.fbrd);
+}
+
+static uint32_t char_time(const TUart &s) {
+  uint32_t b = baud(s);
+  return (b == 0) ? 0 : (uint32_t)(((uint64_t)charbits(s) * 1000000000 + b - 1) / b);
+}
+
+uint32_t uart_set_baudrate(uart_inst_t *u, uint32_t baudrate) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TUart &s = uart[index_of(u)];
+  uint32_t div = (8 * SIM_CLK_PERI / baudrate) + 1;
+  s.ibrd = div >> 7;
+  if (s.ibrd == 0) {
+    s.ibrd = 1;
+    s.fbrd = 0;
+  } else if (s.ibrd >= 65535) {
+    s.ibrd = 65535;
+    s.fbrd = 0;
+  } else
+    s.fbrd = (div & 0x7f) >> 1;
+  return baud(s);
+}
+
+uint32_t uart_init(uart_inst_t *u, uint32_t baudrate) {
+  uint32_t b;
+  {
+    std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+    TUart &s = uart[index_of(u)];
+    s = TUart();
+    s.enabled = true;
+    s.lcr_h = UART_UARTLCR_H_FEN_BITS | (3 << UART_UARTLCR_H_WLEN_LSB);
+    b = uart_set_baudrate(u, baudrate);
+  }
+  return b;
+}
+
+void uart_deinit(uart_inst_t *u) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  uart[index_of(u)].enabled = false;
+}
+
+void uart_set_format(uart_inst_t *u, uint data_bits, uint stop_bits, uart_parity_t parity) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TUart &s = uart[index_of(u)];
+  s.lcr_h &= ~(UART_UARTLCR_H_WLEN_BITS | UART_UARTLCR_H_STP2_BITS | UART_UARTLCR_H_PEN_BITS | UART_UARTLCR_H_EPS_BITS);
+  s.lcr_h |= ((data_bits - 5) << UART_UARTLCR_H_WLEN_LSB) | ((stop_bits == 2) ? UART_UARTLCR_H_STP2_BITS : 0);
+  if (parity != UART_PARITY_NONE) s.lcr_h |= UART_UARTLCR_H_PEN_BITS | ((parity == UART_PARITY_EVEN) ? UART_UARTLCR_H_EPS_BITS : 0);
+}
+
+void uart_set_break(uart_inst_t *u, bool en) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TUart &s = uart[index_of(u)];
+  if (en) s.lcr_h |= UART_UARTLCR_H_BRK_BITS;
+  else s.lcr_h &= ~UART_UARTLCR_H_BRK_BITS;
+}
+
+void uart_set_hw_flow(uart_inst_t *u, bool cts, bool rts) {
+  std::lock_guard<std::recursive_mutex> l(sim_hw_mutex);
+  TUart &s = uart[index_of(u)];
+  s.cr = (s.cr & ~(UART_UARTCR_CTSEN_BITS | UART_UARTCR_RTSEN_BITS)) | (cts ? UART_UARTCR_CTSEN_BITS : 0) | (rts ? UART_UARTCR_RTSEN_BITS : 0);
+}
+
+bool sim_uart_dreq(int u, bool tx) {
+  TUart &s = uart[u];
+  if (!s.enabled) return false;
+  return tx ? s.tx.size() < FIFO_DEPTH : !s.rx.empty();
+}
+
+bool sim_uart_cts_enabled(int u) {
+  return (uart[u].cr & UART_UARTCR_CTSEN_BITS) != 0;
+}
+
+bool sim_uart_break(int u) {
+  return uart[u].enabled && (uart[u].lcr_h & UART_UARTLCR_H_BRK_BITS);
+}
+
+bool sim_uart_tx_pop(int u, uint16_t *c, uint32_t *char_ns) {
+  TUart &s = uart[u];
+  *char_ns = char_time(s);
+  if (!s.enabled || s.tx.empty()) return false;
+  *c = s.tx.front();
+  s.tx.pop_front();
+  return true;
+}
+
+// A character, or a break or line error, off the line into the RX FIFO
+bool sim_uart_rx_push(int u, uint16_t c, uint32_t *char_ns) {
+  TUart &s = uart[u];
+  *char_ns = char_time(s);
+  if (!s.enabled) return false;
+  uint16_t e = c >> 8;
+  uint16_t d = c & 0xff;
+  if (e & 0x04) d = 0;  // a break reads as 0 with BE and FE
+  if (e & 0x01) s.ris |= UART_UARTRIS_FERIS_BITS;
+  if (e & 0x02) s.ris |= UART_UARTRIS_PERIS_BITS;
+  if (e & 0x04) s.ris |= UART_UARTRIS_BERIS_BITS;
+  if (s.rx.size() >= FIFO_DEPTH) {
+    s.ris |= UART_UARTRIS_OERIS_BITS;
+    s.rsr |= UART_UARTRSR_OE_BITS;
+    return true;
+  }
+  s.rx.push_back(d | ((e & 0x01) ? UART_UARTDR_FE_BITS : 0) | ((e & 0x02) ? UART_UARTDR_PE_BITS : 0) | ((e & 0x04) ? UART_UARTDR_BE_BITS | UART_UARTDR_FE_BITS : 0));
+  return true;
+}
+
+uintptr_t sim_uart_read(int u, int field, int byte, int size, bool dma) {
+  TUart &s = uart[u];
+  uint32_t v = 0;
+  switch (field) {
+    case F_DR:
+      if (!s.rx.empty()) {
+        v = s.rx.front();
+        s.rx.pop_front();
+        // The status of the character just read
+        s.rsr = (s.rsr & UART_UARTRSR_OE_BITS) | ((v >> 8) & 0x7);
+      }
+      break;
+    case F_RSR:
+      v = s.rsr;
+      break;
+    case F_FR:
+      if (s.tx.empty()) v |= UART_UARTFR_TXFE_BITS;
+      else v |= UART_UARTFR_BUSY_BITS;
+      if (s.tx.size() >= FIFO_DEPTH) v |= UART_UARTFR_TXFF_BITS;
+      if (s.rx.empty()) v |= UART_UARTFR_RXFE_BITS;
+      if (s.rx.size() >= FIFO_DEPTH) v |= UART_UARTFR_RXFF_BITS;
+      break;
+    case F_IBRD:
+      v = s.ibrd;
+      break;
+    case F_FBRD:
+      v = s.fbrd;
+      break;
+    case F_LCR_H:
+      v = s.lcr_h;
+      break;
+    case F_CR:
+      v = s.cr;
+      break;
+    case F_RIS:
+      v = s.ris;
+      break;
+    default:
+      break;
+  }
+  return (v >> (8 * byte)) & ((size >= 4) ? 0xffffffffu : ((1u << (8 * size)) - 1));
+}
+
+void sim_uart_write(int u, int field, int byte, int size, uintptr_t v, bool dma) {
+  TUart &s = uart[u];
+  switch (field) {
+    case F_DR:
+      if (s.enabled && s.tx.size() < FIFO_DEPTH) s.tx.push_back((uint8_t)v);
+      break;
+    case F_RSR:
+      // Any write clears it
+      s.rsr = 0;
+      break;
+    case F_LCR_H:
+      s.lcr_h = v;
+      break;
+    case F_CR:
+      s.cr = v;
+      break;
+    case F_ICR:
+      s.ris &= ~v;
+      break;
+    default:
+      break;
+  }
+}
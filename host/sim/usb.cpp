@@ -0,0 +1,123 @@
+/*
+  usb
+
+  The CDC interface of TinyUSB in the host simulation, the test is the USB host.
+  The device side FIFO holds 256 bytes towards the host, as the arduino-pico configuration does.
+  As in TinyUSB, a write that leaves a full packet in the FIFO sends it, and a flush sends
+  the rest as a short packet. The host takes every packet at once, the endpoint is never busy.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <CoreMutex.h>
+#include <tusb.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <sim/sim.h>
+
+#define TX_FIFO 256
+#define PACKET 64
+
+mutex_t __usb_mutex;
+
+static std::deque<uint8_t> cdc_rx, cdc_tx, host_rx;
+static std::vector<size_t> packets;
+static bool cdc_connected = true;
+static uint32_t flushes;
+
+// One packet from the FIFO to the host, under the lock
+static void send(size_t n) {
+  host_rx.insert(host_rx.end(), cdc_tx.begin(), cdc_tx.begin() + n);
+  cdc_tx.erase(cdc_tx.begin(), cdc_tx.begin() + n);
+  packets.push_back(n);
+}
+
+bool tud_disconnect(void) {
+  CoreMutex m(&__usb_mutex);
+  cdc_connected = false;
+  return true;
+}
+
+bool tud_cdc_connected(void) {
+  CoreMutex m(&__usb_mutex);
+  return cdc_connected;
+}
+
+uint32_t tud_cdc_available(void) {
+  CoreMutex m(&__usb_mutex);
+  return cdc_rx.size();
+}
+
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize) {
+  CoreMutex m(&__usb_mutex);
+  uint32_t n = 0;
+  for (; n < bufsize && !cdc_rx.empty(); n++) {
+    ((uint8_t *)buffer)[n] = cdc_rx.front();
+    cdc_rx.pop_front();
+  }
+  return n;
+}
+
+uint32_t tud_cdc_write(const void *buffer, uint32_t bufsize) {
+  CoreMutex m(&__usb_mutex);
+  uint32_t n = 0;
+  for (; n < bufsize && cdc_tx.size() < TX_FIFO; n++) cdc_tx.push_back(((const uint8_t *)buffer)[n]);
+  while (cdc_tx.size() >= PACKET) send(PACKET);
+  return n;
+}
+
+uint32_t tud_cdc_write_available(void) {
+  CoreMutex m(&__usb_mutex);
+  return TX_FIFO - cdc_tx.size();
+}
+
+uint32_t tud_cdc_write_flush(void) {
+  CoreMutex m(&__usb_mutex);
+  flushes++;
+  uint32_t n = cdc_tx.size();
+  while (!cdc_tx.empty()) send(std::min(cdc_tx.size(), (size_t)PACKET));
+  return n;
+}
+
+// The sketch defines its own
+__attribute__((weak)) void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding) {}
+
+//---- host side
+void sim_usb_connect(bool on) {
+  CoreMutex m(&__usb_mutex);
+  cdc_connected = on;
+}
+
+void sim_usb_write(const void *p, size_t len) {
+  CoreMutex m(&__usb_mutex);
+  cdc_rx.insert(cdc_rx.end(), (const uint8_t *)p, (const uint8_t *)p + len);
+}
+
+size_t sim_usb_read(void *p, size_t max) {
+  CoreMutex m(&__usb_mutex);
+  size_t n = 0;
+  for (; n < max && !host_rx.empty(); n++) {
+    ((uint8_t *)p)[n] = host_rx.front();
+    host_rx.pop_front();
+  }
+  return n;
+}
+
+std::vector<size_t> sim_usb_packets(bool clear) {
+  CoreMutex m(&__usb_mutex);
+  std::vector<size_t> v = packets;
+  if (clear) packets.clear();
+  return v;
+}
+
+uint32_t sim_usb_flushes(void) {
+  CoreMutex m(&__usb_mutex);
+  return flushes;
+}
+
+void sim_usb_line_coding(uint32_t baud, uint8_t databits, uint8_t parity, uint8_t stopbits) {
+  cdc_line_coding_t c = { baud, stopbits, parity, databits };
+  tud_cdc_line_coding_cb(0, &c);
+}
@@ -0,0 +1,386 @@
+/*
+  wifi
+
+  WiFi, TCP and UDP of the host simulation.
+
+  A connection is a socketpair, the sketch holds one end through a WiFiClient and the test
+  the other. availableForWrite() is what an 11680 byte send window leaves after the bytes
+  the test has not read yet, which is how a client that cannot keep up looks to the sketch.
+  Datagrams are queued in memory, per port on the way in and in one queue on the way out.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <LEAmDNS.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sim/sim.h>
+
+#define SEND_WINDOW 11680
+#define WRITE_TIMEOUT_MS 5000
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+static std::mutex wifi_mutex;
+
+//---- link
+static std::atomic<bool> link_up(true);
+static uint8_t ap_bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static int ap_channel = 6;
+static std::vector<uint8_t> join_bssid;
+static uint32_t joins;
+
+void sim_wifi_link(bool up) {
+  link_up.store(up);
+}
+
+void sim_wifi_ap(const uint8_t bssid[6], int channel) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  memcpy(ap_bssid, bssid, 6);
+  ap_channel = channel;
+}
+
+std::vector<uint8_t> sim_wifi_join_bssid(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  return join_bssid;
+}
+
+uint32_t sim_wifi_joins(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  return joins;
+}
+
+int WiFiClass::beginNoBlock(const char *ssid, const char *psk, const uint8_t *bssid) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  joins++;
+  if (bssid != nullptr) join_bssid.assign(bssid, bssid + 6);
+  else join_bssid.clear();
+  return 0;
+}
+
+int WiFiClass::disconnect(bool wifioff) {
+  return 0;
+}
+
+bool WiFiClass::connected(void) {
+  return link_up.load();
+}
+
+int32_t WiFiClass::RSSI(void) {
+  return link_up.load() ? -50 : 0;
+}
+
+uint8_t *WiFiClass::BSSID(uint8_t *bssid) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  memcpy(bssid, ap_bssid, 6);
+  return bssid;
+}
+
+int32_t WiFiClass::channel(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  return ap_channel;
+}
+
+//---- TCP
+struct WiFiClient::TConn {
+  int fd;
+  uint16_t rport;
+  int peer;       // the test's end, for what it has not read yet
+  ino_t peer_ino;
+  ~TConn() {
+    if (fd >= 0) close(fd);
+  }
+};
+
+// Bytes sent and not yet read by the test, 0 once it has closed its end
+static size_t peer_queued(int peer, ino_t ino) {
+  struct stat st;
+  int n = 0;
+  if (fstat(peer, &st) != 0 || st.st_ino != ino || ioctl(peer, FIONREAD, &n) != 0) return 0;
+  return n;
+}
+
+WiFiClient::WiFiClient(int fd, uint16_t remoteport) : conn(new TConn{ fd, remoteport, -1, 0 }) {}
+
+uint8_t WiFiClient::connected(void) {
+  if (!conn || conn->fd < 0) return 0;
+  uint8_t c;
+  ssize_t n = recv(conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) ? 1 : 0;
+}
+
+WiFiClient::operator bool(void) {
+  return connected() != 0;
+}
+
+int WiFiClient::available(void) {
+  int n = 0;
+  if (!conn || conn->fd < 0 || ioctl(conn->fd, FIONREAD, &n) != 0) return 0;
+  return n;
+}
+
+int WiFiClient::read(void) {
+  uint8_t c;
+  return (read(&c, 1) == 1) ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+  if (!conn || conn->fd < 0) return -1;
+  ssize_t n = recv(conn->fd, buf, size, MSG_DONTWAIT);
+  return (n > 0) ? (int)n : -1;
+}
+
+int WiFiClient::peek(void) {
+  uint8_t c;
+  if (!conn || conn->fd < 0) return -1;
+  return (recv(conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1) ? c : -1;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+// Blocks while the socket is full, as lwIP does, up to a timeout
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+  if (!conn || conn->fd < 0) return 0;
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = send(conn->fd, buf + done, size - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      done += n;
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+    struct pollfd p = { conn->fd, POLLOUT, 0 };
+    if (poll(&p, 1, WRITE_TIMEOUT_MS) <= 0) break;
+  }
+  return done;
+}
+
+int WiFiClient::availableForWrite(void) {
+  if (!conn || conn->fd < 0) return 0;
+  int n = SEND_WINDOW - (int)peer_queued(conn->peer, conn->peer_ino);
+  return (n > 0) ? n : 0;
+}
+
+void WiFiClient::stop(void) {
+  if (!conn || conn->fd < 0) return;
+  close(conn->fd);
+  conn->fd = -1;
+}
+
+uint16_t WiFiClient::remotePort(void) {
+  return conn ? conn->rport : 0;
+}
+
+typedef struct {
+  int fd, peer;
+  uint16_t rport;
+} TPending;
+
+static std::map< uint16_t, WiFiServer * > listeners;
+static std::map< uint16_t, std::deque< TPending > > pending;
+static uint16_t next_ephemeral = 49152;
+static uint16_t next_rport = 50000;
+
+WiFiServer::WiFiServer(uint16_t p) : port(p), listening(false) {}
+
+WiFiServer::~WiFiServer() {
+  end();
+}
+
+// A port another server has taken is not listened on, as lwIP refuses the bind
+void WiFiServer::begin(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  if (listening) return;
+  if (port == 0) {
+    while (listeners.count(next_ephemeral)) next_ephemeral++;
+    port = next_ephemeral++;
+  }
+  if (listeners.count(port)) return;
+  listeners[port] = this;
+  listening = true;
+}
+
+void WiFiServer::end(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  if (!listening) return;
+  listening = false;
+  listeners.erase(port);
+  for (TPending &c : pending[port]) ::close(c.fd);
+  pending.erase(port);
+}
+
+WiFiClient WiFiServer::accept(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  if (!listening || pending[port].empty()) return WiFiClient();
+  TPending c = pending[port].front();
+  pending[port].pop_front();
+  WiFiClient w(c.fd, c.rport);
+  w.conn->peer = c.peer;
+  struct stat st;
+  if (fstat(c.peer, &st) == 0) w.conn->peer_ino = st.st_ino;
+  return w;
+}
+
+static void big_buffers(int fd) {
+  int size = 4 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+int sim_connect(uint16_t port) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  if (!listeners.count(port)) return -1;
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return -1;
+  big_buffers(sv[0]);
+  big_buffers(sv[1]);
+  pending[port].push_back({ sv[0], sv[1], next_rport++ });
+  return sv[1];
+}
+
+bool sim_listening(uint16_t port) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  return listeners.count(port) != 0;
+}
+
+size_t sim_fd_write(int fd, const void *p, size_t len, int timeout_ms) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = send(fd, (const uint8_t *)p + done, len - done, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      done += n;
+      continue;
+    }
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) break;
+    struct pollfd q = { fd, POLLOUT, 0 };
+    if (poll(&q, 1, timeout_ms) <= 0) break;
+  }
+  return done;
+}
+
+size_t sim_fd_read(int fd, void *p, size_t len, int timeout_ms) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = recv(fd, (uint8_t *)p + done, len - done, MSG_DONTWAIT);
+    if (n > 0) {
+      done += n;
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) break;
+    struct pollfd q = { fd, POLLIN, 0 };
+    if (poll(&q, 1, timeout_ms) <= 0) break;
+  }
+  return done;
+}
+
+std::string sim_fd_read_all(int fd, int idle_ms) {
+  std::string s;
+  uint8_t buf[4096];
+  for (;;) {
+    ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      s.append((const char *)buf, n);
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) break;
+    struct pollfd q = { fd, POLLIN, 0 };
+    if (poll(&q, 1, idle_ms) <= 0) break;
+  }
+  return s;
+}
+
+//---- UDP
+typedef struct {
+  IPAddress ip;
+  uint16_t port;
+  std::vector< uint8_t > data;
+} TInbound;
+
+static std::map< uint16_t, std::deque< TInbound > > udp_in;
+static std::deque< TSimDatagram > udp_out;
+
+uint8_t WiFiUDP::begin(uint16_t p) {
+  port = p;
+  return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress group, uint16_t p) {
+  return begin(p);
+}
+
+void WiFiUDP::stop(void) {
+  port = 0;
+  rxbuf.clear();
+  rxpos = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t p) {
+  dip = ip;
+  dport = p;
+  txbuf.clear();
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t size) {
+  txbuf.insert(txbuf.end(), buf, buf + size);
+  return size;
+}
+
+int WiFiUDP::endPacket(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  udp_out.push_back({ dip, dport, port, txbuf });
+  txbuf.clear();
+  return 1;
+}
+
+int WiFiUDP::parsePacket(void) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  rxbuf.clear();
+  rxpos = 0;
+  if (port == 0 || udp_in[port].empty()) return 0;
+  TInbound &d = udp_in[port].front();
+  rxbuf = d.data;
+  rip = d.ip;
+  rport = d.port;
+  udp_in[port].pop_front();
+  return rxbuf.size();
+}
+
+int WiFiUDP::read(void) {
+  return (rxpos < rxbuf.size()) ? rxbuf[rxpos++] : -1;
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t size) {
+  size_t n = min(size, rxbuf.size() - rxpos);
+  memcpy(buf, rxbuf.data() + rxpos, n);
+  rxpos += n;
+  return n;
+}
+
+void sim_udp_send(uint16_t port, IPAddress from, uint16_t fromport, const void *p, size_t len) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  udp_in[port].push_back({ from, fromport, std::vector< uint8_t >((const uint8_t *)p, (const uint8_t *)p + len) });
+}
+
+bool sim_udp_recv(TSimDatagram &d) {
+  std::lock_guard<std::mutex> l(wifi_mutex);
+  if (udp_out.empty()) return false;
+  d = udp_out.front();
+  udp_out.pop_front();
+  return true;
+}
@@ -0,0 +1,125 @@
+/*
+  backlog_test
+
+  CBacklog with a size that is not a power of two: appends that wrap and ones longer than
+  the ring, oldest first dropping and its count, a reader overtaken by the writer, and
+  where each replay mode starts, the time marks included once they have wrapped.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string>
+#include "backlog.hpp"
+#include "check.h"
+
+static const uint32_t SIZE = 1000;
+
+static std::string pattern(uint32_t from, size_t n) {
+  std::string s(n, '\0');
+  for (size_t i = 0; i < n; i++) s[i] = (char)((from + i) * 7 + (from + i) / 253);
+  return s;
+}
+
+// From pos to the head, pos ends at the head
+static std::string read_from(CBacklog &b, uint32_t &pos) {
+  TRingSpan s1, s2;
+  size_t n = b.peek_at(pos, s1, s2);
+  CHECK_EQ(s1.len + s2.len, n);
+  std::string r((const char *)s1.ptr, s1.len);
+  r.append((const char *)s2.ptr, s2.len);
+  pos += n;
+  return r;
+}
+
+int main() {
+  static uint8_t buf[SIZE];
+  CBacklog b;
+
+  // Off without a buffer
+  b.begin(NULL, SIZE);
+  CHECK(!b.enabled());
+  b.append((const uint8_t *)"abc", 3, 0);
+  CHECK_EQ(b.held(), 0);
+
+  b.begin(buf, SIZE, 100);
+  CHECK(b.enabled());
+  CHECK_EQ(b.size(), SIZE);
+
+  // Appends of every size up to a wrap, then the ring holds the newest SIZE bytes
+  uint32_t in = 0, now = 0;
+  for (uint32_t n = 1; in < 5 * SIZE; n = n * 3 % 317 + 1, now += 10) {
+    std::string d = pattern(in, n);
+    b.append((const uint8_t *)d.data(), n, now);
+    in += n;
+    CHECK_EQ(b.head_pos(), in);
+    CHECK_EQ(b.held(), std::min(in, SIZE));
+    CHECK_EQ(b.lost(), in - b.held());
+    uint32_t pos = b.start_all();
+    CHECK(read_from(b, pos) == pattern(b.tail_pos(), b.held()));
+  }
+
+  // One append longer than the ring keeps its end
+  std::string big = pattern(in, 2500);
+  uint64_t lost = b.lost();
+  b.append((const uint8_t *)big.data(), big.size(), now);
+  in += big.size();
+  CHECK_EQ(b.held(), SIZE);
+  CHECK_EQ(b.lost(), lost + big.size());
+  uint32_t pos = b.start_all();
+  CHECK(read_from(b, pos) == pattern(in - SIZE, SIZE));
+
+  // A reader the writer has lapped starts again at the oldest byte held
+  uint32_t slow = b.head_pos() - 100;
+  std::string more = pattern(in, 1500);
+  b.append((const uint8_t *)more.data(), more.size(), now);
+  in += more.size();
+  CHECK(read_from(b, slow) == pattern(in - SIZE, SIZE));
+  CHECK_EQ(slow, in);
+  // and one at the head has nothing to read
+  CHECK(read_from(b, slow).empty());
+
+  // The last n bytes, all of them if fewer are held
+  CHECK_EQ(b.start_last(10), in - 10);
+  CHECK_EQ(b.start_last(SIZE), b.tail_pos());
+  CHECK_EQ(b.start_last(5 * SIZE), b.tail_pos());
+
+  // Since a time: marks every 100ms, a replay starts at the mark before the time asked for
+  b.begin(buf, SIZE, 100);
+  in = 0;
+  for (now = 0; now < 5000; now += 10) {
+    std::string d = pattern(in, 1);
+    b.append((const uint8_t *)d.data(), 1, now);
+    in++;
+  }
+  // 500 bytes, one every 10ms, all still held; far more marks than MARKS
+  CHECK_EQ(b.held(), 500);
+  CHECK_EQ(b.start_since(4500), 450);
+  CHECK_EQ(b.start_since(4550), 450);
+  CHECK_EQ(b.start_since(4990), 490);
+  CHECK_EQ(b.start_since(9999), 490);
+  // Older than the oldest mark kept, or than the data, gives everything held
+  CHECK_EQ(b.start_since(0), b.tail_pos());
+  // Marks in data since overwritten do not count
+  for (; now < 8000; now += 10) {
+    std::string d = pattern(in, 3);
+    b.append((const uint8_t *)d.data(), 3, now);
+    in += 3;
+  }
+  CHECK_EQ(b.held(), SIZE);
+  CHECK_EQ(b.tail_pos(), 400);
+  CHECK_EQ(b.start_since(3000), b.tail_pos());
+  CHECK_EQ(b.start_since(5000), 500);
+  CHECK_EQ(b.start_since(7900), in - 30);
+
+  // Cleared once replayed, what comes after is held again
+  b.clear();
+  CHECK_EQ(b.held(), 0);
+  pos = b.start_all();
+  CHECK(read_from(b, pos).empty());
+  b.append((const uint8_t *)"xyz", 3, now);
+  pos = b.start_all();
+  CHECK(read_from(b, pos) == "xyz");
+  printf("ok\n");
+  return 0;
+}
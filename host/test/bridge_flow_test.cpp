@@ -0,0 +1,68 @@
+/*
+  bridge_flow_test
+
+  Port 0 with RTS/CTS, end to end: while the device holds CTS off the bridge stops reading
+  from the client, so that the client's writes stall instead of data being dropped, and
+  once CTS is on again everything written reaches the line in order.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static uint8_t pattern(uint32_t i) {
+  return 0x20 + (i * 7 + i / 251) % 0x5f;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.flowctrl = 1;
+      n.baudrate = 921600;
+    });
+  sim_gpio_drive(6, true);
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+  // A socket of an ordinary size, the bridge's rings are what is tested
+  int size = 32 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+  // Write until the writes stall
+  uint8_t b[4096];
+  uint32_t w = 0;
+  while (true) {
+    CHECK(w < 4 << 20);
+    for (size_t i = 0; i < sizeof(b); i++) b[i] = pattern(w + i);
+    size_t n = sim_fd_write(fd, b, sizeof(b), 300);
+    w += n;
+    if (n < sizeof(b)) break;
+  }
+  CHECK(sim_line_sent(4) <= 1);
+  printf("stalled after %u bytes\n", w);
+
+  // CTS on, all of it goes out
+  sim_gpio_drive(6, false);
+  std::string s;
+  for (int i = 0; i < 5000 && s.size() < w; i++) {
+    char r[4096];
+    size_t n = sim_line_recv(4, r, sizeof(r));
+    s.append(r, n);
+    if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK_EQ(s.size(), w);
+  for (uint32_t i = 0; i < w; i++) CHECK_EQ((uint8_t)s[i], pattern(i));
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
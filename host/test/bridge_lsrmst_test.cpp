@@ -0,0 +1,66 @@
+/*
+  bridge_lsrmst_test
+
+  Port 0 with encprotocol 2: baudrate inserts from the client change the UART, also when
+  the sequence is split over TCP writes, and an escaped escape character reaches the line.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static std::string line_out(size_t want) {
+  std::string s;
+  for (int i = 0; i < 2000 && s.size() < want; i++) {
+    char b[256];
+    size_t n = sim_line_recv(4, b, sizeof(b));
+    s.append(b, n);
+    if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return s;
+}
+
+static bool baud_near(uint32_t want) {
+  for (int i = 0; i < 2000; i++) {
+    uint32_t b = sim_sketch_uart(0)->getActualBaud();
+    if (b > want * 99 / 100 && b < want * 101 / 100) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.encprotocol = 2;
+    });
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+
+  // 'a' 0x00 is a literal 'a', then 57600 (LSB first)
+  const uint8_t a[] = { 'x', 'a', 0x00, 'y', 'a', 16, 0x00, 0xe1, 0x00, 0x00, 'z' };
+  sim_fd_write(fd, a, sizeof(a));
+  CHECK(line_out(4) == "xayz");
+  CHECK(baud_near(57600));
+
+  // 230400 split in the middle of the baudrate
+  const uint8_t b1[] = { 'q', 'a', 16, 0x00 }, b2[] = { 0x84, 0x03, 0x00, 'r' };
+  sim_fd_write(fd, b1, sizeof(b1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  sim_fd_write(fd, b2, sizeof(b2));
+  CHECK(baud_near(230400));
+  CHECK(line_out(2) == "qr");
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
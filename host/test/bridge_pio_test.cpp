@@ -0,0 +1,88 @@
+/*
+  bridge_pio_test
+
+  Two PIO ports with DMA channels for only one of them: the first bridges its line like any
+  other port, the second is reported off on the console and never listens.
+  The first speaks RFC 2217, and a client asking it for 7E1 is answered with 8N1, which is
+  also what `i` shows.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <hardware/dma.h>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "rfc2217.hpp"
+#include "check.h"
+
+static std::string subneg(uint8_t cmd, uint8_t v) {
+  const char b[] = { (char)CRfc2217::IAC, (char)CRfc2217::SB, (char)CRfc2217::OPT_COM_PORT, (char)cmd, (char)v, (char)CRfc2217::IAC, (char)CRfc2217::SE };
+  return std::string(b, sizeof(b));
+}
+
+static std::string expect(int fd, const std::string &want) {
+  std::string s;
+  for (int i = 0; i < 100 && s.find(want) == std::string::npos; i++) {
+    char b[256];
+    s.append(b, sim_fd_read(fd, b, sizeof(b), 20));
+  }
+  CHECK(s.find(want) != std::string::npos);
+  return s;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.pio[0] = { 1, 8000, 10, 11, 3, 115200 };
+      n.pio[1] = { 1, 8001, 12, 13, 0, 115200 };
+    });
+  // Leave channels for UART1 and one PIO UART
+#if PICO_RP2040
+  const int per_uart = 3;
+#else
+  const int per_uart = 2;
+#endif
+  for (int i = 0; i < NUM_DMA_CHANNELS - 2 * per_uart; i++) CHECK(dma_claim_unused_channel(false) >= 0);
+  sim_line_loopback(10, 11);
+  sim_sketch_start();
+  CHECK(sim_sketch_enabled(0));
+  CHECK(sim_sketch_enabled(2));
+  CHECK(!sim_sketch_enabled(3));
+  std::string out = sim_serial_output();
+  CHECK(out.find("Port 3 off, its PIO UART could not be started") != std::string::npos);
+
+  int fd = sim_connect(8000);
+  CHECK(fd >= 0);
+  sim_fd_write(fd, "echo", 4);
+  char b[4];
+  CHECK_EQ(sim_fd_read(fd, b, 4), 4);
+  CHECK(std::string(b, 4) == "echo");
+
+  std::string m = subneg(CRfc2217::SET_DATASIZE, 7) + subneg(CRfc2217::SET_PARITY, 3);
+  sim_fd_write(fd, m.data(), m.size());
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_DATASIZE, 8) + subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_PARITY, 1));
+  out = sim_serial_output();
+  sim_serial_type("i");
+  size_t p2;
+  for (int i = 0; i < 100 && ((p2 = out.find("Port 2 on 8000")) == std::string::npos || out.find("actual UART", p2) == std::string::npos); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    out += sim_serial_output();
+  }
+  CHECK(p2 != std::string::npos);
+  CHECK(out.find("actual UART is 115", p2) != std::string::npos);
+  CHECK(out.find("bps 8N1\n", p2) != std::string::npos);
+  CHECK(out.find("Update UART") == std::string::npos);
+  close(fd);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  CHECK(!sim_listening(8001));
+
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+  bridge_ports_test
+
+  The TCP ports: the report on port+1 lists the ports that are on, saved settings where
+  ports clash keep the later port off, and the settings menu keeps port 0 low enough for
+  the two ports after it and turns off a port that clashes.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static std::string out;
+
+// Waits for the prompt, and for the menu to be through flushing the input, then answers it
+static void answer(const char *prompt, const char *text) {
+  size_t at = out.size();
+  for (int i = 0; i < 2000 && out.find(prompt, at) == std::string::npos; i++) {
+    out += sim_serial_output();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(out.find(prompt, at) != std::string::npos);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  sim_serial_type(text);
+  sim_serial_type("\r");
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.port = 7000;
+      n.uart2 = 1;
+      n.port2 = 7001;  // the report's
+      n.tx2 = 0;
+      n.rx2 = 1;
+      n.pio[0] = { 1, 7005, 10, 11, 0, 115200 };
+      n.pio[1] = { 1, 7005, 12, 13, 0, 115200 };  // the first PIO port's
+    });
+  sim_sketch_start();
+  CHECK(sim_sketch_enabled(0));
+  CHECK(!sim_sketch_enabled(1));
+  CHECK(sim_sketch_enabled(2));
+  CHECK(!sim_sketch_enabled(3));
+
+  int fd = sim_connect(7001);
+  CHECK(fd >= 0);
+  std::string r = sim_fd_read_all(fd, 500);
+  close(fd);
+  CHECK(r.find("Port 0 on 7000") != std::string::npos);
+  CHECK(r.find("Port 2 on 7005") != std::string::npos);
+  CHECK(r.find("Port 1") == std::string::npos);
+  CHECK(r.find("Port 3") == std::string::npos);
+  CHECK(sim_listening(7002));
+
+  // The menu, left without saving
+  sim_serial_output();
+  sim_serial_type("s");
+  answer("WiFi mode", "1");
+  answer("hostname", "h");
+  answer("ssid", "s");
+  answer("psk", "12345678");
+  answer("ip", "");
+  answer("mask", "");
+  answer("port(", "65535");
+  answer("transport", "0");
+  answer("serial protocol", "0");
+  answer("client allowed", "0");
+  answer("slow client", "0");
+  answer("backlog", "0");
+  answer("packing length", "0");
+  answer("packing idle", "0");
+  answer("packing delimiter", "0");
+  answer("serial baudrate", "115200");
+  answer("serial config", "8N1");
+  answer("flow control", "0");
+  answer("second UART (", "1");
+  answer("second UART port", "65534");
+  answer("PIO UART 1 (", "1");
+  answer("PIO UART 1 port", "7100");
+  answer("PIO UART 1 TX", "10");
+  answer("PIO UART 1 RX", "11");
+  answer("PIO UART 1 serial protocol", "0");
+  answer("PIO UART 1 baudrate", "115200");
+  answer("PIO UART 2 (", "1");
+  answer("PIO UART 2 port", "7100");
+  answer("Are you sure", "n");
+  CHECK(out.find("port 65534 is taken by port 65533 and the two after it, second UART off") != std::string::npos);
+  CHECK(out.find("port 7100 is taken, PIO UART off") != std::string::npos);
+  CHECK(out.find(" port:65533\n") != std::string::npos);
+  CHECK(out.find(" second UART:0\n") != std::string::npos);
+  CHECK(out.find("PIO UART 1 port:7100") != std::string::npos);
+  CHECK(out.find("PIO UART 2 port:") == std::string::npos);
+
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+  bridge_pusr_test
+
+  Port 0 with encprotocol 1: a PUSR packet from the client changes the UART, one split over
+  two TCP writes as well, and a packet head the client leaves standing reaches the UART
+  as data once the client has gone quiet.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "pusr.hpp"
+#include "check.h"
+
+static std::string line_out(size_t want, int timeout_ms = 2000) {
+  std::string s;
+  for (int i = 0; i < timeout_ms && s.size() < want; i++) {
+    char b[256];
+    size_t n = sim_line_recv(4, b, sizeof(b));
+    s.append(b, n);
+    if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return s;
+}
+
+static bool baud_near(uint32_t want) {
+  for (int i = 0; i < 2000; i++) {
+    uint32_t b = sim_sketch_uart(0)->getActualBaud();
+    if (b > want * 99 / 100 && b < want * 101 / 100) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.encprotocol = 1;
+    });
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+
+  // Data, a packet for 57600 8N1, data
+  const uint8_t a[] = { 'x', 'y', 0x55, 0xaa, 0x55, 0x00, 0xe1, 0x00, 0x03, 0xe4, 'z' };
+  CHECK_EQ(sim_fd_write(fd, a, sizeof(a)), sizeof(a));
+  CHECK(line_out(3) == "xyz");
+  CHECK(baud_near(57600));
+
+  // A packet for 115200 in two writes, well within HOLD_US of each other
+  const uint8_t b1[] = { 'q', 0x55, 0xaa, 0x55 }, b2[] = { 0x01, 0xc2, 0x00, 0x03, 0xc6 };
+  sim_fd_write(fd, b1, sizeof(b1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  sim_fd_write(fd, b2, sizeof(b2));
+  CHECK(baud_near(115200));
+  CHECK(line_out(1) == "q");
+
+  // A head nothing follows goes out as it is
+  const uint8_t c[] = { 'e', 'n', 'd', 0x55, 0xaa };
+  sim_fd_write(fd, c, sizeof(c));
+  auto t0 = std::chrono::steady_clock::now();
+  std::string s = line_out(5);
+  CHECK(s == std::string("end\x55\xaa"));
+  CHECK(std::chrono::steady_clock::now() - t0 >= std::chrono::microseconds(CPUSRDecoder::HOLD_US));
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
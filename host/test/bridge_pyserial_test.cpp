@@ -0,0 +1,93 @@
+/*
+  bridge_pyserial_test
+
+  Port 0 with encprotocol 3 and its line looped back, driven by pyserial's RFC 2217 client
+  in bridge_pyserial_test.py. The sim's sockets are not TCP, so the test listens on the
+  loopback interface and relays between the client and the sketch until the script ends.
+  Skipped when python3 or pyserial is not installed.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <string>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+#define SKIP 77
+
+// Copies what is there from one end to the other, false once from has closed
+static bool relay(int from, int to) {
+  char b[4096];
+  ssize_t n = recv(from, b, sizeof(b), MSG_DONTWAIT);
+  if (n == 0) return false;
+  if (n > 0) CHECK_EQ(sim_fd_write(to, b, n, 1000), (size_t)n);
+  return true;
+}
+
+int main() {
+  if (system("python3 -c 'import serial' 2>/dev/null") != 0) {
+    printf("skipped, no pyserial\n");
+    return SKIP;
+  }
+  std::string script = __FILE__;
+  script.replace(script.rfind('.'), std::string::npos, ".py");
+
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.encprotocol = 3;
+      n.baudrate = 115200;
+    });
+  sim_line_loopback(4, 5);
+  sim_sketch_start();
+
+  int ls = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK(ls >= 0);
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t alen = sizeof(a);
+  CHECK_EQ(bind(ls, (struct sockaddr *)&a, sizeof(a)), 0);
+  CHECK_EQ(listen(ls, 1), 0);
+  CHECK_EQ(getsockname(ls, (struct sockaddr *)&a, &alen), 0);
+
+  pid_t pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) {
+    std::string port = std::to_string(ntohs(a.sin_port));
+    execlp("python3", "python3", script.c_str(), port.c_str(), (char *)NULL);
+    _exit(127);
+  }
+
+  struct pollfd q = { ls, POLLIN, 0 };
+  CHECK_EQ(poll(&q, 1, 10000), 1);
+  int c = accept(ls, NULL, NULL);
+  CHECK(c >= 0);
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+
+  int status;
+  for (bool open = true; waitpid(pid, &status, WNOHANG) == 0;) {
+    struct pollfd p[2] = { { c, (short)(open ? POLLIN : 0), 0 }, { fd, POLLIN, 0 } };
+    poll(p, 2, 20);
+    if (open && (p[0].revents & (POLLIN | POLLHUP))) open = relay(c, fd);
+    if (p[1].revents & POLLIN) relay(fd, c);
+  }
+  close(c);
+  close(fd);
+  close(ls);
+  CHECK(WIFEXITED(status));
+  CHECK_EQ(WEXITSTATUS(status), 0);
+
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+#
+# bridge_pyserial_test.py
+#
+# The client side of bridge_pyserial_test: pyserial's rfc2217:// driver against port 0,
+# whose line loops back. pyserial checks every answer against what it asked for, so a
+# setting the bridge applies must come back unchanged and one it cannot must not.
+#
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: (C) 2026 mukyokyo
+
+import sys
+import time
+import serial
+
+
+def loop(s, data):
+    s.write(data)
+    got = s.read(len(data))
+    assert got == data, (data, got)
+
+
+def main(port):
+    s = serial.serial_for_url("rfc2217://127.0.0.1:%d" % port, baudrate=57600, timeout=2)
+    loop(s, b"hello")
+
+    # Port settings take effect while open
+    s.baudrate = 9600
+    s.bytesize = serial.SEVENBITS
+    s.parity = serial.PARITY_EVEN
+    loop(s, b"7E1")
+    s.baudrate = 115200
+    s.bytesize = serial.EIGHTBITS
+    s.parity = serial.PARITY_NONE
+    loop(s, b"8N1")
+
+    # DTR is not wired and stays on, so turning it off is refused
+    try:
+        s.dtr = False
+        raise AssertionError("DTR off was accepted")
+    except ValueError:
+        pass
+
+    assert s.cts and s.dsr and s.cd
+
+    # What waits to go out is dropped, 1500 bytes take 130ms at 115200bps
+    data = bytes(0x20 + i % 0x5f for i in range(1500))
+    s.write(data)
+    s.reset_output_buffer()
+    time.sleep(0.3)
+    got = s.read(s.in_waiting)
+    assert len(got) < len(data), len(got)
+    assert got == data[:len(got)]
+
+    s.reset_input_buffer()
+    loop(s, b"ok")
+    s.close()
+    print("%d of %d bytes left before the purge" % (len(got), len(data)))
+
+
+if __name__ == "__main__":
+    main(int(sys.argv[1]))
@@ -0,0 +1,102 @@
+/*
+  bridge_raw_test
+
+  Port 0 with the raw TCP transport and its line looped back: what the client sends comes
+  back to it in order, across core 1 writing received chains to the UART and the RX ring
+  being sent by reference, and once it is all acknowledged no pbuf is left and no byte lwIP
+  held was overwritten.
+  With RTS/CTS, data the peer does not acknowledge backs up into the RX ring until RTS goes off,
+  which `i` reports from what core 1 published, and on again once it is acknowledged.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static const size_t TOTAL = 64 * 1024;
+
+static uint8_t pattern(uint32_t i) {
+  return 0x20 + (i * 11 + i / 97) % 0x5f;
+}
+
+// `i` shows RTS as on (asserted) or off, within a few reports as core 1 publishes it after the pin
+static bool rts(bool on) {
+  std::string want = on ? "RTS is asserted" : "RTS is deasserted";
+  for (int k = 0; k < 20; k++) {
+    std::string out;
+    sim_serial_output();
+    sim_serial_type("i");
+    for (int i = 0; i < 1000 && out.find("RTS is") == std::string::npos; i++) {
+      out += sim_serial_output();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (out.find(want) != std::string::npos) return true;
+  }
+  return false;
+}
+
+int main() {
+  sim_sketch_config([](TNetInfo &n) {
+    n.baudrate = 921600;
+    n.transport = 2;
+    n.flowctrl = 1;
+  });
+  sim_line_loopback(4, 5);
+  sim_gpio_drive(6, false);
+  sim_sketch_start();
+  int c = -1;
+  for (int i = 0; i < 1000 && (c = sim_tcp_connect(sim_sketch_port(0))) < 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CHECK(c >= 0);
+
+  std::string d;
+  for (size_t i = 0; i < TOTAL; i++) d.push_back(pattern(i));
+  size_t sent = 0, got = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int round = 0; got < TOTAL; round++) {
+    CHECK(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(30));
+    sim_tcp_poll();
+    sent += sim_tcp_send(c, d.data() + sent, TOTAL - sent);
+    uint8_t r[2048];
+    size_t n = sim_tcp_recv(c, r, sizeof(r));
+    for (size_t i = 0; i < n; i++) CHECK_EQ(r[i], pattern(got + i));
+    got += n;
+    // A peer with delayed acknowledgements
+    if (round % 4 == 3) sim_tcp_ack(c, sim_tcp_unacked(c));
+    if (n == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  sim_tcp_ack(c, sim_tcp_unacked(c));
+  CHECK(sim_tcp_open(c));
+  CHECK_EQ(sim_tcp_ref_errors(), 0);
+
+  // The chains go back to core 0 to be freed on its next rounds
+  for (int i = 0; i < 1000 && sim_tcp_pbufs() > 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CHECK_EQ(sim_tcp_pbufs(), 0);
+
+  // Unacknowledged data stays in uart2net, 8192 bytes, and 1800 more fill the 2048 byte
+  // RX ring past its high mark
+  CHECK(rts(true));
+  CHECK(!sim_gpio_level(7));
+  sim_line_send(5, d.data(), 8192 + 1800);
+  for (int i = 0; i < 1000 && !sim_gpio_level(7); i++) {
+    sim_tcp_poll();
+    uint8_t r[2048];
+    sim_tcp_recv(c, r, sizeof(r));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(sim_gpio_level(7));
+  CHECK(rts(false));
+  sim_tcp_ack(c, sim_tcp_unacked(c));
+  for (int i = 0; i < 1000 && sim_gpio_level(7); i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CHECK(rts(true));
+
+  sim_tcp_close(c);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
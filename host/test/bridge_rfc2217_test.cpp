@@ -0,0 +1,97 @@
+/*
+  bridge_rfc2217_test
+
+  Port 0 with encprotocol 3 and RTS/CTS: the client learns the modem state from the CTS pin
+  when it agrees to COM-PORT-OPTION and whenever the pin changes, and hears of a framing
+  error ahead of the character it came with. DTR and RTS are answered with what the lines
+  do, not with what was asked, and purging the transmit buffer drops what had not yet left.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "rfc2217.hpp"
+#include "check.h"
+
+static const uint8_t IAC = CRfc2217::IAC, SB = CRfc2217::SB, SE = CRfc2217::SE, COM = CRfc2217::OPT_COM_PORT;
+
+static std::string subneg(uint8_t cmd, uint8_t v) {
+  const char b[] = { (char)IAC, (char)SB, (char)COM, (char)cmd, (char)v, (char)IAC, (char)SE };
+  return std::string(b, sizeof(b));
+}
+
+// Reads until want has come, returns all that came
+static std::string expect(int fd, const std::string &want) {
+  std::string s;
+  for (int i = 0; i < 100 && s.find(want) == std::string::npos; i++) {
+    char b[256];
+    s.append(b, sim_fd_read(fd, b, sizeof(b), 20));
+  }
+  CHECK(s.find(want) != std::string::npos);
+  return s;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.encprotocol = 3;
+      n.flowctrl = 1;
+    });
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+
+  // CTS low is on, CD and DSR are not wired and read as on
+  sim_gpio_drive(6, false);
+  const uint8_t will[] = { IAC, CRfc2217::WILL, COM };
+  sim_fd_write(fd, will, sizeof(will));
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, 0xb0));
+
+  // The device drops CTS, then raises it again
+  sim_gpio_drive(6, true);
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, 0xa1));
+  sim_gpio_drive(6, false);
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, 0xb1));
+
+  // Line errors once the client asks for them
+  std::string m = subneg(CRfc2217::SET_LINESTATE_MASK, 0x1e);
+  sim_fd_write(fd, m.data(), m.size());
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_LINESTATE_MASK, 0x1e));
+  sim_line_send(5, "ok", 2);
+  expect(fd, "ok");
+  sim_line_send(5, "x", 1, CUartBase::LINE_FRAMING);
+  std::string s = expect(fd, "x");
+  CHECK(s == subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_LINESTATE, CRfc2217::LINE_FRAMING) + "x");
+
+  // DTR is not wired and stays on, RTS is flow control's and on while the RX ring has room
+  m = subneg(CRfc2217::SET_CONTROL, 9) + subneg(CRfc2217::SET_CONTROL, 12);
+  sim_fd_write(fd, m.data(), m.size());
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_CONTROL, 8) + subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_CONTROL, 11));
+
+  // 1500 bytes that take 130ms on the line, purged behind the first few
+  std::string d(1500, ' ');
+  for (size_t i = 0; i < d.size(); i++) d[i] = 'A' + i % 26;
+  m = d + subneg(CRfc2217::PURGE_DATA, 2) + "end";
+  sim_fd_write(fd, m.data(), m.size());
+  expect(fd, subneg(CRfc2217::SERVER_OFFSET + CRfc2217::PURGE_DATA, 2));
+  std::string line;
+  for (int i = 0; i < 200 && line.find("end") == std::string::npos; i++) {
+    char b[2048];
+    line.append(b, sim_line_recv(4, b, sizeof(b)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  printf("%zu of %zu bytes reached the line before the purge\n", line.size() - 3, d.size());
+  CHECK(line.size() >= 3 && line.size() < d.size() / 2);
+  CHECK(line == d.substr(0, line.size() - 3) + "end");
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*
+  bridge_sched_test
+
+  Core 1 waiting for events: while no port has traffic it sleeps most of the time and
+  wakes about as often as its tick, and a character arriving on a quiet line still reaches
+  the client within a few ticks, since the line wakes core 1 rather than the next poll.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+// _CORE1_TICK_US of the sketch
+static const unsigned TICK_US = 100;
+
+struct TReport {
+  double asleep;
+  unsigned wakeups;
+  unsigned samples, p99;
+};
+
+static TReport report(void) {
+  int fd = sim_connect(sim_sketch_port(0) + 1);
+  CHECK(fd >= 0);
+  std::string s = sim_fd_read_all(fd);
+  close(fd);
+  TReport r = {};
+  CHECK_EQ(sscanf(s.c_str(), "Core 1 asleep %lf%%, %u wakeups/s", &r.asleep, &r.wakeups), 2);
+  size_t p = s.find("latency, ");
+  CHECK(p != std::string::npos);
+  CHECK_EQ(sscanf(s.c_str() + p, "latency, %u samples, p50 <%*uus, p99 <%uus", &r.samples, &r.p99), 2);
+  printf("%s", s.c_str());
+  return r;
+}
+
+int main() {
+  sim_sketch_config([](TNetInfo &n) {
+    n.baudrate = 115200;
+  });
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+
+  // Idle: a whole second of rates, with nothing on the line or the network
+  // The share the report gives is taken on the wall clock, which a loaded host stretches
+  // while core 1 waits for a CPU between its wakeups, so the CPU time of its thread is what
+  // says it slept: a loaded host only lowers that.
+  uint64_t cpu0 = sim_sketch_cpu_us(1);
+  auto t0 = std::chrono::steady_clock::now();
+  usleep(2200 * 1000);
+  double busy1 = (sim_sketch_cpu_us(1) - cpu0) / std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+  printf("core 1 busy %.1f%% of the wall clock\n", busy1 * 100);
+  TReport idle = report();
+  CHECK(busy1 <= 0.2);
+  CHECK(idle.asleep > 0);
+  CHECK(idle.wakeups > 0 && idle.wakeups <= 1000000 / TICK_US + 1000);
+
+  // One character at a time on a quiet line, each waits for the one before to arrive
+  std::vector<double> lat;
+  for (int i = 0; i < 50; i++) {
+    uint8_t c = 'a' + i % 26, r = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    sim_line_send(5, &c, 1);
+    CHECK_EQ(sim_fd_read(fd, &r, 1, 1000), 1);
+    lat.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+    CHECK_EQ(r, c);
+    usleep(3000);
+  }
+  std::sort(lat.begin(), lat.end());
+  printf("line to client, p50 %.0fus, worst %.0fus\n", lat[lat.size() / 2], lat.back());
+  CHECK(lat[lat.size() / 2] < 20 * TICK_US);
+  TReport busy = report();
+  CHECK(busy.samples >= 50);
+  CHECK(busy.p99 <= 4096);
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
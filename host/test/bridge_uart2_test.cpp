@@ -0,0 +1,71 @@
+/*
+  bridge_uart2_test
+
+  Port 0 on UART1 and port 1 on UART0 saturated at once, each line looped back to itself:
+  every byte a client sends comes back to it and to no one else, and the ports finish
+  close together, so that neither is starved while the other is busy.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static const size_t TOTAL = 128 * 1024;
+
+static uint8_t pattern(int port, uint32_t i) {
+  return 0x20 + (i * (port ? 5 : 3) + port) % 0x5f;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.baudrate = 921600;
+      n.uart2 = 1;
+      n.port2 = 8000;
+      n.tx2 = 0;
+      n.rx2 = 1;
+      n.baudrate2 = 921600;
+    });
+  sim_line_loopback(4, 5);
+  sim_line_loopback(0, 1);
+  sim_sketch_start();
+  CHECK(sim_sketch_enabled(1));
+  int fd[2] = { sim_connect(sim_sketch_port(0)), sim_connect(sim_sketch_port(1)) };
+  CHECK(fd[0] >= 0 && fd[1] >= 0);
+
+  size_t sent[2] = {}, got[2] = {};
+  double done[2] = {};
+  auto t0 = std::chrono::steady_clock::now();
+  while (got[0] < TOTAL || got[1] < TOTAL) {
+    double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    CHECK(t < 30);
+    for (int p = 0; p < 2; p++) {
+      // Keep some way ahead of what has come back, the line is the bottleneck
+      if (sent[p] < TOTAL && sent[p] - got[p] < 32768) {
+        uint8_t b[1024];
+        size_t n = std::min(sizeof(b), TOTAL - sent[p]);
+        for (size_t i = 0; i < n; i++) b[i] = pattern(p, sent[p] + i);
+        sent[p] += sim_fd_write(fd[p], b, n, 0);
+      }
+      uint8_t r[4096];
+      size_t n = sim_fd_read(fd[p], r, sizeof(r), 1);
+      for (size_t i = 0; i < n; i++) CHECK_EQ(r[i], pattern(p, got[p] + i));
+      got[p] += n;
+      if (got[p] == TOTAL && done[p] == 0) done[p] = t;
+    }
+  }
+  printf("port 0 %.2fs, port 1 %.2fs, %.0f KB/s each\n", done[0], done[1], TOTAL / 1024 / std::max(done[0], done[1]));
+  CHECK(std::max(done[0], done[1]) < 1.5 * std::min(done[0], done[1]));
+
+  close(fd[0]);
+  close(fd[1]);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
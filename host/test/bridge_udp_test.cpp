@@ -0,0 +1,73 @@
+/*
+  bridge_udp_test
+
+  Port 0 with the UDP transport, multicast destination and the sequence header: UART data
+  goes out as numbered datagrams to the group, and datagrams sent to the port reach the UART
+  without their header.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "dgram.hpp"
+#include "check.h"
+
+static std::string line_out(size_t want) {
+  std::string s;
+  for (int i = 0; i < 2000 && s.size() < want; i++) {
+    char b[256];
+    size_t n = sim_line_recv(4, b, sizeof(b));
+    s.append(b, n);
+    if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return s;
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.transport = 1;
+      n.udpremote = IPAddress(239, 1, 2, 3);
+      n.udpport = 5555;
+      n.udpseq = 1;
+    });
+  sim_sketch_start();
+  uint16_t port = sim_sketch_port(0);
+
+  // UART -> group, in order and numbered from 0 without gaps
+  std::string d;
+  for (int i = 0; i < 5000; i++) d.push_back(0x20 + i % 0x40);
+  sim_line_send(5, d.data(), d.size());
+  std::string got;
+  uint32_t next = 0;
+  for (int i = 0; i < 5000 && got.size() < d.size(); i++) {
+    TSimDatagram g;
+    if (!sim_udp_recv(g)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    CHECK(g.ip == IPAddress(239, 1, 2, 3));
+    CHECK_EQ(g.port, 5555);
+    CHECK_EQ(g.srcport, port);
+    CHECK(g.data.size() > CDgramPacker::SEQ_LEN && g.data.size() <= CDgramPacker::MAX_DATAGRAM);
+    CHECK_EQ((uint32_t)g.data[0] << 24 | g.data[1] << 16 | g.data[2] << 8 | g.data[3], next);
+    next++;
+    got.append((const char *)g.data.data() + CDgramPacker::SEQ_LEN, g.data.size() - CDgramPacker::SEQ_LEN);
+  }
+  CHECK(got == d);
+
+  // Network -> UART
+  const uint8_t a[] = { 0, 0, 0, 7, 'p', 'i', 'n', 'g' }, b[] = { 0, 0, 0, 8, '!' };
+  sim_udp_send(port, IPAddress(192, 168, 1, 9), 4000, a, sizeof(a));
+  sim_udp_send(port, IPAddress(192, 168, 1, 9), 4000, b, sizeof(b));
+  CHECK(line_out(5) == "ping!");
+
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+  bridge_usb_test
+
+  WiFi off, port 0 bridged to USB on the TinyUSB FIFOs: a steady stream from the UART goes
+  to the host in full packets only, and the rest follows in one short packet once the line
+  has been silent for _CDC_IDLE_CHARS, not before. Data from the host reaches the line.
+  The clock is stepped by the test with the hardware, and core 0, whose delay() would move
+  it, is stopped once the sketch is up; core 1 has nothing to wait for in this mode.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+#define CHAR_US 87  // 10 bits at 115200bps
+#define IDLE_US (2 * CHAR_US)
+
+static uint32_t seq;
+
+static uint8_t pattern(uint32_t i) {
+  return i * 13 + 5;
+}
+
+// n characters on the line, the clock moving in steps shorter than one of them
+static void stream(size_t n) {
+  std::vector<uint8_t> b(n);
+  for (size_t i = 0; i < n; i++) b[i] = pattern(seq + i);
+  sim_line_send(5, b.data(), n);
+  while (sim_line_pending(5) > 0) {
+    sim_advance(CHAR_US / 2);
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+}
+
+// Lets core 1 go round with the clock standing still
+static void settle(void) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+}
+
+// What the host has received, in the packets it came in
+static std::string host_rx(std::vector<size_t> &packets) {
+  std::string s;
+  char b[4096];
+  for (size_t n; (n = sim_usb_read(b, sizeof(b))) > 0;) s.append(b, n);
+  packets = sim_usb_packets();
+  return s;
+}
+
+static void expect(const std::string &s, uint32_t from) {
+  for (size_t i = 0; i < s.size(); i++) CHECK_EQ((uint8_t)s[i], pattern(from + i));
+}
+
+int main() {
+  sim_sketch_config(
+    [](TNetInfo &n) {
+      n.mode = 0;
+      n.baudrate = 115200;
+    });
+  sim_sketch_start();
+  sim_request_halt(0, true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  sim_hw_stop();
+  sim_clock_manual(true);
+  std::vector<size_t> packets;
+  host_rx(packets);
+
+  // 1000 characters back to back: 15 full packets, the 40 left wait for the line to fall silent
+  uint32_t flushes = sim_usb_flushes();
+  stream(1000);
+  settle();
+  std::string s = host_rx(packets);
+  CHECK_EQ(s.size(), 960);
+  CHECK_EQ(packets.size(), 15);
+  for (size_t p : packets) CHECK_EQ(p, 64);
+  CHECK_EQ(sim_usb_flushes(), flushes);
+  expect(s, seq);
+
+  // Silent for nearly the idle time, still waiting
+  sim_advance(IDLE_US - CHAR_US - 10);
+  settle();
+  CHECK_EQ(host_rx(packets).size(), 0);
+  CHECK_EQ(sim_usb_flushes(), flushes);
+
+  // and past it, the rest in one short packet
+  sim_advance(CHAR_US + 20);
+  for (int i = 0; i < 100 && sim_usb_flushes() == flushes; i++) settle();
+  s = host_rx(packets);
+  CHECK_EQ(sim_usb_flushes(), flushes + 1);
+  CHECK_EQ(s.size(), 40);
+  CHECK_EQ(packets.size(), 1);
+  expect(s, seq + 960);
+  seq += 1000;
+
+  // A few characters alone go in one packet after the same wait
+  flushes = sim_usb_flushes();
+  stream(10);
+  settle();
+  CHECK_EQ(host_rx(packets).size(), 0);
+  sim_advance(IDLE_US + 10);
+  for (int i = 0; i < 100 && sim_usb_flushes() == flushes; i++) settle();
+  s = host_rx(packets);
+  CHECK_EQ(s.size(), 10);
+  CHECK_EQ(packets.size(), 1);
+  expect(s, seq);
+  seq += 10;
+
+  // Host to line
+  sim_usb_write("usb", 3);
+  settle();
+  for (int i = 0; i < 100 && sim_line_sent(4) < 3; i++) {
+    sim_advance(CHAR_US);
+    settle();
+  }
+  char r[8];
+  CHECK_EQ(sim_line_recv(4, r, sizeof(r)), 3);
+  CHECK(std::string(r, 3) == "usb");
+
+  sim_clock_manual(false);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
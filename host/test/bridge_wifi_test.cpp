@@ -0,0 +1,112 @@
+/*
+  bridge_wifi_test
+
+  STA mode losing and regaining its AP: boot joins the AP cached in the settings and saves
+  the one it ended up on, a lost link is rejoined without tearing the stack down, so a
+  client stays connected through it, the cached AP is only tried first, each further
+  attempt waits longer, and `i` shows the AP and how long the link took to come back.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "check.h"
+
+static const std::vector<uint8_t> OLD_AP = { 0x02, 0, 0, 0, 0, 0x99 }, AP = { 0x02, 0, 0, 0, 0, 0x01 }, NEW_AP = { 0x02, 0, 0, 0, 0, 0x02 };
+
+static void sleep_ms(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// What `i` prints, once the line with want has come
+static std::string info(const char *want) {
+  std::string out;
+  sim_serial_output();
+  for (int k = 0; k < 20 && out.find(want) == std::string::npos; k++) {
+    out.clear();
+    sim_serial_type("i");
+    for (int i = 0; i < 300 && out.find("UART protocol") == std::string::npos; i++) {
+      out += sim_serial_output();
+      sleep_ms(1);
+    }
+    if (out.find(want) == std::string::npos) sleep_ms(100);
+  }
+  CHECK(out.find(want) != std::string::npos);
+  return out;
+}
+
+// A character from the line reaches the client
+static void forwards(int fd, uint8_t c) {
+  sim_line_send(5, &c, 1);
+  uint8_t r = 0;
+  CHECK_EQ(sim_fd_read(fd, &r, 1, 2000), 1);
+  CHECK_EQ(r, c);
+}
+
+int main() {
+  sim_sketch_config([](TNetInfo &n) {
+    n.mode = 2;
+    n.ip = IPAddress(0, 0, 0, 0);
+    n.wificache = { 1, { 0x02, 0, 0, 0, 0, 0x99 }, 1 };
+  });
+  sim_wifi_ap(AP.data(), 6);
+  uint32_t programs = sim_flash_programs();
+  sim_sketch_start();
+  CHECK_EQ(sim_wifi_joins(), 1);
+  CHECK(sim_wifi_join_bssid() == OLD_AP);
+
+  // The AP it is on is saved and shown
+  info("BSSID is 02:00:00:00:00:01 on channel 6");
+  CHECK(sim_flash_programs() > programs);
+  int fd = -1;
+  for (int i = 0; i < 1000 && (fd = sim_connect(sim_sketch_port(0))) < 0; i++) sleep_ms(1);
+  CHECK(fd >= 0);
+  sleep_ms(100);
+  forwards(fd, 'a');
+
+  // A roam: gone for a moment, back on another AP, rejoined once at the cached one
+  sim_wifi_ap(NEW_AP.data(), 11);
+  sim_wifi_link(false);
+  sleep_ms(1500);
+  CHECK_EQ(sim_wifi_joins(), 2);
+  CHECK(sim_wifi_join_bssid() == AP);
+  sim_wifi_link(true);
+  std::string s = info("BSSID is 02:00:00:00:00:02 on channel 11");
+  CHECK(s.find("link lost 1 times") != std::string::npos);
+  unsigned back = 0;
+  CHECK_EQ(sscanf(s.c_str() + s.find("last back in"), "last back in %ums", &back), 1);
+  CHECK(back >= 1000 && back < 3000);
+  // The stack was not torn down, the client is still there
+  forwards(fd, 'b');
+
+  // A longer outage: the cached AP first, then any AP after the time the first attempt had
+  uint32_t j = sim_wifi_joins();
+  sim_wifi_link(false);
+  sleep_ms(2500);
+  CHECK_EQ(sim_wifi_joins(), j + 1);
+  CHECK(sim_wifi_join_bssid() == NEW_AP);
+  sleep_ms(3500);
+  CHECK_EQ(sim_wifi_joins(), j + 2);
+  CHECK(sim_wifi_join_bssid().empty());
+  sim_wifi_link(true);
+  // Drops are counted when the link goes, wait for the time it came back in
+  for (int k = 0; k < 30 && back < 5000; k++) {
+    s = info("link lost 2 times");
+    CHECK_EQ(sscanf(s.c_str() + s.find("last back in"), "last back in %ums", &back), 1);
+  }
+  CHECK(back >= 5000 && back < 8000);
+  forwards(fd, 'c');
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,31 @@
+/*
+  check
+
+  Assertions of the host tests. A failed check prints where and what, and ends the test
+  there and then, with the cores of a running sketch still inside it.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECK(c)                                                          \
+  do {                                                                    \
+    if (!(c)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); \
+      _Exit(1);                                                           \
+    }                                                                     \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                                                  \
+  do {                                                                                                  \
+    long long _a = (long long)(a), _b = (long long)(b);                                                 \
+    if (_a != _b) {                                                                                     \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      _Exit(1);                                                                                         \
+    }                                                                                                   \
+  } while (0)
@@ -0,0 +1,105 @@
+/*
+  dgram_test
+
+  CDgramPacker: datagrams cut from a ring across its end, no bigger than asked for and
+  never past the limit, numbered when the sequence header is on, and received numbers
+  counted as lost only where some are missing, not when they come late or repeat.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string>
+#include "dgram.hpp"
+#include "check.h"
+
+static uint32_t seq_of(const uint8_t *p) {
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void pack(void) {
+  static CSPSCRing<4096> ring;
+  static uint8_t out[CDgramPacker::MAX_DATAGRAM];
+  CDgramPacker p;
+
+  // Plain: the payload and nothing else
+  p.begin(false);
+  CHECK_EQ(p.header_len(), 0);
+  ring.write((const uint8_t *)"hello", 5);
+  CHECK_EQ(p.pack(&ring, ring.head_pos(), out), 5);
+  CHECK(std::string((char *)out, 5) == "hello");
+  CHECK_EQ(ring.available(), 0);
+  CHECK_EQ(p.pack(&ring, ring.head_pos(), out), 0);
+
+  // Sequenced, across the end of the ring and cut to MAX_DATAGRAM
+  p.begin(true);
+  std::string d;
+  for (int i = 0; i < 4000; i++) d.push_back((char)(i * 7));
+  std::string in;
+  uint32_t next = 0;
+  for (int round = 0; round < 3; round++) {
+    ring.write((const uint8_t *)d.data(), d.size());
+    size_t n;
+    while ((n = p.pack(&ring, ring.head_pos(), out)) > 0) {
+      CHECK(n <= CDgramPacker::MAX_DATAGRAM);
+      CHECK(n > CDgramPacker::SEQ_LEN);
+      CHECK_EQ(seq_of(out), next++);
+      in.append((char *)out + CDgramPacker::SEQ_LEN, n - CDgramPacker::SEQ_LEN);
+    }
+    CHECK(in == d);
+    in.clear();
+  }
+  CHECK_EQ(next, 3 * 3);
+
+  // Not past the limit, a smaller maximum, and none that would carry only a header
+  ring.write((const uint8_t *)d.data(), 100);
+  uint32_t limit = ring.tail_pos() + 30;
+  CHECK_EQ(p.pack(&ring, limit, out, 14), 14);
+  CHECK_EQ(p.pack(&ring, limit, out), 4 + 20);
+  CHECK_EQ(p.pack(&ring, limit, out), 0);
+  CHECK_EQ(p.pack(&ring, ring.head_pos(), out, CDgramPacker::SEQ_LEN), 0);
+  CHECK_EQ(ring.available(), 70);
+}
+
+static size_t recv(CDgramPacker &p, uint32_t seq) {
+  uint8_t b[6] = { (uint8_t)(seq >> 24), (uint8_t)(seq >> 16), (uint8_t)(seq >> 8), (uint8_t)seq, 'x', 'y' };
+  return p.unpack(b, sizeof(b));
+}
+
+static void unpack(void) {
+  CDgramPacker p;
+  // Without the header everything is payload
+  p.begin(false);
+  CHECK_EQ(recv(p, 5), 0);
+  CHECK_EQ(p.lost, 0);
+
+  p.begin(true);
+  // The first number is taken as it is
+  CHECK_EQ(recv(p, 1000), 4);
+  CHECK_EQ(recv(p, 1001), 4);
+  CHECK_EQ(p.lost, 0);
+  // Two missing
+  CHECK_EQ(recv(p, 1004), 4);
+  CHECK_EQ(p.lost, 2);
+  // Late and repeated ones are not loss and do not move the expected number back
+  recv(p, 1002);
+  recv(p, 1004);
+  recv(p, 1005);
+  CHECK_EQ(p.lost, 2);
+  // Across the wrap of the counter
+  p.begin(true);
+  recv(p, 0xfffffffe);
+  recv(p, 0xffffffff);
+  recv(p, 1);
+  CHECK_EQ(p.lost, 1);
+  // Too short to hold a header is no payload at all
+  const uint8_t s[3] = { 1, 2, 3 };
+  CHECK_EQ(p.unpack(s, sizeof(s)), sizeof(s));
+}
+
+int main() {
+  pack();
+  unpack();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,156 @@
+/*
+  journal_test
+
+  CJournal on a flash of its own that can lose power in the middle of a page program or a
+  sector erase: the newest complete record survives every cut, a torn one is never read,
+  appends wear the sectors evenly, and a flipped bit is caught by the CRC.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "journal.hpp"
+#include "check.h"
+
+static const uint32_t SECTOR = 4096, PAGE = 256, SECTORS = 3;
+
+struct TPowerFail {};
+
+// Programming only clears bits, a cut leaves half a page programmed or half a sector erased
+struct TFlash {
+  std::vector<uint8_t> mem;
+  std::vector<uint32_t> wear;
+  int budget;  // operations until the power fails, -1 never
+
+  TFlash() : mem(SECTOR * SECTORS, 0xff), wear(SECTORS), budget(-1) {}
+
+  bool cut(void) {
+    if (budget < 0) return false;
+    return budget-- == 0;
+  }
+  static void read(uint32_t off, void *buf, size_t len, void *any) {
+    memcpy(buf, &((TFlash *)any)->mem[off], len);
+  }
+  static void program(uint32_t off, const void *buf, size_t len, void *any) {
+    TFlash *f = (TFlash *)any;
+    bool c = f->cut();
+    for (size_t i = 0; i < (c ? len / 2 : len); i++) f->mem[off + i] &= ((const uint8_t *)buf)[i];
+    if (c) throw TPowerFail();
+  }
+  static void erase(uint32_t off, void *any) {
+    TFlash *f = (TFlash *)any;
+    bool c = f->cut();
+    memset(&f->mem[off], 0xff, c ? SECTOR / 2 : SECTOR);
+    f->wear[off / SECTOR]++;
+    if (c) throw TPowerFail();
+  }
+};
+
+struct TRec {
+  uint32_t n;
+  uint8_t fill[600];
+};
+
+static TRec rec(uint32_t n) {
+  TRec r;
+  r.n = n;
+  for (size_t i = 0; i < sizeof(r.fill); i++) r.fill[i] = n + i;
+  return r;
+}
+
+// What a reboot finds, -1 for nothing
+static int64_t boot(const TJournalFlash &jf, size_t len = sizeof(TRec)) {
+  CJournal j;
+  CHECK(j.begin(&jf, len));
+  TRec r;
+  if (j.read(&r, sizeof(r)) < 0) return -1;
+  TRec e = rec(r.n);
+  CHECK(memcmp(&r, &e, sizeof(r)) == 0);
+  return r.n;
+}
+
+int main() {
+  TFlash f;
+  TJournalFlash jf = { TFlash::read, TFlash::program, TFlash::erase, &f, SECTOR, PAGE, SECTORS };
+  CJournal j;
+
+  // Too little flash or too large a record
+  TJournalFlash one = jf;
+  one.sectors = 1;
+  CHECK(!j.begin(&one, sizeof(TRec)));
+  CHECK(!j.begin(&jf, SECTOR));
+
+  // Blank flash
+  CHECK(j.begin(&jf, sizeof(TRec)));
+  CHECK_EQ(j.capacity(), SECTOR / 1024 * SECTORS);
+  TRec r;
+  CHECK_EQ(j.read(&r, sizeof(r)), -1);
+
+  // Round after round of the region, each record found by a fresh boot
+  const uint32_t N = j.capacity() * 40;
+  for (uint32_t i = 0; i < N; i++) {
+    TRec a = rec(i);
+    CHECK(j.append(&a, sizeof(a), 1));
+    if (i % 7 == 0) CHECK_EQ(boot(jf), i);
+  }
+  CHECK_EQ(boot(jf), N - 1);
+  uint32_t lo = *std::min_element(f.wear.begin(), f.wear.end()), hi = *std::max_element(f.wear.begin(), f.wear.end());
+  CHECK(hi - lo <= 1);
+  CHECK(lo * SECTOR / 1024 >= N / SECTORS - SECTOR / 1024);
+  printf("%u appends, sectors erased %u to %u times\n", N, lo, hi);
+
+  // Power cut after every possible number of operations, over a whole round of the region
+  // with the erases that come with it
+  uint32_t n = N;
+  for (uint32_t k = 0; k < 2 * j.capacity(); k++) {
+    for (int cut = 0;; cut++) {
+      CJournal w;
+      CHECK(w.begin(&jf, sizeof(TRec)));
+      TRec a = rec(n);
+      f.budget = cut;
+      bool done = false;
+      try {
+        done = w.append(&a, sizeof(a), 1);
+      } catch (TPowerFail &) {
+      }
+      f.budget = -1;
+      int64_t b = boot(jf);
+      // A cut after the last byte of the record went in still leaves it complete
+      if (done || b == n) {
+        CHECK_EQ(b, n);
+        break;
+      }
+      CHECK_EQ(b, n - 1);
+    }
+    n++;
+  }
+  CHECK_EQ(boot(jf), n - 1);
+
+  // A bit flipped in the newest record, the one before is read
+  CHECK(j.begin(&jf, sizeof(TRec)));
+  TRec a = rec(n);
+  CHECK(j.append(&a, sizeof(a), 1));
+  auto at = std::search(f.mem.begin(), f.mem.end(), (uint8_t *)&a, (uint8_t *)&a + sizeof(a));
+  CHECK(at != f.mem.end());
+  at[100] ^= 0x10;
+  CHECK_EQ(boot(jf), n - 1);
+  at[100] ^= 0x10;
+  CHECK_EQ(boot(jf), n);
+
+  // A shorter record of a later version, what it lacks reads as erased
+  CHECK(j.begin(&jf, sizeof(TRec)));
+  uint32_t s = 12345;
+  CHECK(j.append(&s, sizeof(s), 2));
+  memset(&r, 0, sizeof(r));
+  uint8_t v = 0;
+  CHECK_EQ(j.read(&r, sizeof(r), &v), (int)sizeof(s));
+  CHECK_EQ(v, 2);
+  CHECK_EQ(r.n, s);
+  CHECK_EQ(r.fill[0], 0xff);
+  CHECK_EQ(r.fill[sizeof(r.fill) - 1], 0xff);
+  printf("ok\n");
+  return 0;
+}
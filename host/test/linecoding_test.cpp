@@ -0,0 +1,106 @@
+/*
+  linecoding_test
+
+  CLineCoding in every one of the 40 settings, to and from each form: SERIAL_xxx, "8N1"
+  text, USB CDC, LsrMstInsert, PUSR and RFC 2217, and what is refused or clamped.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <Arduino.h>
+#include "linecoding.hpp"
+#include "check.h"
+
+static_assert(sizeof(CLineCoding) == 1, "one byte");
+static_assert(CLineCoding().serial() == SERIAL_8N1, "8N1 by default");
+static_assert(CLineCoding(7, CLineCoding::EVEN, 2).charbits() == 11, "usable in constant expressions");
+
+#define E(b, p, s) { #b #p #s, SERIAL_##b##p##s }
+static const struct {
+  const char *text;
+  uint16_t serial;
+} all[] = {
+  E(5, N, 1), E(6, N, 1), E(7, N, 1), E(8, N, 1), E(5, N, 2), E(6, N, 2), E(7, N, 2), E(8, N, 2),
+  E(5, O, 1), E(6, O, 1), E(7, O, 1), E(8, O, 1), E(5, O, 2), E(6, O, 2), E(7, O, 2), E(8, O, 2),
+  E(5, E, 1), E(6, E, 1), E(7, E, 1), E(8, E, 1), E(5, E, 2), E(6, E, 2), E(7, E, 2), E(8, E, 2),
+  E(5, M, 1), E(6, M, 1), E(7, M, 1), E(8, M, 1), E(5, M, 2), E(6, M, 2), E(7, M, 2), E(8, M, 2),
+  E(5, S, 1), E(6, S, 1), E(7, S, 1), E(8, S, 1), E(5, S, 2), E(6, S, 2), E(7, S, 2), E(8, S, 2),
+};
+
+int main() {
+  int distinct = 0;
+  uint64_t seen = 0;
+  for (int d = 5; d <= 8; d++)
+    for (int p = CLineCoding::NONE; p <= CLineCoding::SPACE; p++)
+      for (int s = 1; s <= 2; s++) {
+        CLineCoding c(d, p, s);
+        CHECK_EQ(c.databits(), d);
+        CHECK_EQ(c.parity(), p);
+        CHECK_EQ(c.stopbits(), s);
+        CHECK_EQ(c.charbits(), 1 + d + (p != CLineCoding::NONE) + s);
+        CHECK(c.raw() < 64);
+        if (!(seen & (1ull << c.raw()))) distinct++;
+        seen |= 1ull << c.raw();
+
+        // Text and SERIAL_xxx against the Arduino names
+        CLineCoding::TText t = c.text();
+        int k = p * 8 + (s - 1) * 4 + (d - 5);
+        CHECK(strcmp(t.s, all[k].text) == 0);
+        CHECK_EQ(c.serial(), all[k].serial);
+        CLineCoding r;
+        CHECK(CLineCoding::parse(t.s, r) && r == c);
+        char lower[4] = { t.s[0], (char)(t.s[1] - 'A' + 'a'), t.s[2], '\0' };
+        CHECK(CLineCoding::parse(lower, r) && r == c);
+        CHECK(CLineCoding::from_serial(c.serial(), r) && r == c);
+
+        // USB CDC and LsrMstInsert count stop bits 0:1 1:1.5 2:2
+        CHECK(CLineCoding::from_cdc(d, p, c.cdc_stop_bits()) == c);
+        CHECK_EQ(c.cdc_stop_bits(), (s == 1) ? 0 : 2);
+        CHECK(CLineCoding::from_lsrmst(d, p, (s == 1) ? 0 : 2) == c);
+
+        // PUSR
+        uint8_t b = c.pusr();
+        CHECK_EQ(b & 3, d - 5);
+        CHECK_EQ((b >> 2) & 1, s - 1);
+        CHECK_EQ((b >> 3) & 1, p != CLineCoding::NONE);
+        if (p != CLineCoding::NONE) CHECK_EQ((b >> 4) & 3, p - CLineCoding::ODD);
+        CHECK(CLineCoding::from_pusr(b) == c);
+
+        // RFC 2217
+        CHECK_EQ(c.rfc2217_parity(), p + 1);
+        CHECK_EQ(CLineCoding::rfc2217_parity(c.rfc2217_parity()), p);
+        CHECK_EQ(c.rfc2217_stopsize(), s);
+        CHECK_EQ(CLineCoding::rfc2217_stopbits(c.rfc2217_stopsize()), s);
+
+        CHECK(c.with_databits(8).with_parity(CLineCoding::NONE).with_stopbits(1) == CLineCoding());
+        CHECK(CLineCoding().with_databits(d).with_parity(p).with_stopbits(s) == c);
+      }
+  CHECK_EQ(distinct, 40);
+
+  // 1.5 stop bits is taken as 2 wherever it can be asked for
+  CHECK_EQ(CLineCoding::from_cdc(8, 0, 1).stopbits(), 2);
+  CHECK_EQ(CLineCoding::from_lsrmst(8, 0, 1).stopbits(), 2);
+  CHECK_EQ(CLineCoding::rfc2217_stopbits(3), 2);
+  // PUSR bytes as the VCOM software sends them, bits 6-7 are not ours
+  CHECK(CLineCoding::from_pusr(0x03) == CLineCoding(8, CLineCoding::NONE, 1));
+  CHECK(CLineCoding::from_pusr(0x1b) == CLineCoding(8, CLineCoding::EVEN, 1));
+  CHECK(CLineCoding::from_pusr(0x0e) == CLineCoding(7, CLineCoding::ODD, 2));
+  CHECK(CLineCoding::from_pusr(0xc3) == CLineCoding(8, CLineCoding::NONE, 1));
+  // Out of range values are clamped
+  CHECK(CLineCoding(9, 7, 3) == CLineCoding(8, CLineCoding::SPACE, 2));
+  CHECK(CLineCoding(4, -1, 1) == CLineCoding(5, CLineCoding::NONE, 1));
+
+  // Refused, and the value is left alone
+  CLineCoding r(7, CLineCoding::MARK, 2);
+  const char *bad[] = { nullptr, "", "8", "8N", "9N1", "4N1", "8X1", "8N0", "8N3", "8N1 ", "8N11" };
+  for (const char *s : bad) CHECK(!CLineCoding::parse(s, r));
+  CHECK(!CLineCoding::from_serial(SERIAL_DATA_8 | SERIAL_PARITY_NONE | SERIAL_STOP_BIT_1_5, r));
+  CHECK(!CLineCoding::from_serial(SERIAL_DATA_8 | SERIAL_STOP_BIT_1, r));
+  CHECK(!CLineCoding::from_serial(SERIAL_PARITY_NONE | SERIAL_STOP_BIT_1, r));
+  CHECK(!CLineCoding::from_serial(0x500 | SERIAL_PARITY_NONE | SERIAL_STOP_BIT_1, r));
+  CHECK(r == CLineCoding(7, CLineCoding::MARK, 2));
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+  lsrmst_test
+
+  CLsrMstDecoder on generated IOCTL_SERIAL_LSRMST_INSERT streams: data, escaped escape
+  characters, LSR/MST inserts and the RBR and RLC extensions, fed in reads split at random
+  places, including inside every sequence. The generator knows what each piece must give.
+  The data of a read is handed over in one piece unless a baudrate or format change cuts it,
+  from the input itself when nothing in the read had to be dropped.
+  Ends with the decoding rate of a plain stream.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "lsrmst.hpp"
+#include "check.h"
+
+// Data bytes, then baud changes as -1 - baud and format changes as -(1 << 40) - bytesize << 16 | parity << 8 | stopbits
+struct TOut {
+  std::vector<long long> v;
+  int calls;
+  const uint8_t *last;  // where the last run was handed over from
+  int changes;          // baudrate and format changes
+  size_t count;
+};
+
+static void on_data(const uint8_t *p, size_t len, void *any) {
+  TOut *o = (TOut *)any;
+  CHECK(len > 0);
+  o->calls++;
+  o->last = p;
+  for (size_t i = 0; i < len; i++) o->v.push_back(p[i]);
+}
+
+static void on_baud(uint32_t baud, void *any) {
+  ((TOut *)any)->v.push_back(-1 - (long long)baud);
+  ((TOut *)any)->changes++;
+}
+
+static void on_format(int bytesize, int parity, int stopbits, void *any) {
+  ((TOut *)any)->v.push_back(-(1ll << 40) - (bytesize << 16 | parity << 8 | stopbits));
+  ((TOut *)any)->changes++;
+}
+
+static void generate(std::mt19937 &rng, uint8_t esc, std::vector<uint8_t> &s, std::vector<long long> &want) {
+  int parts = 1 + rng() % 10;
+  for (int k = 0; k < parts; k++) {
+    switch (rng() % 8) {
+      case 0: {  // escaped escape character
+        s.push_back(esc);
+        s.push_back((uint8_t)CLsrMstDecoder::SERIAL_LSRMST_ESCAPE);
+        want.push_back(esc);
+        break;
+      }
+      case 1: {
+        uint32_t b = rng();
+        uint8_t q[6] = { esc, CLsrMstDecoder::C0CE_INSERT_RBR, (uint8_t)b, (uint8_t)(b >> 8), (uint8_t)(b >> 16), (uint8_t)(b >> 24) };
+        s.insert(s.end(), q, q + 6);
+        want.push_back(-1 - (long long)b);
+        break;
+      }
+      case 2: {
+        uint8_t b = 5 + rng() % 4, p = rng() % 5, st = rng() % 3;
+        uint8_t q[5] = { esc, CLsrMstDecoder::C0CE_INSERT_RLC, b, p, st };
+        s.insert(s.end(), q, q + 5);
+        want.push_back(-(1ll << 40) - (b << 16 | p << 8 | st));
+        break;
+      }
+      case 3: {  // LSR and data, carried and dropped
+        uint8_t q[4] = { esc, CLsrMstDecoder::SERIAL_LSRMST_LSR_DATA, (uint8_t)rng(), (uint8_t)rng() };
+        s.insert(s.end(), q, q + 4);
+        break;
+      }
+      case 4: {
+        uint8_t q[3] = { esc, (uint8_t)((rng() & 1) ? CLsrMstDecoder::SERIAL_LSRMST_LSR_NODATA : CLsrMstDecoder::SERIAL_LSRMST_MST), (uint8_t)rng() };
+        s.insert(s.end(), q, q + 3);
+        break;
+      }
+      default:
+        for (int n = rng() % 30; n > 0; n--) {
+          uint8_t c = rng();
+          if (c == esc) continue;
+          s.push_back(c);
+          want.push_back(c);
+        }
+        break;
+    }
+  }
+}
+
+static std::vector<long long> decode(CLsrMstDecoder &d, TOut &out, const std::vector<uint8_t> &s, std::mt19937 &rng) {
+  out.v.clear();
+  for (size_t o = 0; o < s.size();) {
+    size_t n = 1 + rng() % ((rng() % 4 == 0) ? 64 : 7);
+    n = std::min(n, s.size() - o);
+    int calls = out.calls, changes = out.changes;
+    d.decode(&s[o], n);
+    CHECK(out.calls - calls <= 1 + out.changes - changes);
+    o += n;
+  }
+  return out.v;
+}
+
+int main() {
+  std::mt19937 rng(17);
+  TOut out = {};
+  CLsrMstDecoder d;
+
+  // The default escape character, and others as the driver may pick any
+  const uint8_t escs[] = { 'a', 0x00, 0xff, 0x1b };
+  for (uint8_t esc : escs) {
+    d.begin(on_data, on_baud, on_format, &out, esc);
+    for (int round = 0; round < 5000; round++) {
+      std::vector<uint8_t> s;
+      std::vector<long long> want;
+      generate(rng, esc, s, want);
+      CHECK(decode(d, out, s, rng) == want);
+    }
+  }
+
+  // Unknown codes are skipped with the escape
+  d.begin(on_data, on_baud, on_format, &out);
+  out.v.clear();
+  const uint8_t u[] = { 'x', 'a', 0x42, 'y' };
+  d.decode(u, sizeof(u));
+  CHECK(out.v == std::vector<long long>({ 'x', 'y' }));
+
+  // A plain run goes over in one call straight from the input
+  out.v.clear();
+  out.calls = 0;
+  std::vector<uint8_t> run(2048, 'b');
+  d.decode(run.data(), run.size());
+  CHECK_EQ(out.calls, 1);
+  CHECK(out.last == run.data());
+  CHECK_EQ(out.v.size(), run.size());
+
+  // Escaped escape characters and dropped sequences leave no cut in the data, a change does
+  out.v.clear();
+  out.calls = 0;
+  const uint8_t g[] = { 'x', 'a', 0x00, 'y', 'a', CLsrMstDecoder::SERIAL_LSRMST_MST, 0x30, 'z', 'a', 0x00,
+                        'a', CLsrMstDecoder::C0CE_INSERT_RLC, 7, 2, 0, 'w' };
+  d.decode(g, sizeof(g));
+  CHECK(out.v == std::vector<long long>({ 'x', 'a', 'y', 'z', 'a', -(1ll << 40) - (7 << 16 | 2 << 8 | 0), 'w' }));
+  CHECK_EQ(out.calls, 2);
+
+  // reset() drops a sequence half way, what follows is data again
+  out.v.clear();
+  const uint8_t h[] = { 'a', CLsrMstDecoder::C0CE_INSERT_RBR, 0x00, 0xc2 }, t[] = { 'z' };
+  d.decode(h, sizeof(h));
+  d.reset();
+  d.decode(t, sizeof(t));
+  CHECK(out.v == std::vector<long long>({ 'z' }));
+
+  // Rate on a stream with a baudrate change every 64KB
+  std::vector<uint8_t> big;
+  for (int k = 0; k < 64; k++) {
+    std::vector<uint8_t> r(65536);
+    for (uint8_t &c : r) c = 0x20 + rng() % 0x40;
+    big.insert(big.end(), r.begin(), r.end());
+    const uint8_t q[6] = { 'a', CLsrMstDecoder::C0CE_INSERT_RBR, 0x00, 0xc2, 0x01, 0x00 };
+    big.insert(big.end(), q, q + 6);
+  }
+  d.begin([](const uint8_t *p, size_t len, void *any) { *(size_t *)any += len; }, NULL, NULL, &out.count);
+  out.count = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  const int reps = 16;
+  for (int r = 0; r < reps; r++)
+    for (size_t o = 0; o < big.size(); o += 1460) d.decode(&big[o], std::min((size_t)1460, big.size() - o));
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  CHECK_EQ(out.count, (size_t)reps * 64 * 65536);
+  printf("ok, %.0f MB/s in 1460 byte reads\n", reps * big.size() / sec / 1e6);
+  return 0;
+}
@@ -0,0 +1,342 @@
+/*
+  modbus_test
+
+  CModbusGateway on simulated timings against a unit played by the test: 3.5 character
+  times below and above 19200bps, the timeout and broken responses turned into exception
+  0x0b, the turnaround after a broadcast, and two clients pipelining more requests than
+  the queue holds, across the wrap of the clock. And CMbapAssembler on a stream split at
+  every possible place.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "crc16.hpp"
+#include "modbus.hpp"
+#include "check.h"
+
+static const uint32_t STEP_US = 10;
+
+// tag, MBAP and PDU, as core 0 makes them
+static std::string record(uint8_t tag, uint16_t tid, uint8_t unit, const std::string &pdu) {
+  size_t l = 1 + pdu.size();
+  std::string r = { (char)tag, (char)(tid >> 8), (char)tid, 0, 0, (char)(l >> 8), (char)l, (char)unit };
+  return r + pdu;
+}
+
+static std::string rtu(uint8_t unit, const std::string &pdu) {
+  CCRC16 CRC16;
+  std::string f = std::string(1, (char)unit) + pdu;
+  uint16_t crc = CRC16.calc(f.data(), f.size());
+  return f + (char)crc + (char)(crc >> 8);
+}
+
+static std::string read_pdu(uint16_t addr) {
+  return { 0x03, (char)(addr >> 8), (char)addr, 0, 1 };
+}
+
+// The gateway with a unit on the line
+struct TBench {
+  CModbusGateway gw;
+  uint32_t now;
+  uint32_t char_us;
+  std::vector<std::string> uart;  // frames sent
+  std::vector<uint32_t> uart_at;
+  std::vector<std::string> net;   // records back to core 0
+  int refuse;                     // polls the way back is full for
+
+  // The unit answers a frame with this, nothing if empty, after a little thinking
+  std::string (*unit)(const std::string &frame);
+  std::string reply;
+  uint32_t reply_at;
+  size_t reply_pos;
+  uint32_t gap_at;                // a pause of gap_us in front of that byte of the reply
+  uint32_t gap_us;
+
+  static void to_uart(const uint8_t *p, size_t len, void *any) {
+    TBench *b = (TBench *)any;
+    b->uart.push_back(std::string((const char *)p, len));
+    b->uart_at.push_back(b->now);
+    if (b->unit == NULL) return;
+    b->reply = b->unit(b->uart.back());
+    b->reply_pos = 0;
+    b->reply_at = b->now + len * b->char_us + 500;
+  }
+  static bool to_net(const uint8_t *p, size_t len, void *any) {
+    TBench *b = (TBench *)any;
+    if (b->refuse > 0) {
+      b->refuse--;
+      return false;
+    }
+    b->net.push_back(std::string((const char *)p, len));
+    return true;
+  }
+
+  void step(void) {
+    now += STEP_US;
+    while (reply_pos < reply.size() && (int32_t)(now - reply_at) >= 0) {
+      gw.receive((const uint8_t *)&reply[reply_pos++], 1, now);
+      reply_at += char_us + ((reply_pos == gap_at) ? gap_us : 0);
+    }
+    gw.poll(now);
+  }
+  void run(uint32_t us) {
+    for (uint32_t end = now + us; (int32_t)(now - end) < 0;) step();
+  }
+  void feed(const std::string &r) {
+    CHECK(gw.room() > 0);
+    gw.decode((const uint8_t *)r.data(), r.size());
+  }
+
+  TBench(uint32_t baud, int bits, uint32_t start = 1000000) {
+    gw.begin(to_uart, to_net, this);
+    gw.line(baud, bits);
+    char_us = (bits * 1000000 + baud - 1) / baud;
+    now = start;
+    refuse = 0;
+    unit = NULL;
+    reply_at = 0;
+    reply_pos = 0;
+    gap_at = gap_us = 0;
+  }
+};
+
+// Holding register addr holds addr * 3, and a broadcast gets no answer
+static std::string answer(const std::string &f) {
+  if (f[0] == 0) return "";
+  uint16_t addr = (uint8_t)f[2] << 8 | (uint8_t)f[3];
+  uint16_t v = addr * 3;
+  return rtu(f[0], { 0x03, 2, (char)(v >> 8), (char)v });
+}
+
+static void test_t35(void) {
+  CModbusGateway gw;
+  gw.line(9600, 11);  // 8E1
+  CHECK_EQ(gw.t35(), 4011);
+  gw.line(19200, 10);
+  CHECK_EQ(gw.t35(), 1823);
+  gw.line(38400, 10);
+  CHECK_EQ(gw.t35(), CModbusGateway::FAST_T35_US);
+  gw.line(921600, 12);
+  CHECK_EQ(gw.t35(), CModbusGateway::FAST_T35_US);
+  gw.line(0, 10);
+  CHECK_EQ(gw.t35(), CModbusGateway::FAST_T35_US);
+
+  // At 9600 a response pausing for 1.5ms is still one frame, and it is complete 3.5
+  // characters after its last byte, not before
+  {
+    TBench b(9600, 10);
+    b.unit = answer;
+    b.gap_at = 3;
+    b.gap_us = 1500;
+    b.feed(record(1, 0x1234, 1, read_pdu(7)));
+    b.run(100);
+    CHECK_EQ(b.uart.size(), 1);
+    CHECK(b.uart[0] == rtu(1, read_pdu(7)));
+    while (b.reply_pos < b.reply.size()) b.step();
+    uint32_t last = b.now;
+    while (b.net.empty()) b.step();
+    CHECK(b.now - last >= b.gw.t35());
+    CHECK(b.now - last < b.gw.t35() + 2 * STEP_US);
+    CHECK(b.net[0] == record(1, 0x1234, 1, { 0x03, 2, 0, 21 }));
+    CHECK_EQ(b.gw.stat.responses.get(), 1);
+  }
+  // A request waits for the line to have been silent 3.5 characters, here after noise
+  {
+    TBench b(19200, 10);
+    uint8_t noise[3] = { 0xff, 0x00, 0xff };
+    b.gw.receive(noise, sizeof(noise), b.now);
+    b.feed(record(1, 1, 1, read_pdu(7)));
+    uint32_t quiet = b.now + b.gw.t35();
+    b.run(quiet - STEP_US - b.now);
+    CHECK(b.uart.empty());
+    b.run(quiet - b.now);
+    CHECK_EQ(b.uart.size(), 1);
+    CHECK_EQ(b.gw.stat.stray.get(), 3);
+  }
+  // At 38400 the same pause ends the frame, and the two halves are broken responses
+  {
+    TBench b(38400, 10);
+    b.unit = answer;
+    b.gap_at = 3;
+    b.gap_us = 1800;
+    b.feed(record(1, 0x1234, 1, read_pdu(7)));
+    b.run(20000);
+    CHECK_EQ(b.net.size(), 1);
+    CHECK(b.net[0] == record(1, 0x1234, 1, { (char)0x83, CModbus::GATEWAY_TARGET_FAILED }));
+    CHECK_EQ(b.gw.stat.bad_frames.get(), 1);
+  }
+}
+
+static void test_timeout(void) {
+  TBench b(115200, 10);
+  b.feed(record(3, 0x0101, 5, read_pdu(0)));
+  b.step();
+  CHECK_EQ(b.uart.size(), 1);
+  // Timed from when the frame has left
+  uint32_t until = b.uart_at[0] + 8 * b.char_us + CModbusGateway::RESPONSE_TIMEOUT_US;
+  b.run(until - STEP_US - b.now);
+  CHECK(b.net.empty());
+  CHECK_EQ(b.gw.queued(), 1);
+  CHECK_EQ(b.gw.stat.timeouts.get(), 0);
+  b.run(until - b.now);
+  CHECK_EQ(b.gw.stat.timeouts.get(), 1);
+  // and the exception goes back on the next poll
+  b.step();
+  CHECK_EQ(b.net.size(), 1);
+  CHECK(b.net[0] == record(3, 0x0101, 5, { (char)0x83, CModbus::GATEWAY_TARGET_FAILED }));
+  CHECK_EQ(b.gw.queued(), 0);
+}
+
+static void test_broadcast(void) {
+  TBench b(115200, 10);
+  b.unit = answer;
+  b.feed(record(1, 1, 0, { 0x06, 0, 1, 0, 5 }));
+  b.feed(record(1, 2, 1, read_pdu(1)));
+  b.step();
+  CHECK_EQ(b.uart.size(), 1);
+  CHECK(b.uart[0] == rtu(0, { 0x06, 0, 1, 0, 5 }));
+  // Nobody answers a broadcast, it is off the queue at once
+  CHECK_EQ(b.gw.queued(), 1);
+  CHECK_EQ(b.gw.stat.broadcasts.get(), 1);
+  uint32_t next = b.uart_at[0] + 8 * b.char_us + CModbusGateway::BROADCAST_DELAY_US;
+  b.run(next - STEP_US - b.now);
+  CHECK_EQ(b.uart.size(), 1);
+  b.run(next - b.now);
+  CHECK_EQ(b.uart.size(), 2);
+  b.run(20000);
+  // and the client hears only of the second request
+  CHECK_EQ(b.net.size(), 1);
+  CHECK(b.net[0] == record(1, 2, 1, { 0x03, 2, 0, 3 }));
+}
+
+static void test_bad_responses(void) {
+  struct {
+    std::string (*unit)(const std::string &);
+    bool ok;
+  } cases[] = {
+    { [](const std::string &f) { std::string r = answer(f); r.back() ^= 1; return r; }, false },  // CRC
+    { [](const std::string &f) { return rtu(f[0] + 1, { 0x03, 2, 0, 3 }); }, false },            // unit
+    { [](const std::string &f) { return rtu(f[0], { 0x04, 2, 0, 3 }); }, false },                // function
+    { [](const std::string &f) { return std::string(1, f[0]) + '\x03'; }, false },               // too short
+    { [](const std::string &f) { return rtu(f[0], { (char)0x83, 0x02 }); }, true },              // exception from the unit
+  };
+  for (auto &c : cases) {
+    TBench b(115200, 10);
+    b.unit = c.unit;
+    b.feed(record(2, 0xbeef, 9, read_pdu(1)));
+    b.run(20000);
+    CHECK_EQ(b.net.size(), 1);
+    if (c.ok) {
+      CHECK(b.net[0] == record(2, 0xbeef, 9, { (char)0x83, 0x02 }));
+      CHECK_EQ(b.gw.stat.exceptions.get(), 1);
+      CHECK_EQ(b.gw.stat.bad_frames.get(), 0);
+    } else {
+      CHECK(b.net[0] == record(2, 0xbeef, 9, { (char)0x83, CModbus::GATEWAY_TARGET_FAILED }));
+      CHECK_EQ(b.gw.stat.bad_frames.get(), 1);
+      CHECK_EQ(b.gw.stat.responses.get(), 0);
+    }
+  }
+}
+
+// Two clients keeping more requests in flight than the queue holds, the records arriving
+// in pieces as they would from the ring, and the way back full now and then
+static void test_pipeline(void) {
+  const int N = 40;
+  TBench b(115200, 10, 0xffffffff - 200000);  // the clock wraps in the middle
+  b.unit = answer;
+  std::string in;
+  std::vector<std::string> want;
+  for (int i = 0; i < N; i++) {
+    uint8_t tag = 1 + i % 2;
+    uint16_t tid = 0x100 * tag + i;
+    uint16_t addr = 100 + i;
+    in += record(tag, tid, 1, read_pdu(addr));
+    uint16_t v = addr * 3;
+    want.push_back(record(tag, tid, 1, { 0x03, 2, (char)(v >> 8), (char)v }));
+  }
+  std::mt19937 rng(7);
+  size_t pos = 0;
+  bool full = false;
+  for (int round = 0; b.net.size() < (size_t)N; round++) {
+    CHECK(round < 1000000);
+    while (pos < in.size() && b.gw.room() > 0) {
+      size_t n = std::min<size_t>(in.size() - pos, 1 + rng() % 13);
+      n = std::min<size_t>(n, b.gw.room());
+      b.gw.decode((const uint8_t *)&in[pos], n);
+      pos += n;
+    }
+    if (pos < in.size()) {
+      CHECK_EQ(b.gw.queued(), CModbusGateway::QUEUE_LEN);
+      full = true;
+    }
+    if (rng() % 64 == 0) b.refuse = 1 + rng() % 3;
+    b.step();
+  }
+  CHECK(full);
+  CHECK_EQ(b.gw.stat.max_queued.get(), CModbusGateway::QUEUE_LEN);
+  CHECK_EQ(b.uart.size(), N);
+  for (int i = 0; i < N; i++) CHECK(b.net[i] == want[i]);
+  // One request at a time, each 3.5 characters after the last byte of the response before
+  for (int i = 1; i < N; i++) CHECK(b.uart_at[i] - b.uart_at[i - 1] >= 8 * b.char_us + 500 + 6 * b.char_us + b.gw.t35());
+  CHECK_EQ(b.gw.stat.requests.get(), N);
+  CHECK_EQ(b.gw.stat.responses.get(), N);
+  CHECK_EQ(b.gw.stat.stray.get(), 0);
+  CHECK_EQ(b.gw.queued(), 0);
+}
+
+// Three ADUs, the second with the longest PDU, read the way the sessions read a socket
+static void test_assembler(void) {
+  std::vector<std::string> adus = {
+    record(0, 1, 1, read_pdu(1)).substr(1),
+    record(0, 2, 7, std::string(CModbus::MAX_PDU, 'x')).substr(1),
+    record(0, 3, 0, { 0x06, 0, 1, 0, 5 }).substr(1),
+  };
+  std::string stream;
+  for (auto &a : adus) stream += a;
+  for (size_t chunk = 1; chunk <= stream.size(); chunk++) {
+    CMbapAssembler a;
+    std::vector<std::string> got;
+    size_t pos = 0, avail = 0;
+    while (pos < stream.size()) {
+      if (avail == 0) avail = std::min<size_t>(chunk, stream.size() - pos);
+      size_t n = std::min<size_t>(a.need(), avail);
+      CHECK(n > 0);
+      memcpy(a.tail(), &stream[pos], n);
+      pos += n;
+      avail -= n;
+      CHECK(a.add(n));
+      if (a.complete()) {
+        got.push_back(std::string((const char *)a.adu(), a.len()));
+        a.reset();
+      }
+    }
+    CHECK_EQ(got.size(), adus.size());
+    for (size_t i = 0; i < adus.size(); i++) CHECK(got[i] == adus[i]);
+  }
+
+  // Not Modbus TCP: another protocol id, a length too short or too long
+  const char *bad[] = { "\x00\x01\x00\x01\x00\x06\x01", "\x00\x01\x00\x00\x00\x01\x01", "\x00\x01\x00\x00\x00\xff\x01" };
+  for (const char *h : bad) {
+    CMbapAssembler a;
+    memcpy(a.tail(), h, 3);
+    CHECK(a.add(3));
+    memcpy(a.tail(), h + 3, a.need());
+    CHECK(!a.add(4));
+  }
+}
+
+int main() {
+  test_t35();
+  test_timeout();
+  test_broadcast();
+  test_bad_responses();
+  test_pipeline();
+  test_assembler();
+  printf("ok\n");
+  return 0;
+}
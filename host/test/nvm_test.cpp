@@ -0,0 +1,115 @@
+/*
+  nvm_test
+
+  CSysNVM on the simulated 2MB flash, which like a board built without a filesystem has
+  _FS_start at the EEPROM: the journal goes to the free sectors just below it, settings
+  saved there come back after a restart, and neither the EEPROM sector nor the sketch
+  binary is touched by a save. Settings without a valid key are not saved.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <string.h>
+#include <vector>
+#include <sim/sim.h>
+#include "nvm.hpp"
+#include "check.h"
+
+extern uint8_t sim_flash[];
+
+typedef struct {
+  char key[2];
+  uint32_t baud;
+  char name[50];
+} TSettings;
+
+static TSettings now;
+static bool defaulted;
+
+static void load(void) {
+  EEPROM.get(0, now);
+}
+
+static void defaults(void) {
+  TSettings d = { { '0', '0' }, 115200, "default" };
+  EEPROM.put(0, d);
+  EEPROM.get(0, now);
+  defaulted = true;
+}
+
+static void save(uint32_t baud) {
+  static uint32_t b;
+  b = baud;
+  now.baud = b;
+  CSysNVM nvm;
+  nvm.Init(sizeof(TSettings));
+  nvm.Read(load, defaults);
+  nvm.Write([] {
+    TSettings s;
+    EEPROM.get(0, s);
+    s.baud = b;
+    EEPROM.put(0, s);
+  });
+  CHECK(nvm.Flush() >= 0);
+}
+
+// A restart: what the settings read as
+static TSettings boot(void) {
+  CSysNVM nvm;
+  defaulted = false;
+  nvm.Init(sizeof(TSettings));
+  CHECK(nvm.Journaled());
+  nvm.Read(load, defaults);
+  return now;
+}
+
+int main() {
+  const uint32_t fs = &_FS_start - sim_flash;
+  const uint32_t bin = (&__flash_binary_end - sim_flash + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE * FLASH_SECTOR_SIZE;
+  CHECK_EQ(&_FS_end - &_FS_start, 0);
+  CHECK(fs - bin >= 16 * FLASH_SECTOR_SIZE);
+  std::vector<uint8_t> before(sim_flash, sim_flash + (2u << 20));
+
+  // Blank flash gets the defaults, which are journalled
+  TSettings s = boot();
+  CHECK(defaulted);
+  CHECK_EQ(s.baud, 115200);
+  s = boot();
+  CHECK(!defaulted);
+  CHECK(strcmp(s.name, "default") == 0);
+
+  // Saves come back, at a fraction of an erase each once the journal has come round
+  uint32_t e = sim_flash_erases();
+  for (uint32_t i = 0; i < 400; i++) {
+    save(9600 + i);
+    CHECK_EQ(boot().baud, 9600 + i);
+  }
+  printf("400 saves, %u sectors erased\n", sim_flash_erases() - e);
+  CHECK(sim_flash_erases() - e > 0);
+  CHECK(sim_flash_erases() - e <= 400 / (FLASH_SECTOR_SIZE / 256) + 1);
+
+  // Without a valid key Flush() saves nothing and says so, as it did before the journal
+  CSysNVM nvm;
+  nvm.Init(sizeof(TSettings));
+  nvm.Read(load, defaults);
+  nvm.Write([] {
+    TSettings s;
+    EEPROM.get(0, s);
+    s.key[0] = 'x';
+    s.baud = 1;
+    EEPROM.put(0, s);
+  });
+  e = sim_flash_erases();
+  CHECK_EQ(nvm.Flush(), -1);
+  CHECK_EQ(boot().baud, 9600 + 399);
+  CHECK_EQ(sim_flash_erases(), e);
+
+  // Only the 16 sectors below _FS_start changed
+  for (uint32_t i = 0; i < (2u << 20); i++)
+    if (i < fs - 16 * FLASH_SECTOR_SIZE || i >= fs) CHECK_EQ(sim_flash[i], before[i]);
+  CHECK(memcmp(sim_flash + fs - 16 * FLASH_SECTOR_SIZE, before.data() + fs - 16 * FLASH_SECTOR_SIZE, 16 * FLASH_SECTOR_SIZE) != 0);
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+  packer_test
+
+  CPacker on a trace of a 921600 baud device sending small bursts every millisecond,
+  polled every 20us the way core 1 does: the bytes are the same with and without packing,
+  each threshold releases where it should, and the number of writes to the network drops
+  to about one per burst. The idle time counts the bits a character really takes, so at 8E2
+  a pause that is under the idle time is not mistaken for the end of a burst.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <random>
+#include <string>
+#include <vector>
+#include "packer.hpp"
+#include "check.h"
+
+static const uint32_t BAUD = 921600;
+static const int BITS = 10;  // 8N1
+static const uint32_t CHAR_NS = BITS * 1000000000ull / BAUD;
+static const uint32_t STEP_US = 20;
+
+// Byte i arrives at at[i] ns
+struct TTrace {
+  std::string data;
+  std::vector<uint64_t> at;
+  std::vector<size_t> bursts;  // where each burst starts
+};
+
+static TTrace record(int n, uint32_t seed) {
+  std::mt19937 rng(seed);
+  TTrace t;
+  for (int b = 0; b < n; b++) {
+    uint64_t ns = (uint64_t)b * 1000000;
+    t.bursts.push_back(t.data.size());
+    int len = 5 + rng() % 60;
+    for (int i = 0; i < len; i++, ns += CHAR_NS) {
+      t.data.push_back(0x20 + rng() % 0x40);
+      t.at.push_back(ns + CHAR_NS);
+    }
+    t.data.back() = '\n';
+  }
+  return t;
+}
+
+struct TResult {
+  std::string out;
+  std::vector<size_t> segments;  // length of each write
+  uint32_t worst_us;             // longest the last byte of a write waited after arriving
+};
+
+static TResult replay(const TTrace &t, CPacker &p, uint32_t baud = BAUD, int bits = BITS) {
+  static CSPSCRing<8192> ring;
+  ring.clear();
+  TResult r = {};
+  size_t in = 0;
+  uint64_t end = t.at.back() / 1000 + 10000;
+  for (uint64_t us = 0; us < end; us += STEP_US) {
+    while (in < t.data.size() && t.at[in] <= us * 1000) {
+      CHECK_EQ(ring.write((const uint8_t *)&t.data[in], 1), 1);
+      in++;
+    }
+    uint32_t limit = p.update(&ring, (uint32_t)us, baud, bits);
+    size_t n = limit - ring.tail_pos();
+    if (n == 0) continue;
+    CHECK(n <= ring.available());
+    uint32_t first = r.out.size();
+    r.out.resize(first + n);
+    ring.read((uint8_t *)&r.out[first], n);
+    r.segments.push_back(n);
+    uint32_t waited = us - t.at[first + n - 1] / 1000;
+    if (waited > r.worst_us) r.worst_us = waited;
+  }
+  CHECK_EQ(in, t.data.size());
+  return r;
+}
+
+int main() {
+  TTrace t = record(200, 5);
+  CPacker p;
+
+  // Off: whatever is there on each poll, a write for every other character
+  TResult off = replay(t, p);
+  CHECK(off.out == t.data);
+  CHECK(off.segments.size() > t.data.size() / 3);
+
+  // Idle gap: one write per burst, each ending with its burst
+  p.config(0, 4, -1);
+  TResult idle = replay(t, p);
+  CHECK(idle.out == t.data);
+  CHECK_EQ(idle.segments.size(), t.bursts.size());
+  for (size_t i = 0, o = 0; i < idle.segments.size(); o += idle.segments[i++]) CHECK_EQ(o, t.bursts[i]);
+  CHECK(idle.worst_us <= 4 * CHAR_NS / 1000 + 2 * STEP_US);
+  printf("%zu bytes in %zu writes, packed by idle time %zu writes\n", t.data.size(), off.segments.size(), idle.segments.size());
+
+  // Delimiter: released at the '\n' ending each burst without waiting for the idle time
+  p.config(0, 0, '\n');
+  TResult delim = replay(t, p);
+  CHECK(delim.out == t.data);
+  CHECK_EQ(delim.segments.size(), t.bursts.size());
+  CHECK(delim.worst_us <= STEP_US);
+
+  // Length alone gets the default idle time, so a burst is not held up to the next one
+  p.config(1000, 0, -1);
+  TResult len = replay(t, p);
+  CHECK(len.out == t.data);
+  CHECK(len.segments.size() <= t.bursts.size());
+  CHECK(len.worst_us <= CPacker::DEFAULT_IDLECHARS * CHAR_NS / 1000 + 2 * STEP_US);
+  // With an idle time longer than the gaps, writes of packlen and what is left at the end
+  p.config(1000, 100, -1);
+  len = replay(t, p);
+  CHECK(len.out == t.data);
+  for (size_t i = 0; i + 1 < len.segments.size(); i++) CHECK(len.segments[i] >= 1000);
+
+  // 8E2 at 115200, 12 bits a character: each burst pauses for a little under 4 characters
+  // halfway, which ends the burst only when the idle time is taken from 10 bits
+  {
+    const uint32_t baud = 115200, char_ns = 12 * 1000000000ull / baud;
+    TTrace s;
+    for (int b = 0; b < 50; b++) {
+      uint64_t ns = (uint64_t)b * 10000000;
+      s.bursts.push_back(s.data.size());
+      for (int i = 0; i < 20; i++) {
+        ns += (i == 10) ? 400000 : char_ns;
+        s.data.push_back('0' + i % 10);
+        s.at.push_back(ns);
+      }
+    }
+    p.config(0, 4, -1);
+    TResult r = replay(s, p, baud, 12);
+    CHECK(r.out == s.data);
+    CHECK_EQ(r.segments.size(), s.bursts.size());
+    r = replay(s, p, baud, 10);
+    CHECK_EQ(r.segments.size(), 2 * s.bursts.size());
+    // and a change of the bits alone is picked up
+    r = replay(s, p, baud, 12);
+    CHECK_EQ(r.segments.size(), s.bursts.size());
+  }
+
+  // Settings saved by an older firmware are off
+  p.config(0xffff, 0xff, 0xff);
+  CHECK(p.enabled());
+  p.config(0xffff, 0xff, 0x1ff);
+  CHECK(!p.enabled());
+  printf("ok\n");
+  return 0;
+}
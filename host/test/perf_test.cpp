@@ -0,0 +1,114 @@
+/*
+  perf_test
+
+  CLog2Histogram: which bucket a value goes in and where each bucket ends, at 0, 1, around
+  every power of two and at UINT32_MAX, for histograms short enough that the last bucket
+  takes everything above; and which bucket a percentile falls in, the rank rounded up so
+  that p50 of two samples is the first and p100 the largest.
+  CStampQueue: stamps come out in order, a full queue drops new ones, and drain() takes
+  every stamp up to a position, also across the wrap of positions and of the clock.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include "perf.hpp"
+#include "check.h"
+
+// Every value lies in its bucket, below its upper edge and not below the one before
+template< std::size_t N > static void edges(void) {
+  typedef CLog2Histogram<N> H;
+  CHECK_EQ(H::index(0), 0);
+  CHECK_EQ(H::index(1), 0);
+  CHECK_EQ(H::upper(0), 2);
+  for (int k = 1; k < 32; k++) {
+    uint32_t p = (uint32_t)1 << k;
+    size_t i = (size_t)k < N - 1 ? k : N - 1;
+    CHECK_EQ(H::index(p - 1), (size_t)k - 1 < N - 1 ? k - 1 : N - 1);
+    CHECK_EQ(H::index(p), i);
+    CHECK_EQ(H::index(p + 1), (k == 1) ? 1 : i);
+  }
+  CHECK_EQ(H::index(UINT32_MAX), N - 1);
+  CHECK_EQ(H::upper(N - 1), UINT32_MAX);
+  const uint32_t vs[] = { 0, 1, 2, 3, 4, 5, 7, 8, 1000, 65535, 65536, 1u << 23, (1u << 24) - 1, 1u << 24, 1u << 30, 1u << 31, UINT32_MAX - 1, UINT32_MAX };
+  for (uint32_t v : vs) {
+    size_t i = H::index(v);
+    CHECK(i < N);
+    CHECK(v < H::upper(i) || H::upper(i) == UINT32_MAX);
+    if (i > 0) CHECK(v >= H::upper(i - 1));
+  }
+}
+
+int main() {
+  edges<4>();
+  edges<24>();
+  edges<32>();
+
+  // Percentiles: the rank is the fraction of the count rounded up, the answer its bucket's edge
+  CLog2Histogram<> h;
+  CHECK_EQ(h.percentile(500), 0);
+  h.add(1);
+  h.add(100);
+  CHECK_EQ(h.total(), 2);
+  CHECK_EQ(h.percentile(0), 2);
+  CHECK_EQ(h.percentile(500), 2);
+  CHECK_EQ(h.percentile(501), 128);
+  CHECK_EQ(h.percentile(1000), 128);
+  // 100 samples, 90 below 16, 9 below 1024, 1 far out
+  CLog2Histogram<> g;
+  for (int i = 0; i < 90; i++) g.add(10);
+  for (int i = 0; i < 9; i++) g.add(1000);
+  g.add(50000000);
+  CHECK_EQ(g.count(3), 90);
+  CHECK_EQ(g.count(9), 9);
+  CHECK_EQ(g.count(23), 1);
+  CHECK_EQ(g.percentile(900), 16);
+  CHECK_EQ(g.percentile(901), 1024);
+  CHECK_EQ(g.percentile(990), 1024);
+  CHECK_EQ(g.percentile(991), UINT32_MAX);
+  // A short histogram, whose last bucket has no upper edge
+  CLog2Histogram<4> f;
+  for (int i = 0; i < 3; i++) f.add(UINT32_MAX);
+  CHECK_EQ(f.percentile(1), UINT32_MAX);
+
+  // Stamps in order, dropped when full
+  CStampQueue<4> q;
+  uint32_t pos, t;
+  CHECK(!q.front(pos, t));
+  for (uint32_t i = 0; i < 4; i++) CHECK(q.push(100 * (i + 1), i));
+  CHECK(!q.push(500, 4));
+  CHECK(q.front(pos, t));
+  CHECK_EQ(pos, 100);
+  CHECK_EQ(t, 0);
+
+  // drain() takes what was passed and times it, the rest stays
+  CLog2Histogram<> lat;
+  q.drain(250, 64, lat);
+  CHECK_EQ(lat.total(), 2);
+  CHECK_EQ(lat.count(CLog2Histogram<>::index(64)), 1);
+  CHECK_EQ(lat.count(CLog2Histogram<>::index(63)), 1);
+  CHECK(q.front(pos, t));
+  CHECK_EQ(pos, 300);
+  CHECK(q.push(500, 4));
+  CHECK(q.push(600, 5));
+  CHECK(!q.push(700, 6));
+
+  // Positions and the clock both wrap
+  CStampQueue<4> w;
+  CHECK(w.push(0xffffff00, 0xfffffff0));
+  CHECK(w.push(0x00000010, 0xfffffff8));
+  CHECK(w.push(0x00000100, 0x00000004));
+  CLog2Histogram<> wl;
+  w.drain(0x00000010, 0x00000010, wl);
+  CHECK_EQ(wl.total(), 2);
+  CHECK_EQ(wl.count(CLog2Histogram<>::index(0x20)), 1);
+  CHECK_EQ(wl.count(CLog2Histogram<>::index(0x18)), 1);
+  CHECK(w.front(pos, t));
+  CHECK_EQ(pos, 0x100);
+  w.drain(0x00000100, 0x00000008, wl);
+  CHECK_EQ(wl.total(), 3);
+  CHECK(!w.front(pos, t));
+  printf("ok\n");
+  return 0;
+}
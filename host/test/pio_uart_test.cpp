@@ -0,0 +1,112 @@
+/*
+  pio_uart_test
+
+  The PIO UART: the divider for every baudrate from 300 to the maximum lands within 1%
+  of it and reports what it actually gives, and CPioUart on GPIO 10/11, looped back on
+  itself, behaves like CUartDMA through CUartBase: write(), available(), readBytes(),
+  flush(), getActualBaud(), a framing error on a bad stop bit, and many laps of both rings.
+  Running out of state machines makes begin() fail cleanly.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdlib.h>
+#include <hardware/clocks.h>
+#include <sim/sim.h>
+#include "piodiv.hpp"
+#include "us_pio.h"
+#include "check.h"
+
+static void divider(void) {
+  // RP2040 and RP2350 at their usual system clocks, 300bps needs a divider just short of the maximum at 150MHz
+  const uint32_t clocks[] = { 125000000, 133000000, 150000000 };
+  for (uint32_t sys : clocks) {
+    for (uint32_t b = 300; b <= sys / 8; b += (b < 10000) ? 300 : b / 16) {
+      TPioDiv d = piodiv_from_baud(sys, b, 8);
+      uint32_t a = piodiv_to_baud(sys, d, 8);
+      CHECK(llabs((long long)a - b) * 100 <= b);
+      // The 1/256 steps are the best there is
+      CHECK_EQ(a, (uint32_t)(((uint64_t)sys * 256 + ((d.integer << 8 | d.frac) * 8) / 2) / ((d.integer << 8 | d.frac) * 8)));
+    }
+    // Out of range either way is clamped, not wrapped
+    TPioDiv lo = piodiv_from_baud(sys, 10, 8), hi = piodiv_from_baud(sys, sys, 8);
+    CHECK(lo.integer == 0xffff && lo.frac == 0xff);
+    CHECK(hi.integer == 1 && hi.frac == 0);
+    CHECK_EQ(piodiv_to_baud(sys, hi, 8), sys / 8);
+    TPioDiv z = piodiv_from_baud(sys, 0, 8);
+    CHECK(z.integer == 0xffff);
+  }
+}
+
+static uint8_t pattern(uint32_t i) {
+  return i * 53 + 7;
+}
+
+static void loopback(void) {
+  static CPioUart u;
+  sim_line_loopback(10, 11);
+  uint32_t a = u.begin(10, 11, 115200, 256, 256);
+  CHECK(a != 0);
+  CHECK_EQ(u.getActualBaud(), a);
+  CHECK(a > 115200 * 99 / 100 && a < 115200 * 101 / 100);
+  CHECK_EQ(u.available(), 0);
+  const uint32_t char_us = 10 * 1000000 / a + 1;
+
+  // Many laps of both rings in pieces of every size
+  uint32_t w = 0, r = 0;
+  for (int k = 0; k < 300; k++) {
+    uint8_t b[200];
+    size_t n = 1 + (k * 37) % 200;
+    n = std::min(n, u.availableForWrite());
+    for (size_t i = 0; i < n; i++) b[i] = pattern(w + i);
+    CHECK_EQ(u.write(b, n), n);
+    w += n;
+    sim_advance(60 * char_us);
+    size_t m = u.readBytes(b, std::min(u.available(), sizeof(b)));
+    for (size_t i = 0; i < m; i++) CHECK_EQ(b[i], pattern(r + i));
+    r += m;
+  }
+  u.flush();
+  sim_advance(300 * char_us);
+  uint8_t b[256];
+  while (r < w) {
+    size_t m = u.readBytes(b, std::min(u.available(), sizeof(b)));
+    CHECK(m > 0);
+    for (size_t i = 0; i < m; i++) CHECK_EQ(b[i], pattern(r + i));
+    r += m;
+  }
+  CHECK_EQ(u.availableForWrite(), u.getTxBufferSize());
+  TUartRxStats s = u.getRxStats();
+  CHECK_EQ(s.overruns, 0);
+  CHECK_EQ(s.received, w);
+  CHECK_EQ(u.takeLineErrors(), 0);
+
+  // A character with a bad stop bit is not pushed by the program, only flagged
+  sim_line_loopback(10, -1);
+  sim_line_send(11, "z", 1, CUartBase::LINE_FRAMING);
+  sim_advance(3 * char_us);
+  CHECK_EQ(u.available(), 0);
+  CHECK((u.takeLineErrors() & CUartBase::LINE_FRAMING) != 0);
+  CHECK_EQ(u.getRxStats().framing, 1);
+}
+
+static void exhausted(void) {
+  // Two state machines each, four to a block, one of them taken above
+  static CPioUart u[2 * NUM_PIOS];
+  int ok = 0;
+  for (CPioUart &p : u) ok += (p.begin(12, 13, 9600, 64, 64) != 0);
+  CHECK_EQ(ok, 2 * NUM_PIOS - 1);
+  CHECK_EQ(u[2 * NUM_PIOS - 1].getActualBaud(), 0);
+  CHECK_EQ(u[2 * NUM_PIOS - 1].available(), 0);
+}
+
+int main() {
+  divider();
+  sim_clock_manual(true);
+  sim_hw_step();
+  loopback();
+  exhausted();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+  pusr_test
+
+  CPUSRDecoder against a byte by byte reference: random streams of data, packets and
+  packet look-alikes, fed in reads split at random places, must give the same data and
+  the same packets at the same positions. A tail that may start a packet is handed over
+  by flush() or by poll() once it has been held for HOLD_US.
+  Ends with the decoding rate of a stream of text, 0x55 included, with a packet every 64KB.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "pusr.hpp"
+#include "check.h"
+
+// Data bytes, with a marker for every packet at the place it was found
+struct TOut {
+  std::vector<int> v;
+  size_t count;
+};
+
+static void on_data(const uint8_t *p, size_t len, void *any) {
+  CHECK(len > 0);
+  for (size_t i = 0; i < len; i++) ((TOut *)any)->v.push_back(p[i]);
+}
+
+static void on_config(const uint8_t *pkt, void *any) {
+  CHECK(CPUSRDecoder::is_packet(pkt));
+  ((TOut *)any)->v.push_back(-1 - (pkt[3] << 16 | pkt[4] << 8 | pkt[5]));
+}
+
+static std::vector<int> reference(const std::vector<uint8_t> &s) {
+  std::vector<int> v;
+  for (size_t i = 0; i < s.size();) {
+    if (i + CPUSRDecoder::PACKET_LEN <= s.size() && CPUSRDecoder::is_packet(&s[i])) {
+      v.push_back(-1 - (s[i + 3] << 16 | s[i + 4] << 8 | s[i + 5]));
+      i += CPUSRDecoder::PACKET_LEN;
+    } else
+      v.push_back(s[i++]);
+  }
+  return v;
+}
+
+static void packet(std::vector<uint8_t> &s, uint32_t baud, uint8_t param, bool good) {
+  uint8_t p[8] = { 0x55, 0xaa, 0x55, (uint8_t)(baud >> 16), (uint8_t)(baud >> 8), (uint8_t)baud, param, 0 };
+  p[7] = p[3] + p[4] + p[5] + p[6] + (good ? 0 : 1);
+  s.insert(s.end(), p, p + 8);
+}
+
+static std::vector<int> decode(const std::vector<uint8_t> &s, std::mt19937 &rng) {
+  TOut out;
+  CPUSRDecoder d;
+  d.begin(on_data, on_config, &out);
+  for (size_t o = 0; o < s.size();) {
+    size_t n = 1 + rng() % ((rng() % 4 == 0) ? 40 : 9);
+    n = std::min(n, s.size() - o);
+    d.decode(&s[o], n);
+    CHECK(d.pending() < CPUSRDecoder::PACKET_LEN);
+    o += n;
+  }
+  d.flush();
+  CHECK_EQ(d.pending(), 0);
+  return out.v;
+}
+
+int main() {
+  std::mt19937 rng(2026);
+
+  for (int round = 0; round < 20000; round++) {
+    std::vector<uint8_t> s;
+    int parts = 1 + rng() % 12;
+    for (int k = 0; k < parts; k++) {
+      switch (rng() % 7) {
+        case 0:
+          packet(s, 9600 + rng() % 1000000, rng(), true);
+          break;
+        case 1:
+          packet(s, rng(), rng(), false);
+          break;
+        case 2: {
+          // Heads of a packet, cut short
+          static const uint8_t head[] = { 0x55, 0xaa, 0x55, 0x55, 0xaa, 0x55 };
+          s.insert(s.end(), head, head + 1 + rng() % 6);
+          break;
+        }
+        case 3:
+          s.push_back(0x55);
+          break;
+        default:
+          for (int n = rng() % 20; n > 0; n--) s.push_back((rng() % 3 == 0) ? 0x55 + (rng() % 2) * 0x55 : rng());
+          break;
+      }
+    }
+    CHECK(decode(s, rng) == reference(s));
+  }
+
+  // A trailing head stays held until something decides it
+  TOut out;
+  CPUSRDecoder d;
+  d.begin(on_data, on_config, &out);
+  const uint8_t tail[] = { 'a', 'b', 0x55, 0xaa };
+  d.decode(tail, sizeof(tail));
+  CHECK_EQ(out.v.size(), 2);
+  CHECK_EQ(d.pending(), 2);
+
+  // poll() hands it over once nothing has followed for HOLD_US
+  uint32_t t = 0xfffff000;  // and across the wrap of the clock
+  CHECK(!d.poll(t));
+  CHECK(!d.poll(t + CPUSRDecoder::HOLD_US - 1));
+  CHECK(d.poll(t + CPUSRDecoder::HOLD_US));
+  CHECK_EQ(d.pending(), 0);
+  CHECK(out.v == std::vector<int>({ 'a', 'b', 0x55, 0xaa }));
+  CHECK(!d.poll(t + 2 * CPUSRDecoder::HOLD_US));
+
+  // More data restarts the wait, and a completed packet is still one
+  out.v.clear();
+  const uint8_t p1[] = { 0x55, 0xaa }, p2[] = { 0x55, 0x01, 0xc2, 0x00, 0x03 }, p3[] = { 0xc6 };
+  d.decode(p1, sizeof(p1));
+  CHECK(!d.poll(t));
+  d.decode(p2, sizeof(p2));
+  CHECK(!d.poll(t + CPUSRDecoder::HOLD_US));
+  CHECK(!d.poll(t + 2 * CPUSRDecoder::HOLD_US - 1));
+  d.decode(p3, sizeof(p3));
+  CHECK(out.v == std::vector<int>({ -1 - 115200 }));
+  CHECK_EQ(d.pending(), 0);
+
+  // reset() forgets a head, as a new client starts afresh
+  out.v.clear();
+  d.decode(p1, sizeof(p1));
+  d.reset();
+  CHECK_EQ(d.pending(), 0);
+  CHECK(!d.poll(t + 10 * CPUSRDecoder::HOLD_US));
+  CHECK(out.v.empty());
+
+  // Rate on a stream with a baudrate change every 64KB
+  std::vector<uint8_t> big;
+  for (int k = 0; k < 64; k++) {
+    std::vector<uint8_t> r(65536);
+    for (uint8_t &c : r) c = 0x20 + rng() % 0x40;
+    big.insert(big.end(), r.begin(), r.end());
+    packet(big, 115200, 0x03, true);
+  }
+  d.begin([](const uint8_t *p, size_t len, void *any) { ((TOut *)any)->count += len; }, [](const uint8_t *pkt, void *any) {}, &out);
+  out.count = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  const int reps = 16;
+  for (int r = 0; r < reps; r++)
+    for (size_t o = 0; o < big.size(); o += 1460) d.decode(&big[o], std::min((size_t)1460, big.size() - o));
+  d.flush();
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  CHECK_EQ(out.count, (size_t)reps * 64 * 65536);
+  printf("ok, %.0f MB/s in 1460 byte reads\n", reps * big.size() / sec / 1e6);
+  return 0;
+}
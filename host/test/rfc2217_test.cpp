@@ -0,0 +1,155 @@
+/*
+  rfc2217_test
+
+  CRfc2217 against a network side that takes only as much as it is told to: option
+  negotiation, COM-PORT-OPTION requests split over reads, replies waiting in order while
+  there is no room and handed over by flush(), modem state notifications with their
+  delta bits, and the client's masks.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string>
+#include "rfc2217.hpp"
+#include "check.h"
+
+typedef std::basic_string<uint8_t> bytes;
+
+struct TPeer {
+  bytes uart, net;
+  size_t room;  // what the network takes before it refuses
+  uint32_t baud;
+  uint8_t modem;
+};
+
+static const TRfc2217Callbacks callbacks = {
+  [](const uint8_t *p, size_t len, void *any) {
+    ((TPeer *)any)->uart.append(p, len);
+  },
+  [](const uint8_t *p, size_t len, void *any) {
+    TPeer *t = (TPeer *)any;
+    if (len > t->room) return false;
+    t->room -= len;
+    t->net.append(p, len);
+    return true;
+  },
+  [](uint32_t baud, void *any) {
+    TPeer *t = (TPeer *)any;
+    if (baud != 0) t->baud = baud;
+    return t->baud;
+  },
+  NULL,
+  NULL,
+  NULL,
+  [](void *any) {
+    return ((TPeer *)any)->modem;
+  }
+};
+
+static const uint8_t IAC = CRfc2217::IAC, SB = CRfc2217::SB, SE = CRfc2217::SE, COM = CRfc2217::OPT_COM_PORT;
+
+static bytes subneg(uint8_t cmd, bytes v) {
+  bytes b = { IAC, SB, COM, cmd };
+  for (uint8_t c : v) {
+    if (c == IAC) b.push_back(IAC);
+    b.push_back(c);
+  }
+  b.push_back(IAC);
+  b.push_back(SE);
+  return b;
+}
+
+static bytes take(TPeer &t) {
+  bytes b = t.net;
+  t.net.clear();
+  return b;
+}
+
+int main() {
+  TPeer t = {};
+  t.room = SIZE_MAX;
+  t.baud = 115200;
+  t.modem = 0xb0;
+  CRfc2217 r;
+  r.begin(&callbacks, &t);
+
+  // Nothing is told before the client agrees to COM-PORT-OPTION, then the modem lines are
+  r.notify_modemstate(0xa0);
+  CHECK(take(t).empty());
+  const uint8_t will[] = { IAC, CRfc2217::WILL, COM };
+  r.decode(will, sizeof(will));
+  CHECK(take(t) == bytes({ IAC, CRfc2217::DO, COM }) + subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, { 0xb0 }));
+
+  // Data around an escaped IAC and a baudrate request split over reads
+  bytes req = bytes({ 'a', IAC, IAC, 'b' }) + subneg(CRfc2217::SET_BAUDRATE, { 0x00, 0x01, 0xc2, 0x00 }) + bytes({ 'c' });
+  for (size_t i = 0; i < req.size(); i++) r.decode(&req[i], 1);
+  CHECK(t.uart == bytes({ 'a', IAC, 'b', 'c' }));
+  CHECK_EQ(t.baud, 115200);
+  CHECK(take(t) == subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_BAUDRATE, { 0x00, 0x01, 0xc2, 0x00 }));
+
+  // No room: the replies wait in order, data encoded meanwhile goes behind them
+  t.room = 0;
+  bytes two = subneg(CRfc2217::SET_BAUDRATE, { 0x00, 0x00, 0x25, 0x80 }) + subneg(CRfc2217::SET_LINESTATE_MASK, { 0x1e });
+  r.decode(two.data(), two.size());
+  const uint8_t d[] = { 'x', IAC };
+  r.encode(d, sizeof(d));
+  CHECK(t.net.empty());
+  bytes want = subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_BAUDRATE, { 0x00, 0x00, 0x25, 0x80 })
+               + subneg(CRfc2217::SERVER_OFFSET + CRfc2217::SET_LINESTATE_MASK, { 0x1e }) + bytes({ 'x', IAC, IAC });
+  CHECK_EQ(r.pending(), want.size());
+  // All of it goes at once or not at all
+  t.room = want.size() - 1;
+  CHECK(!r.flush());
+  CHECK(t.net.empty());
+  t.room = SIZE_MAX;
+  CHECK(r.flush());
+  CHECK_EQ(r.pending(), 0);
+  CHECK(take(t) == want);
+
+  // What does not fit even there is dropped whole
+  t.room = 0;
+  bytes sig = subneg(CRfc2217::SIGNATURE, {});
+  int n = 0;
+  while (r.dropped == 0) {
+    r.decode(sig.data(), sig.size());
+    n++;
+  }
+  CHECK(n > 1);
+  CHECK(r.pending() <= CRfc2217::MAX_PENDING);
+  t.room = SIZE_MAX;
+  CHECK(r.flush());
+  bytes all = take(t);
+  size_t each = all.size() / (n - 1);
+  CHECK_EQ(all.size(), each * (n - 1));
+  for (int i = 1; i < n - 1; i++) CHECK(all.compare(i * each, each, all, 0, each) == 0);
+
+  // Modem state: only changes, with the delta bits, through the client's mask
+  r.notify_modemstate(0xb0);
+  CHECK(take(t).empty());
+  r.notify_modemstate(0xa0);
+  CHECK(take(t) == subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, { 0xa1 }));
+  bytes m = subneg(CRfc2217::SET_MODEMSTATE_MASK, { 0x01 });
+  r.decode(m.data(), m.size());
+  take(t);
+  r.notify_modemstate(0xa0);
+  r.notify_modemstate(0xb0);
+  CHECK(take(t) == subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_MODEMSTATE, { 0x01 }));
+
+  // Line state through its mask, 0x1e from above
+  r.notify_linestate(0x01);
+  CHECK(take(t).empty());
+  r.notify_linestate(CRfc2217::LINE_FRAMING | 0x01);
+  CHECK(take(t) == subneg(CRfc2217::SERVER_OFFSET + CRfc2217::NOTIFY_LINESTATE, { CRfc2217::LINE_FRAMING }));
+
+  // A new client starts over, nothing of the old one waits
+  t.room = 0;
+  r.notify_linestate(CRfc2217::LINE_BREAK);
+  CHECK(r.pending() > 0);
+  r.reset();
+  CHECK_EQ(r.pending(), 0);
+  r.notify_linestate(CRfc2217::LINE_BREAK);
+  CHECK_EQ(r.pending(), 0);
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+  seqlock_test
+
+  CSeqLock with a writer and a reader on threads of their own: every snapshot read is one
+  the writer wrote whole, for a struct of 64 bit counts as big as TUartRxStats. Then the
+  sketch: `i` run over and over while a port receives shows UART receive counts that only
+  grow, never read past received, and end at what was sent, read or, if the host kept core 1
+  off the CPU long enough for the RX ring to overrun, counted lost.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <sim/sim.h>
+#include <sim/sketch.h>
+#include "seqlock.hpp"
+#include "check.h"
+
+// Every field from the same update k
+typedef struct {
+  uint64_t a;
+  uint32_t b;
+  uint64_t c;
+  uint32_t d[6];
+} TTorn;
+
+static bool whole(const TTorn &v) {
+  for (int i = 0; i < 6; i++)
+    if (v.d[i] != (uint32_t)v.a * 7 + i) return false;
+  return v.b == (uint32_t)(v.a >> 3) && v.c == ~v.a;
+}
+
+static void torture(void) {
+  static CSeqLock<TTorn> lock;
+  std::atomic<bool> stop(false);
+  std::thread writer([&] {
+    TTorn v;
+    // Halves that differ from one update to the next, so a mix of two shows
+    for (uint64_t k = 1; !stop.load(std::memory_order_relaxed); k++) {
+      v.a = k * 0x100000001ull;
+      v.b = (uint32_t)(v.a >> 3);
+      v.c = ~v.a;
+      for (int i = 0; i < 6; i++) v.d[i] = (uint32_t)v.a * 7 + i;
+      lock.write(v);
+      if ((k & 0xff) == 0) std::this_thread::yield();
+    }
+  });
+  uint64_t prev = 0;
+  uint32_t reads = 0, retries = 0;
+  for (auto t0 = std::chrono::steady_clock::now(); std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(1500);) {
+    TTorn v;
+    if (!lock.try_read(v)) {
+      retries++;
+      continue;
+    }
+    reads++;
+    if (v.a == 0) continue;
+    CHECK(whole(v));
+    CHECK(v.a >= prev);
+    prev = v.a;
+    if ((reads & 0xff) == 0) std::this_thread::yield();
+  }
+  stop.store(true);
+  writer.join();
+  printf("%u reads, %u retried, last update %u\n", reads, retries, lock.version());
+  CHECK(reads > 1000 && prev > 0);
+}
+
+// `i` until its report is through, with the receive counts of port 0
+static void info(unsigned long long &received, unsigned long long &read, unsigned long long &lost) {
+  std::string out;
+  sim_serial_output();
+  sim_serial_type("i");
+  for (int i = 0; i < 1000 && out.find("UART errors") == std::string::npos; i++) {
+    out += sim_serial_output();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(out.find("UART errors") != std::string::npos);
+  size_t at = out.rfind("UART RX", out.find("bytes, read"));
+  CHECK(at != std::string::npos);
+  CHECK_EQ(sscanf(out.c_str() + at, "UART RX %llu bytes, read %llu, ring overruns %*u (%llu bytes lost)", &received, &read, &lost), 3);
+}
+
+int main() {
+  torture();
+
+  sim_sketch_config([](TNetInfo &n) {
+    n.baudrate = 921600;
+  });
+  sim_sketch_start();
+  int fd = sim_connect(sim_sketch_port(0));
+  CHECK(fd >= 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  const size_t TOTAL = 64 * 1024;
+  std::thread line([] {
+    uint8_t b[1024];
+    for (size_t i = 0; i < TOTAL; i += sizeof(b)) {
+      for (size_t j = 0; j < sizeof(b); j++) b[j] = i + j;
+      sim_line_send(5, b, sizeof(b));
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+  unsigned long long received = 0, read = 0, lost = 0, prev = 0;
+  size_t got = 0;
+  int reports = 0;
+  while (got + lost < TOTAL) {
+    uint8_t r[4096];
+    got += sim_fd_read(fd, r, sizeof(r), 1);
+    info(received, read, lost);
+    CHECK(read <= received && received <= TOTAL);
+    CHECK(read >= prev);
+    prev = read;
+    reports++;
+  }
+  line.join();
+  for (int i = 0; i < 100 && read + lost < TOTAL; i++) info(received, read, lost);
+  CHECK_EQ(received, TOTAL);
+  CHECK_EQ(read + lost, TOTAL);
+  printf("%d reports while receiving, %llu bytes lost\n", reports, lost);
+
+  close(fd);
+  sim_sketch_stop();
+  printf("ok\n");
+  return 0;
+}
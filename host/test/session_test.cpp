@@ -0,0 +1,264 @@
+/*
+  session_test
+
+  CSessions on the simulated WiFiServer: UART data fanned out to every client, which
+  client may write to the UART under each arbitration, what happens to a client that
+  stops reading under each slow client policy, the limit on clients, and the backlog
+  replayed to clients that come while nobody or a replaying client is connected.
+  The clock is manual, so the timeouts are exact.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <sim/sim.h>
+#include "session.hpp"
+#include "check.h"
+
+static uint16_t next_port = 7000;
+
+struct TBench {
+  uint16_t port;
+  WiFiServer server;
+  CSPSCRing<8192> rx, tx;
+  CSessions s;
+
+  TBench(uint8_t arb, uint8_t slow) : port(next_port++), server(port) {
+    server.begin();
+    s.begin(&rx, &tx, arb, slow);
+  }
+  ~TBench() { s.end(); server.end(); }
+  void poll(int n = 3) {
+    while (n-- > 0) s.poll(&server, rx.head_pos());
+  }
+  int connect(void) {
+    int fd = sim_connect(port);
+    CHECK(fd >= 0);
+    poll();
+    return fd;
+  }
+  std::string to_uart(void) {
+    std::string r(tx.available(), '\0');
+    tx.read((uint8_t *)&r[0], r.size());
+    return r;
+  }
+};
+
+static std::string pattern(size_t n, int seed) {
+  std::string s(n, '\0');
+  for (size_t i = 0; i < n; i++) s[i] = (char)(i * 13 + seed);
+  return s;
+}
+
+static void fanout(void) {
+  TBench b(CSessions::tFirst, CSessions::tWait);
+  int fd[3];
+  for (int &f : fd) f = b.connect();
+  CHECK_EQ(b.s.clients(), 3);
+
+  // More than the ring holds, each client gets all of it once
+  std::string d = pattern(20000, 1);
+  size_t o = 0, got[3] = {};
+  std::string in[3];
+  while (o < d.size() || got[0] < d.size() || got[1] < d.size() || got[2] < d.size()) {
+    o += b.rx.write((const uint8_t *)&d[o], d.size() - o);
+    b.poll(1);
+    for (int i = 0; i < 3; i++) {
+      char buf[4096];
+      size_t n = sim_fd_read(fd[i], buf, sizeof(buf), 1);
+      in[i].append(buf, n);
+      got[i] += n;
+    }
+  }
+  for (int i = 0; i < 3; i++) CHECK(in[i] == d);
+  for (int f : fd) close(f);
+  b.poll();
+  CHECK_EQ(b.s.clients(), 0);
+}
+
+static void arbitration(void) {
+  // First: the first client keeps the UART, the others' data is dropped
+  {
+    TBench b(CSessions::tFirst, CSessions::tWait);
+    int a = b.connect(), c = b.connect();
+    uint32_t g = b.s.generation();
+    sim_fd_write(a, "from a", 6);
+    sim_fd_write(c, "from c", 6);
+    b.poll();
+    CHECK(b.to_uart() == "from a");
+    // It passes to the longest connected client when the owner leaves
+    close(a);
+    b.poll();
+    CHECK(b.s.generation() != g);
+    sim_fd_write(c, "now c", 5);
+    b.poll();
+    CHECK(b.to_uart() == "now c");
+    close(c);
+  }
+  // Last: the newest client takes over
+  {
+    TBench b(CSessions::tLast, CSessions::tWait);
+    int a = b.connect();
+    uint32_t g = b.s.generation();
+    int c = b.connect();
+    CHECK(b.s.generation() != g);
+    sim_fd_write(a, "from a", 6);
+    sim_fd_write(c, "from c", 6);
+    b.poll();
+    CHECK(b.to_uart() == "from c");
+    close(a);
+    close(c);
+  }
+  // Demand: a client that sends takes over once the owner has been quiet for ARB_IDLE_MS
+  {
+    TBench b(CSessions::tDemand, CSessions::tWait);
+    int a = b.connect(), c = b.connect();
+    sim_fd_write(a, "a1", 2);
+    b.poll();
+    sim_advance((CSessions::ARB_IDLE_MS - 10) * 1000);
+    sim_fd_write(c, "c1", 2);
+    b.poll();
+    CHECK(b.to_uart() == "a1");
+    sim_advance(11 * 1000);
+    sim_fd_write(c, "c2", 2);
+    b.poll();
+    CHECK(b.to_uart() == "c2");
+    sim_fd_write(a, "a2", 2);
+    b.poll();
+    CHECK(b.to_uart() == "");
+    close(a);
+    close(c);
+  }
+}
+
+// Offers 4KB every 10ms while fast reads and the other client does not, returns what fast got
+static size_t starve(TBench &b, int fast, uint32_t ms) {
+  std::string d = pattern(4096, 2);
+  size_t got = 0;
+  for (uint32_t t = 0; t < ms; t += 10) {
+    b.rx.write((const uint8_t *)d.data(), d.size());
+    b.poll(1);
+    char buf[65536];
+    got += sim_fd_read(fast, buf, sizeof(buf), 0);
+    sim_advance(10 * 1000);
+  }
+  return got;
+}
+
+static void slow(void) {
+  // Wait: the slow client holds everyone up, nothing is lost
+  {
+    TBench b(CSessions::tFirst, CSessions::tWait);
+    int fast = b.connect(), lazy = b.connect();
+    // No further than what the other's socket and the ring hold
+    CHECK(starve(b, fast, 2 * CSessions::SLOW_TIMEOUT_MS) <= 11680 + 8192);
+    CHECK_EQ(b.s.clients(), 2);
+    CHECK_EQ(b.rx.space(), 0);
+    close(fast);
+    close(lazy);
+  }
+  // Drop: it skips ahead and the ring keeps moving
+  {
+    TBench b(CSessions::tFirst, CSessions::tDrop);
+    int fast = b.connect(), lazy = b.connect();
+    // A ring's worth more every SLOW_TIMEOUT_MS
+    CHECK(starve(b, fast, 4 * CSessions::SLOW_TIMEOUT_MS) >= 11680 + 3 * 8192);
+    CHECK_EQ(b.s.clients(), 2);
+    close(fast);
+    close(lazy);
+  }
+  // Disconnect: it is let go of
+  {
+    TBench b(CSessions::tFirst, CSessions::tDisconnect);
+    int fast = b.connect(), lazy = b.connect();
+    starve(b, fast, 2 * CSessions::SLOW_TIMEOUT_MS);
+    CHECK_EQ(b.s.clients(), 1);
+    std::string all = sim_fd_read_all(lazy, 50);
+    CHECK(all.size() > 0);  // what it had been sent, then the end
+    char c;
+    CHECK_EQ(read(lazy, &c, 1), 0);
+    close(fast);
+    close(lazy);
+  }
+}
+
+static void limit(void) {
+  TBench b(CSessions::tFirst, CSessions::tWait);
+  std::vector<int> fd;
+  for (int i = 0; i < CSessions::MAX_SESSIONS; i++) fd.push_back(b.connect());
+  CHECK_EQ(b.s.clients(), CSessions::MAX_SESSIONS);
+  int extra = b.connect();
+  CHECK_EQ(b.s.clients(), CSessions::MAX_SESSIONS);
+  char c;
+  CHECK_EQ(sim_fd_read(extra, &c, 1, 100), 0);
+  CHECK_EQ(read(extra, &c, 1), 0);
+  close(extra);
+  // A slot that frees up can be taken again
+  close(fd[1]);
+  b.poll();
+  fd[1] = b.connect();
+  CHECK_EQ(b.s.clients(), CSessions::MAX_SESSIONS);
+  for (int f : fd) close(f);
+}
+
+// Reads what fd has until it has n bytes
+static std::string drain(TBench &b, int fd, size_t n) {
+  std::string r;
+  for (int i = 0; i < 10000 && r.size() < n; i++) {
+    char buf[4096];
+    r.append(buf, sim_fd_read(fd, buf, sizeof(buf), 1));
+    b.poll(1);
+  }
+  return r;
+}
+
+static void feed(TBench &b, const std::string &d) {
+  for (size_t o = 0; o < d.size(); b.poll(1)) o += b.rx.write((const uint8_t *)&d[o], d.size() - o);
+}
+
+static void replay(void) {
+  static uint8_t buf[64 * 1024];
+  TBench b(CSessions::tFirst, CSessions::tWait);
+  b.s.setBacklog(buf, sizeof(buf), 0);
+
+  // Kept while nobody is there
+  std::string held = pattern(30000, 3);
+  feed(b, held);
+  // The first client does not read yet, so it is still replaying when the second comes
+  int a = b.connect();
+  std::string live1 = pattern(3000, 4);
+  feed(b, live1);
+  int c = b.connect();
+  std::string live2 = pattern(3000, 5);
+  feed(b, live2);
+  // Both get all that was held and everything since, without a gap or a repeat
+  std::string want = held + live1 + live2;
+  CHECK(drain(b, a, want.size()) == want);
+  CHECK(drain(b, c, want.size()) == want);
+
+  // Once everyone has had it, a newcomer only gets live data
+  int d = b.connect();
+  std::string live3 = pattern(1000, 6);
+  feed(b, live3);
+  CHECK(drain(b, d, live3.size()) == live3);
+  CHECK(drain(b, a, live3.size()) == live3);
+  close(a);
+  close(c);
+  close(d);
+  b.poll();
+  CHECK_EQ(b.s.clients(), 0);
+}
+
+int main() {
+  sim_clock_manual(true);
+  fanout();
+  arbitration();
+  slow();
+  limit();
+  replay();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,149 @@
+/*
+  spsc_test
+
+  CSPSCRing and CSPSCQueue: the spans across the end of the ring, cursors and release_to(),
+  and a producer and a consumer thread passing a numbered stream in pieces of every size,
+  which has to arrive whole and in order.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <random>
+#include <thread>
+#include <vector>
+#include "spsc.hpp"
+#include "check.h"
+
+static uint8_t pattern(uint32_t i) {
+  return i ^ (i >> 8) ^ (i >> 16);
+}
+
+static void single(void) {
+  CSPSCRing<64> r;
+  uint8_t b[128];
+  TRingSpan s1, s2;
+  CHECK_EQ(r.size(), 64);
+  CHECK_EQ(r.space(), 64);
+  CHECK_EQ(r.available(), 0);
+  CHECK_EQ(r.peek(s1, s2), 0);
+
+  // Full, then nothing more is taken
+  for (int i = 0; i < 100; i++) b[i] = pattern(i);
+  CHECK_EQ(r.write(b, 100), 64);
+  CHECK_EQ(r.space(), 0);
+  CHECK_EQ(r.write(b, 1), 0);
+
+  // Reading frees the front, which is where the next reservation starts
+  CHECK_EQ(r.read(b, 50), 50);
+  for (int i = 0; i < 50; i++) CHECK_EQ(b[i], pattern(i));
+  CHECK_EQ(r.reserve(s1, s2), 50);
+  CHECK_EQ(s1.len, 50);
+  CHECK_EQ(s2.len, 0);
+  for (int i = 0; i < 50; i++) s1.ptr[i] = pattern(64 + i);
+  r.commit(50);
+
+  // Unread data 50..113 lies in two spans
+  CHECK_EQ(r.peek(s1, s2), 64);
+  CHECK_EQ(s1.len, 14);
+  CHECK_EQ(s2.len, 50);
+  for (size_t i = 0; i < s1.len; i++) CHECK_EQ(s1.ptr[i], pattern(50 + i));
+  for (size_t i = 0; i < s2.len; i++) CHECK_EQ(s2.ptr[i], pattern(64 + i));
+
+  // Cursors of their own, the oldest releases
+  uint32_t a = r.tail_pos() + 20, c = r.tail_pos() + 5;
+  CHECK_EQ(r.peek_at(a, s1, s2), 44);
+  CHECK_EQ((s1.len ? s1.ptr[0] : s2.ptr[0]), pattern(70));
+  CHECK_EQ(r.peek_at(c, a, s1, s2), 15);
+  r.release_to(c);
+  CHECK_EQ(r.available(), 59);
+  CHECK_EQ(r.space(), 5);
+  r.clear();
+  CHECK_EQ(r.available(), 0);
+  CHECK_EQ(r.space(), 64);
+}
+
+static void stream(void) {
+  static CSPSCRing<1024> r;
+  const uint32_t total = 16 << 20;
+  std::thread producer([&] {
+    std::mt19937 rng(1);
+    uint32_t n = 0;
+    while (n < total) {
+      TRingSpan s1, s2;
+      size_t l = std::min((size_t)(1 + rng() % 700), (size_t)(total - n));
+      if (rng() & 1) {
+        uint8_t b[700];
+        for (size_t i = 0; i < l; i++) b[i] = pattern(n + i);
+        l = r.write(b, l);
+      } else {
+        l = std::min(l, r.reserve(s1, s2));
+        for (size_t i = 0; i < l; i++) (i < s1.len ? s1.ptr[i] : s2.ptr[i - s1.len]) = pattern(n + i);
+        r.commit(l);
+      }
+      n += l;
+      // There may be a single CPU to share
+      if (l == 0) std::this_thread::yield();
+    }
+  });
+  std::mt19937 rng(2);
+  uint32_t n = 0;
+  while (n < total) {
+    TRingSpan s1, s2;
+    size_t l;
+    if (rng() & 1) {
+      uint8_t b[700];
+      l = r.read(b, 1 + rng() % 700);
+      for (size_t i = 0; i < l; i++) CHECK_EQ(b[i], pattern(n + i));
+    } else {
+      l = r.peek(s1, s2);
+      for (size_t i = 0; i < s1.len; i++) CHECK_EQ(s1.ptr[i], pattern(n + i));
+      for (size_t i = 0; i < s2.len; i++) CHECK_EQ(s2.ptr[i], pattern(n + s1.len + i));
+      r.consume(l);
+    }
+    n += l;
+    if (l == 0) std::this_thread::yield();
+  }
+  producer.join();
+  CHECK_EQ(r.available(), 0);
+}
+
+static void queue(void) {
+  static CSPSCQueue<uint32_t, 8> q;
+  uint32_t v;
+  CHECK(!q.front(v));
+  for (uint32_t i = 0; i < 8; i++) CHECK(q.push(i));
+  CHECK(!q.push(8));
+  CHECK(q.front(v) && v == 0);
+  q.pop();
+  CHECK(q.push(8));
+  for (uint32_t i = 1; i <= 8; i++) {
+    CHECK(q.front(v) && v == i);
+    q.pop();
+  }
+
+  const uint32_t total = 1 << 20;
+  std::thread producer([&] {
+    for (uint32_t i = 9; i < 9 + total;)
+      if (q.push(i)) i++;
+      else std::this_thread::yield();
+  });
+  for (uint32_t i = 9; i < 9 + total;) {
+    if (!q.front(v)) {
+      std::this_thread::yield();
+      continue;
+    }
+    CHECK_EQ(v, i);
+    q.pop();
+    i++;
+  }
+  producer.join();
+}
+
+int main() {
+  single();
+  stream();
+  queue();
+  printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+  uart_reconf_test
+
+  reconfigure() on UART1 in the middle of a stream that is read as it arrives: RX DMA
+  keeps running, so every byte comes through once and in order, none lost and none twice,
+  the switch is recorded at the RX byte offset reached when it happened, and what follows
+  arrives at the new character time.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <Arduino.h>
+#include <api/HardwareSerial.h>
+#include <sim/sim.h>
+#include "us_dma.h"
+#include "check.h"
+
+#define RXBUF 1024
+#define TOTAL 3000
+#define CHAR_US 87       // 10 bits at 115200bps
+#define CHAR_US_NEW 191  // 11 bits at 57600bps
+
+static CUartDMA u;
+static uint32_t rseq;  // next byte of the pattern expected
+
+static uint8_t pattern(uint32_t i) {
+  return i * 29 + 3;
+}
+
+// Takes everything that has arrived, returns how much that was
+static size_t drain(void) {
+  TUartSpan s[2];
+  size_t n = u.peek(s[0], s[1]);
+  for (const TUartSpan &p : s)
+    for (size_t i = 0; i < p.len; i++) CHECK_EQ(p.ptr[i], pattern(rseq++));
+  u.consume(n);
+  return n;
+}
+
+int main() {
+  sim_clock_manual(true);
+  sim_hw_step();
+  gpio_set_function(4, GPIO_FUNC_UART);
+  gpio_set_function(5, GPIO_FUNC_UART);
+  CHECK(u.begin(1, 115200, SERIAL_8N1, 256, RXBUF) != 0);
+
+  uint8_t b[TOTAL];
+  for (uint32_t i = 0; i < TOTAL; i++) b[i] = pattern(i);
+  sim_line_send(5, b, TOTAL);
+
+  // A third of the way in, with part of it read and part of it waiting in the ring
+  while (u.getRxStats().received < TOTAL / 3) {
+    sim_advance(20 * CHAR_US);
+    drain();
+  }
+  sim_advance(20 * CHAR_US);
+  CHECK(u.available() > 0);
+  uint64_t at = u.getRxStats().received;
+  CHECK(u.reconfigure(57600, SERIAL_8E1) > 0);
+  CHECK(u.getActualBaud() > 57000 && u.getActualBaud() < 58200);
+  const TUartReconf &r = u.getReconf();
+  CHECK_EQ(r.count, 1);
+  CHECK_EQ(r.rxpos, at);
+  CHECK_EQ(u.getRxCount() + u.available(), at);
+
+  // The rest comes at the new character time, 100 of them in the time of 100 and not 219
+  drain();
+  uint32_t from = rseq;
+  for (int i = 0; i < 5; i++) {
+    sim_advance(20 * CHAR_US_NEW);
+    drain();
+  }
+  CHECK(rseq - from >= 99 && rseq - from <= 101);
+  while (rseq < TOTAL) {
+    sim_advance(20 * CHAR_US_NEW);
+    CHECK(drain() <= 21);
+  }
+  CHECK_EQ(sim_line_pending(5), 0);
+  CHECK_EQ(u.available(), 0);
+
+  TUartRxStats st = u.getRxStats();
+  CHECK_EQ(st.received, TOTAL);
+  CHECK_EQ(st.consumed, TOTAL);
+  CHECK_EQ(st.lost, 0);
+  CHECK_EQ(st.overruns, 0);
+  CHECK_EQ(u.takeLineErrors(), 0);
+  printf("ok, switched at byte %llu of %u\n", (unsigned long long)r.rxpos, TOTAL);
+  return 0;
+}
@@ -0,0 +1,205 @@
+/*
+  uart_rx_test
+
+  The RX side of CUartDMA on UART1: peek() hands out the unread part of the ring as one or
+  two spans, consume() releases it, readBytes() and read() copy out of the same spans,
+  and the ring keeps going over many laps of DMA.
+  When DMA laps the reader, with its IRQ held off throughout as a flash write from the
+  other core would, the reader goes on from the oldest byte still in the ring and exactly
+  the overwritten bytes are counted lost, also when they were overwritten while peek()
+  had handed them out.
+  Ends with the rate of draining a full ring into a buffer a byte at a time with pop(), as
+  the bridge did before, and with peek() and consume(). Both read the DMA position through
+  the simulated registers, which costs more than on the Pico, so the ratio is what counts.
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <string.h>
+#include <chrono>
+#include <Arduino.h>
+#include <api/HardwareSerial.h>
+#include <sim/sim.h>
+#include "us_dma.h"
+#include "check.h"
+
+#define RXBUF 256
+#define CHAR_US 87
+
+// pop() is for the class itself, the rate test calls it from outside
+class CUartPop : public CUartDMA {
+public:
+  using CUartBase::pop;
+};
+
+static CUartPop u;
+static uint32_t seq;  // next byte of the pattern sent
+static uint32_t rseq; // next byte of the pattern expected
+
+static uint8_t pattern(uint32_t i) {
+  return i * 29 + 3;
+}
+
+static void send(size_t n) {
+  uint8_t b[4096];
+  for (size_t i = 0; i < n; i++) b[i] = pattern(seq++);
+  sim_line_send(5, b, n);
+}
+
+// Time for everything sent to arrive
+static void arrive(void) {
+  sim_advance((sim_line_pending(5) + 1) * CHAR_US);
+  CHECK_EQ(sim_line_pending(5), 0);
+}
+
+static void expect(const uint8_t *p, size_t n) {
+  for (size_t i = 0; i < n; i++) CHECK_EQ(p[i], pattern(rseq++));
+}
+
+int main() {
+  sim_clock_manual(true);
+  sim_hw_step();
+  gpio_set_function(4, GPIO_FUNC_UART);
+  gpio_set_function(5, GPIO_FUNC_UART);
+  CHECK(u.begin(1, 115200, SERIAL_8N1, 256, RXBUF) != 0);
+  CHECK_EQ(u.getRxBufferSize(), RXBUF);
+
+  TUartSpan s1, s2;
+  CHECK_EQ(u.available(), 0);
+  CHECK_EQ(u.peek(s1, s2), 0);
+  CHECK_EQ(s1.len + s2.len, 0);
+
+  // One span while the data does not cross the end of the ring
+  send(100);
+  arrive();
+  CHECK_EQ(u.available(), 100);
+  CHECK_EQ(u.peek(s1, s2), 100);
+  CHECK_EQ(s1.len, 100);
+  CHECK_EQ(s2.len, 0);
+  expect(s1.ptr, 40);
+  u.consume(40);
+  CHECK_EQ(u.getRxCount(), 40);
+  CHECK_EQ(u.peek(s1, s2), 60);
+  expect(s1.ptr, 60);
+  u.consume(60);
+
+  // Two spans across it, the second starting at the beginning of the ring
+  send(200);
+  arrive();
+  CHECK_EQ(u.peek(s1, s2), 200);
+  CHECK_EQ(s1.len, RXBUF - 100);
+  CHECK_EQ(s2.len, 200 - (RXBUF - 100));
+  expect(s1.ptr, s1.len);
+  expect(s2.ptr, s2.len);
+  u.consume(200);
+  CHECK_EQ(u.available(), 0);
+
+  // readBytes() waits for what has not arrived yet, read() takes single bytes
+  uint8_t b[1024];
+  send(120);
+  CHECK_EQ(u.readBytes(b, 120), 120);
+  expect(b, 120);
+  send(3);
+  for (int i = 0; i < 3; i++) {
+    int c = u.read();
+    CHECK(c >= 0);
+    uint8_t ch = c;
+    expect(&ch, 1);
+  }
+
+  // Many laps, taken in pieces of every size
+  for (int i = 0; i < 200; i++) {
+    send(1 + (i * 31) % 200);
+    arrive();
+    size_t n = u.peek(s1, s2);
+    CHECK_EQ(n, 1 + (i * 31) % 200);
+    expect(s1.ptr, s1.len);
+    expect(s2.ptr, s2.len);
+    u.consume(n);
+  }
+  TUartRxStats st = u.getRxStats();
+  CHECK_EQ(st.received, seq);
+  CHECK_EQ(st.consumed, seq);
+  CHECK_EQ(st.overruns, 0);
+  CHECK_EQ(u.takeLineErrors(), 0);
+
+  // Nothing read and no IRQ taken while 700 bytes arrive, almost three laps
+  uint32_t lost = 0;
+  noInterrupts();
+  send(700);
+  arrive();
+  CHECK_EQ(u.peek(s1, s2), RXBUF);
+  interrupts();
+  lost += 700 - RXBUF;
+  rseq = seq - RXBUF;
+  expect(s1.ptr, s1.len);
+  expect(s2.ptr, s2.len);
+  u.consume(RXBUF);
+  st = u.getRxStats();
+  CHECK_EQ(st.received, seq);
+  CHECK_EQ(st.overruns, 1);
+  CHECK_EQ(st.lost, lost);
+  CHECK_EQ(st.consumed, seq - lost);
+  CHECK_EQ(u.getRxCount(), seq);
+  CHECK(u.takeLineErrors() & CUartBase::LINE_RING_OVERRUN);
+
+  // 300 more arrive while 100 handed out are in use: 144 of those were overwritten,
+  // the other 56 came through, and the reader goes on from the oldest byte left
+  send(100);
+  arrive();
+  CHECK_EQ(u.peek(s1, s2), 100);
+  expect(s1.ptr, s1.len);
+  expect(s2.ptr, s2.len);
+  send(300);
+  arrive();
+  u.consume(100);
+  lost += 400 - RXBUF;
+  st = u.getRxStats();
+  CHECK_EQ(st.overruns, 2);
+  CHECK_EQ(st.lost, lost);
+  CHECK_EQ(st.consumed, seq - RXBUF - lost);
+  CHECK_EQ(u.peek(s1, s2), RXBUF);
+  rseq = seq - RXBUF;
+  expect(s1.ptr, s1.len);
+  expect(s2.ptr, s2.len);
+  u.consume(RXBUF);
+  st = u.getRxStats();
+  CHECK_EQ(st.received, seq);
+  CHECK_EQ(st.consumed, seq - lost);
+  CHECK_EQ(u.available(), 0);
+
+  // and goes on as before
+  send(50);
+  CHECK_EQ(u.readBytes(b, 50), 50);
+  expect(b, 50);
+  st = u.getRxStats();
+  CHECK_EQ(st.overruns, 2);
+  CHECK_EQ(st.received, st.consumed + st.lost);
+
+  // Rates, a full ring at a time
+  const int rounds = 2000;
+  double sec[2] = {};
+  for (int r = 0; r < rounds; r++)
+    for (int way = 0; way < 2; way++) {
+      send(RXBUF);
+      arrive();
+      auto t0 = std::chrono::steady_clock::now();
+      size_t n = 0;
+      if (way == 0) {
+        uint8_t c;
+        while (u.pop(&c)) b[n++] = c;
+      } else {
+        n = u.peek(s1, s2);
+        memcpy(b, s1.ptr, s1.len);
+        memcpy(&b[s1.len], s2.ptr, s2.len);
+        u.consume(n);
+      }
+      sec[way] += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      CHECK_EQ(n, RXBUF);
+      expect(b, n);
+    }
+  printf("ok, %u bytes, %u lost, draining the ring %.1f MB/s with pop(), %.1f MB/s with peek()\n", seq, lost,
+         rounds * RXBUF / sec[0] / 1e6, rounds * RXBUF / sec[1] / 1e6);
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+  capdump
+
+  Prints the traffic capture stream of PicoMultiBridge (port+2) one run per line.
+    nc pico 25 | capdump
+    capdump capture.bin
+  Built on the host, e.g. g++ -std=c++17 -I../PicoMultiBridge -o capdump capdump.cpp
+
+  SPDX-License-Identifier: MIT
+  SPDX-FileCopyrightText: (C) 2026 mukyokyo
+*/
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "capture.hpp"
+
+static CCaptureParser parser;
+
+static void print_record(const TCaptureRecord &r, const uint8_t *p, void *any) {
+  static uint64_t prev = 0;
+  const char *flag_s[] = { "framing", "parity", "break", "fifo-overrun", "ring-overrun" };
+
+  if (r.type == CCapture::LOST) {
+    printf("%12.6f port %d      lost %" PRIu32 " bytes\n", r.time / 1e6, r.port, (uint32_t)(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24));
+    return;
+  }
+  printf("%12.6f +%-9" PRIu64 " port %d %s %5u ", r.time / 1e6, (prev != 0) ? r.time - prev : 0, r.port, (r.type == CCapture::RX) ? "RX" : (r.type == CCapture::TX) ? "TX" : "??", r.len);
+  prev = r.time;
+  for (int i = 0; i < 5; i++)
+    if (r.flags & (1 << i)) printf("[%s] ", flag_s[i]);
+  for (int i = 0; i < r.len; i++) printf("%02x", p[i]);
+  printf("  |");
+  for (int i = 0; i < r.len; i++) putchar((p[i] >= 0x20 && p[i] < 0x7f) ? p[i] : '.');
+  printf("|\n");
+}
+
+int main(int argc, char **argv) {
+  FILE *f = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+  uint8_t buf[4096];
+  size_t n;
+
+  if (f == NULL) {
+    perror(argv[1]);
+    return 1;
+  }
+  parser.begin(print_record, NULL);
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    parser.feed(buf, n);
+    fflush(stdout);
+    if (parser.bad) {
+      fprintf(stderr, "not a capture stream of a known version\n");
+      return 1;
+    }
+  }
+  return 0;
+}